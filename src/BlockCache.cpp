@@ -0,0 +1,98 @@
+#include "BlockCache.h"
+
+#include "ExternalSequence.h"
+
+#include <QMutexLocker>
+
+BlockCache::BlockCache() = default;
+
+BlockCache::~BlockCache()
+{
+    clear();
+}
+
+void BlockCache::reset(const std::shared_ptr<ExternalSequence>& seq, std::size_t budgetBytes)
+{
+    clear();
+    QMutexLocker lock(&m_mutex);
+    m_seq = seq;
+    m_budgetBytes = budgetBytes;
+}
+
+void BlockCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_freeBlocks.clear();
+    m_slabs.clear();
+    m_lru.clear();
+    m_residentBytes = 0;
+    m_seq.reset();
+}
+
+SeqBlock* BlockCache::block(int index)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(index);
+    if (it != m_entries.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it->lruPos);
+        return it->block;
+    }
+    if (!m_seq || index < 0 || index >= m_seq->GetNumberOfBlocks())
+        return nullptr;
+
+    SeqBlock* blk = acquireBlock();
+    m_seq->GetBlock(index, blk);
+    if (!m_seq->decodeBlock(blk))
+    {
+        blk->free();
+        m_freeBlocks.push_back(blk);
+        return nullptr;
+    }
+
+    m_lru.push_front(index);
+    Entry entry;
+    entry.block = blk;
+    entry.bytes = approximateBytes(blk);
+    entry.lruPos = m_lru.begin();
+    m_entries.insert(index, entry);
+    m_residentBytes += entry.bytes;
+    evictToBudget();
+    return blk;
+}
+
+std::size_t BlockCache::approximateBytes(SeqBlock* blk)
+{
+    // Shapes are shared through the sequence's decoded-shape store and not charged here
+    return sizeof(SeqBlock)
+         + (blk->GetLabelSetEvents().capacity() + blk->GetLabelIncEvents().capacity()) * sizeof(LabelEvent);
+}
+
+void BlockCache::evictToBudget()
+{
+    while (m_residentBytes > m_budgetBytes && m_entries.size() > kMinResidentBlocks)
+    {
+        const int victim = m_lru.back();
+        m_lru.pop_back();
+        auto it = m_entries.find(victim);
+        m_residentBytes -= it->bytes;
+        it->block->free();
+        m_freeBlocks.push_back(it->block);
+        m_entries.erase(it);
+    }
+}
+
+SeqBlock* BlockCache::acquireBlock()
+{
+    if (m_freeBlocks.empty())
+    {
+        m_slabs.emplace_back(new SeqBlock[kSlabBlocks]);
+        SeqBlock* slab = m_slabs.back().get();
+        for (int i = kSlabBlocks - 1; i >= 0; --i)
+            m_freeBlocks.push_back(slab + i);
+    }
+    SeqBlock* blk = m_freeBlocks.back();
+    m_freeBlocks.pop_back();
+    return blk;
+}
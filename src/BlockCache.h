@@ -0,0 +1,105 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <vector>
+
+class SeqBlock;
+class ExternalSequence;
+
+// Bounded LRU cache of decoded blocks for the lazy (on-demand) decoding mode.
+// Blocks are built with GetBlock()+decodeBlock() on first access and dropped again,
+// least recently used first, once the resident size exceeds the budget. The decoded
+// shapes themselves live in the sequence's shared shape store, so a block only costs
+// its event headers and label lists. Block objects come from slabs owned by the cache and
+// evicted ones are refilled in place, so a miss does not allocate once the cache is warm.
+class BlockCache
+{
+public:
+    BlockCache();
+    ~BlockCache();
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    void reset(const std::shared_ptr<ExternalSequence>& seq, std::size_t budgetBytes);
+    void clear();
+
+    // Decoded block at 'index' or nullptr if it cannot be decoded. The pointer stays valid
+    // at least until kMinResidentBlocks other blocks have been requested.
+    SeqBlock* block(int index);
+
+    std::size_t budgetBytes() const { return m_budgetBytes; }
+    std::size_t residentBytes() const { return m_residentBytes; }
+    int residentBlocks() const { return static_cast<int>(m_entries.size()); }
+
+    static constexpr int kMinResidentBlocks = 256;
+
+private:
+    struct Entry
+    {
+        SeqBlock* block {nullptr};
+        std::size_t bytes {0};
+        std::list<int>::iterator lruPos;
+    };
+
+    static std::size_t approximateBytes(SeqBlock* blk);
+    void evictToBudget();
+    SeqBlock* acquireBlock();
+
+    static constexpr int kSlabBlocks = 256;
+
+    std::shared_ptr<ExternalSequence> m_seq;
+    std::size_t m_budgetBytes {0};
+    std::size_t m_residentBytes {0};
+    std::list<int> m_lru; // front = most recently used
+    QHash<int, Entry> m_entries;
+    std::vector<std::unique_ptr<SeqBlock[]>> m_slabs;
+    std::vector<SeqBlock*> m_freeBlocks; // unused slab entries
+    QMutex m_mutex;
+};
+
+// Read-only, index-based view of the sequence blocks. Either wraps the fully decoded
+// block vector (eager mode) or forwards to a BlockCache (lazy mode), so consumers can
+// keep writing blocks[i] / blocks.size() without caring which mode is active.
+class BlockSource
+{
+public:
+    BlockSource() = default;
+    BlockSource(const std::vector<SeqBlock*>& blocks)
+        : m_blocks(&blocks), m_count(static_cast<int>(blocks.size())) {}
+    BlockSource(BlockCache* cache, int count)
+        : m_cache(cache), m_count(cache ? count : 0) {}
+
+    int size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    bool isLazy() const { return m_cache != nullptr; }
+    SeqBlock* operator[](int index) const
+    {
+        return m_blocks ? (*m_blocks)[index] : m_cache->block(index);
+    }
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const BlockSource* src, int index) : m_src(src), m_index(index) {}
+        SeqBlock* operator*() const { return (*m_src)[m_index]; }
+        const_iterator& operator++() { ++m_index; return *this; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+    private:
+        const BlockSource* m_src;
+        int m_index;
+    };
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_count); }
+
+private:
+    const std::vector<SeqBlock*>* m_blocks {nullptr};
+    BlockCache* m_cache {nullptr};
+    int m_count {0};
+};
+
+#endif // BLOCKCACHE_H
@@ -0,0 +1,111 @@
+#include "BlockTable.h"
+
+#include "ExternalSequence.h"
+
+#include <algorithm>
+
+void BlockTable::clear()
+{
+    rf = RfColumns();
+    for (GradColumns& g : grad) g = GradColumns();
+    adc = AdcColumns();
+    m_blockCount = 0;
+}
+
+void BlockTable::append(int blockIndex, SeqBlock* blk)
+{
+    m_blockCount = std::max(m_blockCount, blockIndex + 1);
+    if (!blk) return;
+
+    if (blk->isRF())
+    {
+        const RFEvent& ev = blk->GetRFEvent();
+        rf.block.push_back(blockIndex);
+        rf.amplitude.push_back(ev.amplitude);
+        rf.freqOffset.push_back(ev.freqOffset);
+        rf.phaseOffset.push_back(ev.phaseOffset);
+        rf.freqPPM.push_back(ev.freqPPM);
+        rf.phasePPM.push_back(ev.phasePPM);
+        rf.center.push_back(ev.center);
+        rf.delay.push_back(ev.delay);
+        rf.use.push_back(ev.use);
+        rf.magShape.push_back(ev.magShape);
+        rf.phaseShape.push_back(ev.phaseShape);
+        rf.timeShape.push_back(ev.timeShape);
+        rf.length.push_back(blk->GetRFLength());
+        rf.dwell.push_back(blk->GetRFDwellTime());
+        rf.ampSamples.push_back(blk->GetRFAmplitudePtr());
+        rf.phaseSamples.push_back(blk->GetRFPhasePtr());
+        rf.sampleSum.push_back((rf.sampleSum.empty() ? 0 : rf.sampleSum.back()) + std::max(0, rf.length.back()));
+    }
+
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        const bool trap = blk->isTrapGradient(ch);
+        const bool arb = !trap && blk->isArbitraryGradient(ch);
+        const bool extTrap = !trap && !arb && blk->isExtTrapGradient(ch);
+        if (!trap && !arb && !extTrap) continue;
+
+        const GradEvent& ev = blk->GetGradEvent(ch);
+        GradColumns& g = grad[ch];
+        g.block.push_back(blockIndex);
+        g.kind.push_back(trap ? GradTrap : (arb ? GradArbitrary : GradExtTrap));
+        g.amplitude.push_back(ev.amplitude);
+        g.delay.push_back(ev.delay);
+        g.rampUp.push_back(static_cast<int>(ev.rampUpTime));
+        g.flat.push_back(static_cast<int>(ev.flatTime));
+        g.rampDown.push_back(static_cast<int>(ev.rampDownTime));
+        g.waveShape.push_back(ev.waveShape);
+        g.timeShape.push_back(ev.timeShape);
+        if (arb)
+        {
+            g.numPoints.push_back(blk->GetArbGradNumSamples(ch));
+            g.values.push_back(blk->GetArbGradShapePtr(ch));
+            g.timesUs.push_back(nullptr);
+        }
+        else if (extTrap)
+        {
+            const std::vector<long>& times = blk->GetExtTrapGradTimes(ch);
+            const std::vector<float>& shape = blk->GetExtTrapGradShape(ch);
+            const bool valid = !times.empty() && times.size() == shape.size();
+            g.numPoints.push_back(valid ? static_cast<int>(times.size()) : 0);
+            g.values.push_back(valid ? shape.data() : nullptr);
+            g.timesUs.push_back(valid ? times.data() : nullptr);
+        }
+        else
+        {
+            g.numPoints.push_back(0);
+            g.values.push_back(nullptr);
+            g.timesUs.push_back(nullptr);
+        }
+        const long long points = trap ? 4 : std::max(0, g.numPoints.back());
+        g.sampleSum.push_back((g.sampleSum.empty() ? 0 : g.sampleSum.back()) + points);
+    }
+
+    if (blk->isADC())
+    {
+        const ADCEvent& ev = blk->GetADCEvent();
+        adc.block.push_back(blockIndex);
+        adc.numSamples.push_back(ev.numSamples);
+        adc.dwellNs.push_back(ev.dwellTime);
+        adc.delay.push_back(ev.delay);
+        adc.freqOffset.push_back(ev.freqOffset);
+        adc.phaseOffset.push_back(ev.phaseOffset);
+        adc.freqPPM.push_back(ev.freqPPM);
+        adc.phasePPM.push_back(ev.phasePPM);
+        adc.sampleSum.push_back((adc.sampleSum.empty() ? 0 : adc.sampleSum.back()) + std::max(0, ev.numSamples));
+    }
+}
+
+long long BlockTable::samplesInRows(const std::vector<long long>& sampleSum, int first, int last)
+{
+    if (first > last || last < 0 || last >= static_cast<int>(sampleSum.size())) return 0;
+    return sampleSum[last] - (first > 0 ? sampleSum[first - 1] : 0);
+}
+
+int BlockTable::findRow(const std::vector<int>& blocks, int block)
+{
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), block);
+    if (it == blocks.end() || *it != block) return -1;
+    return static_cast<int>(it - blocks.begin());
+}
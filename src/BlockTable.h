@@ -0,0 +1,103 @@
+#ifndef BLOCKTABLE_H
+#define BLOCKTABLE_H
+
+#include <cstdint>
+#include <vector>
+
+class SeqBlock;
+
+// Struct-of-arrays copy of the event scalars of every block, built once at load while the
+// decoded blocks stream past. Each channel holds one row per block that carries an event on
+// it, in block order, so row r of a channel is entry r of the loader's per-channel event
+// index. Viewport, sampling and trajectory paths read these columns instead of chasing
+// SeqBlock pointers (or decoding blocks through the lazy cache).
+// Times are sequence microseconds, independent of the display time unit. Sample pointers
+// point into the sequence's shared shape store and stay valid until the sequence is reset.
+class BlockTable
+{
+public:
+    enum GradKind : std::uint8_t { GradTrap = 0, GradArbitrary, GradExtTrap };
+
+    struct RfColumns
+    {
+        std::vector<int> block;
+        std::vector<float> amplitude;   // Hz
+        std::vector<float> freqOffset;  // Hz
+        std::vector<float> phaseOffset; // rad
+        std::vector<float> freqPPM;
+        std::vector<float> phasePPM;
+        std::vector<float> center;      // us from the shape start, < 0 when undefined
+        std::vector<int> delay;         // us
+        std::vector<char> use;
+        std::vector<int> magShape;
+        std::vector<int> phaseShape;
+        std::vector<int> timeShape;
+        std::vector<int> length;        // samples
+        std::vector<float> dwell;       // us
+        std::vector<const float*> ampSamples;
+        std::vector<const float*> phaseSamples;
+        std::vector<long long> sampleSum; // samples in rows 0..r
+        int size() const { return static_cast<int>(block.size()); }
+    };
+
+    struct GradColumns
+    {
+        std::vector<int> block;
+        std::vector<std::uint8_t> kind; // GradKind
+        std::vector<float> amplitude;   // Hz/m
+        std::vector<int> delay;         // us
+        // Trapezoid timing (us)
+        std::vector<int> rampUp;
+        std::vector<int> flat;
+        std::vector<int> rampDown;
+        std::vector<int> waveShape;
+        std::vector<int> timeShape;
+        // Arbitrary: shape samples on the gradient raster. ExtTrap: amplitudes at timesUs.
+        std::vector<int> numPoints;
+        std::vector<const float*> values;
+        std::vector<const long*> timesUs;
+        std::vector<long long> sampleSum; // points in rows 0..r (4 per trapezoid)
+        int size() const { return static_cast<int>(block.size()); }
+    };
+
+    struct AdcColumns
+    {
+        std::vector<int> block;
+        std::vector<int> numSamples;
+        std::vector<int> dwellNs;
+        std::vector<int> delay;         // us
+        std::vector<float> freqOffset;  // Hz
+        std::vector<float> phaseOffset; // rad
+        std::vector<float> freqPPM;
+        std::vector<float> phasePPM;
+        std::vector<long long> sampleSum; // samples in rows 0..r
+        int size() const { return static_cast<int>(block.size()); }
+    };
+
+    void clear();
+    // Adds the events of decoded block 'blockIndex'. Blocks must arrive in increasing index
+    // order; a null block only counts towards blockCount().
+    void append(int blockIndex, SeqBlock* blk);
+
+    int blockCount() const { return m_blockCount; }
+    bool empty() const { return m_blockCount == 0; }
+
+    // Row of 'block' on a channel, or -1 if the block carries no such event (binary search)
+    int rfRow(int block) const { return findRow(rf.block, block); }
+    int gradRow(int channel, int block) const { return findRow(grad[channel].block, block); }
+    int adcRow(int block) const { return findRow(adc.block, block); }
+    // Samples in rows [first, last] of a channel, from its sampleSum column (O(1), so viewport
+    // decimation can gate on the visible sample count without walking the rows)
+    static long long samplesInRows(const std::vector<long long>& sampleSum, int first, int last);
+
+    RfColumns rf;
+    GradColumns grad[3];
+    AdcColumns adc;
+
+private:
+    static int findRow(const std::vector<int>& blocks, int block);
+
+    int m_blockCount {0};
+};
+
+#endif // BLOCKTABLE_H
@@ -0,0 +1,278 @@
+#include "DecimationKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DECIMATION_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DECIMATION_TARGET_AVX2
+#else
+#define DECIMATION_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace DecimationKernels {
+
+namespace {
+
+const float kInf = std::numeric_limits<float>::infinity();
+
+// Scalar loops, also the tails of the vector variants; maxArea/maxIndex carry the best so far
+int maxTriangleAreaScalar(const float* src, int begin, int end, double tStart, double dt,
+                          double ax, double ay, double cx, double cy, double maxArea, int maxIndex)
+{
+    for (int i = begin; i < end; ++i) {
+        double bx = tStart + i*dt; double by = double(src[i]);
+        double area = std::abs((ax - cx)*(by - ay) - (ax - bx)*(cy - ay));
+        if (area > maxArea) { maxArea = area; maxIndex = i; }
+    }
+    return maxIndex;
+}
+
+void argMinMaxScalar(const float* src, int begin, int end, int& iMin, int& iMax)
+{
+    float mn = kInf; float mx = -kInf;
+    iMin = begin; iMax = begin;
+    for (int i = begin; i < end; ++i) {
+        float v = src[i];
+        if (std::isnan(v)) continue;
+        if (v < mn) { mn = v; iMin = i; }
+        if (v > mx) { mx = v; iMax = i; }
+    }
+}
+
+#ifdef DECIMATION_X86_64
+
+int lowestSetBit(unsigned mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Per-lane bests reduced to the largest area, lowest index on ties, so the result matches the
+// scalar scan (strict >, ascending) over the same range
+void reduceLanes(const double* areas, const double* indices, int lanes, double& maxArea, int& maxIndex)
+{
+    for (int l = 0; l < lanes; ++l) {
+        const int index = int(indices[l]);
+        if (areas[l] > maxArea || (areas[l] == maxArea && index < maxIndex)) {
+            maxArea = areas[l];
+            maxIndex = index;
+        }
+    }
+}
+
+int maxTriangleAreaSse2(const float* src, int begin, int end, double tStart, double dt,
+                        double ax, double ay, double cx, double cy)
+{
+    const __m128d vT0 = _mm_set1_pd(tStart), vDt = _mm_set1_pd(dt);
+    const __m128d vAx = _mm_set1_pd(ax), vAy = _mm_set1_pd(ay);
+    const __m128d vAxCx = _mm_set1_pd(ax - cx), vCyAy = _mm_set1_pd(cy - ay);
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    const __m128d step = _mm_set1_pd(2.0);
+    __m128d bestArea = _mm_set1_pd(-1.0);
+    __m128d bestIdx = _mm_set1_pd(double(begin));
+    __m128d idx = _mm_setr_pd(double(begin), double(begin) + 1.0);
+    int i = begin;
+    for (; i + 2 <= end; i += 2) {
+        const __m128d bx = _mm_add_pd(vT0, _mm_mul_pd(idx, vDt));
+        const __m128d by = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))));
+        const __m128d area = _mm_and_pd(absMask, _mm_sub_pd(_mm_mul_pd(vAxCx, _mm_sub_pd(by, vAy)),
+                                                            _mm_mul_pd(_mm_sub_pd(vAx, bx), vCyAy)));
+        const __m128d gt = _mm_cmpgt_pd(area, bestArea); // false for NaN, like the scalar '>'
+        bestArea = _mm_or_pd(_mm_and_pd(gt, area), _mm_andnot_pd(gt, bestArea));
+        bestIdx = _mm_or_pd(_mm_and_pd(gt, idx), _mm_andnot_pd(gt, bestIdx));
+        idx = _mm_add_pd(idx, step);
+    }
+    double areas[2], indices[2];
+    _mm_storeu_pd(areas, bestArea);
+    _mm_storeu_pd(indices, bestIdx);
+    double maxArea = -1.0; int maxIndex = begin;
+    reduceLanes(areas, indices, 2, maxArea, maxIndex);
+    return maxTriangleAreaScalar(src, i, end, tStart, dt, ax, ay, cx, cy, maxArea, maxIndex);
+}
+
+DECIMATION_TARGET_AVX2
+int maxTriangleAreaAvx2(const float* src, int begin, int end, double tStart, double dt,
+                        double ax, double ay, double cx, double cy)
+{
+    const __m256d vT0 = _mm256_set1_pd(tStart), vDt = _mm256_set1_pd(dt);
+    const __m256d vAx = _mm256_set1_pd(ax), vAy = _mm256_set1_pd(ay);
+    const __m256d vAxCx = _mm256_set1_pd(ax - cx), vCyAy = _mm256_set1_pd(cy - ay);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d step = _mm256_set1_pd(4.0);
+    __m256d bestArea = _mm256_set1_pd(-1.0);
+    __m256d bestIdx = _mm256_set1_pd(double(begin));
+    __m256d idx = _mm256_setr_pd(double(begin), double(begin) + 1.0, double(begin) + 2.0, double(begin) + 3.0);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m256d bx = _mm256_add_pd(vT0, _mm256_mul_pd(idx, vDt));
+        const __m256d by = _mm256_cvtps_pd(_mm_loadu_ps(src + i));
+        const __m256d area = _mm256_and_pd(absMask, _mm256_sub_pd(_mm256_mul_pd(vAxCx, _mm256_sub_pd(by, vAy)),
+                                                                  _mm256_mul_pd(_mm256_sub_pd(vAx, bx), vCyAy)));
+        const __m256d gt = _mm256_cmp_pd(area, bestArea, _CMP_GT_OQ);
+        bestArea = _mm256_blendv_pd(bestArea, area, gt);
+        bestIdx = _mm256_blendv_pd(bestIdx, idx, gt);
+        idx = _mm256_add_pd(idx, step);
+    }
+    double areas[4], indices[4];
+    _mm256_storeu_pd(areas, bestArea);
+    _mm256_storeu_pd(indices, bestIdx);
+    double maxArea = -1.0; int maxIndex = begin;
+    reduceLanes(areas, indices, 4, maxArea, maxIndex);
+    return maxTriangleAreaScalar(src, i, end, tStart, dt, ax, ay, cx, cy, maxArea, maxIndex);
+}
+
+// Min/max take two passes: the extreme values (NaN lanes of the data leave the accumulators
+// alone, since MINPS/MAXPS return the second operand on NaN), then the first index holding each.
+void finishArgMinMax(const float* src, int begin, int end, float mn, float mx, int from,
+                     int& iMin, int& iMax, int (*firstEqual)(const float*, int, int, float))
+{
+    for (int i = from; i < end; ++i) {
+        const float v = src[i];
+        if (std::isnan(v)) continue;
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+    }
+    iMin = (mn < kInf) ? firstEqual(src, begin, end, mn) : begin;
+    iMax = (mx > -kInf) ? firstEqual(src, begin, end, mx) : begin;
+}
+
+int firstEqualSse2(const float* src, int begin, int end, float value)
+{
+    const __m128 target = _mm_set1_ps(value);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(src + i), target));
+        if (mask) return i + lowestSetBit(unsigned(mask));
+    }
+    for (; i < end; ++i)
+        if (src[i] == value) return i;
+    return begin;
+}
+
+void argMinMaxSse2(const float* src, int begin, int end, int& iMin, int& iMax)
+{
+    __m128 vMin = _mm_set1_ps(kInf), vMax = _mm_set1_ps(-kInf);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m128 v = _mm_loadu_ps(src + i);
+        vMin = _mm_min_ps(v, vMin);
+        vMax = _mm_max_ps(v, vMax);
+    }
+    float lanesMin[4], lanesMax[4];
+    _mm_storeu_ps(lanesMin, vMin);
+    _mm_storeu_ps(lanesMax, vMax);
+    const float mn = *std::min_element(lanesMin, lanesMin + 4);
+    const float mx = *std::max_element(lanesMax, lanesMax + 4);
+    finishArgMinMax(src, begin, end, mn, mx, i, iMin, iMax, firstEqualSse2);
+}
+
+DECIMATION_TARGET_AVX2
+int firstEqualAvx2(const float* src, int begin, int end, float value)
+{
+    const __m256 target = _mm256_set1_ps(value);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(src + i), target, _CMP_EQ_OQ));
+        if (mask) return i + lowestSetBit(unsigned(mask));
+    }
+    for (; i < end; ++i)
+        if (src[i] == value) return i;
+    return begin;
+}
+
+DECIMATION_TARGET_AVX2
+void argMinMaxAvx2(const float* src, int begin, int end, int& iMin, int& iMax)
+{
+    __m256 vMin = _mm256_set1_ps(kInf), vMax = _mm256_set1_ps(-kInf);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m256 v = _mm256_loadu_ps(src + i);
+        vMin = _mm256_min_ps(v, vMin);
+        vMax = _mm256_max_ps(v, vMax);
+    }
+    float lanesMin[8], lanesMax[8];
+    _mm256_storeu_ps(lanesMin, vMin);
+    _mm256_storeu_ps(lanesMax, vMax);
+    const float mn = *std::min_element(lanesMin, lanesMin + 8);
+    const float mx = *std::max_element(lanesMax, lanesMax + 8);
+    finishArgMinMax(src, begin, end, mn, mx, i, iMin, iMax, firstEqualAvx2);
+}
+
+#endif // DECIMATION_X86_64
+
+Isa detectIsa()
+{
+#ifdef DECIMATION_X86_64
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        const bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        if (osAvx && (info[1] & (1 << 5))) return IsaAvx2;
+    }
+    return IsaSse2; // x86-64 baseline
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? IsaAvx2 : IsaSse2;
+#endif
+#else
+    return IsaScalar;
+#endif
+}
+
+} // namespace
+
+Isa bestIsa()
+{
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+int maxTriangleArea(const float* src, int begin, int end, double tStart, double dt,
+                    double ax, double ay, double cx, double cy)
+{
+    return maxTriangleArea(bestIsa(), src, begin, end, tStart, dt, ax, ay, cx, cy);
+}
+
+int maxTriangleArea(Isa isa, const float* src, int begin, int end, double tStart, double dt,
+                    double ax, double ay, double cx, double cy)
+{
+    switch (std::min(isa, bestIsa())) {
+#ifdef DECIMATION_X86_64
+    case IsaAvx2: return maxTriangleAreaAvx2(src, begin, end, tStart, dt, ax, ay, cx, cy);
+    case IsaSse2: return maxTriangleAreaSse2(src, begin, end, tStart, dt, ax, ay, cx, cy);
+#endif
+    default: return maxTriangleAreaScalar(src, begin, end, tStart, dt, ax, ay, cx, cy, -1.0, begin);
+    }
+}
+
+void argMinMax(const float* src, int begin, int end, int& iMin, int& iMax)
+{
+    argMinMax(bestIsa(), src, begin, end, iMin, iMax);
+}
+
+void argMinMax(Isa isa, const float* src, int begin, int end, int& iMin, int& iMax)
+{
+    switch (std::min(isa, bestIsa())) {
+#ifdef DECIMATION_X86_64
+    case IsaAvx2: argMinMaxAvx2(src, begin, end, iMin, iMax); return;
+    case IsaSse2: argMinMaxSse2(src, begin, end, iMin, iMax); return;
+#endif
+    default: argMinMaxScalar(src, begin, end, iMin, iMax); return;
+    }
+}
+
+} // namespace DecimationKernels
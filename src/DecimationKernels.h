@@ -0,0 +1,31 @@
+#ifndef DECIMATIONKERNELS_H
+#define DECIMATIONKERNELS_H
+
+// Inner loops of viewport decimation over float shape samples, with SSE2 and AVX2 variants.
+// The widest variant the CPU supports is picked once, at first use. Every variant returns
+// the same index as the scalar loop: the arithmetic runs in the same order and the first
+// index wins ties (test/DecimationKernelsTest checks this).
+
+namespace DecimationKernels {
+
+enum Isa { IsaScalar = 0, IsaSse2, IsaAvx2 };
+
+// Widest variant compiled in and supported by this CPU
+Isa bestIsa();
+
+// LTTB triangle-area search: index in [begin, end) of the sample (tStart + i*dt, src[i]) that
+// spans the largest triangle with (ax, ay) and (cx, cy). Returns begin when the range is empty
+// or all areas are NaN.
+int maxTriangleArea(const float* src, int begin, int end, double tStart, double dt,
+                    double ax, double ay, double cx, double cy);
+int maxTriangleArea(Isa isa, const float* src, int begin, int end, double tStart, double dt,
+                    double ax, double ay, double cx, double cy);
+
+// First index of the smallest and of the largest non-NaN value in [begin, end). Either is
+// begin when no value is below +inf (above -inf).
+void argMinMax(const float* src, int begin, int end, int& iMin, int& iMax);
+void argMinMax(Isa isa, const float* src, int begin, int end, int& iMin, int& iMax);
+
+} // namespace DecimationKernels
+
+#endif // DECIMATIONKERNELS_H
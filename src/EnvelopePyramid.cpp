@@ -0,0 +1,158 @@
+#include "EnvelopePyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+const float kEmptyMin = std::numeric_limits<float>::infinity();
+const float kEmptyMax = -std::numeric_limits<float>::infinity();
+}
+
+void EnvelopePyramid::reset(double baseBinWidth, std::size_t maxBaseBins)
+{
+    clear();
+    if (!(baseBinWidth > 0.0) || !std::isfinite(baseBinWidth) || maxBaseBins < 2)
+        return;
+    Level base;
+    base.binWidth = baseBinWidth;
+    m_levels.push_back(base);
+    m_maxBaseBins = maxBaseBins;
+}
+
+void EnvelopePyramid::clear()
+{
+    m_levels.clear();
+    m_maxBaseBins = 0;
+    m_finalized = false;
+}
+
+void EnvelopePyramid::growBase(std::size_t bins)
+{
+    Level& base = m_levels.front();
+    if (base.vMin.size() >= bins) return;
+    base.vMin.resize(bins, kEmptyMin);
+    base.vMax.resize(bins, kEmptyMax);
+}
+
+void EnvelopePyramid::coarsenBase()
+{
+    Level& base = m_levels.front();
+    const std::size_t n = base.vMin.size();
+    const std::size_t half = (n + 1) / 2;
+    for (std::size_t i = 0; i < half; ++i)
+    {
+        const std::size_t a = 2 * i, b = std::min(2 * i + 1, n - 1);
+        base.vMin[i] = std::min(base.vMin[a], base.vMin[b]);
+        base.vMax[i] = std::max(base.vMax[a], base.vMax[b]);
+    }
+    base.vMin.resize(half);
+    base.vMax.resize(half);
+    base.binWidth *= 2.0;
+}
+
+void EnvelopePyramid::addSegment(double t0, double v0, double t1, double v1)
+{
+    if (m_levels.empty() || m_finalized) return;
+    if (std::isnan(v0) || std::isnan(v1) || !std::isfinite(t0) || !std::isfinite(t1)) return;
+    if (t1 < t0) { std::swap(t0, t1); std::swap(v0, v1); }
+    if (t1 < 0.0) return;
+
+    const double slope = (t1 > t0) ? (v1 - v0) / (t1 - t0) : 0.0;
+    const double tFrom = std::max(t0, 0.0);
+    auto binOf = [this](double t) { return static_cast<std::size_t>(t / m_levels.front().binWidth); };
+    while (binOf(t1) >= m_maxBaseBins)
+        coarsenBase();
+    const std::size_t lastBin = binOf(t1);
+    growBase(lastBin + 1);
+
+    Level& base = m_levels.front();
+    const double w = base.binWidth;
+    for (std::size_t b = binOf(tFrom); b <= lastBin; ++b)
+    {
+        // Linear piece clipped to this bin: its extremes sit at the clip points
+        const double ta = std::max(tFrom, b * w);
+        const double tb = std::min(t1, (b + 1) * w);
+        const double va = v0 + slope * (ta - t0);
+        const double vb = v0 + slope * (tb - t0);
+        base.vMin[b] = std::min(base.vMin[b], static_cast<float>(std::min(va, vb)));
+        base.vMax[b] = std::max(base.vMax[b], static_cast<float>(std::max(va, vb)));
+    }
+}
+
+void EnvelopePyramid::finalize()
+{
+    if (m_levels.empty() || m_finalized) return;
+    m_levels.resize(1);
+    while (m_levels.back().vMin.size() > 1)
+    {
+        const Level& fine = m_levels.back();
+        const std::size_t n = fine.vMin.size();
+        Level coarse;
+        coarse.binWidth = fine.binWidth * 2.0;
+        coarse.vMin.resize((n + 1) / 2);
+        coarse.vMax.resize((n + 1) / 2);
+        for (std::size_t i = 0; i < coarse.vMin.size(); ++i)
+        {
+            const std::size_t a = 2 * i, b = std::min(2 * i + 1, n - 1);
+            coarse.vMin[i] = std::min(fine.vMin[a], fine.vMin[b]);
+            coarse.vMax[i] = std::max(fine.vMax[a], fine.vMax[b]);
+        }
+        m_levels.push_back(std::move(coarse));
+    }
+    m_finalized = true;
+}
+
+void EnvelopePyramid::rescaleTime(double ratio)
+{
+    for (Level& level : m_levels)
+        level.binWidth *= ratio;
+}
+
+bool EnvelopePyramid::query(double visibleStart, double visibleEnd, int pixelWidth, bool breakOnGaps,
+                            QVector<double>& tOut, QVector<double>& vOut) const
+{
+    tOut.clear(); vOut.clear();
+    if (!isReady() || pixelWidth <= 0 || !(visibleEnd > visibleStart)) return false;
+
+    const double pixelSpan = (visibleEnd - visibleStart) / pixelWidth;
+    if (m_levels.front().binWidth > pixelSpan) return false;
+    std::size_t li = 0;
+    while (li + 1 < m_levels.size() && m_levels[li + 1].binWidth <= pixelSpan)
+        ++li;
+    const Level& level = m_levels[li];
+    const double w = level.binWidth;
+    const long long n = static_cast<long long>(level.vMin.size());
+    if (n == 0) return true;
+
+    const long long first = std::max(0LL, static_cast<long long>(std::floor(visibleStart / w)));
+    const long long last = std::min(n - 1, static_cast<long long>(std::floor(visibleEnd / w)));
+    if (first > last) return true;
+    tOut.reserve(int(2 * (last - first + 1)));
+    vOut.reserve(int(2 * (last - first + 1)));
+
+    bool gap = false;
+    for (long long b = first; b <= last; ++b)
+    {
+        const double lo = level.vMin[b];
+        const double hi = level.vMax[b];
+        if (lo > hi) { gap = !tOut.isEmpty(); continue; }
+        if (gap && breakOnGaps)
+        {
+            // Duplicate last x for the NaN break to keep x monotonic
+            tOut.append(tOut.last());
+            vOut.append(std::numeric_limits<double>::quiet_NaN());
+        }
+        gap = false;
+        if (lo == hi)
+        {
+            tOut.append((b + 0.5) * w); vOut.append(lo);
+            continue;
+        }
+        // Order the pair so the line continues from the side the previous column ended on
+        const bool highFirst = !vOut.isEmpty() && !std::isnan(vOut.last()) && vOut.last() > 0.5 * (lo + hi);
+        tOut.append((b + 0.25) * w); vOut.append(highFirst ? hi : lo);
+        tOut.append((b + 0.75) * w); vOut.append(highFirst ? lo : hi);
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef ENVELOPEPYRAMID_H
+#define ENVELOPEPYRAMID_H
+
+#include <QVector>
+#include <cstddef>
+#include <vector>
+
+// Multi-resolution min/max summary of one channel over absolute time (internal units).
+// Level 0 holds fixed-width bins fed with the piecewise-linear waveform while the blocks
+// stream past at load time; each further level merges pairs of bins of the level below.
+// A viewport is answered from the coarsest level that still gives at least one bin per
+// pixel, so the cost depends on the pixel width and not on the sequence length.
+class EnvelopePyramid
+{
+public:
+    // Starts a new summary. Bins double in width whenever level 0 would exceed maxBaseBins.
+    void reset(double baseBinWidth, std::size_t maxBaseBins);
+    void clear();
+
+    // Feed the waveform as linear pieces or single points
+    void addSegment(double t0, double v0, double t1, double v1);
+    void addPoint(double t, double v) { addSegment(t, v, t, v); }
+    // Builds the coarser levels; call once after the last segment
+    void finalize();
+
+    // Time axis changed scale (e.g. ms <-> us display units); bins keep their contents
+    void rescaleTime(double ratio);
+
+    bool isReady() const { return m_finalized && !m_levels.empty(); }
+    double baseBinWidth() const { return m_levels.empty() ? 0.0 : m_levels.front().binWidth; }
+
+    // Envelope of [visibleStart, visibleEnd] for a plot pixelWidth pixels wide. Returns false
+    // (leaving the outputs empty) when level 0 is too coarse for that resolution and the
+    // caller should render from the blocks instead. Bins without data are skipped; with
+    // breakOnGaps a NaN separator is emitted across them.
+    bool query(double visibleStart, double visibleEnd, int pixelWidth, bool breakOnGaps,
+               QVector<double>& tOut, QVector<double>& vOut) const;
+
+private:
+    struct Level
+    {
+        double binWidth {0.0};
+        std::vector<float> vMin; // +inf where the bin is empty
+        std::vector<float> vMax; // -inf where the bin is empty
+    };
+
+    void coarsenBase();
+    void growBase(std::size_t bins);
+
+    std::vector<Level> m_levels; // [0] = finest
+    std::size_t m_maxBaseBins {0};
+    bool m_finalized {false};
+};
+
+#endif // ENVELOPEPYRAMID_H
@@ -192,12 +192,15 @@ void ExtensionPlotter::rebuildCacheIfNeeded(PulseqLoader* loader)
         return;
 
     void* seqPtr = static_cast<void*>(seq);
-    const int blockCount = static_cast<int>(loader->getDecodedSeqBlocks().size());
-    if (seqPtr == m_lastSeqPtr && blockCount == m_lastBlockCount)
+    const BlockTable& table = loader->getBlockTable();
+    const int blockCount = table.blockCount();
+    const double tFactor = loader->getTFactor();
+    if (seqPtr == m_lastSeqPtr && blockCount == m_lastBlockCount && tFactor == m_lastTFactor)
         return;
 
     m_lastSeqPtr = seqPtr;
     m_lastBlockCount = blockCount;
+    m_lastTFactor = tFactor;
 
     // Clear caches
     for (auto it = m_cacheByName.begin(); it != m_cacheByName.end(); ++it)
@@ -212,12 +215,7 @@ void ExtensionPlotter::rebuildCacheIfNeeded(PulseqLoader* loader)
     if (edges.size() < 2)
         return;
 
-    // Track current label state (known IDs only; ignore unknown IDs >= NUM_LABELS/NUM_FLAGS).
-    QVector<int> counterVal(NUM_LABELS, 0);
-    QVector<bool> flagVal(NUM_FLAGS, false);
-
     auto specs = supportedSpecs();
-    // Initialize series with a starting point at time 0
     for (const Spec& s : specs)
     {
         SeriesCache& sc = m_cacheByName[s.name];
@@ -225,10 +223,7 @@ void ExtensionPlotter::rebuildCacheIfNeeded(PulseqLoader* loader)
         sc.used = false;
     }
 
-    auto appendPoint = [&](const Spec& s, double t, double newVal) {
-        SeriesCache& sc = m_cacheByName[s.name];
-        if (!sc.valid)
-            return;
+    auto appendPoint = [&](SeriesCache& sc, double t, double newVal) {
         // Avoid duplicate timestamps
         if (!sc.t.isEmpty() && sc.t.last() == t)
         {
@@ -239,94 +234,45 @@ void ExtensionPlotter::rebuildCacheIfNeeded(PulseqLoader* loader)
         sc.v.push_back(newVal);
     };
 
-    // Track whether each label ever appeared; only plot after it appeared at least once (SeqPlot.m's label_defined semantics).
-    QVector<bool> usedCounters(NUM_LABELS, false);
-    QVector<bool> usedFlags(NUM_FLAGS, false);
+    // Values are recorded ONLY at ADC events (SeqPlot.m behavior), at the ADC center:
+    // blockStart + adc.delay + (numSamples-1)/2*dwell
+    const BlockTable::AdcColumns& adc = table.adc;
+    const int nBlocks = std::min(blockCount, static_cast<int>(edges.size() - 1));
+    QVector<int> adcBlocks;
+    QVector<double> adcTimes;
+    adcBlocks.reserve(adc.size());
+    adcTimes.reserve(adc.size());
+    for (int r = 0; r < adc.size() && adc.block[r] < nBlocks; ++r)
+    {
+        const double tDelay = adc.delay[r] * tFactor;          // us -> internal
+        const double dt = adc.dwellNs[r] / 1000.0 * tFactor;   // ns -> internal
+        const double mid = (adc.numSamples[r] > 0 ? (adc.numSamples[r] - 1) * 0.5 * dt : 0.0);
+        adcBlocks.push_back(adc.block[r]);
+        adcTimes.push_back(edges[adc.block[r]] + tDelay + mid);
+    }
 
-    // Walk blocks, apply label events, and record values ONLY at ADC events (SeqPlot.m behavior).
-    const auto& blocks = loader->getDecodedSeqBlocks();
-    const int nBlocks = std::min(static_cast<int>(blocks.size()), static_cast<int>(edges.size() - 1));
-    for (int i = 0; i < nBlocks; ++i)
+    // Step each label's transitions alongside the ADC blocks. A label is only plotted after it
+    // appeared at least once (SeqPlot.m's label_defined semantics), i.e. from its first transition.
+    const PulseqLoader::LabelHistory& history = loader->getLabelHistory();
+    for (const Spec& s : specs)
     {
-        SeqBlock* blk = blocks[i];
-        if (!blk)
+        if (s.id < 0 || s.id >= (s.isFlag ? NUM_FLAGS : NUM_LABELS))
+            continue;
+        const auto& transitions = s.isFlag ? history.flags[s.id] : history.counters[s.id];
+        if (transitions.empty())
             continue;
 
-        // Apply labelset then labelinc (SeqPlot.m behavior)
-        if (blk->isLabel())
-        {
-            const auto& sets = blk->GetLabelSetEvents();
-            for (const auto& e : sets)
-            {
-                const int lblId = e.numVal.first;
-                const int val = e.numVal.second;
-                const int flagId = e.flagVal.first;
-                const bool fval = e.flagVal.second;
-
-                if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
-                {
-                    counterVal[lblId] = val;
-                    usedCounters[lblId] = true;
-                }
-                if (flagId >= 0 && flagId < NUM_FLAGS && flagId != FLAG_UNKNOWN)
-                {
-                    flagVal[flagId] = fval;
-                    usedFlags[flagId] = true;
-                }
-            }
-            const auto& incs = blk->GetLabelIncEvents();
-            for (const auto& e : incs)
-            {
-                const int lblId = e.numVal.first;
-                const int val = e.numVal.second;
-                if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
-                {
-                    counterVal[lblId] += val;
-                    usedCounters[lblId] = true;
-                }
-            }
-        }
-
-        if (blk->isADC())
+        SeriesCache& sc = m_cacheByName[s.name];
+        std::size_t next = 0;
+        int value = 0;
+        for (int k = 0; k < adcBlocks.size(); ++k)
         {
-            // ADC center time: blockStart + adc.delay + (numSamples-1)/2*dwell
-            const ADCEvent& adc = blk->GetADCEvent();
-            const double tStart = edges[i];
-            const double tDelay = adc.delay * loader->getTFactor(); // us -> internal
-            const double dwellUs = adc.dwellTime / 1000.0;          // ns -> us
-            const double dt = dwellUs * loader->getTFactor();
-            const double mid = (adc.numSamples > 0 ? (adc.numSamples - 1) * 0.5 * dt : 0.0);
-            const double tAdc = tStart + tDelay + mid;
-
-            for (const Spec& s : specs)
-            {
-                // Only plot labels/flags that have appeared at least once.
-                if (s.isFlag)
-                {
-                    if (s.id >= 0 && s.id < usedFlags.size() && !usedFlags[s.id])
-                        continue;
-                    m_cacheByName[s.name].used = true;
-                }
-                else
-                {
-                    if (s.id >= 0 && s.id < usedCounters.size() && !usedCounters[s.id])
-                        continue;
-                    m_cacheByName[s.name].used = true;
-                }
-
-                double v = 0.0;
-                if (s.isFlag)
-                {
-                    if (s.id >= 0 && s.id < NUM_FLAGS)
-                        v = flagVal[s.id] ? 1.0 : 0.0;
-                }
-                else
-                {
-                    if (s.id >= 0 && s.id < NUM_LABELS)
-                        v = static_cast<double>(counterVal[s.id]);
-                }
-                appendPoint(s, tAdc, v);
-            }
+            while (next < transitions.size() && transitions[next].block <= adcBlocks[k])
+                value = transitions[next++].value;
+            if (next == 0)
+                continue;
+            sc.used = true;
+            appendPoint(sc, adcTimes[k], static_cast<double>(value));
         }
     }
 }
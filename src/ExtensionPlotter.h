@@ -71,6 +71,7 @@ private:
     // Cache invalidation
     void* m_lastSeqPtr {nullptr};
     int m_lastBlockCount {0};
+    double m_lastTFactor {0.0}; // cached times are in internal units
 
     // Graphs (one per label/flag)
     QMap<QString, QCPGraph*> m_graphByName;
@@ -21,7 +21,8 @@ InteractionHandler notes:
    * In TR-Segmented mode, panning/zooming is effectively clamped by TRManager through WaveformDrawer,
      preventing accidental rendering of multi-TR spans that could degrade performance.
  - After each viewport change, WaveformDrawer::ensureRenderedForCurrentViewport() is invoked
-   to re-render only the visible content at the appropriate detail level.
+   to re-render only the visible content at the appropriate detail level. It prepares the
+   series off the GUI thread and returns immediately; the graphs update when the frame lands.
 */
 #include <QDragEnterEvent>
 #include <QDropEvent>
@@ -95,6 +96,8 @@ void InteractionHandler::dropEvent(QDropEvent* event)
         // Delegate to PulseqLoader
         if (!m_mainWindow->getPulseqLoader()->LoadPulseqFile(sPulseqFilePath))
         {
+            if (m_mainWindow->getPulseqLoader()->wasLastLoadCancelled())
+                return;
             std::stringstream sLog;
             sLog << "Load " << sPulseqFilePath.toStdString() << " failed!";
             QMessageBox::critical(m_mainWindow, "File Error", sLog.str().c_str());
@@ -232,25 +235,10 @@ void InteractionHandler::onMouseMove(QMouseEvent* event)
 	PulseqLoader* loader = m_mainWindow->getPulseqLoader();
 	if (!loader || loader->getDecodedSeqBlocks().empty()) return;
 
+	// Global search (not limited to the active block window) so whole-sequence mode
+	// keeps the status bar accurate instead of reporting -1.
 	const auto& edges = loader->getBlockEdges();
-	int start = loader->getBlockRangeStart();
-	int end = loader->getBlockRangeEnd();
-	int blockIdx = -1;
-	for (int i = start; i <= end && i + 1 < edges.size(); ++i)
-	{
-		if (xCoord >= edges[i] && xCoord < edges[i+1]) { blockIdx = i; break; }
-	}
-	// Whole-sequence mode can cover more than the active block window; fall back to
-	// a global search so the status bar stays accurate instead of reporting -1.
-	if (blockIdx < 0 && edges.size() > 1)
-	{
-		auto upper = std::upper_bound(edges.begin(), edges.end(), xCoord);
-		int candidate = static_cast<int>(upper - edges.begin()) - 1;
-		if (candidate >= 0 && candidate < loader->getDecodedSeqBlocks().size())
-		{
-			blockIdx = candidate;
-		}
-	}
+	int blockIdx = loader->findBlockAtTime(xCoord);
 
 	// Use mouse x position directly for the guide line to avoid snapping to sparse keys.
 	double guideX = xCoord;
@@ -284,18 +272,10 @@ void InteractionHandler::onMouseMove(QMouseEvent* event)
         {
             double fovMeters = 0.0;
             bool haveFov = false;
-            if (loader)
+            if (loader && loader->getSystemParameters().fovMeters > 0.0)
             {
-                auto seq = loader->getSequence();
-                if (seq)
-                {
-                    std::vector<double> def = seq->GetDefinition("FOV");
-                    if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0)
-                    {
-                        fovMeters = def[0];
-                        haveFov = true;
-                    }
-                }
+                fovMeters = loader->getSystemParameters().fovMeters;
+                haveFov = true;
             }
             if (haveFov)
             {
@@ -338,7 +318,11 @@ void InteractionHandler::onMouseMove(QMouseEvent* event)
             double kxVal = 0.0, kyVal = 0.0, kzVal = 0.0;
             auto fmt1 = [](double v){ return QString::number(v, 'f', 1); };
             QString kxStr = "--.-", kyStr = "--.-", kzStr = "--.-";
-            if (m_mainWindow && m_mainWindow->sampleTrajectoryAtInternalTime(guideX, kxVal, kyVal, kzVal))
+            if (loader->isTrajectoryComputing())
+            {
+                segKSpace = fixed(QString("kxyz=computing..."), W_KSPACE);
+            }
+            else if (m_mainWindow && m_mainWindow->sampleTrajectoryAtInternalTime(guideX, kxVal, kyVal, kzVal))
             {
                 kxVal *= trajScale;
                 kyVal *= trajScale;
@@ -347,7 +331,8 @@ void InteractionHandler::onMouseMove(QMouseEvent* event)
                 kyStr = fmt1(kyVal);
                 kzStr = fmt1(kzVal);
             }
-            segKSpace = fixed(QString("kxyz=%1,%2,%3 %4").arg(kxStr, kyStr, kzStr, trajUnitLabel), W_KSPACE);
+            if (segKSpace.isEmpty())
+                segKSpace = fixed(QString("kxyz=%1,%2,%3 %4").arg(kxStr, kyStr, kzStr, trajUnitLabel), W_KSPACE);
         }
 
         // RF amplitude/phase (1 decimal)
@@ -576,15 +561,7 @@ void InteractionHandler::showRawBlockData()
     PulseqLoader* loader = m_mainWindow->getPulseqLoader();
     if (!loader) return;
 
-    int currentBlock = -1;
-    const auto& edges = loader->getBlockEdges();
-    if (edges.size() > 1)
-    {
-        auto upper = std::upper_bound(edges.begin(), edges.end(), x);
-        int candidate = static_cast<int>(upper - edges.begin()) - 1;
-        if (candidate >= 0 && candidate < static_cast<int>(loader->getDecodedSeqBlocks().size()))
-            currentBlock = candidate;
-    }
+    int currentBlock = loader->findBlockAtTime(x);
     if (currentBlock < 0) return;
 
     if (!m_pBlockInfoDialog)
@@ -782,16 +759,7 @@ void InteractionHandler::showBlockInformation()
     if (found)
     {
         PulseqLoader* loader = m_mainWindow->getPulseqLoader();
-        int currentBlock = -1;
-        const auto& vecBlockEdges = loader->getBlockEdges();
-        for (int i = 0; i < vecBlockEdges.size() - 1; ++i)
-        {
-            if (closestX >= vecBlockEdges[i] && closestX < vecBlockEdges[i + 1])
-            {
-                currentBlock = i;
-                break;
-            }
-        }
+        int currentBlock = loader->findBlockAtTime(closestX);
 
         if (currentBlock != -1)
         {
@@ -930,7 +898,7 @@ void InteractionHandler::synchronizeXAxes(const QCPRange& newRange)
     {
         m_mainWindow->refreshTrajectoryPlotData();
     }
-    // No extra replot here; WaveformDrawer::ensureRenderedForCurrentViewport() already replots
+    // No extra replot here; WaveformDrawer replots once the prepared frame has been swapped in
     m_syncInProgress = false;
 }
 
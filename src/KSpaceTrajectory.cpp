@@ -9,7 +9,8 @@
 #include <limits>
 #include <numeric>
 #include <QtGlobal>
-#include "Settings.h"
+#include <QThread>
+#include <QThreadPool>
 #include <QDebug>
 
 namespace KSpaceTrajectory
@@ -24,19 +25,17 @@ namespace
         return microseconds * 1e-6;
     }
 
-    double rfCenterUs(SeqBlock* blk, const RFEvent& rf)
+    double rfCenterUs(const BlockTable::RfColumns& rf, int row)
     {
-        if (!blk)
-            return 0.0;
-        if (rf.center >= 0.0)
-            return rf.center;
+        if (rf.center[row] >= 0.0)
+            return rf.center[row];
 
-        int length = blk->GetRFLength();
+        int length = rf.length[row];
         if (length <= 0)
             return 0.0;
 
-        const float* ampPtr = blk->GetRFAmplitudePtr();
-        float dwell = blk->GetRFDwellTime();
+        const float* ampPtr = rf.ampSamples[row];
+        float dwell = rf.dwell[row];
         if (dwell <= 0.0f)
             dwell = 1.0f;
 
@@ -66,19 +65,17 @@ namespace
         return tc;
     }
 
-    double estimateFlipAngleDeg(SeqBlock* blk)
+    double estimateFlipAngleDeg(const BlockTable::RfColumns& rf, int row)
     {
-        if (!blk || !blk->isRF())
-            return 0.0;
-        int len = blk->GetRFLength();
+        int len = rf.length[row];
         if (len <= 1)
             return 0.0;
 
-        const float* ampPtr = blk->GetRFAmplitudePtr();
-        const float* phasePtr = blk->GetRFPhasePtr();
+        const float* ampPtr = rf.ampSamples[row];
+        const float* phasePtr = rf.phaseSamples[row];
         if (!ampPtr || !phasePtr)
             return 0.0;
-        float dwellUs = blk->GetRFDwellTime();
+        float dwellUs = rf.dwell[row];
         if (dwellUs <= 0.0f)
             dwellUs = 1.0f;
 
@@ -87,9 +84,8 @@ namespace
         // Rebuild those complex samples here and integrate with left rectangles.
         // flipAngleDeg = abs(sum(rf.signal(1:end-1) .* (rf.t(2:end)-rf.t(1:end-1)))) * 360
         // with uniform dt = dwellUs * 1e-6
-        const RFEvent& rf = blk->GetRFEvent();
         double dt = static_cast<double>(dwellUs) * 1e-6;
-        const double rfScale = static_cast<double>(rf.amplitude);
+        const double rfScale = static_cast<double>(rf.amplitude[row]);
         std::complex<double> accum(0.0, 0.0);
         for (int i = 0; i < len - 1; ++i)
         {
@@ -103,24 +99,32 @@ namespace
         return std::abs(accum) * 360.0;
     }
 
-    char classifyRfUse(SeqBlock* blk, const RFEvent& rf, bool supportsMetadata, bool& guessedUse, double b0Tesla, double gammaHzPerT)
+    // Duration derived from the RF samples and dwell time
+    double rfDurationSec(const BlockTable::RfColumns& rf, int row)
+    {
+        int len = rf.length[row];
+        float dwellUs = rf.dwell[row];
+        if (len > 1 && dwellUs > 0.0f)
+            return static_cast<double>(len - 1) * static_cast<double>(dwellUs) * 1e-6;
+        return 0.0;
+    }
+
+    bool hasRfUseMetadata(const BlockTable::RfColumns& rf, int row, bool supportsMetadata)
+    {
+        const char use = rf.use[row];
+        return supportsMetadata && use != 0 && use != 'u' && use != 'U';
+    }
+
+    char classifyRfUse(const BlockTable::RfColumns& rf, int row, bool supportsMetadata, bool& guessedUse, double b0Tesla, double gammaHzPerT)
     {
-        if (supportsMetadata && rf.use != 0 && rf.use != 'u' && rf.use != 'U')
-            return rf.use;
+        if (hasRfUseMetadata(rf, row, supportsMetadata))
+            return rf.use[row];
         guessedUse = true;
-        double flipAngle = estimateFlipAngleDeg(blk);
+        double flipAngle = estimateFlipAngleDeg(rf, row);
         if (flipAngle < 90.01)
             return 'e';
         // MATLAB parity: detect fat-sat ('s') by long duration and off-resonance near -3.45 ppm
-        // Duration: derive from RF samples and dwell time
-        double dur_s = 0.0;
-        if (blk)
-        {
-            int len = blk->GetRFLength();
-            float dwellUs = blk->GetRFDwellTime();
-            if (len > 1 && dwellUs > 0.0f)
-                dur_s = static_cast<double>(len - 1) * static_cast<double>(dwellUs) * 1e-6;
-        }
+        const double dur_s = rfDurationSec(rf, row);
         // Off-resonance ppm:
         // - v1.5.x: rf.freqPPM populated directly
         // - v1.4.x: compute from freqOffset if B0 is available: ppm = 1e6 * freqOffset / (gamma * B0)
@@ -135,10 +139,10 @@ namespace
                 s_warnedDefaultB0 = true;
             }
         }
-        double freqPPM = static_cast<double>(rf.freqPPM);
+        double freqPPM = static_cast<double>(rf.freqPPM[row]);
         if (std::abs(freqPPM) < 1e-12 && b0Tesla > 0.0 && std::abs(gammaHzPerT) > 0.0)
         {
-            freqPPM = 1e6 * static_cast<double>(rf.freqOffset) / (gammaHzPerT * b0Tesla);
+            freqPPM = 1e6 * static_cast<double>(rf.freqOffset[row]) / (gammaHzPerT * b0Tesla);
         }
         // Widen detection band for saturation pulses to [-4.5, -3.0] ppm
         if (dur_s > 6e-3 && freqPPM >= -4.5 && freqPPM <= -3.0)
@@ -228,17 +232,17 @@ namespace
         values.resize(writeIdx);
     }
 
-    double trapezoidGradientValue(const GradEvent& grad, double localSec)
+    double trapezoidGradientValue(const BlockTable::GradColumns& g, int row, double localSec)
     {
         if (localSec < 0.0)
             return 0.0;
-        double rampUpSec = static_cast<double>(grad.rampUpTime) * 1e-6;
-        double flatSec = static_cast<double>(grad.flatTime) * 1e-6;
-        double rampDownSec = static_cast<double>(grad.rampDownTime) * 1e-6;
+        double rampUpSec = static_cast<double>(g.rampUp[row]) * 1e-6;
+        double flatSec = static_cast<double>(g.flat[row]) * 1e-6;
+        double rampDownSec = static_cast<double>(g.rampDown[row]) * 1e-6;
         double totalSec = rampUpSec + flatSec + rampDownSec;
         if (localSec > totalSec || totalSec <= 0.0)
             return 0.0;
-        double amp = static_cast<double>(grad.amplitude);
+        double amp = static_cast<double>(g.amplitude[row]);
         if (localSec <= rampUpSec && rampUpSec > 0.0)
             return amp * (localSec / rampUpSec);
         if (localSec <= rampUpSec + flatSec)
@@ -252,21 +256,22 @@ namespace
         return 0.0;
     }
 
-    double arbitraryGradientValue(SeqBlock* blk, int channel, const GradEvent& grad, double localSec, double gradientRasterUs)
+    double arbitraryGradientValue(const BlockTable::GradColumns& g, int row, double localSec, double gradientRasterUs)
     {
         if (localSec < 0.0)
             return 0.0;
-        int numSamples = blk->GetArbGradNumSamples(channel);
-        const float* shapePtr = blk->GetArbGradShapePtr(channel);
+        int numSamples = g.numPoints[row];
+        const float* shapePtr = g.values[row];
         if (numSamples <= 0 || !shapePtr)
             return 0.0;
+        const double amplitude = static_cast<double>(g.amplitude[row]);
         double rasterUs = (gradientRasterUs > 0.0 ? gradientRasterUs : 10.0);
         double rasterSec = rasterUs * 1e-6;
         if (numSamples == 1)
         {
             double durationSec = rasterSec;
             if (localSec <= durationSec)
-                return static_cast<double>(shapePtr[0]) * static_cast<double>(grad.amplitude);
+                return static_cast<double>(shapePtr[0]) * amplitude;
             return 0.0;
         }
         double totalSec = rasterSec * static_cast<double>(numSamples - 1);
@@ -275,29 +280,32 @@ namespace
         double pos = localSec / rasterSec;
         int idx0 = static_cast<int>(std::floor(pos));
         if (idx0 >= numSamples - 1)
-            return static_cast<double>(shapePtr[numSamples - 1]) * static_cast<double>(grad.amplitude);
+            return static_cast<double>(shapePtr[numSamples - 1]) * amplitude;
         double frac = pos - idx0;
         int idx1 = idx0 + 1;
         double v0 = static_cast<double>(shapePtr[idx0]);
         double v1 = static_cast<double>(shapePtr[idx1]);
-        return (v0 + (v1 - v0) * frac) * static_cast<double>(grad.amplitude);
+        return (v0 + (v1 - v0) * frac) * amplitude;
     }
 
-    double extTrapGradientValue(SeqBlock* blk, int channel, const GradEvent& grad, double localSec)
+    // 'segment' caches the search position between calls with non-decreasing localSec
+    double extTrapGradientValue(const BlockTable::GradColumns& g, int row, double localSec, int& segment)
     {
         if (localSec < 0.0)
             return 0.0;
-        const std::vector<long>& timesUs = blk->GetExtTrapGradTimes(channel);
-        const std::vector<float>& shape = blk->GetExtTrapGradShape(channel);
-        if (timesUs.empty() || shape.empty() || timesUs.size() != shape.size())
+        const long* timesUs = g.timesUs[row];
+        const float* shape = g.values[row];
+        const int n = g.numPoints[row];
+        if (n <= 0 || !timesUs || !shape)
             return 0.0;
+        const double amplitude = static_cast<double>(g.amplitude[row]);
         double localUs = localSec * 1e6;
-        if (localUs <= static_cast<double>(timesUs.front()))
-            return static_cast<double>(shape.front()) * static_cast<double>(grad.amplitude);
-        if (localUs >= static_cast<double>(timesUs.back()))
-            return static_cast<double>(shape.back()) * static_cast<double>(grad.amplitude);
+        if (localUs <= static_cast<double>(timesUs[0]))
+            return static_cast<double>(shape[0]) * amplitude;
+        if (localUs >= static_cast<double>(timesUs[n - 1]))
+            return static_cast<double>(shape[n - 1]) * amplitude;
         int idx1 = -1;
-        for (int j = 1; j < static_cast<int>(timesUs.size()); ++j)
+        for (int j = std::max(1, segment); j < n; ++j)
         {
             if (localUs <= static_cast<double>(timesUs[j]))
             {
@@ -305,38 +313,62 @@ namespace
                 break;
             }
         }
+        segment = std::max(1, idx1);
         if (idx1 <= 0)
-            return static_cast<double>(shape.front()) * static_cast<double>(grad.amplitude);
+            return static_cast<double>(shape[0]) * amplitude;
         int idx0 = idx1 - 1;
         double t0 = static_cast<double>(timesUs[idx0]) * 1e-6;
         double t1 = static_cast<double>(timesUs[idx1]) * 1e-6;
         double span = t1 - t0;
         if (span <= 0.0)
-            return static_cast<double>(shape[idx1]) * static_cast<double>(grad.amplitude);
+            return static_cast<double>(shape[idx1]) * amplitude;
         double alpha = (localSec - t0) / span;
         alpha = std::clamp(alpha, 0.0, 1.0);
         double v0 = static_cast<double>(shape[idx0]);
         double v1 = static_cast<double>(shape[idx1]);
-        return (v0 + (v1 - v0) * alpha) * static_cast<double>(grad.amplitude);
+        return (v0 + (v1 - v0) * alpha) * amplitude;
     }
 
-    double gradientValueFromBlock(SeqBlock* blk, int channel, double timeSec, double blockStartSec, double gradientRasterUs)
+    // Evaluates one gradient channel at non-decreasing times. The row and ExtTrap segment
+    // cursors only move forward, so a run of samples costs one search instead of one per sample.
+    class GradientWalker
     {
-        if (!blk)
-            return 0.0;
-        if (!(blk->isTrapGradient(channel) || blk->isArbitraryGradient(channel) || blk->isExtTrapGradient(channel)))
+    public:
+        GradientWalker(const BlockTable& table, int channel, int firstBlock, double gradientRasterUs)
+            : m_g(table.grad[channel]), m_rasterUs(gradientRasterUs)
+        {
+            m_row = static_cast<int>(std::lower_bound(m_g.block.begin(), m_g.block.end(), firstBlock) - m_g.block.begin());
+        }
+
+        double valueAt(int blockIdx, double blockStartSec, double timeSec)
+        {
+            while (m_row < m_g.size() && m_g.block[m_row] < blockIdx)
+            {
+                ++m_row;
+                m_segment = 1;
+            }
+            if (m_row >= m_g.size() || m_g.block[m_row] != blockIdx)
+                return 0.0;
+            double eventStartSec = blockStartSec + static_cast<double>(m_g.delay[m_row]) * 1e-6;
+            double localSec = timeSec - eventStartSec;
+            switch (m_g.kind[m_row])
+            {
+            case BlockTable::GradTrap:
+                return trapezoidGradientValue(m_g, m_row, localSec);
+            case BlockTable::GradArbitrary:
+                return arbitraryGradientValue(m_g, m_row, localSec, m_rasterUs);
+            case BlockTable::GradExtTrap:
+                return extTrapGradientValue(m_g, m_row, localSec, m_segment);
+            }
             return 0.0;
-        const GradEvent& grad = blk->GetGradEvent(channel);
-        double eventStartSec = blockStartSec + static_cast<double>(grad.delay) * 1e-6;
-        double localSec = timeSec - eventStartSec;
-        if (blk->isTrapGradient(channel))
-            return trapezoidGradientValue(grad, localSec);
-        if (blk->isArbitraryGradient(channel))
-            return arbitraryGradientValue(blk, channel, grad, localSec, gradientRasterUs);
-        if (blk->isExtTrapGradient(channel))
-            return extTrapGradientValue(blk, channel, grad, localSec);
-        return 0.0;
-    }
+        }
+
+    private:
+        const BlockTable::GradColumns& m_g;
+        double m_rasterUs;
+        int m_row {0};
+        int m_segment {1};
+    };
 
     void mergeTimeVectors(QVector<double>& base, const QVector<double>& extra, double tFactor)
     {
@@ -348,11 +380,36 @@ namespace
     }
 }
 
+char rfUse(const BlockTable::RfColumns& rf, int row, bool supportsRfUseMetadata,
+           double b0Tesla, double gammaHzPerT)
+{
+    bool guessed = false;
+    const char use = classifyRfUse(rf, row, supportsRfUseMetadata, guessed, b0Tesla, gammaHzPerT);
+    return use ? use : 'u';
+}
+
+bool rfUseDependsOnGamma(const BlockTable::RfColumns& rf, int row, bool supportsRfUseMetadata)
+{
+    // Mirrors the order of the tests in classifyRfUse(); the flip angle is left out, it does
+    // not depend on gamma and is the expensive part
+    if (hasRfUseMetadata(rf, row, supportsRfUseMetadata))
+        return false;
+    if (std::abs(static_cast<double>(rf.freqPPM[row])) >= 1e-12 || rf.freqOffset[row] == 0.0f)
+        return false;
+    return rfDurationSec(rf, row) > 6e-3;
+}
+
 Result compute(const Input& input)
 {
     Result result;
+    result.carry = input.carry;
     if (input.blocks.empty() || input.blockEdges.size() < 2)
         return result;
+    const int blockCount = std::min(input.blocks.blockCount(), static_cast<int>(input.blockEdges.size()) - 1);
+    const int firstBlock = std::clamp(input.firstBlock, 0, blockCount);
+    const int endBlock = input.endBlock < 0 ? blockCount : std::clamp(input.endBlock, firstBlock, blockCount);
+    if (firstBlock >= endBlock)
+        return result;
 
     const double tacc = 1e-10;
     auto roundAcc = [&](double sec) -> double {
@@ -371,9 +428,9 @@ Result compute(const Input& input)
     QVector<double> gxTime, gxValue;
     QVector<double> gyTime, gyValue;
     QVector<double> gzTime, gzValue;
-    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 0, gxTime, gxValue, input.gradientRasterUs);
-    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 1, gyTime, gyValue, input.gradientRasterUs);
-    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 2, gzTime, gzValue, input.gradientRasterUs);
+    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 0, gxTime, gxValue, input.gradientRasterUs, firstBlock, endBlock);
+    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 1, gyTime, gyValue, input.gradientRasterUs, firstBlock, endBlock);
+    SeriesBuilder::buildGradientSeries(input.blocks, input.blockEdges, input.tFactor, 2, gzTime, gzValue, input.gradientRasterUs, firstBlock, endBlock);
     sanitizeGradientSeries(gxTime, gxValue);
     sanitizeGradientSeries(gyTime, gyValue);
     sanitizeGradientSeries(gzTime, gzValue);
@@ -389,30 +446,23 @@ Result compute(const Input& input)
     QVector<double> refocusSecondsRounded;
     bool guessedAny = false;
 
-    double gammaHzPerT = Settings::getInstance().getGamma();
+    const double gammaHzPerT = input.gammaHzPerT;
     QVector<char> rfUsePerBlock;
-    rfUsePerBlock.resize(static_cast<int>(input.blocks.size()));
+    rfUsePerBlock.resize(endBlock - firstBlock);
     std::fill(rfUsePerBlock.begin(), rfUsePerBlock.end(), 0);
-    for (int i = 0; i < input.blocks.size(); ++i)
+    const BlockTable::RfColumns& rf = input.blocks.rf;
+    const int firstRfRow = static_cast<int>(std::lower_bound(rf.block.begin(), rf.block.end(), firstBlock) - rf.block.begin());
+    for (int row = firstRfRow; row < rf.size() && rf.block[row] < endBlock; ++row)
     {
-        SeqBlock* blk = input.blocks[i];
-        if (!blk)
-            continue;
-        if (!blk->isRF())
-        {
-            rfUsePerBlock[i] = 0;
-            continue;
-        }
-
-        const RFEvent& rf = blk->GetRFEvent();
+        const int i = rf.block[row];
         bool guessed = false;
-        char useChar = classifyRfUse(blk, rf, input.supportsRfUseMetadata, guessed,
+        char useChar = classifyRfUse(rf, row, input.supportsRfUseMetadata, guessed,
                                      input.b0Tesla, gammaHzPerT);
         guessedAny |= guessed;
-        rfUsePerBlock[i] = useChar ? useChar : 'u';
+        rfUsePerBlock[i - firstBlock] = useChar ? useChar : 'u';
 
-        double centerUs = rfCenterUs(blk, rf);
-        double internalTime = input.blockEdges[i] + (rf.delay + centerUs) * input.tFactor;
+        double centerUs = rfCenterUs(rf, row);
+        double internalTime = input.blockEdges[i] + (rf.delay[row] + centerUs) * input.tFactor;
 
         if (useChar == 'e' || useChar == 'E')
         {
@@ -435,7 +485,11 @@ Result compute(const Input& input)
 
     double rfRasterSec = input.rfRasterUs > 0.0 ? input.rfRasterUs * 1e-6 : 0.0;
     double gradRasterSec = input.gradientRasterUs > 0.0 ? input.gradientRasterUs * 1e-6 : 0.0;
-    double totalDurationSec = internalToSecRounded(input.blockEdges.last());
+    // Grid points stay inside the range; the end is left open on the last range so trailing
+    // samples past the final block edge are kept
+    const double rangeStartSec = internalToSecRounded(input.blockEdges[firstBlock]);
+    const double rangeEndSec = internalToSecRounded(input.blockEdges[endBlock]);
+    const bool clampRangeEnd = endBlock < blockCount;
 
     QVector<double> adcSecondsRounded;
     adcSecondsRounded.reserve(input.adcEventTimesInternal.size());
@@ -455,7 +509,9 @@ Result compute(const Input& input)
         if (!std::isfinite(sec))
             return;
         sec = roundAcc(sec);
-        sec = clampNonNegative(sec);
+        sec = std::max(clampNonNegative(sec), rangeStartSec);
+        if (clampRangeEnd)
+            sec = std::min(sec, rangeEndSec);
         timeCandidates.append(sec);
     };
 
@@ -464,8 +520,8 @@ Result compute(const Input& input)
     for (double sec : gyTimeSec) addCandidate(sec);
     for (double sec : gzTimeSec) addCandidate(sec);
 
-    addCandidate(0.0);
-    addCandidate(totalDurationSec);
+    addCandidate(rangeStartSec);
+    addCandidate(rangeEndSec);
 
     for (double sec : excitationSecondsRounded)
     {
@@ -503,41 +559,121 @@ Result compute(const Input& input)
     for (int i = 0; i < input.blockEdges.size(); ++i)
         blockEdgesSec[i] = internalToSecRounded(input.blockEdges[i]);
 
-    auto gradientAtSec = [&](int channel, double sec) -> double {
-        if (blockEdgesSec.size() < 2)
-            return 0.0;
-        if (sec < blockEdgesSec.front() || sec >= blockEdgesSec.back())
-            return 0.0;
-        auto it = std::upper_bound(blockEdgesSec.begin(), blockEdgesSec.end(), sec);
-        if (it == blockEdgesSec.begin())
-            return 0.0;
-        int blockIdx = static_cast<int>(it - blockEdgesSec.begin()) - 1;
-        if (blockIdx < 0 || blockIdx >= static_cast<int>(input.blocks.size()))
-            return 0.0;
-        double blockStartSec = blockEdgesSec[blockIdx];
-        return gradientValueFromBlock(input.blocks[blockIdx], channel, sec, blockStartSec, input.gradientRasterUs);
+    // Integrate the gradients over the grid (midpoint rule). Consecutive grid intervals are
+    // split into chunks that integrate in parallel from zero, each walking its blocks and
+    // waveforms with forward-only cursors; a prefix sum over the chunk totals then turns the
+    // partial integrals into the running k-space.
+    const int nGrid = timeGrid.size();
+    QVector<double> kxData(nGrid, 0.0);
+    QVector<double> kyData(nGrid, 0.0);
+    QVector<double> kzData(nGrid, 0.0);
+    const int nBlocks = endBlock;
+    // Raw pointers so the worker threads never touch the QVector (no detach checks)
+    double* kxOut = kxData.data();
+    double* kyOut = kyData.data();
+    double* kzOut = kzData.data();
+
+    // Const views: the workers must not call non-const QVector accessors (timeGrid is shared
+    // with result.t, so those would detach)
+    const QVector<double>& gridSec = timeGrid;
+    const QVector<double>& edgesSec = blockEdgesSec;
+    auto integrateRange = [&](int first, int last) {
+        // Intervals [gridSec[i-1], gridSec[i]] for i in [first, last); kData[first-1] counts as 0
+        const double firstMid = 0.5 * (gridSec[first - 1] + gridSec[first]);
+        int block = std::max(0, static_cast<int>(std::upper_bound(edgesSec.begin(), edgesSec.end(), firstMid) - edgesSec.begin()) - 1);
+        GradientWalker walkers[3] = {
+            GradientWalker(input.blocks, 0, block, input.gradientRasterUs),
+            GradientWalker(input.blocks, 1, block, input.gradientRasterUs),
+            GradientWalker(input.blocks, 2, block, input.gradientRasterUs),
+        };
+        double kx = 0.0, ky = 0.0, kz = 0.0;
+        for (int i = first; i < last; ++i)
+        {
+            double dt = gridSec[i] - gridSec[i - 1];
+            if (dt > 0.0)
+            {
+                double mid = gridSec[i - 1] + 0.5 * dt;
+                if (mid >= edgesSec.front() && mid < edgesSec.back())
+                {
+                    while (block + 1 < edgesSec.size() - 1 && edgesSec[block + 1] <= mid)
+                        ++block;
+                    if (block < nBlocks)
+                    {
+                        double blockStartSec = edgesSec[block];
+                        kx += walkers[0].valueAt(block, blockStartSec, mid) * dt;
+                        ky += walkers[1].valueAt(block, blockStartSec, mid) * dt;
+                        kz += walkers[2].valueAt(block, blockStartSec, mid) * dt;
+                    }
+                }
+            }
+            kxOut[i] = kx;
+            kyOut[i] = ky;
+            kzOut[i] = kz;
+        }
     };
 
-    QVector<double> kxData(timeGrid.size(), 0.0);
-    QVector<double> kyData(timeGrid.size(), 0.0);
-    QVector<double> kzData(timeGrid.size(), 0.0);
-    for (int i = 1; i < timeGrid.size(); ++i)
+    const int kMinIntervalsPerChunk = 4096;
+    const int nThreads = std::max(1, QThread::idealThreadCount());
+    const int nIntervals = nGrid - 1;
+    const int nChunks = std::max(1, std::min(nThreads * 4, nIntervals / kMinIntervalsPerChunk));
+    QVector<int> chunkStart(nChunks + 1);
+    for (int c = 0; c <= nChunks; ++c)
+        chunkStart[c] = 1 + static_cast<int>(static_cast<qint64>(nIntervals) * c / nChunks);
+    QThreadPool pool;
+    pool.setMaxThreadCount(nThreads);
+    if (nChunks == 1)
     {
-        double dt = timeGrid[i] - timeGrid[i - 1];
-        if (dt <= 0.0)
+        integrateRange(chunkStart[0], chunkStart[1]);
+    }
+    else
+    {
+        for (int c = 0; c < nChunks; ++c)
         {
-            kxData[i] = kxData[i - 1];
-            kyData[i] = kyData[i - 1];
-            kzData[i] = kzData[i - 1];
-            continue;
+            const int first = chunkStart[c];
+            const int last = chunkStart[c + 1];
+            pool.start([&integrateRange, first, last]() { integrateRange(first, last); });
         }
-        double mid = timeGrid[i - 1] + 0.5 * dt;
-        double gxMid = gradientAtSec(0, mid);
-        double gyMid = gradientAtSec(1, mid);
-        double gzMid = gradientAtSec(2, mid);
-        kxData[i] = kxData[i - 1] + gxMid * dt;
-        kyData[i] = kyData[i - 1] + gyMid * dt;
-        kzData[i] = kzData[i - 1] + gzMid * dt;
+        pool.waitForDone();
+    }
+
+    // Chunk c starts from the running total at the end of chunk c-1; the first one from the carry
+    QVector<double> offX(nChunks), offY(nChunks), offZ(nChunks);
+    offX[0] = input.carry.k[0];
+    offY[0] = input.carry.k[1];
+    offZ[0] = input.carry.k[2];
+    for (int c = 1; c < nChunks; ++c)
+    {
+        const int prevLast = chunkStart[c] - 1;
+        offX[c] = offX[c - 1] + kxOut[prevLast];
+        offY[c] = offY[c - 1] + kyOut[prevLast];
+        offZ[c] = offZ[c - 1] + kzOut[prevLast];
+    }
+    kxOut[0] = offX[0];
+    kyOut[0] = offY[0];
+    kzOut[0] = offZ[0];
+    auto addOffset = [=](int c) {
+        const int first = chunkStart[c];
+        const int last = chunkStart[c + 1];
+        const double ox = offX[c], oy = offY[c], oz = offZ[c];
+        if (ox == 0.0 && oy == 0.0 && oz == 0.0)
+            return;
+        // Plain contiguous adds, left to the compiler to vectorize
+        for (int i = first; i < last; ++i)
+        {
+            kxOut[i] += ox;
+            kyOut[i] += oy;
+            kzOut[i] += oz;
+        }
+    };
+    if (nChunks == 1)
+    {
+        addOffset(0);
+    }
+    else
+    {
+        for (int c = 0; c < nChunks; ++c)
+            pool.start([&addOffset, c]() { addOffset(c); });
+        pool.waitForDone();
     }
 
     auto indexForSeconds = [&](double sec) -> int {
@@ -582,9 +718,14 @@ Result compute(const Input& input)
     std::sort(boundaries.begin(), boundaries.end());
     boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
 
-    double dkX = -kxData[0];
-    double dkY = -kyData[0];
-    double dkZ = -kzData[0];
+    // Raw integral at the end of the range, before the RF resets below
+    result.carry.k[0] = kxData.last();
+    result.carry.k[1] = kyData.last();
+    result.carry.k[2] = kzData.last();
+
+    double dkX = input.carry.dk[0];
+    double dkY = input.carry.dk[1];
+    double dkZ = input.carry.dk[2];
     int ptrExc = 0;
     int ptrRef = 0;
     for (int seg = 0; seg < boundaries.size() - 1; ++seg)
@@ -625,6 +766,10 @@ Result compute(const Input& input)
         kzData[last] += dkZ;
     }
 
+    result.carry.dk[0] = dkX;
+    result.carry.dk[1] = dkY;
+    result.carry.dk[2] = dkZ;
+
     QVector<double> kxPlot = kxData;
     QVector<double> kyPlot = kyData;
     QVector<double> kzPlot = kzData;
@@ -5,14 +5,22 @@
 #include <QString>
 #include <vector>
 
-class SeqBlock;
+#include "BlockTable.h"
 
 namespace KSpaceTrajectory
 {
 
+// Integration state at the end of a block range; passing it to the next range continues
+// the trajectory exactly where the previous call stopped.
+struct Carry
+{
+    double k[3] = {0.0, 0.0, 0.0};  // running gradient integral (before RF resets)
+    double dk[3] = {0.0, 0.0, 0.0}; // offset applied by the last excitation/refocusing
+};
+
 struct Input
 {
-    const std::vector<SeqBlock*>& blocks;
+    const BlockTable& blocks;
     const QVector<double>& blockEdges;
     double tFactor = 1.0;
     bool supportsRfUseMetadata = false;
@@ -21,6 +29,12 @@ struct Input
     QVector<double> adcEventTimesInternal;
     // Optional system parameters for RF-use guessing (v1.4.x fallback)
     double b0Tesla = 0.0;          // If 0, ppm fallback from freqOffset is disabled
+    double gammaHzPerT = 42.576e6;
+    // Blocks [firstBlock, endBlock) to compute (endBlock < 0: through the last block), starting
+    // from 'carry'. adcEventTimesInternal then only lists the ADC samples of those blocks.
+    int firstBlock = 0;
+    int endBlock = -1;
+    Carry carry;
 };
 
 struct Result
@@ -35,13 +49,21 @@ struct Result
     QVector<double> kz_adc;
     QVector<double> excitationTimesInternal;
     QVector<double> refocusingTimesInternal;
-    QVector<char>   rfUsePerBlock;   // per block rf.use ('e','r','s','i','p','u' or 0)
+    QVector<char>   rfUsePerBlock;   // rf.use ('e','r','s','i','p','u' or 0) of blocks [firstBlock, endBlock)
     bool rfUseGuessed = false;
     QString warning;
+    Carry carry;                     // state after the last block, for the next range
 };
 
 Result compute(const Input& input);
 
+// RF use of RF row 'row' as compute() classifies it ('u' when unknown)
+char rfUse(const BlockTable::RfColumns& rf, int row, bool supportsRfUseMetadata,
+           double b0Tesla, double gammaHzPerT);
+// True if that classification reads the gyromagnetic ratio: a guessed use whose fat-sat test
+// converts freqOffset to ppm because the row stores no ppm value
+bool rfUseDependsOnGamma(const BlockTable::RfColumns& rf, int row, bool supportsRfUseMetadata);
+
 } // namespace KSpaceTrajectory
 
 #endif // KSPACE_TRAJECTORY_H
@@ -7,12 +7,23 @@
 #include "KSpaceTrajectory.h"
 #include "InteractionHandler.h"
 #include "Settings.h"
+#include "SequenceCache.h"
+#include "DecimationKernels.h"
 #include <QCryptographicHash>
+#include <QFile>
 
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QSettings>
 #include <QDir>
+#include <QThread>
+#include <QEventLoop>
+#include <QProgressBar>
+#include <QStatusBar>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <complex>
@@ -20,9 +31,9 @@
 #include <array>
 #include <algorithm>
 #include <utility>
+#include <iterator>
 #include <QSet>
-
-#define SAFE_DELETE(p) { if(p) { delete p; p = nullptr; } }
+#include "v151/SeqTextScan.h"
 
 PulseqLoader::PulseqLoader(MainWindow* mainWindow)
     : QObject(mainWindow),
@@ -49,6 +60,9 @@ PulseqLoader::PulseqLoader(MainWindow* mainWindow)
 PulseqLoader::~PulseqLoader()
 {
     ClearPulseqCache();
+    cancelPendingSignatureCheck();
+    // Signature tasks post their results to this object
+    m_signaturePool.waitForDone();
 }
 
 void PulseqLoader::OpenPulseqFile()
@@ -56,35 +70,39 @@ void PulseqLoader::OpenPulseqFile()
     // Use last open directory if available, otherwise use current path
     QString startDir = m_sLastOpenDirectory.isEmpty() ? QDir::currentPath() : m_sLastOpenDirectory;
     
-    m_sPulseqFilePath = QFileDialog::getOpenFileName(
+    const QString sPulseqFilePath = QFileDialog::getOpenFileName(
         m_mainWindow,
         "Select a Pulseq File",
         startDir,
         "Text Files (*.seq);;All Files (*)"
     );
 
-    if (!m_sPulseqFilePath.isEmpty())
+    if (!sPulseqFilePath.isEmpty())
     {
         // Save the directory of the selected file
-        QFileInfo fileInfo(m_sPulseqFilePath);
+        QFileInfo fileInfo(sPulseqFilePath);
         m_sLastOpenDirectory = fileInfo.absolutePath();
         saveLastOpenDirectory();
         
-        if (!LoadPulseqFile(m_sPulseqFilePath))
+        // A failed or cancelled load leaves the previous sequence (and its path) in place
+        if (!LoadPulseqFile(sPulseqFilePath))
         {
-            m_sPulseqFilePath.clear();
-            std::cout << "LoadPulseqFile failed!\n";
+            if (!m_lastLoadCancelled)
+                std::cout << "LoadPulseqFile failed!\n";
+            return;
         }
-        m_sPulseqFilePathCache = m_sPulseqFilePath;
+        m_sPulseqFilePath = sPulseqFilePath;
+        m_sPulseqFilePathCache = sPulseqFilePath;
     }
 }
 
 void PulseqLoader::ReOpenPulseqFile()
 {
+    // LoadPulseqFile swaps the reloaded sequence in only once it is ready
     if (m_sPulseqFilePathCache.size() > 0)
     {
-        ClearPulseqCache();
-        LoadPulseqFile(m_sPulseqFilePathCache);
+        if (LoadPulseqFile(m_sPulseqFilePathCache))
+            m_sPulseqFilePath = m_sPulseqFilePathCache;
     }
 }
 
@@ -96,6 +114,11 @@ bool PulseqLoader::ClosePulseqFile()
 
 void PulseqLoader::ClearPulseqCache()
 {
+    cancelSignatureCheck();
+    cancelTrajectoryComputation();
+    // Viewport render tasks read the tables cleared below
+    if (m_mainWindow && m_mainWindow->getWaveformDrawer())
+        m_mainWindow->getWaveformDrawer()->cancelRenderPreparation();
     if (m_mainWindow)
     {
         m_mainWindow->clearLoadedFileTitle();
@@ -128,16 +151,13 @@ void PulseqLoader::ClearPulseqCache()
     m_rfUseGuessed = false;
     m_warnedRfUseGuess = false;
     m_rfGuessWarning.clear();
-    m_kTrajectoryReady = false;
-    m_kTrajectoryX.clear();
-    m_kTrajectoryY.clear();
-    m_kTrajectoryZ.clear();
-    m_kTimeSec.clear();
-    m_kTrajectoryXAdc.clear();
-    m_kTrajectoryYAdc.clear();
-    m_kTrajectoryZAdc.clear();
-    m_kTimeAdcSec.clear();
+    clearTrajectoryData();
     m_usedExtensions.clear();
+    m_labelHistory.clear();
+    for (QVector<EventInterval>& events : m_channelEvents) events.clear();
+    m_blockTable.clear();
+    m_shapeAgg = ShapeScaleAggregates();
+    m_envelopes = EnvelopeSet();
     m_adcPhaseCache.valid = false;
 
     if (m_mainWindow && m_mainWindow->getTRManager())
@@ -145,18 +165,18 @@ void PulseqLoader::ClearPulseqCache()
         m_mainWindow->getTRManager()->resetTimeWindow();
     }
     
-    // Reset B0 to default
-    m_b0Tesla = 0.0;
+    // Reset [DEFINITIONS] snapshot (B0 back to its default)
+    m_systemParams = SystemParameters();
 
     if (nullptr != m_spPulseqSeq.get())
     {
         m_spPulseqSeq->reset();
         // m_spPulseqSeq will be recreated based on file version
-        for (uint16_t ushBlockIndex = 0; ushBlockIndex < m_vecDecodeSeqBlocks.size(); ushBlockIndex++)
-        {
-            SAFE_DELETE(m_vecDecodeSeqBlocks[ushBlockIndex]);
-        }
         m_vecDecodeSeqBlocks.clear();
+        std::vector<SeqBlock>().swap(m_blockStorage);
+        m_blockCache.clear();
+        m_lazyDecoding = false;
+        m_lazyBlockCount = 0;
         std::cout << m_sPulseqFilePath.toStdString() << " Closed\n";
     }
     if (m_mainWindow) { m_mainWindow->setWindowFilePath(""); }
@@ -169,21 +189,35 @@ void PulseqLoader::ClearPulseqCache()
  */
 std::pair<int, int> PulseqLoader::ReadFileVersion(const std::string& filename)
 {
-    std::ifstream file(filename, std::ios::in);
-    if (!file.is_open())
+    QFile file(QString::fromStdString(filename));
+    if (!file.open(QIODevice::ReadOnly))
     {
         return std::make_pair(-1, -1);
     }
+    const qint64 size = file.size();
+    uchar* data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data)
+    {
+        return std::make_pair(-1, -1);
+    }
+    std::pair<int, int> version = ReadFileVersion(reinterpret_cast<const char*>(data), static_cast<std::size_t>(size));
+    file.unmap(data);
+    return version;
+}
 
-    std::string line;
+std::pair<int, int> PulseqLoader::ReadFileVersion(const char* data, std::size_t size)
+{
+    SeqLineReader reader(data, size);
+    SeqLine line;
     bool inVersionSection = false;
     int version_major = -1;
     int version_minor = -1;
 
-    while (std::getline(file, line))
+    while (reader.next(line))
     {
+        const std::string text = line.str();
         // Check for [VERSION] section
-        if (line.find("[VERSION]") != std::string::npos)
+        if (text.find("[VERSION]") != std::string::npos)
         {
             inVersionSection = true;
             continue;
@@ -191,37 +225,20 @@ std::pair<int, int> PulseqLoader::ReadFileVersion(const std::string& filename)
 
         if (inVersionSection)
         {
-            // Look for major and minor version lines
-            if (line.find("major") != std::string::npos)
-            {
-                std::istringstream iss(line);
-                std::string key, value;
-                if (std::getline(iss, key, ' ') && std::getline(iss, value))
-                {
-                    try
-                    {
-                        version_major = std::stoi(value);
-                    }
-                    catch (const std::exception&)
-                    {
-                        return std::make_pair(-1, -1);
-                    }
-                }
-            }
-            else if (line.find("minor") != std::string::npos)
+            // Look for major and minor version lines: "<key> <value>"
+            const bool isMajor = text.find("major") != std::string::npos;
+            if (isMajor || text.find("minor") != std::string::npos)
             {
-                std::istringstream iss(line);
-                std::string key, value;
-                if (std::getline(iss, key, ' ') && std::getline(iss, value))
+                SeqFieldScanner scanner(line);
+                SeqLine key;
+                int value = -1;
+                if (scanner.readWord(key) && !scanner.rest().empty())
                 {
-                    try
-                    {
-                        version_minor = std::stoi(value);
-                    }
-                    catch (const std::exception&)
+                    if (!scanner.readInt(value))
                     {
                         return std::make_pair(-1, -1);
                     }
+                    (isMajor ? version_major : version_minor) = value;
                 }
             }
 
@@ -230,17 +247,15 @@ std::pair<int, int> PulseqLoader::ReadFileVersion(const std::string& filename)
             {
                 break;
             }
-        }
 
-        // Stop if we encounter another section
-        if (line.find("[") != std::string::npos && line.find("]") != std::string::npos && inVersionSection)
-        {
-            break;
+            // Stop if we encounter another section
+            if (text.find("[") != std::string::npos && text.find("]") != std::string::npos)
+            {
+                break;
+            }
         }
     }
 
-    file.close();
-
     if (version_major >= 0 && version_minor >= 0)
     {
         return std::make_pair(version_major, version_minor);
@@ -249,19 +264,46 @@ std::pair<int, int> PulseqLoader::ReadFileVersion(const std::string& filename)
     return std::make_pair(-1, -1);
 }
 
-bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
+void PulseqLoader::LoadedSequence::releaseBlocks()
 {
-    m_mainWindow->setEnabled(false);
+    blocks.clear();
+    std::vector<SeqBlock>().swap(blockStorage);
+}
+
+void PulseqLoader::cancelLoad()
+{
+    if (m_loadInProgress)
+    {
+        m_loadCancelRequested.store(true);
+    }
+}
+
+bool PulseqLoader::runLoadJob(const QString& path, const char* text, std::size_t textSize, double timeFactor, double gamma, bool lazy, bool useCache,
+                              qint64 cacheLimitBytes, bool hashInline, const std::atomic<bool>& cancel, const std::function<void(int)>& progress, LoadedSequence& out)
+{
+    // NOTE: runs on the load worker thread. No widgets, no loader members: everything goes into 'out'.
+    auto cancelled = [&]() {
+        if (!cancel.load(std::memory_order_relaxed)) return false;
+        out.releaseBlocks();
+        out.cancelled = true;
+        return true;
+    };
+
+    // The version probe and the parser both read the mapped pages in place, so the text is
+    // neither copied nor read through a stream
+    if (!text)
+    {
+        out.errorTitle = "Load Error";
+        out.errorText = QString("Failed to read: %1").arg(path);
+        return false;
+    }
 
-    // First, read version information without loading the full file
-    std::pair<int, int> version = ReadFileVersion(sPulseqFilePath.toStdString());
+    // First, read version information without parsing the full file
+    std::pair<int, int> version = ReadFileVersion(text, textSize);
     if (version.first == -1 || version.second == -1)
     {
-        m_mainWindow->setEnabled(true);
-        std::stringstream sLog;
-        sLog << "Failed to read version information from: " << sPulseqFilePath.toStdString();
-        if (m_silentMode) { qWarning() << sLog.str().c_str(); }
-        else { QMessageBox::critical(m_mainWindow, "Load Error", sLog.str().c_str()); }
+        out.errorTitle = "Load Error";
+        out.errorText = QString("Failed to read version information from: %1").arg(path);
         return false;
     }
 
@@ -269,14 +311,11 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
     int version_minor = version.second;
 
     // Create appropriate loader based on file version
-    m_spPulseqSeq = CreateLoaderForVersion(version_major, version_minor);
-    if (!m_spPulseqSeq)
+    std::shared_ptr<ExternalSequence> seq = CreateLoaderForVersion(version_major, version_minor);
+    if (!seq)
     {
-        m_mainWindow->setEnabled(true);
-        std::stringstream sLog;
-        sLog << "Unsupported Pulseq file version " << version_major << "." << version_minor << " for: " << sPulseqFilePath.toStdString();
-        if (m_silentMode) { qWarning() << sLog.str().c_str(); }
-        else { QMessageBox::critical(m_mainWindow, "Load Error", sLog.str().c_str()); }
+        out.errorTitle = "Load Error";
+        out.errorText = QString("Unsupported Pulseq file version %1.%2 for: %3").arg(version_major).arg(version_minor).arg(path);
         return false;
     }
 
@@ -308,14 +347,31 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
     // If any of these definitions are missing, the loader will fail with
     // detailed error messages indicating which definition is missing.
     // ============================================================================
-    // Setup time units and factor before loading
-    updateTimeUnitFromSettings();
-
-    if (!m_spPulseqSeq->load(sPulseqFilePath.toStdString()))
+    // An unchanged file (same size, mtime and [SIGNATURE] hash) is restored from its cache entry
+    // and its text is not parsed at all.
+    SequenceCache cache;
+    SequenceCache::Key cacheKey;
+    bool cacheHit = false;
+    if (useCache)
+    {
+        cacheKey = SequenceCache::makeKey(path, text, textSize);
+        if (cache.open(cacheKey))
+        {
+            std::size_t snapshotSize = 0;
+            const char* snapshot = cache.section(SequenceCache::kSequenceSection, &snapshotSize);
+            cacheHit = snapshot && seq->loadSnapshot(snapshot, snapshotSize);
+            if (!cacheHit) cache.close();
+        }
+    }
+    seq->SetSignatureCheck(hashInline);
+    const bool loaded = cacheHit || seq->load_from_memory(text, textSize);
+    // A restored sequence carries no verdict, so its text is hashed like a freshly parsed one
+    if (loaded && cacheHit && hashInline && seq->isSigned())
+        seq->SetCalculatedSignature(ExternalSequence::CalculateMD5(text, std::min(seq->GetSignedSize(), textSize)));
+    if (!loaded)
     {
-        m_mainWindow->setEnabled(true);
         std::stringstream sLog;
-        sLog << "Failed to load Pulseq file: " << sPulseqFilePath.toStdString() << "\n\n";
+        sLog << "Failed to load Pulseq file: " << path.toStdString() << "\n\n";
         sLog << "Possible causes:\n";
         sLog << "1. Missing required definitions for:\n";
         sLog << "   - AdcRasterTime (ADC sampling raster time)\n";
@@ -325,54 +381,39 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
         sLog << "2. File format issues or corruption\n";
         sLog << "3. Unsupported Pulseq version\n\n";
         sLog << "Please check the console output for detailed error messages.";
-        
-        if (m_silentMode) { qWarning() << sLog.str().c_str(); }
-        else { QMessageBox::critical(m_mainWindow, "Pulseq Load Error", sLog.str().c_str()); }
+        out.errorTitle = "Pulseq Load Error";
+        out.errorText = QString::fromStdString(sLog.str());
         return false;
     }
-    // Do not use setWindowFilePath for the main window title, because it can auto-compose
-    // "file - AppName" which conflicts with our explicit "SeqEyes - file.seq" title.
-    if (m_mainWindow) { m_mainWindow->setWindowFilePath(QString()); }
+    if (cancelled()) return false;
+
+    out.systemParams = readSystemParameters(seq);
 
     // Enforce presence of GradientRasterTime. If missing, abort load and inform user.
+    if (out.systemParams.gradRasterUs <= 0.0)
     {
-        std::vector<double> gradDef = m_spPulseqSeq->GetDefinition("GradientRasterTime");
-        bool ok = !gradDef.empty() && std::isfinite(gradDef[0]) && gradDef[0] > 0.0;
-        if (!ok)
-        {
-            m_mainWindow->setEnabled(true);
-            const char* msg = "Missing required definition: GradientRasterTime (seconds)\n\n"
-                              "The sequence lacks GradientRasterTime in [DEFINITIONS].\n"
-                              "Please add e.g. 'GradientRasterTime = 1e-5' and reload.";
-            if (m_silentMode) { qWarning() << msg; }
-            else { QMessageBox::critical(m_mainWindow, "Missing Definition", msg); }
-            ClearPulseqCache();
-            return false;
-        }
+        out.errorTitle = "Missing Definition";
+        out.errorText = "Missing required definition: GradientRasterTime (seconds)\n\n"
+                        "The sequence lacks GradientRasterTime in [DEFINITIONS].\n"
+                        "Please add e.g. 'GradientRasterTime = 1e-5' and reload.";
+        return false;
     }
 
     // Debug: Check if gradient library was loaded
     qDebug() << "Pulseq file loaded successfully";
-    qDebug() << "Total blocks:" << m_spPulseqSeq->GetNumberOfBlocks();
+    qDebug() << "Total blocks:" << seq->GetNumberOfBlocks();
     
     // Debug: Check gradient library loading
     if (WaveformDrawer::DEBUG_GRADIENT_LIBRARY) {
         qDebug() << "=== GRADIENT LIBRARY DEBUG ===";
         qDebug() << "Checking gradient library contents...";
         
-        // Check gradient raster time
-        // For v151 version, use GetDefinition to get gradient raster time
-        auto def = m_spPulseqSeq->GetDefinition("GradientRasterTime");
-        if (!def.empty()) {
-            double gradRaster_us = 1e6 * def[0]; // Convert from seconds to microseconds
-            qDebug() << "Gradient raster time:" << gradRaster_us << "us";
-        } else {
-            qDebug() << "WARNING: GradientRasterTime definition not found";
-        }
+        // Check gradient raster time (presence enforced above)
+        qDebug() << "Gradient raster time:" << out.systemParams.gradRasterUs << "us";
         
         // We need to access the gradient library from the sequence
         // Let's check a few sample blocks to see what gradient events are loaded
-        int totalBlocks = m_spPulseqSeq->GetNumberOfBlocks();
+        int totalBlocks = seq->GetNumberOfBlocks();
         const int MAX_DEBUG_BLOCKS = 20; // Maximum number of blocks to check for debugging
         int blocksToCheck = qMin(MAX_DEBUG_BLOCKS, totalBlocks);
         
@@ -380,7 +421,7 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
         qDebug() << "Checking first" << blocksToCheck << "blocks for gradient library debugging";
         
         for (int i = 0; i < blocksToCheck; i++) {
-            auto block = m_spPulseqSeq->GetBlock(i);
+            auto block = seq->GetBlock(i);
             if (block) {
                 qDebug() << "Block" << i << "gradient events:";
                 for (int ch = 0; ch < 3; ch++) {
@@ -400,6 +441,331 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
         qDebug() << "=== END GRADIENT LIBRARY DEBUG ===";
     }
 
+    const int64_t lSeqBlockNum = seq->GetNumberOfBlocks();
+    std::cout << lSeqBlockNum << " blocks detected!\n";
+    out.blockCount = static_cast<int>(lSeqBlockNum);
+
+    // Cached block edges are only reused for the time unit they were stored with
+    bool cachedEdges = false;
+    bool cachedShapeAgg = false;
+    if (cacheHit)
+    {
+        std::size_t edgesSize = 0;
+        const char* edges = cache.section(SequenceCache::kBlockEdgesSection, &edgesSize);
+        double cachedFactor = 0.0;
+        if (edges && edgesSize == sizeof(double) * std::size_t(lSeqBlockNum + 2))
+        {
+            memcpy(&cachedFactor, edges, sizeof(double));
+            if (cachedFactor == timeFactor)
+            {
+                out.blockEdges.resize(lSeqBlockNum + 1);
+                memcpy(out.blockEdges.data(), edges + sizeof(double), sizeof(double) * (lSeqBlockNum + 1));
+                cachedEdges = true;
+            }
+        }
+        std::size_t aggSize = 0;
+        const char* agg = cache.section(SequenceCache::kShapeScaleSection, &aggSize);
+        cachedShapeAgg = agg && loadShapeScaleAggregates(agg, aggSize, out.shapeAgg);
+        cache.close();
+    }
+
+    // Blocks are independent once the libraries are parsed (GetBlock/decodeBlock only read them),
+    // so decode contiguous chunks on a local pool. The failing block with the lowest index wins,
+    // matching the message of the old serial loop.
+    // Eager mode decodes everything as one window into out.blocks. Lazy mode walks fixed-size
+    // windows, feeds each one to the load-time builders and refills the same block objects
+    // for the next window.
+    // Block objects are filled in place in one contiguous array (out.blockStorage, or the
+    // window array in lazy mode) instead of one heap allocation per block.
+    const int64_t kLazyWindowBlocks = 16384;
+    const int64_t windowSize = lazy ? kLazyWindowBlocks : std::max<int64_t>(lSeqBlockNum, 1);
+    if (!lazy)
+    {
+        out.blockStorage = std::vector<SeqBlock>(static_cast<size_t>(lSeqBlockNum));
+        out.blocks.assign(lSeqBlockNum, nullptr);
+    }
+    std::vector<SeqBlock> windowStorage(lazy ? static_cast<size_t>(std::min(windowSize, lSeqBlockNum)) : 0);
+    std::vector<SeqBlock*> windowBlocks;
+    std::vector<double> blockDurations(static_cast<size_t>(lSeqBlockNum), 0.0);
+    std::atomic<int64_t> decodedCount {0};
+    std::atomic<int64_t> firstFailedBlock {lSeqBlockNum};
+    int lastProgress = -1;
+    auto reportDecoded = [&]() {
+        if (!progress || lSeqBlockNum <= 0) return;
+        int percent = int(decodedCount.load(std::memory_order_relaxed) * 100 / lSeqBlockNum);
+        if (percent != lastProgress) { progress(percent); lastProgress = percent; }
+    };
+
+    const int nThreads = std::max(1, QThread::idealThreadCount());
+    const int64_t kMinBlocksPerChunk = 256;
+    if (!cachedEdges)
+    {
+        out.blockEdges.clear();
+        out.blockEdges.resize(lSeqBlockNum + 1, 0);
+    }
+
+    // Envelope pyramids: level-0 bins start at 8 gradient raster periods and widen as needed
+    // so each channel stays within kEnvelopeMaxBins.
+    const std::size_t kEnvelopeMaxBins = std::size_t(1) << 17;
+    EnvelopeSet& env = out.envelopes;
+    env.gamma = gamma;
+    env.b0Tesla = out.systemParams.b0Tesla;
+    env.gradRasterUs = out.systemParams.gradRasterUs;
+    const double envelopeBinWidth = 8.0 * env.gradRasterUs * timeFactor;
+    env.rfAmp.reset(envelopeBinWidth, kEnvelopeMaxBins);
+    env.rfPh.reset(envelopeBinWidth, kEnvelopeMaxBins);
+    for (EnvelopePyramid& grad : env.grad) grad.reset(envelopeBinWidth, kEnvelopeMaxBins);
+    for (int64_t windowBegin = 0; windowBegin < lSeqBlockNum; windowBegin += windowSize)
+    {
+        const int64_t windowEnd = std::min(lSeqBlockNum, windowBegin + windowSize);
+        const int64_t windowLen = windowEnd - windowBegin;
+        // Lazy mode decodes into the window's own storage; out.blocks stays empty
+        SeqBlock** dst = nullptr;
+        SeqBlock* slots = nullptr;
+        if (lazy)
+        {
+            windowBlocks.assign(windowLen, nullptr);
+            dst = windowBlocks.data();
+            slots = windowStorage.data();
+        }
+        else
+        {
+            dst = out.blocks.data() + windowBegin;
+            slots = out.blockStorage.data() + windowBegin;
+        }
+        auto decodeRange = [&](int64_t begin, int64_t end) {
+            for (int64_t ushBlockIndex = begin; ushBlockIndex < end; ushBlockIndex++)
+            {
+                if (cancel.load(std::memory_order_relaxed) || ushBlockIndex > firstFailedBlock.load(std::memory_order_relaxed))
+                    return;
+                SeqBlock* blk = slots + (ushBlockIndex - windowBegin);
+                seq->GetBlock(static_cast<int>(ushBlockIndex), blk);
+                dst[ushBlockIndex - windowBegin] = blk;
+                if (!seq->decodeBlock(blk))
+                {
+                    int64_t prev = firstFailedBlock.load();
+                    while (ushBlockIndex < prev && !firstFailedBlock.compare_exchange_weak(prev, ushBlockIndex)) {}
+                    return;
+                }
+                blockDurations[ushBlockIndex] = blk->GetDuration() * timeFactor;
+                decodedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        const int64_t nChunks = std::min<int64_t>(int64_t(nThreads) * 4, (windowLen + kMinBlocksPerChunk - 1) / kMinBlocksPerChunk);
+        if (nThreads == 1 || nChunks <= 1)
+        {
+            decodeRange(windowBegin, windowEnd);
+        }
+        else
+        {
+            QThreadPool pool;
+            pool.setMaxThreadCount(nThreads);
+            for (int64_t c = 0; c < nChunks; ++c)
+            {
+                const int64_t begin = windowBegin + windowLen * c / nChunks;
+                const int64_t end = windowBegin + windowLen * (c + 1) / nChunks;
+                pool.start([&decodeRange, begin, end]() { decodeRange(begin, end); });
+            }
+            while (!pool.waitForDone(50))
+                reportDecoded();
+        }
+        reportDecoded();
+        if (cancelled()) return false;
+        if (firstFailedBlock.load() < lSeqBlockNum)
+        {
+            out.releaseBlocks();
+            out.errorTitle = "File Error";
+            out.errorText = QString("Decode SeqBlock failed, block index: %1").arg(firstFailedBlock.load());
+            return false;
+        }
+
+        // Block edges: serial prefix sum over the per-block durations (same summation order as before)
+        if (!cachedEdges)
+        {
+            for (int64_t i = windowBegin; i < windowEnd; ++i)
+                out.blockEdges[i + 1] = out.blockEdges[i] + blockDurations[i];
+        }
+
+        // Per-channel event index and block table; windows arrive in block order so every
+        // list stays sorted and table rows line up with the index entries
+        for (int64_t i = windowBegin; i < windowEnd; ++i)
+        {
+            SeqBlock* blk = dst[i - windowBegin];
+            out.table.append(static_cast<int>(i), blk);
+            if (!blk) continue;
+            const EventInterval ev {static_cast<int>(i), out.blockEdges[i], out.blockEdges[i + 1]};
+            if (blk->isRF()) out.channelEvents[ChannelRF].append(ev);
+            for (int ch = 0; ch < 3; ++ch)
+            {
+                if (blk->isTrapGradient(ch) || blk->isArbitraryGradient(ch) || blk->isExtTrapGradient(ch))
+                    out.channelEvents[ChannelGX + ch].append(ev);
+            }
+            if (blk->isADC()) out.channelEvents[ChannelADC].append(ev);
+            if (blk->isLabel()) out.channelEvents[ChannelLabel].append(ev);
+            if (blk->isTrigger()) out.channelEvents[ChannelTrigger].append(ev);
+        }
+
+        if (lazy)
+        {
+            const BlockSource window(windowBlocks);
+            SeriesBuilder::appendADCSeries(window, static_cast<int>(windowBegin), out.blockEdges, timeFactor, out.adcTime, out.adcValues);
+            buildLabelHistory(seq, window, static_cast<int>(windowBegin), out.labelHistory, out.usedExtensions);
+            if (!cachedShapeAgg) accumulateShapeScaleAggregates(window, out.shapeAgg);
+            accumulateEnvelopes(window, static_cast<int>(windowBegin), out.blockEdges, timeFactor, env);
+        }
+    }
+
+    if (!lazy)
+    {
+        // Build merged ADC series
+        SeriesBuilder::buildADCSeries(out.blocks, out.blockEdges, timeFactor, out.adcTime, out.adcValues);
+
+        // Label/flag transitions for fast UI queries (Information window, extension plot).
+        buildLabelHistory(seq, out.blocks, 0, out.labelHistory, out.usedExtensions);
+
+        // Precompute per-shape scale aggregates for RF/Gradients (single pass over blocks)
+        if (!cachedShapeAgg) buildShapeScaleAggregates(out.blocks, out.shapeAgg);
+
+        accumulateEnvelopes(out.blocks, 0, out.blockEdges, timeFactor, env);
+    }
+    env.rfAmp.finalize();
+    env.rfPh.finalize();
+    for (EnvelopePyramid& grad : env.grad) grad.finalize();
+    env.rfPhaseRealLike.clear();
+    if (cancelled()) return false;
+
+    // Add freshly parsed files to the cache (or refresh an entry written for another time unit).
+    // A failed write only costs the next reopen its speed-up.
+    if (useCache && !(cacheHit && cachedEdges && cachedShapeAgg))
+    {
+        std::string snapshot;
+        seq->saveSnapshot(snapshot);
+        QByteArray edges(reinterpret_cast<const char*>(&timeFactor), sizeof(double));
+        edges.append(reinterpret_cast<const char*>(out.blockEdges.constData()), qsizetype(sizeof(double) * out.blockEdges.size()));
+        const QByteArray shapeAgg = saveShapeScaleAggregates(out.shapeAgg);
+        const QList<QPair<quint32, QByteArrayView>> sections {
+            { SequenceCache::kSequenceSection, QByteArrayView(snapshot.data(), qsizetype(snapshot.size())) },
+            { SequenceCache::kBlockEdgesSection, QByteArrayView(edges) },
+            { SequenceCache::kShapeScaleSection, QByteArrayView(shapeAgg) },
+        };
+        if (!SequenceCache::store(cacheKey, sections, cacheLimitBytes))
+            qWarning() << "Could not write the sequence cache entry for" << path;
+    }
+
+    out.seq = seq;
+    return true;
+}
+
+bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
+{
+    if (m_loadInProgress)
+    {
+        qWarning() << "Ignoring load request while another file is loading:" << sPulseqFilePath;
+        return false;
+    }
+    m_loadInProgress = true;
+    m_lastLoadCancelled = false;
+    m_loadCancelRequested.store(false);
+    m_mainWindow->setLoadInProgress(true);
+
+    // Setup time units and factor before loading
+    updateTimeUnitFromSettings();
+
+    QProgressBar* progressBar = m_mainWindow->getProgressBar();
+    progressBar->setValue(0);
+    progressBar->show();
+    auto reportProgress = [progressBar](int percent) {
+        if (QThread::currentThread() == progressBar->thread()) { progressBar->setValue(percent); return; }
+        QMetaObject::invokeMethod(progressBar, [progressBar, percent]() { progressBar->setValue(percent); }, Qt::QueuedConnection);
+    };
+
+    // Parse + decode off the GUI thread. The window keeps repainting and the status-bar
+    // Cancel button stays live while we wait in a local event loop. Silent (test/CLI) mode
+    // runs the same job inline so callers see strictly synchronous behavior.
+    LoadedSequence staged;
+    bool jobOk = false;
+    const double timeFactor = tFactor;
+    const double gamma = Settings::getInstance().getGamma();
+    const bool lazy = Settings::getInstance().getLazyBlockDecoding();
+    const bool useCache = Settings::getInstance().getSequenceCacheEnabled();
+    const qint64 cacheLimitBytes = qint64(Settings::getInstance().getSequenceCacheLimitMB()) * 1024 * 1024;
+    // Interactive loads hash the signed text in the background while it is parsed and report the
+    // verdict once the sequence is shown; silent loads keep the verdict (and its console warning)
+    // part of the load.
+    const bool hashInline = m_silentMode && m_signatureCheckEnabled;
+
+    // Map the file once: the version probe, the parser and the background signature check all
+    // read the mapped pages in place. The mapping lives until the last of them drops the file.
+    const std::shared_ptr<QFile> file = std::make_shared<QFile>(sPulseqFilePath);
+    const qint64 fileSize = file->open(QIODevice::ReadOnly) ? file->size() : 0;
+    const char* text = fileSize > 0 ? reinterpret_cast<const char*>(file->map(0, fileSize)) : nullptr;
+    const std::size_t textSize = text ? std::size_t(fileSize) : 0;
+    if (text && !hashInline && m_signatureCheckEnabled)
+    {
+        startSignatureCheck(file, text, textSize);
+    }
+    auto job = [&]() { jobOk = runLoadJob(sPulseqFilePath, text, textSize, timeFactor, gamma, lazy, useCache, cacheLimitBytes, hashInline, m_loadCancelRequested, reportProgress, staged); };
+    if (m_silentMode)
+    {
+        job();
+    }
+    else
+    {
+        QEventLoop waitLoop;
+        QThread* worker = QThread::create(job);
+        connect(worker, &QThread::finished, &waitLoop, &QEventLoop::quit);
+        worker->start();
+        waitLoop.exec();
+        worker->wait();
+        delete worker;
+    }
+    progressBar->hide();
+    m_loadInProgress = false;
+
+    if (!jobOk)
+    {
+        cancelPendingSignatureCheck();
+        m_mainWindow->setLoadInProgress(false);
+        if (staged.cancelled)
+        {
+            m_lastLoadCancelled = true;
+            std::cout << "Loading cancelled: " << sPulseqFilePath.toStdString() << "\n";
+            return false;
+        }
+        if (m_silentMode) { qWarning() << staged.errorText; }
+        else { QMessageBox::critical(m_mainWindow, staged.errorTitle, staged.errorText); }
+        return false;
+    }
+
+    // Swap the finished model in one step; the previous sequence stays on screen until here.
+    ClearPulseqCache();
+    m_spPulseqSeq = staged.seq;
+    m_systemParams = staged.systemParams;
+    m_vecDecodeSeqBlocks.swap(staged.blocks);
+    m_blockStorage.swap(staged.blockStorage);
+    m_lazyDecoding = lazy;
+    m_lazyBlockCount = lazy ? staged.blockCount : 0;
+    if (lazy)
+    {
+        const std::size_t budgetBytes = std::size_t(Settings::getInstance().getBlockCacheBudgetMB()) * 1024 * 1024;
+        m_blockCache.reset(m_spPulseqSeq, budgetBytes);
+    }
+    vecBlockEdges.swap(staged.blockEdges);
+    m_adcTime.swap(staged.adcTime);
+    m_adcValues.swap(staged.adcValues);
+    m_labelHistory = std::move(staged.labelHistory);
+    m_usedExtensions.swap(staged.usedExtensions);
+    for (int ch = 0; ch < NumEventChannels; ++ch)
+        m_channelEvents[ch].swap(staged.channelEvents[ch]);
+    m_blockTable = std::move(staged.table);
+    m_shapeAgg = std::move(staged.shapeAgg);
+    m_envelopes = std::move(staged.envelopes);
+
+    // Do not use setWindowFilePath for the main window title, because it can auto-compose
+    // "file - AppName" which conflicts with our explicit "SeqEyes - file.seq" title.
+    if (m_mainWindow) { m_mainWindow->setWindowFilePath(QString()); }
+
     const int& shVersion = m_spPulseqSeq->GetVersion();
     const int& shVersionMajor = shVersion / 1000000L;
     const int& shVersionMinor = (shVersion / 1000L) % 1000L;
@@ -409,46 +775,20 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
     // Do not show redundant version label in status bar; keep cached string only
     if (m_mainWindow->getVersionLabel()) m_mainWindow->getVersionLabel()->setVisible(false);
 
-    const int64_t& lSeqBlockNum = m_spPulseqSeq->GetNumberOfBlocks();
-    std::cout << lSeqBlockNum << " blocks detected!\n";
-    m_vecDecodeSeqBlocks.resize(lSeqBlockNum);
-    m_mainWindow->getProgressBar()->show();
-    m_mainWindow->getProgressBar()->setValue(0);
-    vecBlockEdges.clear();
-    vecBlockEdges.resize(lSeqBlockNum + 1, 0);
-    for (int64_t ushBlockIndex = 0; ushBlockIndex < lSeqBlockNum; ushBlockIndex++)
-    {
-        m_vecDecodeSeqBlocks[ushBlockIndex] = m_spPulseqSeq->GetBlock(ushBlockIndex);
-        if (!m_spPulseqSeq->decodeBlock(m_vecDecodeSeqBlocks[ushBlockIndex]))
-        {
-            std::stringstream sLog;
-            sLog << "Decode SeqBlock failed, block index: " << ushBlockIndex;
-            if (m_silentMode) { qWarning() << sLog.str().c_str(); }
-            else { QMessageBox::critical(m_mainWindow, "File Error", sLog.str().c_str()); }
-            ClearPulseqCache();
-            m_mainWindow->setEnabled(true);
-            return false;
-        }
-        int progress = (ushBlockIndex + 1) * 100 / lSeqBlockNum;
-        m_mainWindow->getProgressBar()->setValue(progress);
-        vecBlockEdges[ushBlockIndex + 1] = vecBlockEdges[ushBlockIndex] + m_vecDecodeSeqBlocks[ushBlockIndex]->GetDuration() * tFactor;
-    }
+    const int64_t lSeqBlockNum = staged.blockCount;
     updateEchoAndExcitationMetadata(shVersionMajor, shVersionMinor);
 
     // Prefer explicit TotalDuration from definitions if available
     // Otherwise, fall back to accumulated block edges
-    std::vector<double> totalDurationDef = m_spPulseqSeq->GetDefinition("TotalDuration");
-    if (!totalDurationDef.empty())
+    if (m_systemParams.totalDurationUs > 0.0)
     {
-        // TotalDuration is in seconds → convert to microseconds
-        m_dTotalDuration_us = totalDurationDef[0] * 1e6;
+        m_dTotalDuration_us = m_systemParams.totalDurationUs;
     }
     else
     {
         m_dTotalDuration_us = vecBlockEdges[lSeqBlockNum] / tFactor;
     }
     std::cout << "Sequence total duration: " << m_dTotalDuration_us / 1e6 << " seconds" << std::endl;
-    m_mainWindow->getProgressBar()->hide();
 
     // Build merged series once at load time (no zero padding, only NaN on real gaps)
     // Phase 1 optimization: skip building merged RF arrays (expensive for large sequences).
@@ -459,19 +799,10 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
     m_gxTime.clear(); m_gxValues.clear();
     m_gyTime.clear(); m_gyValues.clear();
     m_gzTime.clear(); m_gzValues.clear();
-    
-    // Build merged ADC series
-    SeriesBuilder::buildADCSeries(m_vecDecodeSeqBlocks, vecBlockEdges, tFactor, m_adcTime, m_adcValues);
-
-    // Cache label/flag values after each block for fast UI queries (Information window).
-    buildLabelSnapshotCache();
 
     nBlockRangeStart = 0;
     nBlockRangeEnd = std::min(int(lSeqBlockNum - 1), 10);
 
-    // Precompute per-shape scale aggregates for RF/Gradients (single pass over blocks)
-    buildShapeScaleAggregates();
-
     WaveformDrawer* drawer = m_mainWindow->getWaveformDrawer();
     // Compute fixed Y-axis ranges based on full-sequence data to avoid per-TR/window autoscale jitter.
     // This keeps comparisons consistent when toggling TRs or panning/zooming.
@@ -537,17 +868,9 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
     }
 
     // TR Detection
-    std::vector<double> repTimeDef = m_spPulseqSeq->GetDefinition("RepetitionTime");
-    std::vector<double> trDef = m_spPulseqSeq->GetDefinition("TR");
-
-    if (!repTimeDef.empty())
-    {
-        m_dRepetitionTime_us = repTimeDef[0] * 1e6;
-        m_bHasRepetitionTime = true;
-    }
-    else if (!trDef.empty())
+    if (m_systemParams.repetitionTimeUs > 0.0)
     {
-        m_dRepetitionTime_us = trDef[0] * 1e6;
+        m_dRepetitionTime_us = m_systemParams.repetitionTimeUs;
         m_bHasRepetitionTime = true;
     }
     else
@@ -555,40 +878,7 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
         m_bHasRepetitionTime = false;
     }
 
-    if (m_bHasRepetitionTime)
-    {
-        m_nTrCount = static_cast<int>(std::ceil(m_dTotalDuration_us / m_dRepetitionTime_us));
-        m_vecTrBlockIndices.clear();
-        for (int tr = 0; tr < m_nTrCount; ++tr)
-        {
-            double trStartTime = tr * m_dRepetitionTime_us * tFactor;
-            int closestBlock = 0;
-            double minDistance = std::numeric_limits<double>::max();
-            for (int i = 0; i < lSeqBlockNum; ++i)
-            {
-                double blockStartTime = vecBlockEdges[i];
-                double distance = std::abs(blockStartTime - trStartTime);
-                if (distance < minDistance)
-                {
-                    minDistance = distance;
-                    closestBlock = i;
-                }
-            }
-            m_vecTrBlockIndices.push_back(closestBlock);
-        }
-    }
-    else
-    {
-        m_vecTrBlockIndices.clear();
-        for (int i = 0; i < lSeqBlockNum; ++i)
-        {
-            if (m_vecDecodeSeqBlocks[i]->isADC())
-            {
-                m_vecTrBlockIndices.push_back(i);
-            }
-        }
-        m_nTrCount = m_vecTrBlockIndices.size();
-    }
+    rebuildTrBlockIndices();
 
     // Update TR manager with new info
     TRManager* trManager = m_mainWindow->getTRManager();
@@ -606,109 +896,227 @@ bool PulseqLoader::LoadPulseqFile(const QString& sPulseqFilePath)
         // Show "SeqEyes - file.seq" only after a successful load.
         m_mainWindow->setLoadedFileTitle(sPulseqFilePath);
     }
-    m_mainWindow->setEnabled(true);
+    m_mainWindow->setLoadInProgress(false);
+    commitSignatureCheck();
     return true;
 }
 
-void PulseqLoader::buildLabelSnapshotCache()
+void PulseqLoader::startSignatureCheck(const std::shared_ptr<QFile>& file, const char* text, std::size_t textSize)
 {
-    m_labelSnapshots.clear();
-    m_usedExtensions.clear();
-    const int nBlocks = static_cast<int>(m_vecDecodeSeqBlocks.size());
+    cancelPendingSignatureCheck();
+    const std::shared_ptr<std::atomic<bool>> cancel = std::make_shared<std::atomic<bool>>(false);
+    m_pendingSignatureCheck.cancel = cancel;
+    // The task holds the file, so the mapping outlives the load if hashing takes longer
+    m_signaturePool.start([this, file, text, textSize, cancel]() {
+        std::size_t signedSize = 0;
+        if (!ExternalSequence::FindSignedSize(text, textSize, signedSize))
+        {
+            return;
+        }
+        const std::string hash = ExternalSequence::CalculateMD5(text, signedSize,
+            [&cancel]() { return cancel->load(std::memory_order_relaxed); });
+        if (hash.empty())
+        {
+            return;
+        }
+        QMetaObject::invokeMethod(this, [this, cancel, signedSize, hash]() { onSignatureHashed(cancel, signedSize, hash); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void PulseqLoader::onSignatureHashed(const std::shared_ptr<std::atomic<bool>>& cancel, std::size_t signedSize, const std::string& hash)
+{
+    // Hashing finished before the load: keep the result until the sequence is swapped in
+    if (cancel == m_pendingSignatureCheck.cancel)
+    {
+        m_pendingSignatureCheck.hashed = true;
+        m_pendingSignatureCheck.signedSize = signedSize;
+        m_pendingSignatureCheck.hash = hash;
+        return;
+    }
+    // Otherwise only the check of the shown sequence counts; results of closed or replaced ones are dropped
+    if (cancel == m_signatureCheck.cancel)
+    {
+        applySignatureCheck(signedSize, hash);
+    }
+}
+
+void PulseqLoader::commitSignatureCheck()
+{
+    m_signatureCheck = m_pendingSignatureCheck;
+    m_pendingSignatureCheck = SignatureCheck();
+    if (m_signatureCheck.hashed)
+    {
+        applySignatureCheck(m_signatureCheck.signedSize, m_signatureCheck.hash);
+    }
+}
+
+void PulseqLoader::applySignatureCheck(std::size_t signedSize, const std::string& hash)
+{
+    const std::shared_ptr<ExternalSequence> seq = m_spPulseqSeq;
+    // Only MD5 signatures can be checked
+    if (!seq || !seq->isSigned() || seq->getSignatureType() != "md5")
+    {
+        return;
+    }
+    if (signedSize != seq->GetSignedSize())
+    {
+        qWarning() << "Sequence signature not checked: the hashed range differs from the parsed one";
+        return;
+    }
+    const bool verified = seq->SetCalculatedSignature(hash);
+    if (verified)
+    {
+        qDebug() << "Sequence signature verified:" << QString::fromStdString(hash);
+        if (m_mainWindow) m_mainWindow->statusBar()->showMessage("Sequence signature verified", 3000);
+    }
+    else
+    {
+        qWarning() << "Sequence signature check failed: stored" << QString::fromStdString(seq->getSignature())
+                   << "calculated" << QString::fromStdString(hash);
+        if (m_mainWindow) m_mainWindow->statusBar()->showMessage("Warning: the sequence does not match its [SIGNATURE] hash", 10000);
+    }
+}
+
+void PulseqLoader::cancelSignatureCheck()
+{
+    if (m_signatureCheck.cancel) m_signatureCheck.cancel->store(true);
+    m_signatureCheck = SignatureCheck();
+}
+
+void PulseqLoader::cancelPendingSignatureCheck()
+{
+    if (m_pendingSignatureCheck.cancel) m_pendingSignatureCheck.cancel->store(true);
+    m_pendingSignatureCheck = SignatureCheck();
+}
+
+void PulseqLoader::LabelHistory::clear()
+{
+    for (auto& t : counters) t.clear();
+    for (auto& t : flags) t.clear();
+    blockCount = 0;
+    maxAbsEventValue = 0;
+}
+
+int PulseqLoader::LabelHistory::valueAfterBlock(const std::vector<LabelTransition>& transitions, int blockIdx)
+{
+    auto it = std::upper_bound(transitions.begin(), transitions.end(), blockIdx,
+                               [](int b, const LabelTransition& t) { return b < t.block; });
+    return it == transitions.begin() ? 0 : std::prev(it)->value;
+}
+
+int PulseqLoader::LabelHistory::maxValueInBlocks(const std::vector<LabelTransition>& transitions, int firstBlock, int lastBlock)
+{
+    auto it = std::upper_bound(transitions.begin(), transitions.end(), firstBlock,
+                               [](int b, const LabelTransition& t) { return b < t.block; });
+    int maxValue = it == transitions.begin() ? 0 : std::prev(it)->value;
+    for (; it != transitions.end() && it->block <= lastBlock; ++it)
+        maxValue = std::max(maxValue, it->value);
+    return maxValue;
+}
+
+void PulseqLoader::buildLabelHistory(const std::shared_ptr<ExternalSequence>& seq,
+                                     const BlockSource& blocks, int firstBlock,
+                                     LabelHistory& history, QSet<QString>& usedExtensions)
+{
+    if (firstBlock == 0)
+    {
+        history.clear();
+        usedExtensions.clear();
+    }
+    const int nBlocks = static_cast<int>(blocks.size());
     if (nBlocks <= 0)
         return;
+    history.blockCount = firstBlock + nBlocks;
+
+    // Records the value after 'block'. The last transition holds the current value, so state
+    // carries over between lazy windows without a separate running copy.
+    auto setValue = [](std::vector<LabelTransition>& transitions, int block, int value) {
+        if (!transitions.empty() && transitions.back().block == block)
+            transitions.back().value = value;
+        else if (transitions.empty() || transitions.back().value != value)
+            transitions.push_back({block, value});
+    };
+    auto currentValue = [](const std::vector<LabelTransition>& transitions) {
+        return transitions.empty() ? 0 : transitions.back().value;
+    };
 
     // Do NOT call pulseq's LabelStateAndBookkeeping::updateLabelValues here because
     // it can crash on unknown label IDs (>=1000) for LABELINC events. We apply events ourselves with bounds checks.
-    QVector<int>  counterVal(NUM_LABELS, 0);
-    QVector<bool> flagVal(NUM_FLAGS, false);
-
-    m_labelSnapshots.resize(nBlocks);
     for (int i = 0; i < nBlocks; ++i)
     {
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-        if (blk && blk->isLabel())
+        SeqBlock* blk = blocks[i];
+        if (!blk || !blk->isLabel())
+            continue;
+        const int blockIdx = firstBlock + i;
+
+        auto markCounterUsed = [&](int id) {
+            if (!seq) return;
+            const std::string s = seq->getCounterIdAsString(id);
+            if (!s.empty()) { usedExtensions.insert(QString::fromStdString(s).toUpper()); return; }
+            const std::string u = seq->GetUnknownLabelName(id);
+            if (!u.empty()) { usedExtensions.insert(QString::fromStdString(u).toUpper()); return; }
+            usedExtensions.insert(QString("LABEL[%1]").arg(id).toUpper());
+        };
+        auto markFlagUsed = [&](int id) {
+            if (!seq) return;
+            const std::string s = seq->getFlagIdAsString(id);
+            if (!s.empty()) { usedExtensions.insert(QString::fromStdString(s).toUpper()); return; }
+            usedExtensions.insert(QString("FLAG[%1]").arg(id).toUpper());
+        };
+
+        // Apply LABELSET first, then LABELINC (same semantics as SeqPlot.m and pulseq runtime).
+        const auto& sets = blk->GetLabelSetEvents();
+        for (const auto& e : sets)
         {
-            auto seq = m_spPulseqSeq;
-            auto markCounterUsed = [&](int id) {
-                if (!seq) return;
-                const std::string s = seq->getCounterIdAsString(id);
-                if (!s.empty()) { m_usedExtensions.insert(QString::fromStdString(s).toUpper()); return; }
-                const std::string u = seq->GetUnknownLabelName(id);
-                if (!u.empty()) { m_usedExtensions.insert(QString::fromStdString(u).toUpper()); return; }
-                m_usedExtensions.insert(QString("LABEL[%1]").arg(id).toUpper());
-            };
-            auto markFlagUsed = [&](int id) {
-                if (!seq) return;
-                const std::string s = seq->getFlagIdAsString(id);
-                if (!s.empty()) { m_usedExtensions.insert(QString::fromStdString(s).toUpper()); return; }
-                m_usedExtensions.insert(QString("FLAG[%1]").arg(id).toUpper());
-            };
-
-            // Apply LABELSET first, then LABELINC (same semantics as SeqPlot.m and pulseq runtime).
-            const auto& sets = blk->GetLabelSetEvents();
-            for (const auto& e : sets)
-            {
-                const int lblId = e.numVal.first;
-                const int val = e.numVal.second;
-                const int flagId = e.flagVal.first;
-                const bool fval = e.flagVal.second;
+            const int lblId = e.numVal.first;
+            const int val = e.numVal.second;
+            const int flagId = e.flagVal.first;
+            const bool fval = e.flagVal.second;
+            history.maxAbsEventValue = std::max(history.maxAbsEventValue, std::abs(val));
 
-                if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
-                {
-                    counterVal[lblId] = val;
-                    markCounterUsed(lblId);
-                }
-                if (flagId >= 0 && flagId < NUM_FLAGS && flagId != FLAG_UNKNOWN)
-                {
-                    flagVal[flagId] = fval;
-                    markFlagUsed(flagId);
-                }
+            if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
+            {
+                setValue(history.counters[lblId], blockIdx, val);
+                markCounterUsed(lblId);
             }
-            const auto& incs = blk->GetLabelIncEvents();
-            for (const auto& e : incs)
+            if (flagId >= 0 && flagId < NUM_FLAGS && flagId != FLAG_UNKNOWN)
             {
-                const int lblId = e.numVal.first;
-                const int val = e.numVal.second;
-                if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
-                {
-                    counterVal[lblId] += val;
-                    markCounterUsed(lblId);
-                }
+                setValue(history.flags[flagId], blockIdx, fval ? 1 : 0);
+                markFlagUsed(flagId);
+            }
+        }
+        const auto& incs = blk->GetLabelIncEvents();
+        for (const auto& e : incs)
+        {
+            const int lblId = e.numVal.first;
+            const int val = e.numVal.second;
+            history.maxAbsEventValue = std::max(history.maxAbsEventValue, std::abs(val));
+            if (lblId >= 0 && lblId < NUM_LABELS && lblId != LABEL_UNKNOWN)
+            {
+                std::vector<LabelTransition>& transitions = history.counters[lblId];
+                setValue(transitions, blockIdx, currentValue(transitions) + val);
+                markCounterUsed(lblId);
             }
         }
-
-        LabelSnapshot snap;
-        snap.counters = counterVal;
-        snap.flags = flagVal;
-        m_labelSnapshots[i] = snap;
     }
 }
 
-const PulseqLoader::LabelSnapshot* PulseqLoader::labelSnapshotAfterBlock(int blockIdx) const
-{
-    if (blockIdx < 0 || blockIdx >= m_labelSnapshots.size())
-        return nullptr;
-    return &m_labelSnapshots[blockIdx];
-}
-
 bool PulseqLoader::getCounterValueAfterBlock(int blockIdx, int counterId, int& outVal) const
 {
     outVal = 0;
-    const LabelSnapshot* s = labelSnapshotAfterBlock(blockIdx);
-    if (!s) return false;
-    if (counterId < 0 || counterId >= s->counters.size()) return false;
-    outVal = s->counters[counterId];
+    if (blockIdx < 0 || blockIdx >= m_labelHistory.blockCount) return false;
+    if (counterId < 0 || counterId >= NUM_LABELS) return false;
+    outVal = LabelHistory::valueAfterBlock(m_labelHistory.counters[counterId], blockIdx);
     return true;
 }
 
 bool PulseqLoader::getFlagValueAfterBlock(int blockIdx, int flagId, bool& outVal) const
 {
     outVal = false;
-    const LabelSnapshot* s = labelSnapshotAfterBlock(blockIdx);
-    if (!s) return false;
-    if (flagId < 0 || flagId >= s->flags.size()) return false;
-    outVal = s->flags[flagId];
+    if (blockIdx < 0 || blockIdx >= m_labelHistory.blockCount) return false;
+    if (flagId < 0 || flagId >= NUM_FLAGS) return false;
+    outVal = LabelHistory::valueAfterBlock(m_labelHistory.flags[flagId], blockIdx) != 0;
     return true;
 }
 
@@ -724,7 +1132,8 @@ void PulseqLoader::setBlockInfoContent(EventBlockInfoDialog* dialog, int current
         .arg(vecBlockEdges[currentBlock + 1])
         .arg(TimeUnits);
 
-    const auto& pSeqBlock = m_vecDecodeSeqBlocks[currentBlock];
+    SeqBlock* pSeqBlock = getDecodedSeqBlocks()[currentBlock];
+    if (!pSeqBlock) return;
     if (pSeqBlock->isRF())
     {
         blockInfo += QString("|-----------------------------------------------------------------------------------------------|\n");
@@ -814,9 +1223,10 @@ void PulseqLoader::setBlockInfoContent(EventBlockInfoDialog* dialog, int current
 void PulseqLoader::setRawBlockInfoContent(EventBlockInfoDialog* dialog, int currentBlock)
 {
     if (!dialog) return;
-    if (currentBlock < 0 || currentBlock >= static_cast<int>(m_vecDecodeSeqBlocks.size())) return;
+    const BlockSource blocks = getDecodedSeqBlocks();
+    if (currentBlock < 0 || currentBlock >= blocks.size()) return;
 
-    SeqBlock* blk = m_vecDecodeSeqBlocks[currentBlock];
+    SeqBlock* blk = blocks[currentBlock];
     if (!blk) return;
 
     QString s;
@@ -867,26 +1277,44 @@ void PulseqLoader::setManualRepetitionTime(double trValue)
 {
     m_dRepetitionTime_us = trValue * 1e6; // Convert to microseconds
     m_bHasRepetitionTime = true;
+    rebuildTrBlockIndices();
+}
 
-    m_nTrCount = static_cast<int>(std::ceil(m_dTotalDuration_us / m_dRepetitionTime_us));
-
+void PulseqLoader::rebuildTrBlockIndices()
+{
     m_vecTrBlockIndices.clear();
-    for (int tr = 0; tr < m_nTrCount; ++tr)
+    const int numBlocks = int(vecBlockEdges.size()) - 1;
+
+    if (!m_bHasRepetitionTime)
     {
-        double trStartTime = tr * m_dRepetitionTime_us * tFactor;
-        int closestBlock = 0;
-        double minDistance = std::numeric_limits<double>::max();
-        for (int i = 0; i < m_vecDecodeSeqBlocks.size(); ++i)
-        {
-            double blockStartTime = vecBlockEdges[i];
-            double distance = std::abs(blockStartTime - trStartTime);
-            if (distance < minDistance)
-            {
-                minDistance = distance;
-                closestBlock = i;
-            }
-        }
-        m_vecTrBlockIndices.push_back(closestBlock);
+        // ADC-based TRs: one per ADC block, straight from the channel event index
+        const QVector<EventInterval>& adcEvents = m_channelEvents[ChannelADC];
+        m_vecTrBlockIndices.reserve(adcEvents.size());
+        for (const EventInterval& ev : adcEvents)
+            m_vecTrBlockIndices.push_back(ev.block);
+        m_nTrCount = static_cast<int>(m_vecTrBlockIndices.size());
+        return;
+    }
+
+    m_nTrCount = static_cast<int>(std::ceil(m_dTotalDuration_us / m_dRepetitionTime_us));
+    if (numBlocks <= 0)
+    {
+        m_vecTrBlockIndices.assign(std::max(m_nTrCount, 0), 0);
+        return;
+    }
+
+    // Each TR starts at the block whose start edge is nearest to tr * TR (the first such
+    // block on ties); the block start edges are sorted, so one binary search per TR.
+    m_vecTrBlockIndices.reserve(std::max(m_nTrCount, 0));
+    const auto first = vecBlockEdges.cbegin();
+    const auto last = first + numBlocks;
+    for (int tr = 0; tr < m_nTrCount; ++tr)
+    {
+        const double trStartTime = tr * m_dRepetitionTime_us * tFactor;
+        auto it = std::lower_bound(first, last, trStartTime);
+        if (it == last || (it != first && trStartTime - *(it - 1) <= *it - trStartTime))
+            it = std::lower_bound(first, last, *(it - 1)); // earliest block starting there
+        m_vecTrBlockIndices.push_back(int(std::distance(first, it)));
     }
 }
 
@@ -903,6 +1331,41 @@ bool PulseqLoader::IsBlockRf(const float* fAmp, const float* fPhase, const int&
     return false;
 }
 
+PulseqLoader::SystemParameters PulseqLoader::readSystemParameters(const std::shared_ptr<ExternalSequence>& seq)
+{
+    SystemParameters params;
+    if (!seq)
+        return params;
+
+    // First value of a definition if it is a positive, finite number; 0 otherwise
+    auto positive = [&seq](const char* key) {
+        std::vector<double> def = seq->GetDefinition(key);
+        return (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0) ? def[0] : 0.0;
+    };
+    auto positiveEither = [&positive](const char* key, const char* fallbackKey) {
+        double v = positive(key);
+        return v > 0.0 ? v : positive(fallbackKey);
+    };
+
+    // Definitions are in seconds; keep microseconds like the rest of the loader
+    params.gradRasterUs = positive("GradientRasterTime") * 1e6;
+    params.rfRasterUs = positive("RadiofrequencyRasterTime") * 1e6;
+    params.adcRasterUs = positive("AdcRasterTime") * 1e6;
+    params.blockDurationRasterUs = positive("BlockDurationRaster") * 1e6;
+    params.fovMeters = positive("FOV");
+    params.repetitionTimeUs = positiveEither("RepetitionTime", "TR") * 1e6;
+    params.echoTimeUs = positiveEither("TE", "EchoTime") * 1e6;
+    params.totalDurationUs = positive("TotalDuration") * 1e6;
+
+    // If B0 is undefined, assume 3.0T (standard high field) for PPM calculations
+    // This maintains compatibility with sequences that use PPM but don't define B0,
+    // while remaining safe for legacy files (where freqPPM will be 0 anyway).
+    std::vector<double> defB0 = seq->GetDefinition("B0");
+    if (!defB0.empty() && defB0[0] != 0.0)
+        params.b0Tesla = defB0[0];
+    return params;
+}
+
 void PulseqLoader::updateEchoAndExcitationMetadata(int versionMajor, int versionMinor)
 {
     m_excitationCentersAxis.clear();
@@ -917,135 +1380,308 @@ void PulseqLoader::updateEchoAndExcitationMetadata(int versionMajor, int version
     if (!m_spPulseqSeq)
         return;
 
-    std::vector<double> teDef = m_spPulseqSeq->GetDefinition("TE");
-    if (teDef.empty())
-        teDef = m_spPulseqSeq->GetDefinition("EchoTime");
-    if (!teDef.empty())
+    if (m_systemParams.echoTimeUs > 0.0)
     {
         m_hasEchoTimeDefinition = true;
-        m_teTime_us = teDef[0] * 1e6;
+        m_teTime_us = m_systemParams.echoTimeUs;
         m_teDurationAxis = m_teTime_us * tFactor;
     }
 
-    if (m_vecDecodeSeqBlocks.empty() || vecBlockEdges.size() < 2)
+    if (m_blockTable.empty() || vecBlockEdges.size() < 2)
         return;
 
-    computeKSpaceTrajectory();
+    // The trajectory (and the excitation/refocusing centers derived from it) is computed in
+    // the background and streamed in, so the waveform view is usable right away.
+    startTrajectoryComputation();
 }
 
-
-void PulseqLoader::computeKSpaceTrajectory()
+QVector<double> PulseqLoader::adcSampleTimes(const BlockTable& table, const QVector<double>& edges,
+                                             double timeFactor, int firstBlock, int endBlock)
 {
-    double gradRasterUs = -1.0;
-    double rfRasterUs = -1.0;
-    if (m_spPulseqSeq) {
-        std::vector<double> def = m_spPulseqSeq->GetDefinition("GradientRasterTime");
-        if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0) {
-            gradRasterUs = def[0] * 1e6; // seconds -> microseconds
-        }
-        def = m_spPulseqSeq->GetDefinition("RadiofrequencyRasterTime");
-        if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0) {
-            rfRasterUs = def[0] * 1e6;
+    QVector<double> adcEventTimes;
+    const BlockTable::AdcColumns& adc = table.adc;
+    const int firstRow = static_cast<int>(std::lower_bound(adc.block.begin(), adc.block.end(), firstBlock) - adc.block.begin());
+    int endRow = firstRow;
+    qsizetype totalSamples = 0;
+    for (; endRow < adc.size() && adc.block[endRow] < endBlock; ++endRow) {
+        if (adc.numSamples[endRow] > 0)
+            totalSamples += adc.numSamples[endRow];
+    }
+    if (totalSamples > 0)
+        adcEventTimes.reserve(totalSamples);
+
+    for (int r = firstRow; r < endRow; ++r) {
+        const int numSamples = adc.numSamples[r];
+        if (numSamples <= 0 || adc.dwellNs[r] <= 0)
+            continue;
+        double dwellUs = static_cast<double>(adc.dwellNs[r]) * 1e-3; // ns -> us
+        double dwellInternal = dwellUs * timeFactor;
+        double startInternal = edges[adc.block[r]] + adc.delay[r] * timeFactor + 0.5 * dwellInternal;
+        for (int sample = 0; sample < numSamples; ++sample) {
+            adcEventTimes.append(startInternal + sample * dwellInternal);
         }
     }
+    return adcEventTimes;
+}
 
-    QVector<double> adcEventTimes;
-    if (!m_vecDecodeSeqBlocks.empty() && vecBlockEdges.size() >= 2) {
-        qsizetype totalSamples = 0;
-        for (SeqBlock* blk : m_vecDecodeSeqBlocks) {
-            if (!blk || !blk->isADC())
-                continue;
-            const ADCEvent& adc = blk->GetADCEvent();
-            if (adc.numSamples > 0)
-                totalSamples += adc.numSamples;
+void PulseqLoader::clearTrajectoryData()
+{
+    m_kTrajectoryReady = false;
+    m_kTrajectoryX.clear();
+    m_kTrajectoryY.clear();
+    m_kTrajectoryZ.clear();
+    m_kTimeSec.clear();
+    m_kTrajectoryXAdc.clear();
+    m_kTrajectoryYAdc.clear();
+    m_kTrajectoryZAdc.clear();
+    m_kTimeAdcSec.clear();
+    m_excitationCentersAxis.clear();
+    m_refocusingCentersAxis.clear();
+    m_rfUsePerBlock.clear();
+    m_rfUseGuessed = false;
+    m_rfGuessWarning.clear();
+    m_trajectoryCheckpoints.clear();
+    m_kxKyZeroTimesSec.clear();
+    m_kxKyZeroTimesValid = false;
+}
+
+void PulseqLoader::truncateTrajectoryData(int window)
+{
+    if (window <= 0)
+    {
+        clearTrajectoryData();
+        return;
+    }
+    window = std::min(window, static_cast<int>(m_trajectoryCheckpoints.size()));
+    const TrajectoryCheckpoint& kept = m_trajectoryCheckpoints[window - 1];
+    m_kTrajectoryReady = false;
+    m_kTrajectoryX.resize(kept.samples);
+    m_kTrajectoryY.resize(kept.samples);
+    m_kTrajectoryZ.resize(kept.samples);
+    m_kTimeSec.resize(kept.samples);
+    m_kTrajectoryXAdc.resize(kept.adcSamples);
+    m_kTrajectoryYAdc.resize(kept.adcSamples);
+    m_kTrajectoryZAdc.resize(kept.adcSamples);
+    m_kTimeAdcSec.resize(kept.adcSamples);
+    m_excitationCentersAxis.resize(kept.excitations);
+    m_refocusingCentersAxis.resize(kept.refocusings);
+    m_rfUsePerBlock.resize(kept.endBlock);
+    m_rfUseGuessed = kept.rfUseGuessed;
+    if (!m_rfUseGuessed)
+        m_rfGuessWarning.clear();
+    m_trajectoryCheckpoints.resize(window);
+    m_kxKyZeroTimesSec.clear();
+    m_kxKyZeroTimesValid = false;
+}
+
+void PulseqLoader::startTrajectoryComputation(int fromBlock)
+{
+    cancelTrajectoryComputation();
+    // Resume after the last complete window before fromBlock (windows may still be missing
+    // if an earlier pass was cancelled midway)
+    const int window = std::min(std::max(0, fromBlock) / kTrajectoryWindowBlocks,
+                                static_cast<int>(m_trajectoryCheckpoints.size()));
+    truncateTrajectoryData(window);
+    const double gamma = Settings::getInstance().getGamma();
+    m_trajectoryGamma = gamma;
+    const int nBlocks = std::min(m_blockTable.blockCount(), static_cast<int>(vecBlockEdges.size()) - 1);
+    if (nBlocks <= 0)
+        return;
+    const int startBlock = window * kTrajectoryWindowBlocks;
+    const KSpaceTrajectory::Carry startCarry = window > 0 ? m_trajectoryCheckpoints[window - 1].carry
+                                                          : KSpaceTrajectory::Carry();
+    if (startBlock >= nBlocks)
+    {
+        m_kTrajectoryReady = true;
+        return;
+    }
+
+    m_kTrajectoryComputing = true;
+    m_trajectoryRefreshTimer.start();
+    const quint64 generation = m_trajectoryGeneration;
+    // The job keeps its own copy of the edges (a time-unit rescale may replace them meanwhile)
+    // and the sequence (owner of the sample pointers in the block table). The table itself is
+    // only cleared after cancelTrajectoryComputation() has waited for the job.
+    const std::shared_ptr<ExternalSequence> seq = m_spPulseqSeq;
+    const QVector<double> edges = vecBlockEdges;
+    const double jobTFactor = tFactor;
+    const bool supportsRfUse = m_supportsRfUseMetadata;
+    const double rfRasterUs = m_systemParams.rfRasterUs > 0.0 ? m_systemParams.rfRasterUs : -1.0;
+    const double gradRasterUs = m_systemParams.gradRasterUs > 0.0 ? m_systemParams.gradRasterUs : -1.0;
+    // B0 is read at load time (SystemParameters); also needed to detect fat-sat RF use in v1.4.x files
+    const double b0Tesla = m_systemParams.b0Tesla;
+
+    m_trajectoryPool.start([this, seq, edges, nBlocks, startBlock, startCarry, generation, jobTFactor,
+                            supportsRfUse, rfRasterUs, gradRasterUs, b0Tesla, gamma]() {
+        KSpaceTrajectory::Carry carry = startCarry;
+        for (int first = startBlock; first < nBlocks; first += kTrajectoryWindowBlocks)
+        {
+            if (m_trajectoryCancelRequested.load(std::memory_order_relaxed))
+                return;
+            const int end = std::min(nBlocks, first + kTrajectoryWindowBlocks);
+            KSpaceTrajectory::Input input { m_blockTable,
+                                            edges,
+                                            jobTFactor,
+                                            supportsRfUse,
+                                            rfRasterUs,
+                                            gradRasterUs,
+                                            adcSampleTimes(m_blockTable, edges, jobTFactor, first, end),
+                                            b0Tesla,
+                                            gamma,
+                                            first,
+                                            end,
+                                            carry };
+            KSpaceTrajectory::Result part = KSpaceTrajectory::compute(input);
+            carry = part.carry;
+            const bool last = end >= nBlocks;
+            QMetaObject::invokeMethod(this, [this, generation, jobTFactor, first, end, part, last]() {
+                appendTrajectoryWindow(generation, jobTFactor, first, end, part, last);
+            }, Qt::QueuedConnection);
         }
-        if (totalSamples > 0)
-            adcEventTimes.reserve(totalSamples);
+    });
+}
 
-        for (int i = 0; i < static_cast<int>(m_vecDecodeSeqBlocks.size()); ++i) {
-            SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-            if (!blk || !blk->isADC())
-                continue;
-            const ADCEvent& adc = blk->GetADCEvent();
-            if (adc.numSamples <= 0 || adc.dwellTime <= 0)
-                continue;
-            double dwellUs = static_cast<double>(adc.dwellTime) * 1e-3; // ns -> us
-            double dwellInternal = dwellUs * tFactor;
-            double startInternal = vecBlockEdges[i] + adc.delay * tFactor + 0.5 * dwellInternal;
-            for (int sample = 0; sample < adc.numSamples; ++sample) {
-                adcEventTimes.append(startInternal + sample * dwellInternal);
-            }
+void PulseqLoader::cancelTrajectoryComputation()
+{
+    m_trajectoryCancelRequested.store(true);
+    m_trajectoryPool.waitForDone();
+    m_trajectoryCancelRequested.store(false);
+    ++m_trajectoryGeneration;
+    m_kTrajectoryComputing = false;
+}
+
+void PulseqLoader::appendTrajectoryWindow(quint64 generation, double jobTFactor, int firstBlock, int endBlock,
+                                          const KSpaceTrajectory::Result& part, bool last)
+{
+    // Stale window of a computation that has been cancelled or restarted since
+    if (generation != m_trajectoryGeneration)
+        return;
+
+    // Consecutive windows share their boundary grid point
+    const qsizetype skip = (firstBlock > 0 && !m_kTimeSec.isEmpty()) ? 1 : 0;
+    m_kTrajectoryX += part.kx.mid(skip);
+    m_kTrajectoryY += part.ky.mid(skip);
+    m_kTrajectoryZ += part.kz.mid(skip);
+    m_kTimeSec += part.t.mid(skip);
+    m_kTrajectoryXAdc += part.kx_adc;
+    m_kTrajectoryYAdc += part.ky_adc;
+    m_kTrajectoryZAdc += part.kz_adc;
+    m_kTimeAdcSec += part.t_adc;
+    m_rfUsePerBlock += part.rfUsePerBlock;
+    m_rfUseGuessed = m_rfUseGuessed || part.rfUseGuessed;
+    if (!part.warning.isEmpty())
+        m_rfGuessWarning = part.warning;
+
+    // Centers are in axis units of the time unit the job started with
+    const double ratio = jobTFactor != 0.0 ? tFactor / jobTFactor : 1.0;
+    for (double t : part.excitationTimesInternal)
+        m_excitationCentersAxis.append(t * ratio);
+    for (double t : part.refocusingTimesInternal)
+        m_refocusingCentersAxis.append(t * ratio);
+
+    TrajectoryCheckpoint checkpoint;
+    checkpoint.endBlock = endBlock;
+    checkpoint.samples = m_kTimeSec.size();
+    checkpoint.adcSamples = m_kTimeAdcSec.size();
+    checkpoint.excitations = m_excitationCentersAxis.size();
+    checkpoint.refocusings = m_refocusingCentersAxis.size();
+    checkpoint.rfUseGuessed = m_rfUseGuessed;
+    checkpoint.carry = part.carry;
+    m_trajectoryCheckpoints.append(checkpoint);
+
+    if (last)
+    {
+        m_kTrajectoryReady = true;
+        m_kTrajectoryComputing = false;
+    }
+
+    // Progressive display: redraw at most every 200 ms while windows stream in
+    if (m_mainWindow && (last || m_trajectoryRefreshTimer.elapsed() >= 200))
+    {
+        m_trajectoryRefreshTimer.restart();
+        m_mainWindow->onTrajectoryProgress(last);
+    }
+}
+
+void PulseqLoader::onGammaChanged()
+{
+    const double gamma = Settings::getInstance().getGamma();
+    if (gamma == m_trajectoryGamma || m_blockTable.empty())
+        return;
+
+    // Only guessed RF uses read gamma; find the first block whose use flips with the new value.
+    // Blocks not streamed in yet are computed with the new gamma anyway.
+    const BlockTable::RfColumns& rf = m_blockTable.rf;
+    const double b0Tesla = m_systemParams.b0Tesla;
+    int firstChanged = -1;
+    for (int row = 0; row < rf.size() && rf.block[row] < m_rfUsePerBlock.size(); ++row)
+    {
+        if (!KSpaceTrajectory::rfUseDependsOnGamma(rf, row, m_supportsRfUseMetadata))
+            continue;
+        const int block = rf.block[row];
+        if (KSpaceTrajectory::rfUse(rf, row, m_supportsRfUseMetadata, b0Tesla, gamma) != m_rfUsePerBlock[block])
+        {
+            firstChanged = block;
+            break;
         }
     }
 
-    // Read B0 from [DEFINITIONS] if available (needed to detect fat-sat RF use in v1.4.x files)
-    double b0Tesla = 0.0;
-    if (m_spPulseqSeq) {
-        std::vector<double> defB0 = m_spPulseqSeq->GetDefinition("B0");
-        if (!defB0.empty())
-            b0Tesla = defB0[0];
+    if (firstChanged < 0)
+    {
+        // Same trajectory; a pass still running just continues with the new value
+        if (m_kTrajectoryComputing)
+            startTrajectoryComputation(static_cast<int>(m_rfUsePerBlock.size()));
+        else
+            m_trajectoryGamma = gamma;
+        return;
     }
-    // If B0 is undefined, assume 3.0T (standard high field) for PPM calculations
-    // This maintains compatibility with sequences that use PPM but don't define B0,
-    // while remaining safe for legacy files (where freqPPM will be 0 anyway).
-    if (b0Tesla == 0.0) {
-        b0Tesla = 3.0; // Default to 3.0T to match KSpaceTrajectory
-        // qWarning() << "B0 not defined in sequence [DEFINITIONS]. Assuming 3.0T for PPM calculations.";
-    }
-    m_b0Tesla = b0Tesla; // Store for phase computation
-
-    KSpaceTrajectory::Input input { m_vecDecodeSeqBlocks,
-                                    vecBlockEdges,
-                                    tFactor,
-                                    m_supportsRfUseMetadata,
-                                    rfRasterUs,
-                                    gradRasterUs,
-                                    std::move(adcEventTimes),
-                                    b0Tesla };
-    KSpaceTrajectory::Result result = KSpaceTrajectory::compute(input);
-
-    m_excitationCentersAxis = result.excitationTimesInternal;
-    m_refocusingCentersAxis = result.refocusingTimesInternal;
-    m_kTrajectoryX = result.kx;
-    m_kTrajectoryY = result.ky;
-    m_kTrajectoryZ = result.kz;
-    m_kTimeSec      = result.t;
-    m_kTrajectoryXAdc = result.kx_adc;
-    m_kTrajectoryYAdc = result.ky_adc;
-    m_kTrajectoryZAdc = result.kz_adc;
-    m_kTimeAdcSec     = result.t_adc;
-    m_rfUseGuessed = result.rfUseGuessed;
-    m_rfGuessWarning = result.warning;
-    m_rfUsePerBlock = result.rfUsePerBlock;
-    m_kTrajectoryReady = true;
+
+    startTrajectoryComputation(firstChanged);
+    if (m_mainWindow)
+        m_mainWindow->onTrajectoryProgress(false);
 }
 
 void PulseqLoader::ensureTrajectoryPrepared()
 {
+    if (!m_kTrajectoryComputing)
+        return;
+    // Let the background pass finish, then deliver its queued windows right away
+    m_trajectoryPool.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+QVector<double> PulseqLoader::getKxKyZeroTimes() const
+{
+    QVector<double> result;
     if (!m_kTrajectoryReady)
+        return result;
+    // The crossings depend on the trajectory only; they are found once per computed trajectory
+    // and converted to the current time unit on the way out
+    if (!m_kxKyZeroTimesValid)
     {
-        computeKSpaceTrajectory();
+        m_kxKyZeroTimesSec = computeKxKyZeroTimesSec();
+        m_kxKyZeroTimesValid = true;
     }
+    const double secToAxis = 1e6 * getTFactor();
+    result.reserve(m_kxKyZeroTimesSec.size());
+    for (double tSec : m_kxKyZeroTimesSec)
+        result.append(tSec * secToAxis);
+    return result;
 }
 
-QVector<double> PulseqLoader::getKxKyZeroTimes() const
+QVector<double> PulseqLoader::computeKxKyZeroTimesSec() const
 {
     QVector<double> result;
-    if (!m_kTrajectoryReady || m_kTrajectoryX.isEmpty() || m_kTrajectoryY.isEmpty() || m_kTimeSec.isEmpty())
+    if (m_kTrajectoryX.isEmpty() || m_kTrajectoryY.isEmpty() || m_kTimeSec.isEmpty())
         return result;
 
     // Calculate tolerance based on FOV (deltak = 1/FOV)
     // Use 0.2 * deltak as tolerance to account for numerical precision and interpolation
     double kTolerance = 1e-3; // Default fallback tolerance
-    if (m_spPulseqSeq)
+    if (m_systemParams.fovMeters > 0.0)
     {
-        std::vector<double> def = m_spPulseqSeq->GetDefinition("FOV");
-        if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0)
-        {
-            double fovMeters = def[0];
-            double deltak = 1.0 / fovMeters; // k-space sampling interval
-            kTolerance = deltak * 0.2; // Use 20% of deltak as tolerance
-        }
+        double deltak = 1.0 / m_systemParams.fovMeters; // k-space sampling interval
+        kTolerance = deltak * 0.2; // Use 20% of deltak as tolerance
     }
 
     // Collect candidate kx=ky=0 times
@@ -1079,14 +1715,7 @@ QVector<double> PulseqLoader::getKxKyZeroTimes() const
         candidates.erase(std::unique(candidates.begin(), candidates.end(), [dupToleranceSec](double a, double b) {
             return qAbs(a - b) < dupToleranceSec;
         }), candidates.end());
-        
-        // Convert to axis units
-        for (double tSec : candidates)
-        {
-            double tAxis = tSec * 1e6 * getTFactor();
-            result.append(tAxis);
-        }
-        return result;
+        return candidates;
     }
 
     // Only check adjacent point pairs - this limits interpolation to immediate neighbors
@@ -1348,19 +1977,16 @@ QVector<double> PulseqLoader::getKxKyZeroTimes() const
     // Filter: only keep times that are within ADC blocks
     // Build list of ADC block time ranges (in seconds)
     QVector<QPair<double, double>> adcBlockRanges;
-    if (!m_vecDecodeSeqBlocks.empty() && vecBlockEdges.size() >= 2)
+    const BlockTable::AdcColumns& adc = m_blockTable.adc;
+    if (!m_blockTable.empty() && vecBlockEdges.size() >= 2)
     {
-        for (int i = 0; i < static_cast<int>(m_vecDecodeSeqBlocks.size()); ++i)
+        for (int r = 0; r < adc.size(); ++r)
         {
-            SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-            if (!blk || !blk->isADC())
-                continue;
-            
-            const ADCEvent& adc = blk->GetADCEvent();
-            if (adc.numSamples <= 0 || adc.dwellTime <= 0)
+            if (adc.numSamples[r] <= 0 || adc.dwellNs[r] <= 0)
                 continue;
             
             // Convert block time range from internal units to seconds
+            const int i = adc.block[r];
             double blockStartInternal = vecBlockEdges[i];
             double blockEndInternal = vecBlockEdges[i + 1];
             double blockStartSec = blockStartInternal / (1e6 * getTFactor());
@@ -1391,21 +2017,8 @@ QVector<double> PulseqLoader::getKxKyZeroTimes() const
         }
     }
 
-    // Convert to axis units
-    for (double tSec : filteredCandidates)
-    {
-        double tAxis = tSec * 1e6 * getTFactor();
-        result.append(tAxis);
-    }
-
-    // Final sort and dedup
-    std::sort(result.begin(), result.end());
-    double dupTolerance = 1e-6 * 1e6 * getTFactor();
-    result.erase(std::unique(result.begin(), result.end(), [dupTolerance](double a, double b) {
-        return qAbs(a - b) < dupTolerance;
-    }), result.end());
-
-    return result;
+    // Still sorted and deduplicated
+    return filteredCandidates;
 }
 
 void PulseqLoader::updateTimeUnitFromSettings()
@@ -1437,15 +2050,30 @@ void PulseqLoader::rescaleTimeUnit()
 
     double ratio = newFactor / oldFactor;
 
+    // Viewport render tasks read the edges and event index rescaled below
+    WaveformDrawer* drawer = m_mainWindow->getWaveformDrawer();
+    if (drawer)
+        drawer->cancelRenderPreparation();
+
     // Rescale block edges
     for (auto& edge : vecBlockEdges)
         edge *= ratio;
+    for (QVector<EventInterval>& events : m_channelEvents)
+    {
+        for (EventInterval& ev : events) { ev.tStart *= ratio; ev.tEnd *= ratio; }
+    }
+    m_envelopes.rfAmp.rescaleTime(ratio);
+    m_envelopes.rfPh.rescaleTime(ratio);
+    for (EnvelopePyramid& grad : m_envelopes.grad) grad.rescaleTime(ratio);
 
     // Rescale pre-built ADC time series
     for (auto& t : m_adcTime)
         t *= ratio;
+    m_adcPhaseCache.valid = false;
 
-    // Rescale TE overlay data (excitation/refocusing centers are in axis units)
+    // Rescale TE overlay data (excitation/refocusing centers are in axis units). The
+    // trajectory itself is in seconds and stays as it is; so do the kx=ky=0 crossings, which
+    // getKxKyZeroTimes() converts on the way out.
     m_teDurationAxis *= ratio;
     for (auto& t : m_excitationCentersAxis)
         t *= ratio;
@@ -1453,7 +2081,6 @@ void PulseqLoader::rescaleTimeUnit()
         t *= ratio;
 
     // Rescale waveform display
-    WaveformDrawer* drawer = m_mainWindow->getWaveformDrawer();
     if (drawer)
     {
         // Rescale all time-dependent cached state (viewport ranges, debounce
@@ -1471,6 +2098,7 @@ void PulseqLoader::rescaleTimeUnit()
 
         // Recompute and lock Y-axis ranges so they stay consistent
         drawer->computeAndLockYAxisRanges();
+        drawer->refreshTrajectoryGuides();
     }
 
     // Update TR status display text
@@ -1502,57 +2130,56 @@ void PulseqLoader::loadLastOpenDirectory()
     }
 }
 // --- RF shape cache helpers ---
-QString PulseqLoader::rfAmpKey(int magShapeId, int timeShapeId, int len) const
-{
-    return QString("rfA:%1:%2#%3").arg(magShapeId).arg(timeShapeId).arg(len);
-}
-
-QString PulseqLoader::rfPhKey(int phaseShapeId, int timeShapeId, int len) const
-{
-    return QString("rfP:%1:%2#%3").arg(phaseShapeId).arg(timeShapeId).arg(len);
-}
-
 const PulseqLoader::RFAmpEntry& PulseqLoader::ensureRfAmpCached(const float* amp, int len,
                                                                int magShapeId, int timeShapeId)
 {
-    QString key = rfAmpKey(magShapeId, timeShapeId, len);
-    auto it = m_rfAmpCache.find(key);
-    if (it != m_rfAmpCache.end()) return it.value();
-    RFAmpEntry e; e.length = len; e.ampNorm.resize(len);
+    const ShapeKey key = shapeKey(magShapeId, timeShapeId, len);
+    {
+        QMutexLocker lock(&m_shapeCacheMutex);
+        auto it = m_rfAmpCache.constFind(key);
+        if (it != m_rfAmpCache.cend()) return *it.value();
+    }
+    auto e = std::make_shared<RFAmpEntry>(); e->length = len; e->ampNorm.resize(len);
     double mnA = std::numeric_limits<double>::infinity();
     double mxA = -std::numeric_limits<double>::infinity();
     for (int i = 0; i < len; ++i) {
         float a = amp ? amp[i] : std::numeric_limits<float>::quiet_NaN();
-        e.ampNorm[i] = a;
+        e->ampNorm[i] = a;
         if (!std::isnan(a)) { if (a < mnA) mnA = a; if (a > mxA) mxA = a; }
     }
     if (!std::isfinite(mnA) || !std::isfinite(mxA)) { mnA = 0.0; mxA = 0.0; }
-    e.ampMin = mnA; e.ampMax = mxA;
+    e->ampMin = mnA; e->ampMax = mxA;
     // cache peak index by absolute value for later ultra-low-pixel path
     if (len > 0) {
-        auto it = std::max_element(e.ampNorm.begin(), e.ampNorm.end(),
+        auto it = std::max_element(e->ampNorm.begin(), e->ampNorm.end(),
                                    [](float a, float b){ return std::fabs(a) < std::fabs(b); });
-        e.peakIndex = (it != e.ampNorm.end() ? int(std::distance(e.ampNorm.begin(), it)) : 0);
+        e->peakIndex = (it != e->ampNorm.end() ? int(std::distance(e->ampNorm.begin(), it)) : 0);
     } else {
-        e.peakIndex = -1;
+        e->peakIndex = -1;
     }
-    auto ins = m_rfAmpCache.insert(key, e);
-    return ins.value();
+    // Keep the first entry if another render task cached the same shape meanwhile
+    QMutexLocker lock(&m_shapeCacheMutex);
+    auto it = m_rfAmpCache.find(key);
+    if (it == m_rfAmpCache.end()) it = m_rfAmpCache.insert(key, e);
+    return *it.value();
 }
 
 const PulseqLoader::RFPhEntry& PulseqLoader::ensureRfPhCached(const float* phase, int len,
                                                              int phaseShapeId, int timeShapeId)
 {
-    QString key = rfPhKey(phaseShapeId, timeShapeId, len);
-    auto it = m_rfPhCache.find(key);
-    if (it != m_rfPhCache.end()) return it.value();
-    RFPhEntry e; e.length = len; e.phNorm.resize(len);
+    const ShapeKey key = shapeKey(phaseShapeId, timeShapeId, len);
+    {
+        QMutexLocker lock(&m_shapeCacheMutex);
+        auto it = m_rfPhCache.constFind(key);
+        if (it != m_rfPhCache.cend()) return *it.value();
+    }
+    auto e = std::make_shared<RFPhEntry>(); e->length = len; e->phNorm.resize(len);
     double mnP = std::numeric_limits<double>::infinity();
     double mxP = -std::numeric_limits<double>::infinity();
     bool isReal = true;
     for (int i = 0; i < len; ++i) {
         float p = phase ? phase[i] : std::numeric_limits<float>::quiet_NaN();
-        e.phNorm[i] = p;
+        e->phNorm[i] = p;
         if (!std::isnan(p)) { 
             if (p < mnP) mnP = p; if (p > mxP) mxP = p; 
             // Check if logic shape is "Real" (only 0 or pi phases, ignoring small numerical noise)
@@ -1561,189 +2188,250 @@ const PulseqLoader::RFPhEntry& PulseqLoader::ensureRfPhCached(const float* phase
         }
     }
     if (!std::isfinite(mnP) || !std::isfinite(mxP)) { mnP = 0.0; mxP = 0.0; }
-    e.phMin = mnP; e.phMax = mxP;
-    e.isRealLike = isReal;
-    auto ins = m_rfPhCache.insert(key, e);
-    return ins.value();
-}
-
-QString PulseqLoader::gradKey(int waveShapeId, int timeShapeId, int len) const
-{
-    return QString("grad:%1:%2#%3").arg(waveShapeId).arg(timeShapeId).arg(len);
+    e->phMin = mnP; e->phMax = mxP;
+    e->isRealLike = isReal;
+    QMutexLocker lock(&m_shapeCacheMutex);
+    auto it = m_rfPhCache.find(key);
+    if (it == m_rfPhCache.end()) it = m_rfPhCache.insert(key, e);
+    return *it.value();
 }
 
 const PulseqLoader::GradShapeEntry& PulseqLoader::ensureGradCached(const float* shape, int len,
                                                                   int waveShapeId, int timeShapeId)
 {
-    QString key = gradKey(waveShapeId, timeShapeId, len);
-    auto it = m_gradShapeCache.find(key);
-    if (it != m_gradShapeCache.end()) return it.value();
-    GradShapeEntry e; e.length = len; e.norm.resize(len);
+    const ShapeKey key = shapeKey(waveShapeId, timeShapeId, len);
+    {
+        QMutexLocker lock(&m_shapeCacheMutex);
+        auto it = m_gradShapeCache.constFind(key);
+        if (it != m_gradShapeCache.cend()) return *it.value();
+    }
+    auto e = std::make_shared<GradShapeEntry>(); e->length = len; e->norm.resize(len);
     double mn = std::numeric_limits<double>::infinity();
     double mx = -std::numeric_limits<double>::infinity();
     for (int i = 0; i < len; ++i) {
-        float v = shape[i]; e.norm[i] = v;
+        float v = shape[i]; e->norm[i] = v;
         if (!std::isnan(v)) { if (v < mn) mn = v; if (v > mx) mx = v; }
     }
     if (!std::isfinite(mn) || !std::isfinite(mx)) { mn = 0.0; mx = 0.0; }
-    e.vMin = mn; e.vMax = mx;
-    auto ins = m_gradShapeCache.insert(key, e);
-    return ins.value();
+    e->vMin = mn; e->vMax = mx;
+    QMutexLocker lock(&m_shapeCacheMutex);
+    auto it = m_gradShapeCache.find(key);
+    if (it == m_gradShapeCache.end()) it = m_gradShapeCache.insert(key, e);
+    return *it.value();
+}
+
+bool PulseqLoader::findVisibleBlockRange(double visibleStart, double visibleEnd, int& startBlock, int& endBlock) const
+{
+    const int numBlocks = int(vecBlockEdges.size()) - 1;
+    if (numBlocks <= 0) return false;
+    // First block ending after visibleStart, last block starting before visibleEnd
+    auto itStart = std::upper_bound(vecBlockEdges.cbegin() + 1, vecBlockEdges.cend(), visibleStart);
+    auto itEnd = std::lower_bound(vecBlockEdges.cbegin(), vecBlockEdges.cend() - 1, visibleEnd);
+    startBlock = int(std::distance(vecBlockEdges.cbegin() + 1, itStart));
+    endBlock = int(std::distance(vecBlockEdges.cbegin(), itEnd)) - 1;
+    return startBlock <= endBlock;
+}
+
+bool PulseqLoader::findVisibleEvents(int channel, double visibleStart, double visibleEnd, int& first, int& last) const
+{
+    if (channel < 0 || channel >= NumEventChannels) return false;
+    const QVector<EventInterval>& events = m_channelEvents[channel];
+    // Same overlap rule as findVisibleBlockRange; both span ends are sorted because blocks are
+    auto itFirst = std::upper_bound(events.cbegin(), events.cend(), visibleStart,
+                                    [](double t, const EventInterval& ev) { return t < ev.tEnd; });
+    auto itLast = std::lower_bound(events.cbegin(), events.cend(), visibleEnd,
+                                   [](const EventInterval& ev, double t) { return ev.tStart < t; });
+    first = int(std::distance(events.cbegin(), itFirst));
+    last = int(std::distance(events.cbegin(), itLast)) - 1;
+    return first <= last;
+}
+
+int PulseqLoader::findBlockAtTime(double t) const
+{
+    const int numBlocks = int(vecBlockEdges.size()) - 1;
+    if (numBlocks <= 0) return -1;
+    auto it = std::upper_bound(vecBlockEdges.cbegin(), vecBlockEdges.cend(), t);
+    const int idx = int(std::distance(vecBlockEdges.cbegin(), it)) - 1;
+    return (idx >= 0 && idx < numBlocks) ? idx : -1;
+}
+
+void PulseqLoader::getViewportDecimated(const ViewportQuery& query, ViewportSeries& out)
+{
+    for (int c = 0; c < NumViewportChannels; ++c) {
+        out.t[c].clear(); out.v[c].clear(); out.elapsedNs[c] = 0;
+    }
+    if (m_blockTable.empty() || vecBlockEdges.isEmpty()) return;
+
+    // Visible event rows and sample totals of every channel, located once for all kernels
+    const double visibleStart = query.visibleStart;
+    const double visibleEnd = query.visibleEnd;
+    auto locate = [&](int eventChannel, const std::vector<long long>& sampleSum) {
+        ViewportSpan span;
+        if (findVisibleEvents(eventChannel, visibleStart, visibleEnd, span.first, span.last))
+            span.samples = BlockTable::samplesInRows(sampleSum, span.first, span.last);
+        return span;
+    };
+    const ViewportSpan rfSpan = locate(ChannelRF, m_blockTable.rf.sampleSum);
+    const ViewportSpan adcSpan = locate(ChannelADC, m_blockTable.adc.sampleSum);
+    ViewportSpan gradSpan[3];
+    for (int axis = 0; axis < 3; ++axis)
+        gradSpan[axis] = locate(ChannelGX + axis, m_blockTable.grad[axis].sampleSum);
+
+    auto decimate = [&](int c) {
+        QElapsedTimer timer;
+        timer.start();
+        const int px = query.pixelWidth[c];
+        switch (c) {
+        case ViewportRfAmp:
+            decimateRfViewport(visibleStart, visibleEnd, px, rfSpan, false, out.t[c], out.v[c]);
+            break;
+        case ViewportRfPhase:
+            decimateRfViewport(visibleStart, visibleEnd, px, rfSpan, true, out.t[c], out.v[c]);
+            break;
+        case ViewportAdcPhase:
+            decimateAdcPhaseViewport(visibleStart, visibleEnd, px, adcSpan, out.t[c], out.v[c]);
+            break;
+        default: {
+            const int axis = c - ViewportGx;
+            decimateGradViewport(axis, visibleStart, visibleEnd, px, gradSpan[axis], out.t[c], out.v[c]);
+            break;
+        }
+        }
+        out.elapsedNs[c] = timer.nsecsElapsed();
+    };
+
+    // One task per channel; each writes only its own series. The calling thread takes the last.
+    int pending = -1;
+    for (int c = 0; c < NumViewportChannels; ++c) {
+        if (query.pixelWidth[c] <= 0) continue;
+        if (pending >= 0)
+            m_viewportPool.start([&decimate, pending]() { decimate(pending); });
+        pending = c;
+    }
+    if (pending >= 0)
+        decimate(pending);
+    m_viewportPool.waitForDone();
 }
 
-void PulseqLoader::getGradViewportDecimated(int channel, double visibleStart, double visibleEnd, int pixelWidth,
-                                            QVector<double>& tOut, QVector<double>& vOut)
+void PulseqLoader::decimateGradViewport(int channel, double visibleStart, double visibleEnd, int pixelWidth,
+                                        const ViewportSpan& span, QVector<double>& tOut, QVector<double>& vOut)
 {
     tOut.clear(); vOut.clear();
-    if (m_vecDecodeSeqBlocks.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
+    if (m_blockTable.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
 
-    // Find visible block range
-    int startBlock = 0;
-    int endBlock = int(vecBlockEdges.size()) - 2;
-    for (int i = 0; i < vecBlockEdges.size() - 1; ++i) {
-        if (vecBlockEdges[i + 1] > visibleStart) { startBlock = i; break; }
-    }
-    for (int i = int(vecBlockEdges.size()) - 2; i >= startBlock; --i) {
-        if (vecBlockEdges[i] < visibleEnd) { endBlock = i; break; }
-    }
-    if (startBlock > endBlock) return;
+    if (channel < 0 || channel > 2) return;
+
+    // Zoomed out far enough: answer from the load-time min/max pyramid in O(pixels)
+    if (m_envelopes.grad[channel].query(visibleStart, visibleEnd, pixelWidth, false, tOut, vOut)) return;
+
+    // Visible blocks that carry a gradient on this channel
+    if (span.first > span.last) return;
+    const int firstEvent = span.first, lastEvent = span.last;
+    // Table rows of this channel line up with its event index entries
+    const BlockTable::GradColumns& g = m_blockTable.grad[channel];
 
     const double window = std::max(1e-9, visibleEnd - visibleStart);
 
     bool haveLast = false; double lastT=0.0, lastV=0.0;
     // Global decimation gating for gradients (heavy-only)
     const int DECIMATE_TOTAL_THRESHOLD_GRAD = 150000;
-    long long totalGradSamples = 0;
-    for (int i = startBlock; i <= endBlock; ++i) {
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i]; if (!blk) continue;
-        if (blk->isArbitraryGradient(channel)) totalGradSamples += std::max(0, blk->GetArbGradNumSamples(channel));
-        else if (blk->isExtTrapGradient(channel)) totalGradSamples += (int)blk->GetExtTrapGradTimes(channel).size();
-        else if (blk->isTrapGradient(channel)) totalGradSamples += 4;
-    }
+    const long long totalGradSamples = span.samples;
     bool allowDecimateGrad = (totalGradSamples > DECIMATE_TOTAL_THRESHOLD_GRAD);
     if (pixelWidth > 0) {
         double pppTotal = double(std::max<long long>(1, totalGradSamples)) / double(pixelWidth);
         if (pppTotal <= 2.0) allowDecimateGrad = false;
     }
 
-    for (int i = startBlock; i <= endBlock; ++i) {
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i]; if (!blk) continue;
-        bool hasGradient = blk->isTrapGradient(channel) || blk->isArbitraryGradient(channel) || blk->isExtTrapGradient(channel);
-        if (!hasGradient) continue;
-        const GradEvent& grad = blk->GetGradEvent(channel);
-        const double tStart = vecBlockEdges[i] + grad.delay * tFactor;
+    // Blocks are appended straight to the output (no per-block arrays). A block that does not
+    // continue the previous one in time and value gets a NaN break first; the break duplicates
+    // the last x to keep x monotonic, even when the next segment starts at the same timestamp.
+    auto beginSegment = [&](double tFirst, double vFirst) {
+        if (!haveLast) return;
+        const double dtTol = 1e-9;
+        const double dvTol = 1e-12;
+        const bool continuous = (std::abs(tFirst - lastT) <= dtTol) && (std::abs(vFirst - lastV) <= dvTol);
+        if (!continuous) {
+            tOut.append(lastT);
+            vOut.append(std::numeric_limits<double>::quiet_NaN());
+        }
+    };
+    auto endSegment = [&]() {
+        lastT = tOut.last(); lastV = vOut.last(); haveLast = true;
+    };
+
+    for (int e = firstEvent; e <= lastEvent; ++e) {
+        const int i = g.block[e];
+        const double amplitude = g.amplitude[e];
+        const double tStart = vecBlockEdges[i] + g.delay[e] * tFactor;
 
-        if (blk->isTrapGradient(channel)) {
-            double rampUpTime = grad.rampUpTime * tFactor;
-            double flatTime = grad.flatTime * tFactor;
-            double rampDownTime = grad.rampDownTime * tFactor;
+        if (g.kind[e] == BlockTable::GradTrap) {
+            double rampUpTime = g.rampUp[e] * tFactor;
+            double flatTime = g.flat[e] * tFactor;
+            double rampDownTime = g.rampDown[e] * tFactor;
             double t0 = tStart;
             double t1 = tStart + rampUpTime;
             double t2 = t1 + flatTime;
             double t3 = t2 + rampDownTime;
             if (t3 <= visibleStart || t0 >= visibleEnd) continue;
-            // Build block arrays
-            QVector<double> tt{t0,t1,t2,t3};
-            QVector<double> vv{0.0, grad.amplitude, grad.amplitude, 0.0};
-            // Continuity at block start
-            if (!tt.isEmpty()) {
-                if (haveLast) {
-                    double dtTol = 1e-9;
-                    double dvTol = 1e-12;
-                    bool continuous = (std::abs(tt.first() - lastT) <= dtTol) && (std::abs(vv.first() - lastV) <= dvTol);
-                    if (!continuous) {
-                        // Keep x monotonic: duplicate last x as a NaN break marker.
-                        // This avoids generating a break time that is > lastT when the next segment starts at the same timestamp.
-                        tOut.append(lastT);
-                        vOut.append(std::numeric_limits<double>::quiet_NaN());
-                    }
-                }
-                tOut += tt; vOut += vv;
-                lastT = tt.last(); lastV = vv.last(); haveLast = true;
-            }
+            beginSegment(t0, 0.0);
+            tOut.append(t0); vOut.append(0.0);
+            tOut.append(t1); vOut.append(amplitude);
+            tOut.append(t2); vOut.append(amplitude);
+            tOut.append(t3); vOut.append(0.0);
+            endSegment();
             continue;
         }
 
-        if (blk->isArbitraryGradient(channel)) {
-            int numSamples = blk->GetArbGradNumSamples(channel);
-            const float* shapePtr = blk->GetArbGradShapePtr(channel);
+        if (g.kind[e] == BlockTable::GradArbitrary) {
+            int numSamples = g.numPoints[e];
+            const float* shapePtr = g.values[e];
             if (numSamples <= 0 || !shapePtr) continue;
-            const GradShapeEntry& entry = ensureGradCached(shapePtr, numSamples, grad.waveShape, grad.timeShape);
-            // Use sequence GradientRasterTime (seconds) — required by loader
-            if (!m_spPulseqSeq) return; // defensive: loader guarantees presence
-            std::vector<double> def = m_spPulseqSeq->GetDefinition("GradientRasterTime");
-            if (def.empty() || !std::isfinite(def[0]) || def[0] <= 0.0) return; // do not render without definition
-            double gradRaster_us = def[0] * 1e6;
+            const GradShapeEntry& entry = ensureGradCached(shapePtr, numSamples, g.waveShape[e], g.timeShape[e]);
+            // Use sequence GradientRasterTime — required by loader
+            double gradRaster_us = m_systemParams.gradRasterUs;
+            if (gradRaster_us <= 0.0) return; // do not render without definition
             double dt = gradRaster_us * tFactor;
             double duration = numSamples * dt;
             if (tStart >= visibleEnd || (tStart + duration) <= visibleStart) continue;
             int pxForBlock = std::max(1, int(std::round(duration / window * pixelWidth)));
+            // Every path below starts at sample 0
+            beginSegment(tStart, double(entry.norm[0]) * amplitude);
             // Prefer LTTB decimation for shape fidelity
-            QVector<double> tBlk, vBlk;
             double ppp = (pxForBlock > 0) ? double(numSamples) / double(pxForBlock) : double(numSamples);
             if (!allowDecimateGrad || numSamples <= 64 || ppp <= 1.2) {
-                tBlk.reserve(numSamples); vBlk.reserve(numSamples);
-                for (int j=0;j<numSamples;++j){ tBlk.append(tStart + j*dt); vBlk.append(double(entry.norm[j]) * double(grad.amplitude)); }
+                for (int j=0;j<numSamples;++j){ tOut.append(tStart + j*dt); vOut.append(double(entry.norm[j]) * amplitude); }
             } else {
                 int target = std::min(numSamples, std::min(10000, int(std::round(pxForBlock*3.0))));
                 if (target <= 4 || pxForBlock <= 2) {
                     // Extremely narrow: take a few evenly spaced samples to avoid sawtooth artifacts
-                    QSet<int> idxs;
-                    idxs.insert(0);
-                    idxs.insert(std::max(0, std::min(numSamples-1, (int)std::floor(0.25*(numSamples-1)))));
-                    idxs.insert(std::max(0, std::min(numSamples-1, (int)std::floor(0.5*(numSamples-1)))));
-                    idxs.insert(std::max(0, std::min(numSamples-1, (int)std::floor(0.75*(numSamples-1)))));
-                    idxs.insert(numSamples-1);
-                    QList<int> sorted = QList<int>(idxs.constBegin(), idxs.constEnd());
-                    std::sort(sorted.begin(), sorted.end());
-                    tBlk.reserve(sorted.size()); vBlk.reserve(sorted.size());
-                    for (int k : sorted){ tBlk.append(tStart + k*dt); vBlk.append(double(entry.norm[k]) * double(grad.amplitude)); }
+                    int idxs[5] = {
+                        0,
+                        std::max(0, std::min(numSamples-1, (int)std::floor(0.25*(numSamples-1)))),
+                        std::max(0, std::min(numSamples-1, (int)std::floor(0.5*(numSamples-1)))),
+                        std::max(0, std::min(numSamples-1, (int)std::floor(0.75*(numSamples-1)))),
+                        numSamples-1
+                    };
+                    const int count = int(std::unique(idxs, idxs + 5) - idxs); // already ascending
+                    for (int k = 0; k < count; ++k){ tOut.append(tStart + idxs[k]*dt); vOut.append(double(entry.norm[idxs[k]]) * amplitude); }
                 } else {
-                    QVector<double> dT, dV; lttbDownsampleUniform(entry.norm, tStart, dt, target, dT, dV);
-                    tBlk = dT; vBlk.reserve(dV.size()); for (double val: dV){ vBlk.append(val * double(grad.amplitude)); }
-                }
-            }
-            if (!tBlk.isEmpty()) {
-                if (haveLast) {
-                    double dtTol = 1e-9; double dvTol = 1e-12;
-                    bool continuous = (std::abs(tBlk.first() - lastT) <= dtTol) && (std::abs(vBlk.first() - lastV) <= dvTol);
-                    if (!continuous) {
-                        // Duplicate last x for NaN break to keep x monotonic.
-                        tOut.append(lastT);
-                        vOut.append(std::numeric_limits<double>::quiet_NaN());
-                    }
+                    lttbDownsampleUniform(entry.norm, tStart, dt, amplitude, target, tOut, vOut);
                 }
-                tOut += tBlk; vOut += vBlk; lastT = tBlk.last(); lastV = vBlk.last(); haveLast = true;
             }
+            endSegment();
             continue;
         }
 
-        if (blk->isExtTrapGradient(channel)) {
-            const std::vector<long>& times = blk->GetExtTrapGradTimes(channel);
-            const std::vector<float>& shape = blk->GetExtTrapGradShape(channel);
-            if (times.empty() || shape.empty() || times.size() != shape.size()) continue;
-            // Build and decimate via buckets in time domain
-            // We’ll do a simple min-max on the resampled sequence by index mapping similar to arbitrary
-            int n = int(times.size());
-            // Estimate dt average for epsilon
-            double dtAvg = (n>1 ? (times.back()-times.front())/(double)(n-1) * tFactor : 1e-6);
-            QVector<double> tBlk; QVector<double> vBlk; tBlk.reserve(n); vBlk.reserve(n);
+        if (g.kind[e] == BlockTable::GradExtTrap) {
+            const long* times = g.timesUs[e];
+            const float* shape = g.values[e];
+            int n = g.numPoints[e];
+            if (n <= 0 || !times || !shape) continue;
+            beginSegment(tStart + times[0] * tFactor, double(shape[0]) * amplitude);
             for (int j = 0; j < n; ++j) {
-                double t = tStart + times[j] * tFactor;
-                tBlk.append(t); vBlk.append(double(shape[j]) * double(grad.amplitude));
-            }
-            if (!tBlk.isEmpty()) {
-                if (haveLast) {
-                    double dtTol = 1e-9; double dvTol = 1e-12;
-                    bool continuous = (std::abs(tBlk.first() - lastT) <= dtTol) && (std::abs(vBlk.first() - lastV) <= dvTol);
-                    if (!continuous) {
-                        // Duplicate last x for NaN break to keep x monotonic.
-                        tOut.append(lastT);
-                        vOut.append(std::numeric_limits<double>::quiet_NaN());
-                    }
-                }
-                tOut += tBlk; vOut += vBlk; lastT = tBlk.last(); lastV = vBlk.last(); haveLast = true;
+                tOut.append(tStart + times[j] * tFactor);
+                vOut.append(double(shape[j]) * amplitude);
             }
+            endSegment();
             continue;
         }
     }
@@ -1754,7 +2442,7 @@ QPair<double,double> PulseqLoader::getGradGlobalRange(int channel)
     double mn = std::numeric_limits<double>::infinity();
     double mx = -std::numeric_limits<double>::infinity();
     // 1) Arbitrary shapes via per-shape aggregates
-    const auto& agg = m_gradAgg[channel];
+    const auto& agg = m_shapeAgg.gradAgg[channel];
     for (auto it = agg.constBegin(); it != agg.constEnd(); ++it) {
         const ScaleAgg& ag = it.value();
         if (!ag.hasShape) continue;
@@ -1767,11 +2455,11 @@ QPair<double,double> PulseqLoader::getGradGlobalRange(int channel)
         for (double c : candidates) { if (std::isfinite(c)) { if (c < mn) mn = c; if (c > mx) mx = c; } }
     }
     // 2) Trapezoids: extremes at 0 and amplitude
-    mn = std::min(mn, std::min(0.0, m_gradTrapMinNegScale[channel]));
-    mx = std::max(mx, std::max(0.0, m_gradTrapMaxPosScale[channel]));
+    mn = std::min(mn, std::min(0.0, m_shapeAgg.gradTrapMinNegScale[channel]));
+    mx = std::max(mx, std::max(0.0, m_shapeAgg.gradTrapMaxPosScale[channel]));
     // 3) External trapezoid aggregated min/max
-    mn = std::min(mn, m_gradExtTrapGlobalMin[channel]);
-    mx = std::max(mx, m_gradExtTrapGlobalMax[channel]);
+    mn = std::min(mn, m_shapeAgg.gradExtTrapGlobalMin[channel]);
+    mx = std::max(mx, m_shapeAgg.gradExtTrapGlobalMax[channel]);
 
     if (!std::isfinite(mn) || !std::isfinite(mx)) { mn = -1.0; mx = 1.0; }
     double pad = (mx - mn) * 0.05; if (pad == 0) pad = 0.1;
@@ -1782,17 +2470,16 @@ bool PulseqLoader::sampleRFAtTime(double time, int blockIdx, double& ampHzOut, d
 {
     ampHzOut = 0.0; phaseRadOut = 0.0;
     if (blockIdx < 0 || blockIdx + 1 >= vecBlockEdges.size()) return false;
-    if (blockIdx >= static_cast<int>(m_vecDecodeSeqBlocks.size())) return false;
-    SeqBlock* blk = m_vecDecodeSeqBlocks[blockIdx];
-    if (!blk || !blk->isRF()) return false;
+    const BlockTable::RfColumns& rf = m_blockTable.rf;
+    const int row = m_blockTable.rfRow(blockIdx);
+    if (row < 0) return false;
 
-    const RFEvent& rf = blk->GetRFEvent();
-    int RFLength = blk->GetRFLength();
+    int RFLength = rf.length[row];
     if (RFLength <= 0) return false;
-    float dwell = blk->GetRFDwellTime(); // us
-    const float* rfList = blk->GetRFAmplitudePtr();
-    const float* phaseList = blk->GetRFPhasePtr();
-    double tStart = vecBlockEdges[blockIdx] + rf.delay * tFactor;
+    float dwell = rf.dwell[row]; // us
+    const float* rfList = rf.ampSamples[row];
+    const float* phaseList = rf.phaseSamples[row];
+    double tStart = vecBlockEdges[blockIdx] + rf.delay[row] * tFactor;
     double dt = dwell * tFactor;
 
     // Outside block window
@@ -1803,13 +2490,17 @@ bool PulseqLoader::sampleRFAtTime(double time, int blockIdx, double& ampHzOut, d
     // However, cached entry should exist if rendered. If not, we can't update cache.
     // Solution: Look up in cache directly. If missing, default to safe assumption (not real-like) or re-scan.
     // For status bar (mouse hover), it's likely already rendered.
-    QString key = rfPhKey(rf.phaseShape, rf.timeShape, RFLength);
+    const ShapeKey key = shapeKey(rf.phaseShape[row], rf.timeShape[row], RFLength);
     bool isRealLike = false; // Default safe
     // We need access to m_rfPhCache. It is mutable? No.
     // We can cast away constness if we really need to update cache, but cleaner to check if exists.
-    auto it = m_rfPhCache.find(key);
-    if (it != m_rfPhCache.end()) {
-        isRealLike = it.value().isRealLike;
+    std::shared_ptr<const RFPhEntry> cached;
+    {
+        QMutexLocker lock(&m_shapeCacheMutex);
+        cached = m_rfPhCache.value(key);
+    }
+    if (cached) {
+        isRealLike = cached->isRealLike;
     } else {
         // If not cached, do quick scan? Or just assume complex?
         // Assuming complex means we show raw phase. If real pulse has pi phase, it shows 3.14.
@@ -1830,16 +2521,16 @@ bool PulseqLoader::sampleRFAtTime(double time, int blockIdx, double& ampHzOut, d
     double alpha = u - i0;
     if (i0 < 0) { i0 = 0; alpha = 0.0; }
 
-    auto amp0 = static_cast<double>(rfList[i0]) * static_cast<double>(rf.amplitude);
+    auto amp0 = static_cast<double>(rfList[i0]) * static_cast<double>(rf.amplitude[row]);
     auto ph0  = static_cast<double>(phaseList[i0]);
     
-    auto amp1 = static_cast<double>(rfList[i1]) * static_cast<double>(rf.amplitude);
+    auto amp1 = static_cast<double>(rfList[i1]) * static_cast<double>(rf.amplitude[row]);
     auto ph1  = static_cast<double>(phaseList[i1]);
     
     // Interpolate Amplitude
     ampHzOut = amp0 + (amp1 - amp0) * alpha;
 
-    // Phase Calculation matching getRfViewportDecimated
+    // Phase Calculation matching the RF viewport kernel (decimateRfViewport)
     // Base phase: 0 for real-like, otherwise interpolated raw phase
     double basePh0 = isRealLike ? 0.0 : ph0;
     double basePh1 = isRealLike ? 0.0 : ph1;
@@ -1848,8 +2539,8 @@ bool PulseqLoader::sampleRFAtTime(double time, int blockIdx, double& ampHzOut, d
 
     // Full Offsets
     double gamma = Settings::getInstance().getGamma();
-    double fullFreqOff = rf.freqOffset + rf.freqPPM * 1e-6 * gamma * m_b0Tesla;
-    double fullPhaseOff = rf.phaseOffset + rf.phasePPM * 1e-6 * gamma * m_b0Tesla;
+    double fullFreqOff = rf.freqOffset[row] + rf.freqPPM[row] * 1e-6 * gamma * m_systemParams.b0Tesla;
+    double fullPhaseOff = rf.phaseOffset[row] + rf.phasePPM[row] * 1e-6 * gamma * m_systemParams.b0Tesla;
     
     // Time in seconds from pulse start
     double t_local_sec = ((time - tStart) / tFactor) * 1e-6;
@@ -1866,20 +2557,19 @@ bool PulseqLoader::sampleGradAtTime(int channel, double time, int blockIdx, doub
 {
     gradOutHzPerM = 0.0;
     if (blockIdx < 0 || blockIdx + 1 >= vecBlockEdges.size()) return false;
-    if (blockIdx >= static_cast<int>(m_vecDecodeSeqBlocks.size())) return false;
-    SeqBlock* blk = m_vecDecodeSeqBlocks[blockIdx];
-    if (!blk) return false;
-    bool hasGradient = blk->isTrapGradient(channel) || blk->isArbitraryGradient(channel) || blk->isExtTrapGradient(channel);
-    if (!hasGradient) return false;
+    if (channel < 0 || channel > 2) return false;
+    const BlockTable::GradColumns& g = m_blockTable.grad[channel];
+    const int row = m_blockTable.gradRow(channel, blockIdx);
+    if (row < 0) return false;
 
-    const GradEvent& grad = blk->GetGradEvent(channel);
-    double tStart = vecBlockEdges[blockIdx] + grad.delay * tFactor;
+    const double amplitude = g.amplitude[row];
+    double tStart = vecBlockEdges[blockIdx] + g.delay[row] * tFactor;
 
     // Trapezoid
-    if (blk->isTrapGradient(channel)) {
-        double ru = grad.rampUpTime * tFactor;
-        double fl = grad.flatTime * tFactor;
-        double rd = grad.rampDownTime * tFactor;
+    if (g.kind[row] == BlockTable::GradTrap) {
+        double ru = g.rampUp[row] * tFactor;
+        double fl = g.flat[row] * tFactor;
+        double rd = g.rampDown[row] * tFactor;
         double t0 = tStart;
         double t1 = t0 + ru;
         double t2 = t1 + fl;
@@ -1887,28 +2577,26 @@ bool PulseqLoader::sampleGradAtTime(int channel, double time, int blockIdx, doub
         if (time < t0 || time > t3) return false;
         if (time <= t1) {
             double a = (ru > 0.0 ? (time - t0) / ru : 0.0);
-            gradOutHzPerM = grad.amplitude * a;
+            gradOutHzPerM = amplitude * a;
             return true;
         } else if (time <= t2) {
-            gradOutHzPerM = grad.amplitude;
+            gradOutHzPerM = amplitude;
             return true;
         } else {
             double a = (rd > 0.0 ? (t3 - time) / rd : 0.0);
-            gradOutHzPerM = grad.amplitude * a;
+            gradOutHzPerM = amplitude * a;
             return true;
         }
     }
 
     // Arbitrary
-    if (blk->isArbitraryGradient(channel)) {
-        int n = blk->GetArbGradNumSamples(channel);
-        const float* shape = blk->GetArbGradShapePtr(channel);
+    if (g.kind[row] == BlockTable::GradArbitrary) {
+        int n = g.numPoints[row];
+        const float* shape = g.values[row];
         if (n <= 0 || !shape) return false;
-        // Use sequence GradientRasterTime (seconds) — required by loader
-        if (!m_spPulseqSeq) return false; // defensive
-        std::vector<double> def = m_spPulseqSeq->GetDefinition("GradientRasterTime");
-        if (def.empty() || !std::isfinite(def[0]) || def[0] <= 0.0) return false;
-        double gradRaster_us = def[0] * 1e6; // seconds -> microseconds
+        // Use sequence GradientRasterTime — required by loader
+        double gradRaster_us = m_systemParams.gradRasterUs;
+        if (gradRaster_us <= 0.0) return false;
         double dt = gradRaster_us * tFactor;
         double tEnd = tStart + (n - 1) * dt;
         if (time < tStart || time > tEnd) return false;
@@ -1917,21 +2605,21 @@ bool PulseqLoader::sampleGradAtTime(int channel, double time, int blockIdx, doub
         int i1 = std::min(n - 1, i0 + 1);
         double alpha = u - i0;
         if (i0 < 0) { i0 = 0; alpha = 0.0; }
-        double v0 = static_cast<double>(shape[i0]) * static_cast<double>(grad.amplitude);
+        double v0 = static_cast<double>(shape[i0]) * amplitude;
         if (i1 == i0) { gradOutHzPerM = v0; return true; }
-        double v1 = static_cast<double>(shape[i1]) * static_cast<double>(grad.amplitude);
+        double v1 = static_cast<double>(shape[i1]) * amplitude;
         gradOutHzPerM = v0 + (v1 - v0) * alpha;
         return true;
     }
 
     // External trapezoid (piecewise linear defined by times/shape)
-    if (blk->isExtTrapGradient(channel)) {
-        const std::vector<long>& times = blk->GetExtTrapGradTimes(channel);
-        const std::vector<float>& shape = blk->GetExtTrapGradShape(channel);
-        int n = static_cast<int>(times.size());
-        if (n <= 0 || shape.size() != times.size()) return false;
-        double tFirst = tStart + times.front() * tFactor;
-        double tLast  = tStart + times.back()  * tFactor;
+    if (g.kind[row] == BlockTable::GradExtTrap) {
+        const long* times = g.timesUs[row];
+        const float* shape = g.values[row];
+        int n = g.numPoints[row];
+        if (n <= 0 || !times || !shape) return false;
+        double tFirst = tStart + times[0] * tFactor;
+        double tLast  = tStart + times[n - 1] * tFactor;
         if (time < tFirst || time > tLast) return false;
         // Find segment
         int i0 = 0;
@@ -1942,8 +2630,8 @@ bool PulseqLoader::sampleGradAtTime(int channel, double time, int blockIdx, doub
         }
         double ta = tStart + times[i0] * tFactor;
         double tb = tStart + times[i0+1] * tFactor;
-        double va = static_cast<double>(shape[i0]) * static_cast<double>(grad.amplitude);
-        double vb = static_cast<double>(shape[i0+1]) * static_cast<double>(grad.amplitude);
+        double va = static_cast<double>(shape[i0]) * amplitude;
+        double vb = static_cast<double>(shape[i0+1]) * amplitude;
         if (tb <= ta) { gradOutHzPerM = va; return true; }
         double alpha = (time - ta) / (tb - ta);
         gradOutHzPerM = va + (vb - va) * alpha;
@@ -1972,37 +2660,29 @@ void PulseqLoader::downsampleMinMax(const QVector<float>& src, int buckets, QVec
         int i1 = int(std::floor(end));
         if (i0 >= n) i0 = n - 1;
         if (i1 <= i0) i1 = std::min(n, i0 + 1);
-        float mn = std::numeric_limits<float>::infinity(); int iMin = i0;
-        float mx = -std::numeric_limits<float>::infinity(); int iMax = i0;
-        for (int i = i0; i < i1; ++i) {
-            float v = src[i];
-            if (std::isnan(v)) continue;
-            if (v < mn) { mn = v; iMin = i; }
-            if (v > mx) { mx = v; iMax = i; }
-        }
+        int iMin = i0, iMax = i0;
+        DecimationKernels::argMinMax(src.constData(), i0, i1, iMin, iMax);
         outIdxMin.append(iMin);
         outIdxMax.append(iMax);
         idx = i1;
     }
 }
 
-void PulseqLoader::lttbDownsampleUniform(const QVector<float>& src, double tStart, double dt, int targetPoints,
-                               QVector<double>& tOut, QVector<double>& vOut) const
+void PulseqLoader::lttbDownsampleUniform(const QVector<float>& src, double tStart, double dt, double scale,
+                                         int targetPoints, QVector<double>& tOut, QVector<double>& vOut) const
 {
-    tOut.clear(); vOut.clear();
+    // Appends to tOut/vOut (no clear, no reserve: the viewport buffers keep their capacity)
     int n = src.size();
     if (n <= 0 || targetPoints <= 0) return;
     if (n <= targetPoints) {
-        tOut.reserve(n); vOut.reserve(n);
-        for (int i=0;i<n;++i){ tOut.append(tStart + i*dt); vOut.append(double(src[i])); }
+        for (int i=0;i<n;++i){ tOut.append(tStart + i*dt); vOut.append(double(src[i]) * scale); }
         return;
     }
-    tOut.reserve(targetPoints); vOut.reserve(targetPoints);
     // Always include first point
-    tOut.append(tStart); vOut.append(double(src[0]));
+    tOut.append(tStart); vOut.append(double(src[0]) * scale);
     if (targetPoints == 1) return;
     if (targetPoints == 2) {
-        tOut.append(tStart + (n-1)*dt); vOut.append(double(src[n-1]));
+        tOut.append(tStart + (n-1)*dt); vOut.append(double(src[n-1]) * scale);
         return;
     }
     int buckets = targetPoints - 2;
@@ -2018,55 +2698,47 @@ void PulseqLoader::lttbDownsampleUniform(const QVector<float>& src, double tStar
         double avgX = 0.0, avgY = 0.0; int count = 0;
         for (int i = nextStart; i < nextEnd; ++i) { avgX += (tStart + i*dt); avgY += double(src[i]); ++count; }
         if (count == 0) { avgX = tStart + (nextStart)*dt; avgY = double(src[std::min(nextStart, n-1)]); }
-        double maxArea = -1.0; int maxIndex = start;
         double ax = tStart + a*dt; double ay = double(src[a]);
-        for (int i = start; i < end; ++i) {
-            double bx = tStart + i*dt; double by = double(src[i]);
-            double cx = avgX; double cy = avgY;
-            double area = std::abs((ax - cx)*(by - ay) - (ax - bx)*(cy - ay));
-            if (area > maxArea) { maxArea = area; maxIndex = i; }
-        }
+        // Triangle-area search, vectorized where the CPU allows
+        const int maxIndex = DecimationKernels::maxTriangleArea(src.constData(), start, end, tStart, dt, ax, ay, avgX, avgY);
         tOut.append(tStart + maxIndex*dt);
-        vOut.append(double(src[maxIndex]));
+        vOut.append(double(src[maxIndex]) * scale);
         a = maxIndex;
     }
     // include last
     tOut.append(tStart + (n-1)*dt);
-    vOut.append(double(src[n-1]));
+    vOut.append(double(src[n-1]) * scale);
 }
 
-void PulseqLoader::getRfViewportDecimated(double visibleStart, double visibleEnd, int pixelWidth,
-                                          QVector<double>& tAmp, QVector<double>& vAmp,
-                                          QVector<double>& tPh, QVector<double>& vPh)
+void PulseqLoader::decimateRfViewport(double visibleStart, double visibleEnd, int pixelWidth, const ViewportSpan& span,
+                                      bool phase, QVector<double>& tOut, QVector<double>& vOut)
 {
-    tAmp.clear(); vAmp.clear(); tPh.clear(); vPh.clear();
-    if (m_vecDecodeSeqBlocks.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
+    tOut.clear(); vOut.clear();
+    if (m_blockTable.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
 
-    // Find visible block range
-    int startBlock = 0;
-    int endBlock = int(vecBlockEdges.size()) - 2;
-    for (int i = 0; i < vecBlockEdges.size() - 1; ++i) {
-        if (vecBlockEdges[i + 1] > visibleStart) { startBlock = i; break; }
-    }
-    for (int i = int(vecBlockEdges.size()) - 2; i >= startBlock; --i) {
-        if (vecBlockEdges[i] < visibleEnd) { endBlock = i; break; }
-    }
-    if (startBlock > endBlock) return;
+    // Zoomed out far enough: answer from the load-time min/max pyramids in O(pixels). The phase
+    // pyramid bakes in gamma, so fall back to the blocks if the setting changed since the load.
+    const double gamma = Settings::getInstance().getGamma();
+    if (!phase && m_envelopes.rfAmp.query(visibleStart, visibleEnd, pixelWidth, true, tOut, vOut))
+        return;
+    if (phase && m_envelopes.gamma == gamma
+        && m_envelopes.rfPh.query(visibleStart, visibleEnd, pixelWidth, true, tOut, vOut))
+        return;
+
+    // Visible blocks that carry RF
+    if (span.first > span.last) return;
+    const int firstEvent = span.first, lastEvent = span.last;
+    // Table rows line up with the RF event index entries
+    const BlockTable::RfColumns& rf = m_blockTable.rf;
 
     const double window = std::max(1e-9, visibleEnd - visibleStart);
 
-    bool haveLastAmp = false, haveLastPh = false;
-    double lastTAmp = 0.0, lastVAmp = 0.0;
-    double lastTPh  = 0.0, lastVPh  = 0.0;
+    bool haveLast = false;
+    double lastT = 0.0, lastV = 0.0;
 
     // Global decimation gating (heavy-only):
     const int DECIMATE_TOTAL_THRESHOLD_RF = 120000; // conservative; for very large windows
-    long long totalRfSamples = 0;
-    for (int i = startBlock; i <= endBlock; ++i) {
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-        if (!blk || !blk->isRF()) continue;
-        totalRfSamples += std::max(0, blk->GetRFLength());
-    }
+    const long long totalRfSamples = span.samples;
     bool allowDecimateRF = (totalRfSamples > DECIMATE_TOTAL_THRESHOLD_RF);
     // Zoom-in gating: if overall points-per-pixel is low, render full detail regardless of total
     if (pixelWidth > 0) {
@@ -2074,16 +2746,32 @@ void PulseqLoader::getRfViewportDecimated(double visibleStart, double visibleEnd
         if (pppTotal <= 2.0) allowDecimateRF = false;
     }
 
-    for (int i = startBlock; i <= endBlock; ++i) {
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-        if (!blk || !blk->isRF()) continue;
-        RFEvent& rf = blk->GetRFEvent();
-        int RFLength = blk->GetRFLength();
+    // Blocks are appended straight to the output (no per-block arrays). Every sampling path
+    // starts at sample 0, so the gap break before a block is decided from tStart up front.
+    auto beginBlock = [&](double tFirst, double dt) {
+        if (!haveLast) return;
+        double dtTol = std::max(1e-9, dt*1.1);
+        bool gap = (tFirst - lastT) > dtTol;
+        if (gap) { tOut.append(tFirst); vOut.append(std::numeric_limits<double>::quiet_NaN()); }
+    };
+    // Continuity state from the last valid sample of the block appended from 'begin'
+    auto endBlock = [&](int begin) {
+        if (begin >= tOut.size()) return;
+        for (int idx = vOut.size()-1; idx >= begin; --idx){ if (!std::isnan(vOut[idx])) { lastT = tOut[idx]; lastV = vOut[idx]; haveLast = true; break; } }
+        if (!haveLast) { // all NaN? set to end
+            lastT = tOut.last(); lastV = std::numeric_limits<double>::quiet_NaN(); haveLast = true;
+        }
+    };
+
+    for (int e = firstEvent; e <= lastEvent; ++e) {
+        const int i = rf.block[e];
+        int RFLength = rf.length[e];
         if (RFLength <= 0) continue;
-        float dwell = blk->GetRFDwellTime();
-        float* rfList = blk->GetRFAmplitudePtr();
-        float* phaseList = blk->GetRFPhasePtr();
-        const double tStart = vecBlockEdges[i] + rf.delay * tFactor;
+        float dwell = rf.dwell[e];
+        const float* rfList = rf.ampSamples[e];
+        const float* phaseList = rf.phaseSamples[e];
+        const double amplitude = rf.amplitude[e];
+        const double tStart = vecBlockEdges[i] + rf.delay[e] * tFactor;
         const double dt = dwell * tFactor;
         const double duration = RFLength * dt;
         // Skip blocks entirely outside range
@@ -2091,81 +2779,63 @@ void PulseqLoader::getRfViewportDecimated(double visibleStart, double visibleEnd
         // Allocate pixels proportional to duration
         int pxForBlock = std::max(1, int(std::round(duration / window * pixelWidth)));
 
-        const RFAmpEntry& entryA = ensureRfAmpCached(rfList, RFLength, rf.magShape, rf.timeShape);
-        // Build amplitude block data (prefer LTTB over min-max)
-        QVector<double> tAmpBlk, vAmpBlk;
-        double ppp = (pxForBlock > 0) ? double(RFLength) / double(pxForBlock) : double(RFLength);
-        if (!allowDecimateRF || RFLength <= 64 || ppp <= 1.2) {
-            tAmpBlk.reserve(RFLength); vAmpBlk.reserve(RFLength);
-            for (int ii=0;ii<RFLength;++ii){ tAmpBlk.append(tStart + ii*dt); vAmpBlk.append(double(entryA.ampNorm[ii]) * double(rf.amplitude)); }
-        } else {
-            int target = std::min(RFLength, std::min(10000, int(std::round(pxForBlock*2.0))));
-            if (target <= 3 || pxForBlock <= 2) {
-                // Ultra-narrow pulse in pixels: sample around peak to preserve Gaussian shape
-                int iPeak = (entryA.peakIndex >= 0 && entryA.peakIndex < RFLength) ? entryA.peakIndex : RFLength/2;
-                auto clampIndex = [&](int idx){ return std::max(0, std::min(RFLength-1, idx)); };
-                QSet<int> idxs;
-                idxs.insert(0);
-                idxs.insert(clampIndex((int)std::floor(0.25 * (RFLength-1))));
-                idxs.insert(clampIndex(iPeak-1));
-                idxs.insert(clampIndex(iPeak));
-                idxs.insert(clampIndex(iPeak+1));
-                idxs.insert(clampIndex((int)std::floor(0.75 * (RFLength-1))));
-                idxs.insert(RFLength-1);
-                QList<int> sorted = QList<int>(idxs.constBegin(), idxs.constEnd());
-                std::sort(sorted.begin(), sorted.end());
-                tAmpBlk.reserve(sorted.size()); vAmpBlk.reserve(sorted.size());
-                for (int ii : sorted){ tAmpBlk.append(tStart + ii*dt); vAmpBlk.append(double(entryA.ampNorm[ii]) * double(rf.amplitude)); }
+        if (!phase) {
+            const RFAmpEntry& entryA = ensureRfAmpCached(rfList, RFLength, rf.magShape[e], rf.timeShape[e]);
+            beginBlock(tStart, dt);
+            const int begin = tOut.size();
+            // Amplitude block data (prefer LTTB over min-max)
+            double ppp = (pxForBlock > 0) ? double(RFLength) / double(pxForBlock) : double(RFLength);
+            if (!allowDecimateRF || RFLength <= 64 || ppp <= 1.2) {
+                for (int ii=0;ii<RFLength;++ii){ tOut.append(tStart + ii*dt); vOut.append(double(entryA.ampNorm[ii]) * amplitude); }
             } else {
-                QVector<double> dT, dV; lttbDownsampleUniform(entryA.ampNorm, tStart, dt, target, dT, dV);
-                tAmpBlk = dT; vAmpBlk.reserve(dV.size()); for (double val : dV){ vAmpBlk.append(val * double(rf.amplitude)); }
-            }
-        }
-        // Continuity handling for amplitude
-        auto appendWithBreakAmp = [&](const QVector<double>& tB, const QVector<double>& vB){
-            if (tB.isEmpty()) return;
-            // Decide if break is needed between last and first (time-gap based)
-            if (haveLastAmp) {
-                double tFirst = tB.first();
-                double dtTol = std::max(1e-9, dt*1.1);
-                bool gap = (tFirst - lastTAmp) > dtTol;
-                if (gap) { tAmp.append(tFirst); vAmp.append(std::numeric_limits<double>::quiet_NaN()); }
+                int target = std::min(RFLength, std::min(10000, int(std::round(pxForBlock*2.0))));
+                if (target <= 3 || pxForBlock <= 2) {
+                    // Ultra-narrow pulse in pixels: sample around peak to preserve Gaussian shape
+                    int iPeak = (entryA.peakIndex >= 0 && entryA.peakIndex < RFLength) ? entryA.peakIndex : RFLength/2;
+                    auto clampIndex = [&](int idx){ return std::max(0, std::min(RFLength-1, idx)); };
+                    int idxs[7] = {
+                        0,
+                        clampIndex((int)std::floor(0.25 * (RFLength-1))),
+                        clampIndex(iPeak-1),
+                        clampIndex(iPeak),
+                        clampIndex(iPeak+1),
+                        clampIndex((int)std::floor(0.75 * (RFLength-1))),
+                        RFLength-1
+                    };
+                    std::sort(idxs, idxs + 7);
+                    const int count = int(std::unique(idxs, idxs + 7) - idxs);
+                    for (int k = 0; k < count; ++k){ tOut.append(tStart + idxs[k]*dt); vOut.append(double(entryA.ampNorm[idxs[k]]) * amplitude); }
+                } else {
+                    lttbDownsampleUniform(entryA.ampNorm, tStart, dt, amplitude, target, tOut, vOut);
+                }
             }
-            tAmp += tB; vAmp += vB;
-            // Update last valid
-            for (int idx = vB.size()-1; idx >= 0; --idx){ if (!std::isnan(vB[idx])) { lastTAmp = tB[idx]; lastVAmp = vB[idx]; haveLastAmp = true; break; } }
-            if (!haveLastAmp) { // all NaN? set to end
-                lastTAmp = tB.last(); lastVAmp = std::numeric_limits<double>::quiet_NaN(); haveLastAmp = true;
+            endBlock(begin);
+            // Keep block separation with NaN break; duplicate last x to preserve sorted order
+            if (!tOut.isEmpty()) {
+                double tEnd = tStart + std::max(0, RFLength-1) * dt;
+                double tBreak = std::nextafter(tEnd, std::numeric_limits<double>::infinity());
+                tOut.append(tBreak);
+                vOut.append(std::numeric_limits<double>::quiet_NaN());
             }
-        };
-        appendWithBreakAmp(tAmpBlk, vAmpBlk);
-        // Keep block separation with NaN break; duplicate last x to preserve sorted order
-        if (!tAmp.isEmpty()) {
-            double tEnd = tStart + std::max(0, RFLength-1) * dt;
-            double tBreak = std::nextafter(tEnd, std::numeric_limits<double>::infinity());
-            tAmp.append(tBreak);
-            vAmp.append(std::numeric_limits<double>::quiet_NaN());
+            continue;
         }
 
-        // Produce phase series similarly
         // Phase block data + continuity
-        QVector<double> tPhBlk, vPhBlk;
-        const RFPhEntry& entryP = ensureRfPhCached(phaseList, RFLength, rf.phaseShape, rf.timeShape);
+        const RFPhEntry& entryP = ensureRfPhCached(phaseList, RFLength, rf.phaseShape[e], rf.timeShape[e]);
+        beginBlock(tStart, dt);
+        const int begin = tOut.size();
         double pppPh = (pxForBlock > 0) ? double(RFLength) / double(pxForBlock) : double(RFLength);
         if (!allowDecimateRF || RFLength <= 64 || pppPh <= 1.2) {
-            tPhBlk.reserve(RFLength); vPhBlk.reserve(RFLength);
-            for (int ii=0;ii<RFLength;++ii){ tPhBlk.append(tStart + ii*dt); vPhBlk.append(double(entryP.phNorm[ii])); }
+            for (int ii=0;ii<RFLength;++ii){ tOut.append(tStart + ii*dt); vOut.append(double(entryP.phNorm[ii])); }
         } else {
             int target = std::min(RFLength, std::min(10000, int(std::round(pxForBlock*2.0))));
-            QVector<double> dT, dV; lttbDownsampleUniform(entryP.phNorm, tStart, dt, target, dT, dV);
-            tPhBlk = dT; vPhBlk = dV;
+            lttbDownsampleUniform(entryP.phNorm, tStart, dt, 1.0, target, tOut, vOut);
         }
 
-        // Apply full phase offsets (MATLAB-matching)
+        // Apply full phase offsets (MATLAB-matching), in place on the samples just appended
         {
-            double gamma = Settings::getInstance().getGamma();
-            double fullFreqOff = rf.freqOffset + rf.freqPPM * 1e-6 * gamma * m_b0Tesla;
-            double fullPhaseOff = rf.phaseOffset + rf.phasePPM * 1e-6 * gamma * m_b0Tesla;
+            double fullFreqOff = rf.freqOffset[e] + rf.freqPPM[e] * 1e-6 * gamma * m_systemParams.b0Tesla;
+            double fullPhaseOff = rf.phaseOffset[e] + rf.phasePPM[e] * 1e-6 * gamma * m_systemParams.b0Tesla;
             
             // Check if logic shape is "Real" (only 0 or pi phases, ignoring small numerical noise)
             // MATLAB uses angle(s * sign(real(s))) which maps pi -> 0 for real pulses (negative lobes).
@@ -2174,47 +2844,23 @@ void PulseqLoader::getRfViewportDecimated(double visibleStart, double visibleEnd
             // tStart is in display units. We need time in seconds from the start of the pulse for freq offset.
             // ii * dt -> gives time in display units from start of pulse.
             // Divide by tFactor to get internal units (us), then * 1e-6 to get seconds.
-            
-            double minPh = 1e9, maxPh = -1e9;
-            for (int k = 0; k < vPhBlk.size(); ++k) {
-                double t_display = tPhBlk[k];
+            for (int k = begin; k < vOut.size(); ++k) {
+                double t_display = tOut[k];
                 // Convert display duration to seconds: (t_display - tStart) / tFactor -> us -> * 1e-6 -> seconds
                 double t_local_sec = ((t_display - tStart) / tFactor) * 1e-6;
                 
                 // If real-like, ignore the shape phase (treat pi as 0, i.e. negative amplitude)
                 // This matches MATLAB's sign(real(s)) correction.
-                double phaseVal = isRealLike ? 0.0 : vPhBlk[k];
+                double phaseVal = isRealLike ? 0.0 : vOut[k];
                 
                 // Add linear phase evolution: 2*pi * t * freq
                 double totalPhase = phaseVal + fullPhaseOff + 2.0 * M_PI * t_local_sec * fullFreqOff;
                 
                 // Wrap to [-pi, pi]
-                double wrapped = std::atan2(std::sin(totalPhase), std::cos(totalPhase));
-                vPhBlk[k] = wrapped;
-                
-                if (wrapped < minPh) minPh = wrapped;
-                if (wrapped > maxPh) maxPh = wrapped;
+                vOut[k] = std::atan2(std::sin(totalPhase), std::cos(totalPhase));
             }
-            // Debug print once per block (throttle maybe?)
-            // Debug print once per block (throttle maybe?)
-            // static int dbgCount = 0; if (dbgCount++ < 20) 
-            // qDebug() << "RF Block" << i << "isRealLike:" << isRealLike << "Offset:" << fullPhaseOff 
-            //          << "Freq:" << fullFreqOff << "MinPh:" << minPh << "MaxPh:" << maxPh << "B0:" << m_b0Tesla;
-
-        }
-        auto appendWithBreakPh = [&](const QVector<double>& tB, const QVector<double>& vB){
-            if (tB.isEmpty()) return;
-            if (haveLastPh) {
-                double tFirst = tB.first();
-                double dtTol = std::max(1e-9, dt*1.1);
-                bool gap = (tFirst - lastTPh) > dtTol;
-                if (gap) { tPh.append(tFirst); vPh.append(std::numeric_limits<double>::quiet_NaN()); }
-            }
-            tPh += tB; vPh += vB;
-            for (int idx = vB.size()-1; idx >= 0; --idx){ if (!std::isnan(vB[idx])) { lastTPh = tB[idx]; lastVPh = vB[idx]; haveLastPh = true; break; } }
-            if (!haveLastPh) { lastTPh = tB.last(); lastVPh = std::numeric_limits<double>::quiet_NaN(); haveLastPh = true; }
-        };
-        appendWithBreakPh(tPhBlk, vPhBlk);
+        }
+        endBlock(begin);
     }
 }
 
@@ -2223,7 +2869,7 @@ QPair<double,double> PulseqLoader::getRfGlobalRangeAmp()
     // Use precomputed per-shape aggregates to avoid re-scanning blocks
     double mn = std::numeric_limits<double>::infinity();
     double mx = -std::numeric_limits<double>::infinity();
-    for (auto it = m_rfAgg.constBegin(); it != m_rfAgg.constEnd(); ++it) {
+    for (auto it = m_shapeAgg.rfAgg.constBegin(); it != m_shapeAgg.rfAgg.constEnd(); ++it) {
         const ScaleAgg& ag = it.value();
         if (!ag.hasShape) continue;
         double candidates[4] = {
@@ -2242,16 +2888,14 @@ QPair<double,double> PulseqLoader::getRfGlobalRangePh()
 {
     double mn = std::numeric_limits<double>::infinity();
     double mx = -std::numeric_limits<double>::infinity();
-    QSet<QString> seen;
-    for (SeqBlock* blk : m_vecDecodeSeqBlocks) {
-        if (!blk || !blk->isRF()) continue;
-        RFEvent& rf = blk->GetRFEvent();
-        int RFLength = blk->GetRFLength(); if (RFLength <= 0) continue;
-        float* rfList = blk->GetRFAmplitudePtr();
-        float* phaseList = blk->GetRFPhasePtr();
-        QString key = rfPhKey(rf.phaseShape, rf.timeShape, RFLength);
+    QSet<ShapeKey> seen;
+    const BlockTable::RfColumns& rf = m_blockTable.rf;
+    for (int r = 0; r < rf.size(); ++r) {
+        int RFLength = rf.length[r]; if (RFLength <= 0) continue;
+        const float* phaseList = rf.phaseSamples[r];
+        const ShapeKey key = shapeKey(rf.phaseShape[r], rf.timeShape[r], RFLength);
         if (seen.contains(key)) continue; seen.insert(key);
-        const RFPhEntry& eP = ensureRfPhCached(phaseList, RFLength, rf.phaseShape, rf.timeShape);
+        const RFPhEntry& eP = ensureRfPhCached(phaseList, RFLength, rf.phaseShape[r], rf.timeShape[r]);
         if (eP.phMin < mn) mn = eP.phMin; if (eP.phMax > mx) mx = eP.phMax;
     }
     if (!std::isfinite(mn) || !std::isfinite(mx)) { mn = -1.0; mx = 1.0; }
@@ -2263,40 +2907,39 @@ QPair<double,double> PulseqLoader::getRfGlobalRangePh()
 // ADC Phase viewport rendering (MATLAB-matching formula: angle(exp(i*phase)*exp(i*2*pi*t*freq)))
 // Three optimization strategies to keep rendering fast:
 //   1. Pixel-aware decimation: stride through samples when points-per-pixel > 2
-//   2. Viewport caching: if visibleStart/visibleEnd/pixelWidth unchanged, return cached result
+//   2. Viewport caching: if visibleStart/visibleEnd/pixelWidth and gamma unchanged, return cached result
 //   3. NaN breaks between ADC blocks: enables lsLine rendering (10x faster than scatter dots)
 //      while preventing lines from connecting unrelated ADC events
-void PulseqLoader::getAdcPhaseViewport(double visibleStart, double visibleEnd, int pixelWidth,
-                                       QVector<double>& tOut, QVector<double>& vOut)
+void PulseqLoader::decimateAdcPhaseViewport(double visibleStart, double visibleEnd, int pixelWidth,
+                                            const ViewportSpan& span, QVector<double>& tOut, QVector<double>& vOut)
 {
-    // Viewport cache: return cached data if viewport/pixelWidth unchanged
+    // Viewport cache: return cached data if viewport/pixelWidth unchanged. The ppm offsets
+    // scale with gamma, so a gamma change is a miss as well.
+    const double gamma = Settings::getInstance().getGamma();
     if (m_adcPhaseCache.valid &&
         m_adcPhaseCache.visibleStart == visibleStart &&
         m_adcPhaseCache.visibleEnd == visibleEnd &&
-        m_adcPhaseCache.pixelWidth == pixelWidth)
+        m_adcPhaseCache.pixelWidth == pixelWidth &&
+        m_adcPhaseCache.gamma == gamma)
     {
-        tOut = m_adcPhaseCache.tData;
-        vOut = m_adcPhaseCache.vData;
+        // Copied, not shared: a shared buffer would detach (reallocate) on the next clear()
+        tOut.resize(m_adcPhaseCache.tData.size());
+        vOut.resize(m_adcPhaseCache.vData.size());
+        std::copy(m_adcPhaseCache.tData.cbegin(), m_adcPhaseCache.tData.cend(), tOut.begin());
+        std::copy(m_adcPhaseCache.vData.cbegin(), m_adcPhaseCache.vData.cend(), vOut.begin());
         return;
     }
 
     tOut.clear(); vOut.clear();
-    if (m_vecDecodeSeqBlocks.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
+    if (m_blockTable.empty() || vecBlockEdges.isEmpty() || pixelWidth <= 0) return;
 
-    // Find visible block range via binary search
-    auto itStart = std::lower_bound(vecBlockEdges.begin(), vecBlockEdges.end(), visibleStart);
-    int startBlock = std::max(0, int(std::distance(vecBlockEdges.begin(), itStart)) - 1);
-    
-    double gamma = Settings::getInstance().getGamma();
+    // Visible blocks that carry an ADC (located by getViewportDecimated)
+    if (span.first > span.last) return;
+    const int firstEvent = span.first, lastEvent = span.last;
+    const BlockTable::AdcColumns& adc = m_blockTable.adc;
 
-    // Count total visible ADC samples for global decimation gating (like RF approach)
-    long long totalAdcSamples = 0;
-    for (int i = startBlock; i < vecBlockEdges.size() - 1; ++i) {
-        if (vecBlockEdges[i] > visibleEnd) break;
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-        if (!blk || !blk->isADC()) continue;
-        totalAdcSamples += blk->GetADCEvent().numSamples;
-    }
+    // Total visible ADC samples for global decimation gating (like RF approach)
+    const long long totalAdcSamples = span.samples;
     if (totalAdcSamples == 0) return;
 
     // Determine stride based on points-per-pixel (ppp), mirroring RF decimation logic
@@ -2310,20 +2953,14 @@ void PulseqLoader::getAdcPhaseViewport(double visibleStart, double visibleEnd, i
 
     // Emit points with computed stride, NaN-break between ADC blocks for line plot
     bool emittedAny = false;
-    for (int i = startBlock; i < vecBlockEdges.size() - 1; ++i) {
-        double blockStart = vecBlockEdges[i];
-        if (blockStart > visibleEnd) break;
-        
-        SeqBlock* blk = m_vecDecodeSeqBlocks[i];
-        if (!blk || !blk->isADC()) continue;
-
-        ADCEvent& adc = blk->GetADCEvent();
-        int nSamples = adc.numSamples;
-        double dwell = adc.dwellTime * 1e-9; // ns to seconds
-        double delay = adc.delay * 1e-6;     // us to seconds
+    for (int e = firstEvent; e <= lastEvent; ++e) {
+        const int i = adc.block[e];
+        int nSamples = adc.numSamples[e];
+        double dwell = adc.dwellNs[e] * 1e-9; // ns to seconds
+        double delay = adc.delay[e] * 1e-6;   // us to seconds
         
-        double fullFreqOff = adc.freqOffset + adc.freqPPM * 1e-6 * gamma * m_b0Tesla;
-        double fullPhaseOff = adc.phaseOffset + adc.phasePPM * 1e-6 * gamma * m_b0Tesla;
+        double fullFreqOff = adc.freqOffset[e] + adc.freqPPM[e] * 1e-6 * gamma * m_systemParams.b0Tesla;
+        double fullPhaseOff = adc.phaseOffset[e] + adc.phasePPM[e] * 1e-6 * gamma * m_systemParams.b0Tesla;
 
         // Insert NaN break before this block to separate from previous block's line
         if (emittedAny) {
@@ -2334,7 +2971,7 @@ void PulseqLoader::getAdcPhaseViewport(double visibleStart, double visibleEnd, i
         bool emittedInBlock = false;
         for (int k = 0; k < nSamples; k += stride) {
             double t_local = delay + (k + 0.5) * dwell; // Center of dwell
-            double t_offset_us = adc.delay + (k + 0.5) * (adc.dwellTime * 1e-3);
+            double t_offset_us = adc.delay[e] + (k + 0.5) * (adc.dwellNs[e] * 1e-3);
             double t_plot = vecBlockEdges[i] + t_offset_us * tFactor;
             
             if (t_plot < visibleStart) continue;
@@ -2354,35 +2991,122 @@ void PulseqLoader::getAdcPhaseViewport(double visibleStart, double visibleEnd, i
     m_adcPhaseCache.visibleStart = visibleStart;
     m_adcPhaseCache.visibleEnd = visibleEnd;
     m_adcPhaseCache.pixelWidth = pixelWidth;
-    m_adcPhaseCache.tData = tOut;
-    m_adcPhaseCache.vData = vOut;
+    m_adcPhaseCache.gamma = gamma;
+    m_adcPhaseCache.tData.resize(tOut.size());
+    m_adcPhaseCache.vData.resize(vOut.size());
+    std::copy(tOut.cbegin(), tOut.cend(), m_adcPhaseCache.tData.begin());
+    std::copy(vOut.cbegin(), vOut.cend(), m_adcPhaseCache.vData.begin());
     m_adcPhaseCache.valid = true;
 }
 
-void PulseqLoader::buildShapeScaleAggregates()
+void PulseqLoader::buildShapeScaleAggregates(const BlockSource& blocks, ShapeScaleAggregates& agg)
 {
-    // Reset
-    m_rfAgg.clear();
-    for (int c = 0; c < 3; ++c) {
-        m_gradAgg[c].clear();
-        m_gradTrapMaxPosScale[c] = 0.0;
-        m_gradTrapMinNegScale[c] = 0.0;
-        m_gradExtTrapGlobalMin[c] = std::numeric_limits<double>::infinity();
-        m_gradExtTrapGlobalMax[c] = -std::numeric_limits<double>::infinity();
-    }
+    agg = ShapeScaleAggregates();
+    accumulateShapeScaleAggregates(blocks, agg);
+}
+
+QByteArray PulseqLoader::saveShapeScaleAggregates(const ShapeScaleAggregates& agg)
+{
+    // [count, (ShapeKey, ScaleAgg) * count] for rfAgg and each gradAgg, then the scalar extremes.
+    // Entries are written field by field: three qint32 key fields, four doubles and a hasShape byte.
+    QByteArray out;
+    auto appendRaw = [&out](const void* p, std::size_t n) { out.append(static_cast<const char*>(p), qsizetype(n)); };
+    auto appendTable = [&](const QHash<ShapeKey, ScaleAgg>& table) {
+        const quint64 count = quint64(table.size());
+        appendRaw(&count, sizeof(count));
+        for (auto it = table.constBegin(); it != table.constEnd(); ++it)
+        {
+            const qint32 key[3] = { it.key().shapeId, it.key().timeShapeId, it.key().length };
+            const double value[4] = { it.value().shapeMin, it.value().shapeMax, it.value().maxPosScale, it.value().minNegScale };
+            const quint8 hasShape = it.value().hasShape ? 1 : 0;
+            appendRaw(key, sizeof(key));
+            appendRaw(value, sizeof(value));
+            appendRaw(&hasShape, sizeof(hasShape));
+        }
+    };
+    appendTable(agg.rfAgg);
+    for (const QHash<ShapeKey, ScaleAgg>& table : agg.gradAgg) appendTable(table);
+    appendRaw(agg.gradTrapMaxPosScale, sizeof(agg.gradTrapMaxPosScale));
+    appendRaw(agg.gradTrapMinNegScale, sizeof(agg.gradTrapMinNegScale));
+    appendRaw(agg.gradExtTrapGlobalMin, sizeof(agg.gradExtTrapGlobalMin));
+    appendRaw(agg.gradExtTrapGlobalMax, sizeof(agg.gradExtTrapGlobalMax));
+    return out;
+}
+
+bool PulseqLoader::loadShapeScaleAggregates(const char* data, std::size_t size, ShapeScaleAggregates& agg)
+{
+    const char* end = data + size;
+    auto readRaw = [&data, end](void* p, std::size_t n) {
+        if (n > std::size_t(end - data)) return false;
+        memcpy(p, data, n);
+        data += n;
+        return true;
+    };
+    const std::size_t kEntryBytes = 3 * sizeof(qint32) + 4 * sizeof(double) + sizeof(quint8);
+    auto readTable = [&](QHash<ShapeKey, ScaleAgg>& table) {
+        quint64 count = 0;
+        if (!readRaw(&count, sizeof(count)) || count > std::size_t(end - data) / kEntryBytes)
+            return false;
+        table.clear();
+        table.reserve(qsizetype(count));
+        for (quint64 i = 0; i < count; ++i)
+        {
+            qint32 key[3];
+            double value[4];
+            quint8 hasShape = 0;
+            readRaw(key, sizeof(key));
+            readRaw(value, sizeof(value));
+            readRaw(&hasShape, sizeof(hasShape));
+            if (hasShape > 1)
+                return false;
+            ScaleAgg scale;
+            scale.shapeMin = value[0];
+            scale.shapeMax = value[1];
+            scale.maxPosScale = value[2];
+            scale.minNegScale = value[3];
+            scale.hasShape = hasShape != 0;
+            table.insert(shapeKey(key[0], key[1], key[2]), scale);
+        }
+        return true;
+    };
+    agg = ShapeScaleAggregates();
+    bool ok = readTable(agg.rfAgg);
+    for (QHash<ShapeKey, ScaleAgg>& table : agg.gradAgg) ok = ok && readTable(table);
+    ok = ok && readRaw(agg.gradTrapMaxPosScale, sizeof(agg.gradTrapMaxPosScale)) &&
+         readRaw(agg.gradTrapMinNegScale, sizeof(agg.gradTrapMinNegScale)) &&
+         readRaw(agg.gradExtTrapGlobalMin, sizeof(agg.gradExtTrapGlobalMin)) &&
+         readRaw(agg.gradExtTrapGlobalMax, sizeof(agg.gradExtTrapGlobalMax)) && data == end;
+    if (!ok) agg = ShapeScaleAggregates();
+    return ok;
+}
+
+void PulseqLoader::accumulateShapeScaleAggregates(const BlockSource& blocks, ShapeScaleAggregates& agg)
+{
+    // Runs on the load worker: only touches 'agg', never the per-frame render caches.
+    auto shapeRange = [](const float* v, int n) {
+        double mn = std::numeric_limits<double>::infinity();
+        double mx = -std::numeric_limits<double>::infinity();
+        for (int i = 0; i < n; ++i) {
+            float x = v ? v[i] : std::numeric_limits<float>::quiet_NaN();
+            if (!std::isnan(x)) { if (x < mn) mn = x; if (x > mx) mx = x; }
+        }
+        if (!std::isfinite(mn) || !std::isfinite(mx)) { mn = 0.0; mx = 0.0; }
+        return qMakePair(mn, mx);
+    };
     // Single pass over blocks
-    for (SeqBlock* blk : m_vecDecodeSeqBlocks) {
+    for (SeqBlock* blk : blocks) {
         if (!blk) continue;
         // RF
         if (blk->isRF()) {
             RFEvent& rf = blk->GetRFEvent();
             int RFLength = blk->GetRFLength();
             if (RFLength > 0) {
-                float* rfList = blk->GetRFAmplitudePtr();
-                const RFAmpEntry& eA = ensureRfAmpCached(rfList, RFLength, rf.magShape, rf.timeShape);
-                QString key = rfAmpKey(rf.magShape, rf.timeShape, RFLength);
-                ScaleAgg& ag = m_rfAgg[key];
-                if (!ag.hasShape) ag.updateShape(eA.ampMin, eA.ampMax);
+                const ShapeKey key = shapeKey(rf.magShape, rf.timeShape, RFLength);
+                ScaleAgg& ag = agg.rfAgg[key];
+                if (!ag.hasShape) {
+                    auto r = shapeRange(blk->GetRFAmplitudePtr(), RFLength);
+                    ag.updateShape(r.first, r.second);
+                }
                 ag.updateScale(double(rf.amplitude));
             }
         }
@@ -2393,18 +3117,20 @@ void PulseqLoader::buildShapeScaleAggregates()
             const GradEvent& grad = blk->GetGradEvent(ch);
             if (blk->isTrapGradient(ch)) {
                 double s = double(grad.amplitude);
-                if (s >= 0) m_gradTrapMaxPosScale[ch] = std::max(m_gradTrapMaxPosScale[ch], s);
-                else        m_gradTrapMinNegScale[ch] = std::min(m_gradTrapMinNegScale[ch], s);
+                if (s >= 0) agg.gradTrapMaxPosScale[ch] = std::max(agg.gradTrapMaxPosScale[ch], s);
+                else        agg.gradTrapMinNegScale[ch] = std::min(agg.gradTrapMinNegScale[ch], s);
                 continue;
             }
             if (blk->isArbitraryGradient(ch)) {
                 int numSamples = blk->GetArbGradNumSamples(ch);
                 const float* shapePtr = blk->GetArbGradShapePtr(ch);
                 if (numSamples > 0 && shapePtr) {
-                    const GradShapeEntry& e = ensureGradCached(shapePtr, numSamples, grad.waveShape, grad.timeShape);
-                    QString key = gradKey(grad.waveShape, grad.timeShape, numSamples);
-                    ScaleAgg& ag = m_gradAgg[ch][key];
-                    if (!ag.hasShape) ag.updateShape(e.vMin, e.vMax);
+                    const ShapeKey key = shapeKey(grad.waveShape, grad.timeShape, numSamples);
+                    ScaleAgg& ag = agg.gradAgg[ch][key];
+                    if (!ag.hasShape) {
+                        auto r = shapeRange(shapePtr, numSamples);
+                        ag.updateShape(r.first, r.second);
+                    }
                     ag.updateScale(double(grad.amplitude));
                 }
                 continue;
@@ -2412,18 +3138,13 @@ void PulseqLoader::buildShapeScaleAggregates()
             if (blk->isExtTrapGradient(ch)) {
                 const std::vector<float>& shape = blk->GetExtTrapGradShape(ch);
                 if (!shape.empty()) {
-                    double smin = std::numeric_limits<double>::infinity();
-                    double smax = -std::numeric_limits<double>::infinity();
-                    for (float v : shape) {
-                        if (!std::isnan(v)) { if (v < smin) smin = v; if (v > smax) smax = v; }
-                    }
-                    if (!std::isfinite(smin) || !std::isfinite(smax)) { smin = 0.0; smax = 0.0; }
+                    auto r = shapeRange(shape.data(), int(shape.size()));
                     double scale = double(grad.amplitude);
-                    double cands[2] = { smin * scale, smax * scale };
+                    double cands[2] = { r.first * scale, r.second * scale };
                     for (double v : cands) {
                         if (!std::isfinite(v)) continue;
-                        if (v < m_gradExtTrapGlobalMin[ch]) m_gradExtTrapGlobalMin[ch] = v;
-                        if (v > m_gradExtTrapGlobalMax[ch]) m_gradExtTrapGlobalMax[ch] = v;
+                        if (v < agg.gradExtTrapGlobalMin[ch]) agg.gradExtTrapGlobalMin[ch] = v;
+                        if (v > agg.gradExtTrapGlobalMax[ch]) agg.gradExtTrapGlobalMax[ch] = v;
                     }
                 }
                 continue;
@@ -2432,11 +3153,96 @@ void PulseqLoader::buildShapeScaleAggregates()
     }
 }
 
+void PulseqLoader::accumulateEnvelopes(const BlockSource& blocks, int firstBlock, const QVector<double>& edges,
+                                       double timeFactor, EnvelopeSet& env)
+{
+    // Runs on the load worker. Sample timing and values follow decimateRfViewport and
+    // decimateGradViewport so the pyramid and the exact path draw the same waveform.
+    for (int k = 0; k < blocks.size(); ++k) {
+        SeqBlock* blk = blocks[k];
+        if (!blk) continue;
+        const double blockStart = edges[firstBlock + k];
+
+        if (blk->isRF()) {
+            RFEvent& rf = blk->GetRFEvent();
+            const int RFLength = blk->GetRFLength();
+            const float* rfList = blk->GetRFAmplitudePtr();
+            const float* phaseList = blk->GetRFPhasePtr();
+            if (RFLength > 0 && rfList) {
+                const double tStart = blockStart + rf.delay * timeFactor;
+                const double dt = blk->GetRFDwellTime() * timeFactor;
+                const double amp = double(rf.amplitude);
+                for (int i = 0; i + 1 < RFLength; ++i)
+                    env.rfAmp.addSegment(tStart + i * dt, rfList[i] * amp, tStart + (i + 1) * dt, rfList[i + 1] * amp);
+                if (RFLength == 1) env.rfAmp.addPoint(tStart, rfList[0] * amp);
+
+                auto realIt = env.rfPhaseRealLike.find(phaseList);
+                if (realIt == env.rfPhaseRealLike.end()) {
+                    bool isReal = true;
+                    for (int i = 0; phaseList && i < RFLength && isReal; ++i) {
+                        const float p = phaseList[i];
+                        if (!std::isnan(p) && std::abs(std::sin(p)) > 1e-2) isReal = false;
+                    }
+                    realIt = env.rfPhaseRealLike.insert(phaseList, isReal);
+                }
+                const bool isRealLike = realIt.value();
+                const double fullFreqOff = rf.freqOffset + rf.freqPPM * 1e-6 * env.gamma * env.b0Tesla;
+                const double fullPhaseOff = rf.phaseOffset + rf.phasePPM * 1e-6 * env.gamma * env.b0Tesla;
+                auto phaseAt = [&](int i) {
+                    const double phaseVal = (isRealLike || !phaseList) ? 0.0 : double(phaseList[i]);
+                    const double tLocalSec = (i * dt / timeFactor) * 1e-6;
+                    const double totalPhase = phaseVal + fullPhaseOff + 2.0 * M_PI * tLocalSec * fullFreqOff;
+                    return std::atan2(std::sin(totalPhase), std::cos(totalPhase));
+                };
+                double prev = phaseAt(0);
+                if (RFLength == 1) env.rfPh.addPoint(tStart, prev);
+                for (int i = 0; i + 1 < RFLength; ++i) {
+                    const double next = phaseAt(i + 1);
+                    env.rfPh.addSegment(tStart + i * dt, prev, tStart + (i + 1) * dt, next);
+                    prev = next;
+                }
+            }
+        }
+
+        for (int ch = 0; ch < 3; ++ch) {
+            const GradEvent& grad = blk->GetGradEvent(ch);
+            EnvelopePyramid& pyramid = env.grad[ch];
+            const double tStart = blockStart + grad.delay * timeFactor;
+            const double amp = double(grad.amplitude);
+            if (blk->isTrapGradient(ch)) {
+                const double t1 = tStart + grad.rampUpTime * timeFactor;
+                const double t2 = t1 + grad.flatTime * timeFactor;
+                const double t3 = t2 + grad.rampDownTime * timeFactor;
+                pyramid.addSegment(tStart, 0.0, t1, amp);
+                pyramid.addSegment(t1, amp, t2, amp);
+                pyramid.addSegment(t2, amp, t3, 0.0);
+            }
+            else if (blk->isArbitraryGradient(ch)) {
+                const int numSamples = blk->GetArbGradNumSamples(ch);
+                const float* shapePtr = blk->GetArbGradShapePtr(ch);
+                if (numSamples <= 0 || !shapePtr) continue;
+                const double dt = env.gradRasterUs * timeFactor;
+                for (int j = 0; j + 1 < numSamples; ++j)
+                    pyramid.addSegment(tStart + j * dt, shapePtr[j] * amp, tStart + (j + 1) * dt, shapePtr[j + 1] * amp);
+                if (numSamples == 1) pyramid.addPoint(tStart, shapePtr[0] * amp);
+            }
+            else if (blk->isExtTrapGradient(ch)) {
+                const std::vector<long>& times = blk->GetExtTrapGradTimes(ch);
+                const std::vector<float>& shape = blk->GetExtTrapGradShape(ch);
+                if (times.empty() || times.size() != shape.size()) continue;
+                for (std::size_t j = 0; j + 1 < times.size(); ++j)
+                    pyramid.addSegment(tStart + times[j] * timeFactor, shape[j] * amp,
+                                       tStart + times[j + 1] * timeFactor, shape[j + 1] * amp);
+                if (times.size() == 1) pyramid.addPoint(tStart + times[0] * timeFactor, shape[0] * amp);
+            }
+        }
+    }
+}
+
 QList<QPair<QString, int>> PulseqLoader::getActiveLabels(int blockIdx) const
 {
     QList<QPair<QString, int>> result;
-    const LabelSnapshot* snap = labelSnapshotAfterBlock(blockIdx);
-    if (!snap) return result;
+    if (blockIdx < 0 || blockIdx >= m_labelHistory.blockCount) return result;
 
     struct Spec { QString name; bool isFlag; int id; };
     static const QVector<Spec> specs = {
@@ -2461,15 +3267,15 @@ QList<QPair<QString, int>> PulseqLoader::getActiveLabels(int blockIdx) const
 
         if (s.isFlag)
         {
-            if (s.id < 0 || s.id >= snap->flags.size()) continue;
-            if (snap->flags[s.id]) {
+            if (s.id < 0 || s.id >= NUM_FLAGS) continue;
+            if (LabelHistory::valueAfterBlock(m_labelHistory.flags[s.id], blockIdx)) {
                 result.append({s.name, 1});
             }
         }
         else
         {
-            if (s.id < 0 || s.id >= snap->counters.size()) continue;
-            int v = snap->counters[s.id];
+            if (s.id < 0 || s.id >= NUM_LABELS) continue;
+            int v = LabelHistory::valueAfterBlock(m_labelHistory.counters[s.id], blockIdx);
             // Show all counters, even if 0, to match user expectation of "current state"
             result.append({s.name, v});
         }
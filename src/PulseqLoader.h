@@ -11,12 +11,23 @@
 #include <QHash>
 #include <limits>
 #include <QSet>
+#include <QMutex>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <atomic>
+#include <functional>
 
 #include "ExternalSequence.h" // For ExternalSequence factory and SeqBlock
+#include "BlockCache.h"
+#include "BlockTable.h"
+#include "KSpaceTrajectory.h"
+#include "EnvelopePyramid.h"
+#include "ViewportSeries.h"
 
 // Forward declarations
 class MainWindow;
 class EventBlockInfoDialog;
+class QFile;
 
 class PulseqLoader : public QObject
 {
@@ -27,11 +38,39 @@ public:
     ~PulseqLoader();
 
     // Public API for other classes
+    // Parsing and block decoding run on a worker thread (inline in silent mode); the finished
+    // sequence replaces the current one only when the whole load succeeded.
     bool LoadPulseqFile(const QString& sPulseqFilePath);
+    bool isLoadInProgress() const { return m_loadInProgress; }
+    bool wasLastLoadCancelled() const { return m_lastLoadCancelled; }
     void setBlockInfoContent(EventBlockInfoDialog* dialog, int currentBlock);
     void setRawBlockInfoContent(EventBlockInfoDialog* dialog, int currentBlock);
 
-    // Extension label snapshots (current values after a block).
+    // Label state built at load as run-length transitions: for each known counter/flag, the
+    // blocks whose label events changed its value, in block order. The first event on a label
+    // always records a transition, so the front entry is where the label becomes defined.
+    struct LabelTransition
+    {
+        int block;
+        int value; // counter value, or 0/1 for flags
+    };
+    struct LabelHistory
+    {
+        std::vector<LabelTransition> counters[NUM_LABELS];
+        std::vector<LabelTransition> flags[NUM_FLAGS];
+        int blockCount {0};
+        // Largest |value| carried by any LABELSET/LABELINC event (sizes the ADC/labels panel)
+        int maxAbsEventValue {0};
+        void clear();
+        // Value in effect after block blockIdx (0 before the first transition), by binary search
+        static int valueAfterBlock(const std::vector<LabelTransition>& transitions, int blockIdx);
+        // Largest value in effect after any block of [firstBlock, lastBlock]; walks only the
+        // transitions inside the range
+        static int maxValueInBlocks(const std::vector<LabelTransition>& transitions, int firstBlock, int lastBlock);
+    };
+    const LabelHistory& getLabelHistory() const { return m_labelHistory; }
+
+    // Extension label values after a block, answered from the label history
     bool getCounterValueAfterBlock(int blockIdx, int counterId, int& outVal) const;
     bool getFlagValueAfterBlock(int blockIdx, int flagId, bool& outVal) const;
     QSet<QString> getUsedExtensions() const { return m_usedExtensions; }
@@ -40,9 +79,35 @@ public:
 
     // Getters for data needed by other handlers
     const QVector<double>& getBlockEdges() const { return vecBlockEdges; }
+    // Blocks overlapping [visibleStart, visibleEnd) in internal time units, found by binary search
+    // over the block edges. Returns false if the window does not intersect any block.
+    bool findVisibleBlockRange(double visibleStart, double visibleEnd, int& startBlock, int& endBlock) const;
+    // Index of the block containing internal time t (edges[i] <= t < edges[i+1]), or -1
+    int findBlockAtTime(double t) const;
+
+    // Per-channel event index built at load: the blocks that carry an event on a channel, in
+    // block order, with the block's time span (internal units). Viewport paths walk this list
+    // instead of every block in the window.
+    enum EventChannel { ChannelRF = 0, ChannelGX, ChannelGY, ChannelGZ, ChannelADC, ChannelLabel, ChannelTrigger, NumEventChannels };
+    struct EventInterval
+    {
+        int block;
+        double tStart;
+        double tEnd;
+    };
+    const QVector<EventInterval>& getChannelEvents(int channel) const { return m_channelEvents[channel]; }
+    // Event scalars of every block as contiguous columns; rows align with getChannelEvents()
+    const BlockTable& getBlockTable() const { return m_blockTable; }
+    // Range [first, last] into getChannelEvents(channel) of events overlapping [visibleStart, visibleEnd)
+    bool findVisibleEvents(int channel, double visibleStart, double visibleEnd, int& first, int& last) const;
     const QString& getTimeUnits() const { return TimeUnits; }
     double getTotalDuration_us() const { return m_dTotalDuration_us; }
-    const std::vector<SeqBlock*>& getDecodedSeqBlocks() const { return m_vecDecodeSeqBlocks; }
+    // All blocks of the sequence; in lazy mode they are decoded on access through the block cache
+    BlockSource getDecodedSeqBlocks() const
+    {
+        return m_lazyDecoding ? BlockSource(&m_blockCache, m_lazyBlockCount) : BlockSource(m_vecDecodeSeqBlocks);
+    }
+    bool isLazyDecoding() const { return m_lazyDecoding; }
     int getBlockRangeStart() const { return nBlockRangeStart; }
     int getBlockRangeEnd() const { return nBlockRangeEnd; }
     void setBlockRange(int start, int end) { nBlockRangeStart = start; nBlockRangeEnd = end; }
@@ -76,42 +141,58 @@ public:
 
     // Version reading functionality
     static std::pair<int, int> ReadFileVersion(const std::string& filename);
+    // Same, on the text of a .seq file already in memory
+    static std::pair<int, int> ReadFileVersion(const char* data, std::size_t size);
 
     // Test/CLI: suppress GUI dialogs during load failures
     void setSilentMode(bool silent) { m_silentMode = silent; }
     bool isSilentMode() const { return m_silentMode; }
+    // Test/CLI: skip the [SIGNATURE] MD5 verification (trusted batch runs)
+    void setSignatureCheckEnabled(bool enabled) { m_signatureCheckEnabled = enabled; }
+    bool isSignatureCheckEnabled() const { return m_signatureCheckEnabled; }
 
-    // RF on-demand rendering API (Phase 1)
-    // Build viewport RF amplitude/phase series using per-shape cache and per-block scaling.
-    void getRfViewportDecimated(double visibleStart, double visibleEnd, int pixelWidth,
-                                QVector<double>& tAmp, QVector<double>& vAmp,
-                                QVector<double>& tPh, QVector<double>& vPh);
+    // On-demand viewport rendering: decimated RF amplitude/phase, ADC phase (MATLAB-matching
+    // formula) and gradient series for one window, from the per-shape caches and per-block
+    // scaling. The visible event range and sample total of each channel are located once, then
+    // the channels are decimated concurrently on m_viewportPool. Calls must not overlap; the
+    // drawer keeps at most one viewport frame in flight.
+    void getViewportDecimated(const ViewportQuery& query, ViewportSeries& out);
 
     // Global RF ranges without materializing merged arrays
     QPair<double,double> getRfGlobalRangeAmp();
     QPair<double,double> getRfGlobalRangePh();
 
-    // ADC phase on-demand rendering (MATLAB-matching formula)
-    void getAdcPhaseViewport(double visibleStart, double visibleEnd, int pixelWidth,
-                             QVector<double>& tOut, QVector<double>& vOut);
-
-    // ADC phase viewport cache (invalidated on sequence reload)
+    // ADC phase viewport cache, keyed on the viewport and gamma (invalidated on sequence reload).
+    // Only the ADC phase kernel of getViewportDecimated touches it.
     struct AdcPhaseCache {
         double visibleStart {0.0};
         double visibleEnd {0.0};
         int pixelWidth {0};
+        double gamma {0.0};
         QVector<double> tData;
         QVector<double> vData;
         bool valid {false};
     };
     mutable AdcPhaseCache m_adcPhaseCache;
 
+    // Sequence [DEFINITIONS] resolved once at load, so render and trajectory paths do not go
+    // through the string-keyed definition map. Times in microseconds; 0 when undefined.
+    struct SystemParameters {
+        double gradRasterUs {0.0};
+        double rfRasterUs {0.0};
+        double adcRasterUs {0.0};
+        double blockDurationRasterUs {0.0};
+        double b0Tesla {3.0};         // 3 T assumed when B0 is undefined
+        double fovMeters {0.0};       // first FOV component
+        double repetitionTimeUs {0.0}; // RepetitionTime, else TR
+        double echoTimeUs {0.0};       // TE, else EchoTime
+        double totalDurationUs {0.0};
+    };
+    const SystemParameters& getSystemParameters() const { return m_systemParams; }
+
     // B0 accessor (from sequence [DEFINITIONS])
-    double getB0Tesla() const { return m_b0Tesla; }
+    double getB0Tesla() const { return m_systemParams.b0Tesla; }
 
-    // Phase 2: Gradient on-demand rendering API
-    void getGradViewportDecimated(int channel, double visibleStart, double visibleEnd, int pixelWidth,
-                                  QVector<double>& tOut, QVector<double>& vOut);
     QPair<double,double> getGradGlobalRange(int channel);
 
     // Precise single-point sampling APIs (for status bar, no merged arrays)
@@ -131,6 +212,9 @@ public:
     const QVector<double>& getRefocusingCenters() const { return m_refocusingCentersAxis; }
     QVector<double> getKxKyZeroTimes() const; // Returns times when kx=ky=0 (in axis units)
 
+    // The trajectory is computed in the background after load and arrives in block windows;
+    // the getters below return what has been streamed in so far. ensureTrajectoryPrepared()
+    // waits for the rest (trajectory export).
     void ensureTrajectoryPrepared();
     const QVector<double>& getTrajectoryKx() const { return m_kTrajectoryX; }
     const QVector<double>& getTrajectoryKy() const { return m_kTrajectoryY; }
@@ -141,6 +225,7 @@ public:
     const QVector<double>& getTrajectoryKzAdc() const { return m_kTrajectoryZAdc; }
     const QVector<double>& getTrajectoryTimeAdcSec() const { return m_kTimeAdcSec; }
     bool hasTrajectoryData() const { return m_kTrajectoryReady; }
+    bool isTrajectoryComputing() const { return m_kTrajectoryComputing; }
     bool needsRfUseGuessWarning() const { return m_rfUseGuessed && !m_warnedRfUseGuess; }
     void markRfUseGuessWarningShown() { m_warnedRfUseGuess = true; }
     QString getRfUseGuessWarning() const { return m_rfGuessWarning; }
@@ -158,22 +243,32 @@ public slots:
     bool ClosePulseqFile();
     // Lightweight time-unit rescaling (avoids full file reload)
     void rescaleTimeUnit();
+    // Gamma only enters the trajectory through the RF-use guesses (ppm from freqOffset);
+    // recomputes it from the first block whose guessed use changes, if any
+    void onGammaChanged();
+    // Request cancellation of a running LoadPulseqFile (thread-safe, no-op when idle)
+    void cancelLoad();
 
 private:
-    struct LabelSnapshot
-    {
-        QVector<int>  counters; // size NUM_LABELS (known counters only)
-        QVector<bool> flags;    // size NUM_FLAGS (known flags only)
-    };
-
-    void buildLabelSnapshotCache();
-    const LabelSnapshot* labelSnapshotAfterBlock(int blockIdx) const;
-
-    void buildShapeScaleAggregates();
     void ClearPulseqCache();
     bool IsBlockRf(const float* fAmp, const float* fPhase, const int& iSamples);
     void updateEchoAndExcitationMetadata(int versionMajor, int versionMinor);
-    void computeKSpaceTrajectory();
+    // TR start blocks: nearest block edge per TR when a TR is set, else one per ADC block
+    void rebuildTrBlockIndices();
+    // Runs KSpaceTrajectory::compute on m_trajectoryPool in windows of blocks, each handed
+    // to appendTrajectoryWindow() on the GUI thread as soon as it is done. A non-zero
+    // fromBlock keeps the windows before it and resumes from their checkpoint.
+    void startTrajectoryComputation(int fromBlock = 0);
+    void cancelTrajectoryComputation();
+    void appendTrajectoryWindow(quint64 generation, double jobTFactor, int firstBlock, int endBlock,
+                                const KSpaceTrajectory::Result& part, bool last);
+    void clearTrajectoryData();
+    // Drops the trajectory data of the windows from 'window' on (checkpoint sizes)
+    void truncateTrajectoryData(int window);
+    QVector<double> computeKxKyZeroTimesSec() const;
+    // ADC sample times (internal units) of blocks [firstBlock, endBlock)
+    static QVector<double> adcSampleTimes(const BlockTable& table, const QVector<double>& edges,
+                                          double timeFactor, int firstBlock, int endBlock);
     void updateTimeUnitFromSettings();
 
     // Settings management
@@ -189,7 +284,12 @@ private:
     QString m_sLastOpenDirectory;  // Remember last opened directory
     QStringList m_listRecentPulseqFilePaths;
     std::shared_ptr<ExternalSequence> m_spPulseqSeq;
-    std::vector<SeqBlock*> m_vecDecodeSeqBlocks;
+    std::vector<SeqBlock*> m_vecDecodeSeqBlocks; // eager mode only, points into m_blockStorage
+    std::vector<SeqBlock> m_blockStorage;        // all decoded blocks, one allocation
+    // Lazy mode: only the block count is kept, blocks are decoded on demand
+    bool m_lazyDecoding {false};
+    int m_lazyBlockCount {0};
+    mutable BlockCache m_blockCache;
     std::vector<int> m_vecTrBlockIndices;
     double m_dTotalDuration_us;
 
@@ -224,15 +324,17 @@ private:
     // Cached pulseq version like "v1.4.1"
     QString m_pulseqVersionString;
 
-    // Cached extension label values after each block (for Information window)
-    QVector<LabelSnapshot> m_labelSnapshots;
+    // Extension label transitions (Information window, extension plot)
+    LabelHistory m_labelHistory;
     QSet<QString> m_usedExtensions;
 
+    QVector<EventInterval> m_channelEvents[NumEventChannels];
+    BlockTable m_blockTable;
+
     // Test/CLI behavior
     bool m_silentMode {false};
 
-    // B0 field strength from [DEFINITIONS] (Tesla); needed for PPM phase terms
-    double m_b0Tesla {0.0};
+    SystemParameters m_systemParams;
 
     // Echo-time / excitation overlay cache
     bool m_supportsRfUseMetadata {false};
@@ -246,6 +348,7 @@ private:
     QString m_rfGuessWarning;
 
     bool m_kTrajectoryReady {false};
+    bool m_kTrajectoryComputing {false};
     QVector<double> m_kTrajectoryX;
     QVector<double> m_kTrajectoryY;
     QVector<double> m_kTrajectoryZ;
@@ -256,6 +359,23 @@ private:
     QVector<double> m_kTimeAdcSec;
     QVector<char>   m_rfUsePerBlock;
 
+    // Key of the per-shape caches/aggregates: shape ID, time shape ID and sample count. Plain
+    // integers so the per-frame lookups neither format nor allocate.
+    struct ShapeKey {
+        int shapeId {0};
+        int timeShapeId {0};
+        int length {0};
+        bool operator==(const ShapeKey& other) const
+        {
+            return shapeId == other.shapeId && timeShapeId == other.timeShapeId && length == other.length;
+        }
+        friend size_t qHash(const ShapeKey& key, size_t seed = 0) noexcept
+        {
+            return qHashMulti(seed, key.shapeId, key.timeShapeId, key.length);
+        }
+    };
+    static ShapeKey shapeKey(int shapeId, int timeShapeId, int len) { return ShapeKey{shapeId, timeShapeId, len}; }
+
     // ===== RF Shape Cache (split Amp/Phase) =====
     struct RFAmpEntry {
         QVector<float> ampNorm; // normalized amplitude shape
@@ -271,14 +391,16 @@ private:
         double phMax {0.0};
         bool isRealLike {false};
     };
-    QHash<QString, RFAmpEntry> m_rfAmpCache; // rfA:<magShapeId>:<timeShapeId>#<len>
-    QHash<QString, RFPhEntry>  m_rfPhCache;  // rfP:<phaseShapeId>:<timeShapeId>#<len>
-    QString rfAmpKey(int magShapeId, int timeShapeId, int len) const;
-    QString rfPhKey(int phaseShapeId, int timeShapeId, int len) const;
+    // The viewport kernels run concurrently on m_viewportPool. Entries live on the heap so the
+    // references handed out survive later inserts; the maps are guarded by m_shapeCacheMutex.
+    QHash<ShapeKey, std::shared_ptr<const RFAmpEntry>> m_rfAmpCache; // (magShapeId, timeShapeId, len)
+    QHash<ShapeKey, std::shared_ptr<const RFPhEntry>>  m_rfPhCache;  // (phaseShapeId, timeShapeId, len)
+    mutable QMutex m_shapeCacheMutex;
     const RFAmpEntry& ensureRfAmpCached(const float* amp, int len, int magShapeId, int timeShapeId);
     const RFPhEntry&  ensureRfPhCached(const float* phase, int len, int phaseShapeId, int timeShapeId);
     void downsampleMinMax(const QVector<float>& src, int buckets, QVector<int>& outIdxMin, QVector<int>& outIdxMax) const;
-    void lttbDownsampleUniform(const QVector<float>& src, double tStart, double dt, int targetPoints,
+    // Appends the LTTB selection of src (sampled at tStart + i*dt), values multiplied by scale
+    void lttbDownsampleUniform(const QVector<float>& src, double tStart, double dt, double scale, int targetPoints,
                                QVector<double>& tOut, QVector<double>& vOut) const;
 
     // Gradient shape cache for arbitrary gradients
@@ -288,11 +410,25 @@ private:
         double vMin {0.0};
         double vMax {0.0};
     };
-    QHash<QString, GradShapeEntry> m_gradShapeCache; // key: grad:<waveShapeId>:<timeShapeId>#<len>
-    QString gradKey(int waveShapeId, int timeShapeId, int len) const;
+    QHash<ShapeKey, std::shared_ptr<const GradShapeEntry>> m_gradShapeCache; // (waveShapeId, timeShapeId, len)
     const GradShapeEntry& ensureGradCached(const float* shape, int len,
                                           int waveShapeId, int timeShapeId);
 
+    // Per-channel kernels of getViewportDecimated. 'span' holds the visible event rows of the
+    // channel and their sample total, which gates decimation.
+    struct ViewportSpan {
+        int first {0};
+        int last {-1};
+        long long samples {0};
+    };
+    void decimateRfViewport(double visibleStart, double visibleEnd, int pixelWidth, const ViewportSpan& span,
+                            bool phase, QVector<double>& tOut, QVector<double>& vOut);
+    void decimateAdcPhaseViewport(double visibleStart, double visibleEnd, int pixelWidth,
+                                  const ViewportSpan& span, QVector<double>& tOut, QVector<double>& vOut);
+    void decimateGradViewport(int channel, double visibleStart, double visibleEnd, int pixelWidth,
+                              const ViewportSpan& span, QVector<double>& tOut, QVector<double>& vOut);
+    QThreadPool m_viewportPool;
+
     // ===== Aggregated per-shape scale tracking (for global Y-range, computed once at load) =====
     struct ScaleAgg {
         double shapeMin {0.0};
@@ -308,16 +444,126 @@ private:
             else        minNegScale = std::min(minNegScale, s);
         }
     };
-    // RF amplitude aggregations (keyed by rfAmpKey)
-    QHash<QString, ScaleAgg> m_rfAgg;
-    // Gradient aggregations per channel (keyed by gradKey for arbitrary shapes)
-    QHash<QString, ScaleAgg> m_gradAgg[3];
-    // Trapezoid gradient per-channel scale extremes (no shape key)
-    double m_gradTrapMaxPosScale[3] {0.0, 0.0, 0.0};
-    double m_gradTrapMinNegScale[3] {0.0, 0.0, 0.0};
-    // External trapezoid global min/max per channel (aggregated during load)
-    double m_gradExtTrapGlobalMin[3] { std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
-    double m_gradExtTrapGlobalMax[3] { -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+    struct ShapeScaleAggregates {
+        // RF amplitude aggregations (keyed by magnitude shape)
+        QHash<ShapeKey, ScaleAgg> rfAgg;
+        // Gradient aggregations per channel (keyed by waveform shape for arbitrary gradients)
+        QHash<ShapeKey, ScaleAgg> gradAgg[3];
+        // Trapezoid gradient per-channel scale extremes (no shape key)
+        double gradTrapMaxPosScale[3] {0.0, 0.0, 0.0};
+        double gradTrapMinNegScale[3] {0.0, 0.0, 0.0};
+        // External trapezoid global min/max per channel (aggregated during load)
+        double gradExtTrapGlobalMin[3] { std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() };
+        double gradExtTrapGlobalMax[3] { -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+    };
+    ShapeScaleAggregates m_shapeAgg;
+
+    // Min/max pyramids over absolute time for the zoomed-out RF and gradient views (load-time)
+    struct EnvelopeSet {
+        EnvelopePyramid rfAmp;
+        EnvelopePyramid rfPh; // built with 'gamma'; unused once the setting differs
+        EnvelopePyramid grad[3];
+        double gamma {0.0};
+        double b0Tesla {0.0};
+        double gradRasterUs {0.0};
+        QHash<const float*, bool> rfPhaseRealLike; // per decoded phase shape, load-time only
+    };
+    EnvelopeSet m_envelopes;
+
+    // ===== Background load job =====
+    // Everything the worker produces for one file. It is only moved into the loader
+    // (on the GUI thread) once the job has finished successfully.
+    struct LoadedSequence {
+        std::shared_ptr<ExternalSequence> seq;
+        std::vector<SeqBlock*> blocks; // empty in lazy mode
+        std::vector<SeqBlock> blockStorage; // backs 'blocks'
+        int blockCount {0};
+        SystemParameters systemParams;
+        QVector<double> blockEdges;
+        QVector<double> adcTime, adcValues;
+        QVector<EventInterval> channelEvents[NumEventChannels];
+        BlockTable table;
+        LabelHistory labelHistory;
+        QSet<QString> usedExtensions;
+        ShapeScaleAggregates shapeAgg;
+        EnvelopeSet envelopes;
+        bool cancelled {false};
+        QString errorTitle;
+        QString errorText;
+        void releaseBlocks();
+    };
+    // In lazy mode blocks are decoded window by window and released right after the
+    // load-time series/caches have consumed them. With useCache, an unchanged file is restored
+    // from the on-disk sequence cache instead of being parsed, and a parsed one is added to it
+    // (keeping the cache within cacheLimitBytes).
+    // 'text' is the mapped file. hashInline verifies the [SIGNATURE] as part of the load;
+    // otherwise it is left to startSignatureCheck().
+    static bool runLoadJob(const QString& path, const char* text, std::size_t textSize, double timeFactor, double gamma, bool lazy, bool useCache,
+                           qint64 cacheLimitBytes, bool hashInline, const std::atomic<bool>& cancel, const std::function<void(int)>& progress, LoadedSequence& out);
+    // Hashes the signed part of the mapped file on m_signaturePool while the load parses it.
+    // The result is held until commitSignatureCheck() makes it the check of the shown sequence.
+    void startSignatureCheck(const std::shared_ptr<QFile>& file, const char* text, std::size_t textSize);
+    void onSignatureHashed(const std::shared_ptr<std::atomic<bool>>& cancel, std::size_t signedSize, const std::string& hash);
+    void commitSignatureCheck();
+    void applySignatureCheck(std::size_t signedSize, const std::string& hash);
+    // Cancel the check of the shown sequence / of the load in progress
+    void cancelSignatureCheck();
+    void cancelPendingSignatureCheck();
+    // Label transitions of blocks [firstBlock, firstBlock + blocks.size()); a non-zero
+    // firstBlock continues from the history already built.
+    static void buildLabelHistory(const std::shared_ptr<ExternalSequence>& seq,
+                                  const BlockSource& blocks, int firstBlock,
+                                  LabelHistory& history, QSet<QString>& usedExtensions);
+    static void buildShapeScaleAggregates(const BlockSource& blocks, ShapeScaleAggregates& agg);
+    // Flat copy of the aggregates for the sequence cache; load returns false on a size mismatch
+    static QByteArray saveShapeScaleAggregates(const ShapeScaleAggregates& agg);
+    static bool loadShapeScaleAggregates(const char* data, std::size_t size, ShapeScaleAggregates& agg);
+    static void accumulateShapeScaleAggregates(const BlockSource& blocks, ShapeScaleAggregates& agg);
+    // Feeds blocks [firstBlock, firstBlock + blocks.size()) into the envelope pyramids
+    static void accumulateEnvelopes(const BlockSource& blocks, int firstBlock, const QVector<double>& edges,
+                                    double timeFactor, EnvelopeSet& env);
+    static SystemParameters readSystemParameters(const std::shared_ptr<ExternalSequence>& seq);
+
+    std::atomic<bool> m_loadCancelRequested {false};
+    bool m_loadInProgress {false};
+    bool m_lastLoadCancelled {false};
+
+    // Background [SIGNATURE] verification; the pool is waited for when the loader is destroyed
+    struct SignatureCheck {
+        std::shared_ptr<std::atomic<bool>> cancel; // identifies the check; null if none is running
+        bool hashed {false};
+        std::size_t signedSize {0};
+        std::string hash;
+    };
+    bool m_signatureCheckEnabled {true};
+    SignatureCheck m_signatureCheck; // of the shown sequence
+    SignatureCheck m_pendingSignatureCheck; // of the load in progress
+    QThreadPool m_signaturePool;
+
+    // Background trajectory pass; windows of an older generation are dropped on arrival
+    quint64 m_trajectoryGeneration {0};
+    QElapsedTimer m_trajectoryRefreshTimer;
+    std::atomic<bool> m_trajectoryCancelRequested {false};
+    QThreadPool m_trajectoryPool;
+
+    static constexpr int kTrajectoryWindowBlocks = 16384;
+    // State after each appended trajectory window (array sizes and integration carry), so a
+    // recomputation resumes at the first window whose inputs changed
+    struct TrajectoryCheckpoint {
+        int endBlock {0};
+        qsizetype samples {0};
+        qsizetype adcSamples {0};
+        qsizetype excitations {0};
+        qsizetype refocusings {0};
+        bool rfUseGuessed {false};
+        KSpaceTrajectory::Carry carry;
+    };
+    QVector<TrajectoryCheckpoint> m_trajectoryCheckpoints;
+    // Gyromagnetic ratio the RF-use guesses of the trajectory were made with
+    double m_trajectoryGamma {0.0};
+    // kx=ky=0 crossings in seconds, derived from the finished trajectory on first request
+    mutable QVector<double> m_kxKyZeroTimesSec;
+    mutable bool m_kxKyZeroTimesValid {false};
 };
 
 #endif // PULSEQLOADER_H
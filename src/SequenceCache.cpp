@@ -0,0 +1,251 @@
+#include "SequenceCache.h"
+#include "seqeyes_version.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char kMagic[8] = { 'S', 'Q', 'E', 'Y', 'C', 'A', 'C', 'H' };
+const quint32 kFormatVersion = 2;
+// Entries written by another release of the application are misses
+const QByteArray kAppVersion = QByteArrayLiteral(SEQEYES_APP_VERSION_PLAIN);
+
+// Fixed part of an entry, without padding; followed by the application version, the path,
+// the signature and the section table
+struct Header
+{
+    char magic[8];
+    quint32 formatVersion;
+    quint32 sectionCount;
+    qint64 fileSize;
+    qint64 fileMtimeMs;
+    quint32 appVersionBytes;
+    quint32 pathBytes;
+    quint32 signatureBytes;
+    quint32 reserved;
+};
+static_assert(sizeof(Header) == 48, "cache header must not contain padding");
+
+std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+// Cache entries, least recently used first
+QFileInfoList entriesByAge()
+{
+    return QDir(SequenceCache::cacheDirectory())
+        .entryInfoList(QStringList(QStringLiteral("*.bin")), QDir::Files, QDir::Time | QDir::Reversed);
+}
+
+// The [SIGNATURE] section closes the file, so only its tail is searched
+QByteArray readSignatureHash(const char* text, std::size_t size)
+{
+    const std::size_t kTailBytes = 4096;
+    const std::size_t tailStart = size > kTailBytes ? size - kTailBytes : 0;
+    const QByteArray tail = QByteArray::fromRawData(text + tailStart, qsizetype(size - tailStart));
+    const qsizetype section = tail.lastIndexOf("[SIGNATURE]");
+    if (section < 0)
+        return QByteArray();
+    const qsizetype hash = tail.indexOf("Hash", section);
+    if (hash < 0)
+        return QByteArray();
+    qsizetype lineEnd = tail.indexOf('\n', hash);
+    if (lineEnd < 0) lineEnd = tail.size();
+    return tail.mid(hash + 4, lineEnd - hash - 4).trimmed();
+}
+
+} // namespace
+
+SequenceCache::~SequenceCache()
+{
+    close();
+}
+
+SequenceCache::Key SequenceCache::makeKey(const QString& path, const char* text, std::size_t size)
+{
+    const QFileInfo info(path);
+    Key key;
+    key.path = info.absoluteFilePath();
+    key.size = qint64(size);
+    key.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+    key.signature = readSignatureHash(text, size);
+    return key;
+}
+
+QString SequenceCache::cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/sequences");
+}
+
+QString SequenceCache::entryPath(const QString& path)
+{
+    const QByteArray hash = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return cacheDirectory() + QLatin1Char('/') + QString::fromLatin1(hash.toHex()) + QStringLiteral(".bin");
+}
+
+bool SequenceCache::open(const Key& key)
+{
+    close();
+    m_file.setFileName(entryPath(key.path));
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+    m_mapSize = m_file.size();
+    m_map = m_mapSize >= qint64(sizeof(Header)) ? m_file.map(0, m_mapSize) : nullptr;
+    if (!m_map)
+    {
+        close();
+        return false;
+    }
+
+    const char* base = reinterpret_cast<const char*>(m_map);
+    const std::size_t mapSize = std::size_t(m_mapSize);
+    Header header;
+    memcpy(&header, base, sizeof(header));
+    const QByteArray path = key.path.toUtf8();
+    std::size_t pos = sizeof(Header);
+    const std::size_t prefixBytes = std::size_t(header.appVersionBytes) + header.pathBytes + header.signatureBytes;
+    bool ok = memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.formatVersion == kFormatVersion &&
+              header.fileSize == key.size && header.fileMtimeMs == key.mtimeMs &&
+              header.appVersionBytes == quint32(kAppVersion.size()) &&
+              header.pathBytes == quint32(path.size()) && header.signatureBytes == quint32(key.signature.size()) &&
+              pos + prefixBytes <= mapSize;
+    ok = ok && memcmp(base + pos, kAppVersion.constData(), header.appVersionBytes) == 0;
+    pos += header.appVersionBytes;
+    ok = ok && memcmp(base + pos, path.constData(), header.pathBytes) == 0 &&
+         memcmp(base + pos + header.pathBytes, key.signature.constData(), header.signatureBytes) == 0;
+    pos = align8(pos + header.pathBytes + header.signatureBytes);
+    ok = ok && header.sectionCount <= (mapSize - std::min(pos, mapSize)) / sizeof(TocEntry);
+    if (!ok)
+    {
+        close();
+        return false;
+    }
+
+    m_toc.resize(header.sectionCount);
+    if (header.sectionCount)
+        memcpy(m_toc.data(), base + pos, header.sectionCount * sizeof(TocEntry));
+    for (const TocEntry& entry : m_toc)
+    {
+        if (entry.offset > mapSize || entry.size > mapSize - entry.offset)
+        {
+            close();
+            return false;
+        }
+    }
+
+    // Mark the entry as recently used for prune(); failing to do so only ages it
+    QFile touch(m_file.fileName());
+    if (touch.open(QIODevice::ReadWrite | QIODevice::ExistingOnly))
+        touch.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+void SequenceCache::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_toc.clear();
+    m_file.close();
+}
+
+const char* SequenceCache::section(quint32 tag, std::size_t* size) const
+{
+    for (const TocEntry& entry : m_toc)
+    {
+        if (entry.tag != tag)
+            continue;
+        if (size) *size = std::size_t(entry.size);
+        return reinterpret_cast<const char*>(m_map) + entry.offset;
+    }
+    if (size) *size = 0;
+    return nullptr;
+}
+
+bool SequenceCache::store(const Key& key, const QList<QPair<quint32, QByteArrayView>>& sections, qint64 maxTotalBytes)
+{
+    if (!QDir().mkpath(cacheDirectory()))
+        return false;
+
+    const QByteArray path = key.path.toUtf8();
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.formatVersion = kFormatVersion;
+    header.sectionCount = quint32(sections.size());
+    header.fileSize = key.size;
+    header.fileMtimeMs = key.mtimeMs;
+    header.appVersionBytes = quint32(kAppVersion.size());
+    header.pathBytes = quint32(path.size());
+    header.signatureBytes = quint32(key.signature.size());
+
+    QByteArray prefix(reinterpret_cast<const char*>(&header), sizeof(header));
+    prefix.append(kAppVersion);
+    prefix.append(path);
+    prefix.append(key.signature);
+    prefix.append(QByteArray(int(align8(prefix.size()) - prefix.size()), '\0'));
+
+    std::vector<TocEntry> toc(sections.size());
+    std::size_t offset = prefix.size() + toc.size() * sizeof(TocEntry);
+    for (int i = 0; i < sections.size(); ++i)
+    {
+        toc[i].tag = sections[i].first;
+        toc[i].reserved = 0;
+        toc[i].offset = offset;
+        toc[i].size = quint64(sections[i].second.size());
+        offset = align8(offset + toc[i].size);
+    }
+
+    QSaveFile file(entryPath(key.path));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(prefix);
+    if (!toc.empty())
+        file.write(reinterpret_cast<const char*>(toc.data()), qint64(toc.size() * sizeof(TocEntry)));
+    const QByteArray padding(8, '\0');
+    for (int i = 0; i < sections.size(); ++i)
+    {
+        const QByteArrayView data = sections[i].second;
+        file.write(data.data(), data.size());
+        file.write(padding.constData(), qint64(align8(data.size()) - data.size()));
+    }
+    if (!file.commit())
+        return false;
+    prune(maxTotalBytes, entryPath(key.path));
+    return true;
+}
+
+void SequenceCache::prune(qint64 maxTotalBytes, const QString& keep)
+{
+    const QFileInfoList entries = entriesByAge();
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries)
+        total += entry.size();
+    const QString keepPath = keep.isEmpty() ? QString() : QFileInfo(keep).absoluteFilePath();
+    for (const QFileInfo& entry : entries)
+    {
+        if (total <= maxTotalBytes)
+            break;
+        if (entry.absoluteFilePath() == keepPath)
+            continue;
+        if (QFile::remove(entry.absoluteFilePath()))
+            total -= entry.size();
+    }
+}
+
+qint64 SequenceCache::clear()
+{
+    qint64 freed = 0;
+    for (const QFileInfo& entry : entriesByAge())
+    {
+        if (QFile::remove(entry.absoluteFilePath()))
+            freed += entry.size();
+    }
+    return freed;
+}
@@ -0,0 +1,75 @@
+#ifndef SEQUENCECACHE_H
+#define SEQUENCECACHE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <cstddef>
+#include <vector>
+
+// On-disk cache of parsed sequences, one entry per .seq path under the user cache directory.
+// An entry is a header (format and application version, source path, size, mtime and the hash
+// from the [SIGNATURE] section) followed by a table of tagged, 8-byte aligned sections. Entries are read
+// through a memory map, so a hit costs little more than copying the sections back out.
+// The cache is bounded: store() drops the least recently used entries (by modification time,
+// which open() refreshes on every hit) until the directory fits the given size.
+class SequenceCache
+{
+public:
+    struct Key
+    {
+        QString path;         // absolute path of the .seq file
+        qint64 size {0};
+        qint64 mtimeMs {0};
+        QByteArray signature; // [SIGNATURE] hash as written in the file; empty if the file has none
+    };
+
+    // Section tags
+    static constexpr quint32 kSequenceSection = 0x31514553;   // "SEQ1": ExternalSequence snapshot
+    static constexpr quint32 kBlockEdgesSection = 0x31474445; // "EDG1": time factor + block edges
+    static constexpr quint32 kShapeScaleSection = 0x31434353; // "SCC1": shape scale aggregates
+
+    SequenceCache() = default;
+    ~SequenceCache();
+    SequenceCache(const SequenceCache&) = delete;
+    SequenceCache& operator=(const SequenceCache&) = delete;
+
+    // Key of the file at 'path' whose text is [text, text + size)
+    static Key makeKey(const QString& path, const char* text, std::size_t size);
+    static QString cacheDirectory();
+    static QString entryPath(const QString& path);
+
+    // Maps the entry for 'key'; false on a miss (no entry, stale key, other format or application version)
+    bool open(const Key& key);
+    void close();
+    // Section contents inside the map (valid until close()), or nullptr if the entry lacks it
+    const char* section(quint32 tag, std::size_t* size) const;
+
+    // Writes the entry for 'key', replacing any previous one atomically, then prunes the cache
+    // to maxTotalBytes (the new entry itself is always kept)
+    static bool store(const Key& key, const QList<QPair<quint32, QByteArrayView>>& sections, qint64 maxTotalBytes);
+    // Deletes least recently used entries other than 'keep' until all entries take at most
+    // maxTotalBytes
+    static void prune(qint64 maxTotalBytes, const QString& keep = QString());
+    // Deletes every entry; returns the number of bytes freed
+    static qint64 clear();
+
+private:
+    struct TocEntry
+    {
+        quint32 tag;
+        quint32 reserved;
+        quint64 offset;
+        quint64 size;
+    };
+
+    QFile m_file;
+    uchar* m_map {nullptr};
+    qint64 m_mapSize {0};
+    std::vector<TocEntry> m_toc;
+};
+
+#endif // SEQUENCECACHE_H
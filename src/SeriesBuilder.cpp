@@ -1,12 +1,13 @@
 #include "SeriesBuilder.h"
 #include <QtGlobal>
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
 namespace SeriesBuilder {
 
 void buildRFSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockSource& blocks,
     const QVector<double>& edges,
     double tFactor,
     QVector<double>& rfTimeAmp,
@@ -41,8 +42,8 @@ void buildRFSeries(
         if (RFLength <= 0) continue;
 
         float dwell = blk->GetRFDwellTime();
-        float* rfList = blk->GetRFAmplitudePtr();
-        float* phaseList = blk->GetRFPhasePtr();
+        const float* rfList = blk->GetRFAmplitudePtr();
+        const float* phaseList = blk->GetRFPhasePtr();
         const double tStart = edges[i] + rf.delay * tFactor;
 
         // Decide whether to insert a break based on exact endpoint equality rule
@@ -100,18 +101,22 @@ void buildRFSeries(
 }
 
 void buildGradientSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockTable& table,
     const QVector<double>& edges,
     double tFactor,
     int channel, // 0=GX, 1=GY, 2=GZ
     QVector<double>& gradTime,
     QVector<double>& gradValues,
-    double gradientRasterUs)
+    double gradientRasterUs,
+    int firstBlock,
+    int endBlock)
 {
     gradTime.clear(); gradValues.clear();
     
-    const int numBlocks = static_cast<int>(blocks.size());
-    if (numBlocks == 0 || edges.isEmpty()) return;
+    if (channel < 0 || channel > 2) return;
+    const BlockTable::GradColumns& g = table.grad[channel];
+    const int numRows = g.size();
+    if (numRows == 0 || edges.isEmpty()) return;
     
     bool hasAnyPoint = false;
     double lastTime = 0.0;
@@ -121,43 +126,35 @@ void buildGradientSeries(
     const double epsT = 1e-12;
     const double epsV = 1e-12;
     
-    for (int i = 0; i < numBlocks; ++i) {
-        SeqBlock* blk = const_cast<SeqBlock*>(blocks[i]);
-        if (!blk) continue;
-        
-        // Check if this block has gradient data for the specified channel
-        bool hasGradient = false;
-        if (blk->isTrapGradient(channel) || blk->isArbitraryGradient(channel) || blk->isExtTrapGradient(channel)) {
-            hasGradient = true;
-        }
-        
-        if (!hasGradient) continue;
-        
-        const GradEvent& grad = blk->GetGradEvent(channel);
-        const double tStart = edges[i] + grad.delay * tFactor;
+    // One row per block with a gradient on this channel, in block order
+    const int firstRow = static_cast<int>(std::lower_bound(g.block.begin(), g.block.end(), firstBlock) - g.block.begin());
+    for (int r = firstRow; r < numRows && g.block[r] < endBlock; ++r) {
+        const int i = g.block[r];
+        const float amplitude = g.amplitude[r];
+        const double tStart = edges[i] + g.delay[r] * tFactor;
         
         // Process different gradient types
         QVector<double> blockTime, blockValues;
         
-        if (blk->isTrapGradient(channel)) {
+        if (g.kind[r] == BlockTable::GradTrap) {
             // Trapezoid gradient: build time/amplitude arrays
-            double rampUpTime = grad.rampUpTime * tFactor;
-            double flatTime = grad.flatTime * tFactor;
-            double rampDownTime = grad.rampDownTime * tFactor;
+            double rampUpTime = g.rampUp[r] * tFactor;
+            double flatTime = g.flat[r] * tFactor;
+            double rampDownTime = g.rampDown[r] * tFactor;
             
             // Build trapezoid points
             QVector<double> times = {0, rampUpTime, rampUpTime + flatTime, rampUpTime + flatTime + rampDownTime};
-            QVector<double> amps = {0, grad.amplitude, grad.amplitude, 0};
+            QVector<double> amps = {0, amplitude, amplitude, 0};
             
             for (int j = 0; j < times.size(); ++j) {
                 blockTime.append(tStart + times[j]);
                 blockValues.append(amps[j]);
             }
         }
-        else if (blk->isArbitraryGradient(channel)) {
+        else if (g.kind[r] == BlockTable::GradArbitrary) {
             // Arbitrary gradient: use shape data
-            int numSamples = blk->GetArbGradNumSamples(channel);
-            const float* shapePtr = blk->GetArbGradShapePtr(channel);
+            int numSamples = g.numPoints[r];
+            const float* shapePtr = g.values[r];
             
             if (numSamples > 0 && shapePtr) {
                 // Use provided gradient raster time in microseconds if valid, otherwise fallback
@@ -165,21 +162,21 @@ void buildGradientSeries(
                 
                 for (int j = 0; j < numSamples; ++j) {
                     double t = tStart + j * gradRaster_us * tFactor;
-                    double amp = static_cast<double>(shapePtr[j]) * static_cast<double>(grad.amplitude);
+                    double amp = static_cast<double>(shapePtr[j]) * static_cast<double>(amplitude);
                     blockTime.append(t);
                     blockValues.append(amp);
                 }
             }
         }
-        else if (blk->isExtTrapGradient(channel)) {
+        else if (g.kind[r] == BlockTable::GradExtTrap) {
             // Extended trapezoid gradient: use time/amplitude arrays
-            const std::vector<long>& times = blk->GetExtTrapGradTimes(channel);
-            const std::vector<float>& shape = blk->GetExtTrapGradShape(channel);
+            const long* times = g.timesUs[r];
+            const float* shape = g.values[r];
             
-            if (!times.empty() && !shape.empty() && times.size() == shape.size()) {
-                for (size_t j = 0; j < times.size(); ++j) {
+            if (times && shape) {
+                for (int j = 0; j < g.numPoints[r]; ++j) {
                     double t = tStart + times[j] * tFactor;
-                    double amp = static_cast<double>(shape[j]) * static_cast<double>(grad.amplitude);
+                    double amp = static_cast<double>(shape[j]) * static_cast<double>(amplitude);
                     blockTime.append(t);
                     blockValues.append(amp);
                 }
@@ -252,25 +249,35 @@ void buildGradientSeries(
 }
 
 void buildADCSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockSource& blocks,
     const QVector<double>& edges,
     double tFactor,
     QVector<double>& adcTime,
     QVector<double>& adcValues)
 {
     adcTime.clear(); adcValues.clear();
-    
+    appendADCSeries(blocks, 0, edges, tFactor, adcTime, adcValues);
+}
+
+void appendADCSeries(
+    const BlockSource& blocks,
+    int firstBlock,
+    const QVector<double>& edges,
+    double tFactor,
+    QVector<double>& adcTime,
+    QVector<double>& adcValues)
+{
     const int numBlocks = static_cast<int>(blocks.size());
     if (numBlocks == 0 || edges.isEmpty()) return;
     
     for (int i = 0; i < numBlocks; ++i) {
-        SeqBlock* blk = const_cast<SeqBlock*>(blocks[i]);
+        SeqBlock* blk = blocks[i];
         if (!blk || !blk->isADC()) continue;
         
         const ADCEvent& adc = blk->GetADCEvent();
         if (adc.numSamples == 0) continue;
         
-        const double tStart = edges[i] + adc.delay * tFactor;
+        const double tStart = edges[firstBlock + i] + adc.delay * tFactor;
         const double tEnd = tStart + (adc.numSamples * adc.dwellTime / 1000.0) * tFactor;
         
         // ADC events are represented as rectangular pulses
@@ -2,8 +2,11 @@
 #define SERIESBUILDER_H
 
 #include <QVector>
+#include <limits>
 #include <vector>
 #include "external/pulseq/ExternalSequence.h"
+#include "BlockCache.h"
+#include "BlockTable.h"
 
 // Build merged time/value series per axis from decoded Pulseq blocks.
 // Rules:
@@ -16,7 +19,7 @@ namespace SeriesBuilder {
 
 // RF: build two independent series for amplitude and phase.
 void buildRFSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockSource& blocks,
     const QVector<double>& edges,
     double tFactor,
     QVector<double>& rfTimeAmp,
@@ -25,20 +28,34 @@ void buildRFSeries(
     QVector<double>& rfPh
 );
 
-// Gradients: build merged series for GX, GY, GZ channels.
+// Gradients: build merged series for GX, GY, GZ channels from the load-time block table,
+// optionally restricted to blocks [firstBlock, endBlock).
 void buildGradientSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockTable& table,
     const QVector<double>& edges,
     double tFactor,
     int channel, // 0=GX, 1=GY, 2=GZ
     QVector<double>& gradTime,
     QVector<double>& gradValues,
-    double gradientRasterUs = -1.0
+    double gradientRasterUs = -1.0,
+    int firstBlock = 0,
+    int endBlock = std::numeric_limits<int>::max()
 );
 
 // ADC: build merged series for ADC events.
 void buildADCSeries(
-    const std::vector<SeqBlock*>& blocks,
+    const BlockSource& blocks,
+    const QVector<double>& edges,
+    double tFactor,
+    QVector<double>& adcTime,
+    QVector<double>& adcValues
+);
+
+// ADC: append the events of a window of blocks starting at sequence index firstBlock
+// (blocks[0] is block firstBlock, edges are indexed by sequence block index).
+void appendADCSeries(
+    const BlockSource& blocks,
+    int firstBlock,
     const QVector<double>& edges,
     double tFactor,
     QVector<double>& adcTime,
@@ -249,6 +249,7 @@ void Settings::setGamma(double gamma)
         m_gamma = gamma;
         saveSettings();
         emit settingsChanged();
+        emit gammaChanged();
     }
 }
 
@@ -421,6 +422,10 @@ void Settings::saveSettings()
     obj["showTeApproximateDialog"] = m_showTeApproximateDialog;
     obj["showTrajectoryApproximateDialog"] = m_showTrajectoryApproximateDialog;
     obj["showExtensionTooltip"] = m_showExtensionTooltip;
+    obj["lazyBlockDecoding"] = m_lazyBlockDecoding;
+    obj["blockCacheBudgetMB"] = m_blockCacheBudgetMB;
+    obj["sequenceCacheEnabled"] = m_sequenceCacheEnabled;
+    obj["sequenceCacheLimitMB"] = m_sequenceCacheLimitMB;
     // Input behavior
     obj["zoomInputMode"] = getZoomInputModeString();
     obj["panWheelEnabled"] = m_panWheelEnabled;
@@ -545,6 +550,10 @@ void Settings::loadSettings()
     m_showTeApproximateDialog = obj.value("showTeApproximateDialog").toBool(true);
     m_showTrajectoryApproximateDialog = obj.value("showTrajectoryApproximateDialog").toBool(true);
     m_showExtensionTooltip = obj.value("showExtensionTooltip").toBool(false);
+    m_lazyBlockDecoding = obj.value("lazyBlockDecoding").toBool(false);
+    m_blockCacheBudgetMB = qMax(1, obj.value("blockCacheBudgetMB").toInt(256));
+    m_sequenceCacheEnabled = obj.value("sequenceCacheEnabled").toBool(true);
+    m_sequenceCacheLimitMB = qMax(1, obj.value("sequenceCacheLimitMB").toInt(1024));
 
     // Load extension labels (merge onto defaults)
     if (obj.contains("extensionLabels") && obj.value("extensionLabels").isObject())
@@ -585,6 +594,10 @@ void Settings::resetToDefaults()
     m_showTeApproximateDialog = true;
     m_showTrajectoryApproximateDialog = true;
     m_showExtensionTooltip = false;
+    m_lazyBlockDecoding = false;
+    m_blockCacheBudgetMB = 256;
+    m_sequenceCacheEnabled = true;
+    m_sequenceCacheLimitMB = 1024;
     m_panLeftKey = QStringLiteral("A");
     m_panRightKey = QStringLiteral("D");
     // Old time-based LOD settings removed - replaced with complexity-based LOD system
@@ -723,3 +736,61 @@ bool Settings::getShowExtensionTooltip() const
 {
     return m_showExtensionTooltip;
 }
+
+void Settings::setLazyBlockDecoding(bool enabled)
+{
+    if (m_lazyBlockDecoding != enabled) {
+        m_lazyBlockDecoding = enabled;
+        saveSettings();
+        emit settingsChanged();
+    }
+}
+
+bool Settings::getLazyBlockDecoding() const
+{
+    return m_lazyBlockDecoding;
+}
+
+void Settings::setBlockCacheBudgetMB(int megabytes)
+{
+    megabytes = qMax(1, megabytes);
+    if (m_blockCacheBudgetMB != megabytes) {
+        m_blockCacheBudgetMB = megabytes;
+        saveSettings();
+        emit settingsChanged();
+    }
+}
+
+int Settings::getBlockCacheBudgetMB() const
+{
+    return m_blockCacheBudgetMB;
+}
+
+void Settings::setSequenceCacheEnabled(bool enabled)
+{
+    if (m_sequenceCacheEnabled != enabled) {
+        m_sequenceCacheEnabled = enabled;
+        saveSettings();
+        emit settingsChanged();
+    }
+}
+
+bool Settings::getSequenceCacheEnabled() const
+{
+    return m_sequenceCacheEnabled;
+}
+
+void Settings::setSequenceCacheLimitMB(int megabytes)
+{
+    megabytes = qMax(1, megabytes);
+    if (m_sequenceCacheLimitMB != megabytes) {
+        m_sequenceCacheLimitMB = megabytes;
+        saveSettings();
+        emit settingsChanged();
+    }
+}
+
+int Settings::getSequenceCacheLimitMB() const
+{
+    return m_sequenceCacheLimitMB;
+}
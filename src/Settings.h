@@ -155,9 +155,22 @@ public:
     void setShowExtensionTooltip(bool show);
     bool getShowExtensionTooltip() const;
 
+    // Lazy block decoding: decode blocks on demand through a bounded cache (applies on next load)
+    void setLazyBlockDecoding(bool enabled);
+    bool getLazyBlockDecoding() const;
+    void setBlockCacheBudgetMB(int megabytes);
+    int getBlockCacheBudgetMB() const;
+    // Keep a binary copy of each parsed sequence in the user cache directory for fast reopening
+    void setSequenceCacheEnabled(bool enabled);
+    bool getSequenceCacheEnabled() const;
+    // Disk space the sequence cache may use; least recently used entries are dropped beyond it
+    void setSequenceCacheLimitMB(int megabytes);
+    int getSequenceCacheLimitMB() const;
+
 signals:
     void settingsChanged();
     void timeUnitChanged();
+    void gammaChanged();
 
 private:
     explicit Settings(QObject* parent = nullptr);
@@ -186,6 +199,10 @@ private:
     bool m_showTeApproximateDialog { true }; // Show TE approximate warning for legacy sequences
     bool m_showTrajectoryApproximateDialog { true }; // Show trajectory warning for legacy sequences
     bool m_showExtensionTooltip { false }; // Show extension tooltip on hover
+    bool m_lazyBlockDecoding { false }; // Decode blocks on demand instead of all at load
+    int m_blockCacheBudgetMB { 256 }; // Memory budget of the lazy block cache
+    bool m_sequenceCacheEnabled { true }; // Reopen previously parsed files from the on-disk cache
+    int m_sequenceCacheLimitMB { 1024 }; // Disk budget of the sequence cache
     // Old time-based LOD settings removed - replaced with complexity-based LOD system
     
     // Conversion helper functions
@@ -1,4 +1,5 @@
 #include "SettingsDialog.h"
+#include "SequenceCache.h"
 #include <QMessageBox>
 #include <QDebug>
 #include <QApplication>
@@ -25,6 +26,11 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     , m_panDragCheck(nullptr)
     , m_panWheelCheck(nullptr)
     , m_showExtensionTooltipCheck(nullptr)
+    , m_lazyBlockDecodingCheck(nullptr)
+    , m_blockCacheBudgetSpin(nullptr)
+    , m_sequenceCacheCheck(nullptr)
+    , m_clearSequenceCacheButton(nullptr)
+    , m_sequenceCacheLimitSpin(nullptr)
     , m_applyButton(nullptr)
     , m_okButton(nullptr)
     , m_cancelButton(nullptr)
@@ -249,6 +255,49 @@ void SettingsDialog::setupUI()
     extensionsLayout->addStretch();
 
     m_tabWidget->addTab(extensionsTab, "Extensions");
+
+    // ============================================================================
+    // Performance Tab
+    // ============================================================================
+    QWidget* performanceTab = new QWidget();
+    QVBoxLayout* performanceLayout = new QVBoxLayout(performanceTab);
+
+    QGroupBox* decodingGroup = new QGroupBox("", performanceTab);
+    QFormLayout* decodingFormLayout = new QFormLayout(decodingGroup);
+
+    // Lazy decoding keeps only recently viewed blocks in memory (takes effect on the next load)
+    m_lazyBlockDecodingCheck = new QCheckBox("Decode blocks on demand", performanceTab);
+    m_lazyBlockDecodingCheck->setToolTip("Keep only the blocks being viewed in memory. Applies to the next file load.");
+    decodingFormLayout->addRow(m_lazyBlockDecodingCheck);
+
+    m_blockCacheBudgetSpin = new QSpinBox(performanceTab);
+    m_blockCacheBudgetSpin->setRange(1, 65536);
+    m_blockCacheBudgetSpin->setSuffix(" MB");
+    decodingFormLayout->addRow("Block cache budget:", m_blockCacheBudgetSpin);
+    connect(m_lazyBlockDecodingCheck, &QCheckBox::toggled, m_blockCacheBudgetSpin, &QSpinBox::setEnabled);
+
+    m_sequenceCacheCheck = new QCheckBox("Cache parsed sequences on disk", performanceTab);
+    m_sequenceCacheCheck->setToolTip("Reopen unchanged files without parsing their text again.");
+    m_clearSequenceCacheButton = new QPushButton("Clear Cache", performanceTab);
+    m_clearSequenceCacheButton->setToolTip("Delete all cached sequences now.");
+    QHBoxLayout* sequenceCacheLayout = new QHBoxLayout();
+    sequenceCacheLayout->addWidget(m_sequenceCacheCheck);
+    sequenceCacheLayout->addStretch();
+    sequenceCacheLayout->addWidget(m_clearSequenceCacheButton);
+    decodingFormLayout->addRow(sequenceCacheLayout);
+    connect(m_clearSequenceCacheButton, &QPushButton::clicked, this, &SettingsDialog::onClearSequenceCacheClicked);
+
+    // Least recently opened files are dropped from the cache once it outgrows this limit
+    m_sequenceCacheLimitSpin = new QSpinBox(performanceTab);
+    m_sequenceCacheLimitSpin->setRange(1, 1048576);
+    m_sequenceCacheLimitSpin->setSuffix(" MB");
+    decodingFormLayout->addRow("Sequence cache limit:", m_sequenceCacheLimitSpin);
+    connect(m_sequenceCacheCheck, &QCheckBox::toggled, m_sequenceCacheLimitSpin, &QSpinBox::setEnabled);
+
+    performanceLayout->addWidget(decodingGroup);
+    performanceLayout->addStretch();
+
+    m_tabWidget->addTab(performanceTab, "Performance");
     
     // Add tab widget to main layout
     mainLayout->addWidget(m_tabWidget);
@@ -300,6 +349,10 @@ void SettingsDialog::loadCurrentSettings()
     m_originalZoomInputMode = settings.getZoomInputMode();
     m_originalPanWheelEnabled = settings.getPanWheelEnabled();
     m_originalShowExtensionTooltip = settings.getShowExtensionTooltip();
+    m_originalLazyBlockDecoding = settings.getLazyBlockDecoding();
+    m_originalBlockCacheBudgetMB = settings.getBlockCacheBudgetMB();
+    m_originalSequenceCacheEnabled = settings.getSequenceCacheEnabled();
+    m_originalSequenceCacheLimitMB = settings.getSequenceCacheLimitMB();
 
     // Store original extension label states
     m_originalExtensionLabelStates.clear();
@@ -346,6 +399,14 @@ void SettingsDialog::loadCurrentSettings()
         cb->setChecked(enabled);
     }
 
+    // Performance
+    m_lazyBlockDecodingCheck->setChecked(m_originalLazyBlockDecoding);
+    m_blockCacheBudgetSpin->setValue(m_originalBlockCacheBudgetMB);
+    m_blockCacheBudgetSpin->setEnabled(m_originalLazyBlockDecoding);
+    m_sequenceCacheCheck->setChecked(m_originalSequenceCacheEnabled);
+    m_sequenceCacheLimitSpin->setValue(m_originalSequenceCacheLimitMB);
+    m_sequenceCacheLimitSpin->setEnabled(m_originalSequenceCacheEnabled);
+
     // Interactions
     int zoomIndex = (m_originalZoomInputMode == Settings::ZoomInputMode::Wheel) ? 1 : 0;
     m_zoomModeCombo->setCurrentIndex(zoomIndex);
@@ -433,6 +494,12 @@ void SettingsDialog::applySettings()
     bool panWheel = (zoomMode == Settings::ZoomInputMode::Wheel) ? false : m_panWheelCheck->isChecked();
     settings.setPanWheelEnabled(panWheel);
 
+    // Apply performance settings (used by the next load)
+    settings.setLazyBlockDecoding(m_lazyBlockDecodingCheck->isChecked());
+    settings.setBlockCacheBudgetMB(m_blockCacheBudgetSpin->value());
+    settings.setSequenceCacheEnabled(m_sequenceCacheCheck->isChecked());
+    settings.setSequenceCacheLimitMB(m_sequenceCacheLimitSpin->value());
+
     // Old time-based LOD settings removed - replaced with complexity-based LOD system
     
     qDebug() << "Settings applied:";
@@ -470,6 +537,10 @@ void SettingsDialog::onCancelClicked()
     settings.setGamma(m_originalGamma);
     settings.setLogLevel(m_originalLogLevel);
     settings.setShowExtensionTooltip(m_originalShowExtensionTooltip);
+    settings.setLazyBlockDecoding(m_originalLazyBlockDecoding);
+    settings.setBlockCacheBudgetMB(m_originalBlockCacheBudgetMB);
+    settings.setSequenceCacheEnabled(m_originalSequenceCacheEnabled);
+    settings.setSequenceCacheLimitMB(m_originalSequenceCacheLimitMB);
     // Restore original extension label states
     for (auto it = m_originalExtensionLabelStates.constBegin(); it != m_originalExtensionLabelStates.constEnd(); ++it)
     {
@@ -498,6 +569,14 @@ void SettingsDialog::onResetClicked()
     }
 }
 
+void SettingsDialog::onClearSequenceCacheClicked()
+{
+    // Acts immediately, independent of Apply/Cancel
+    const qint64 freed = SequenceCache::clear();
+    QMessageBox::information(this, "Clear Cache",
+                             QString("Removed %1 MB of cached sequences.").arg(double(freed) / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
 void SettingsDialog::onGammaComboChanged(int index)
 {
     // If "Custom..." is selected, show input dialog
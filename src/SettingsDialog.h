@@ -8,6 +8,7 @@
 #include <QTabWidget>
 #include <QScrollArea>
 #include <QCheckBox>
+#include <QSpinBox>
 #include <QMap>
 #include "Settings.h"
 
@@ -35,6 +36,7 @@ private slots:
     void onGammaComboChanged(int index);
     void onZoomModeChanged(int index);
     void onPanWheelToggled(bool checked);
+    void onClearSequenceCacheClicked();
 
 private:
     void setupUI();
@@ -69,6 +71,13 @@ private:
     // Extension tab - label visibility controls
     QCheckBox* m_showExtensionTooltipCheck;
     QMap<QString, QCheckBox*> m_extensionLabelCheckboxes;
+
+    // Performance tab
+    QCheckBox* m_lazyBlockDecodingCheck;
+    QSpinBox* m_blockCacheBudgetSpin;
+    QCheckBox* m_sequenceCacheCheck;
+    QPushButton* m_clearSequenceCacheButton;
+    QSpinBox* m_sequenceCacheLimitSpin;
     
     // Buttons
     QPushButton* m_applyButton;
@@ -88,6 +97,10 @@ private:
     Settings::LogLevel m_originalLogLevel;
     Settings::ZoomInputMode m_originalZoomInputMode;
     bool m_originalPanWheelEnabled;
+    bool m_originalLazyBlockDecoding;
+    int m_originalBlockCacheBudgetMB;
+    bool m_originalSequenceCacheEnabled;
+    int m_originalSequenceCacheLimitMB;
 };
 
 #endif // SETTINGSDIALOG_H
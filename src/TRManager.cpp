@@ -538,6 +538,7 @@ void TRManager::refreshShowTeOverlay()
         return;
     if (m_pShowTeCheckBox->isChecked())
     {
+        // Defers its checks while the trajectory is still being computed
         onShowTeToggled(true);
     }
     else if (auto drawer = m_mainWindow->getWaveformDrawer())
@@ -546,6 +547,12 @@ void TRManager::refreshShowTeOverlay()
     }
 }
 
+void TRManager::onTrajectoryReady()
+{
+    if (m_teOverlayPending)
+        refreshShowTeOverlay();
+}
+
 void TRManager::setShowTrajectory(bool visible)
 {
     if (m_pShowTrajectoryCheckBox)
@@ -1594,6 +1601,8 @@ bool TRManager::canEnableTeOverlay(QString& reason) const
         reason = "The sequence does not define TE or EchoTime in the [DEFINITIONS] section.";
         return false;
     }
+    // Excitation centers come from the background trajectory pass; onShowTeToggled only asks
+    // once it has finished, so this never waits for it
     // For older Pulseq versions without explicit RF use metadata, we still try to
     // draw TE guides based on detected RF uses (classifyRfUse), but warn the user
     // that the result may be approximate.
@@ -1651,26 +1660,11 @@ void TRManager::calculateBlockRangeFromTrRange(int startTr, int endTr, int& star
         endTime = loader->getTotalDuration_us() * tFactor;
     }
 
-    const auto& blockEdges = loader->getBlockEdges();
-    startBlock = 0;
-    endBlock = loader->getDecodedSeqBlocks().size() - 1;
-
-    for (int i = 0; i < blockEdges.size() - 1; ++i)
-    {
-        if (startTime >= blockEdges[i] && startTime < blockEdges[i + 1])
-        {
-            startBlock = i;
-            break;
-        }
-    }
-    for (int i = 0; i < blockEdges.size() - 1; ++i)
-    {
-        if (endTime >= blockEdges[i] && endTime < blockEdges[i + 1])
-        {
-            endBlock = i;
-            break;
-        }
-    }
+    // Blocks containing the TR range ends (binary search over the block edges)
+    const int startHit = loader->findBlockAtTime(startTime);
+    const int endHit = loader->findBlockAtTime(endTime);
+    startBlock = (startHit >= 0) ? startHit : 0;
+    endBlock = (endHit >= 0) ? endHit : loader->getDecodedSeqBlocks().size() - 1;
 
     if (startBlock < 0) startBlock = 0;
     if (endBlock >= loader->getDecodedSeqBlocks().size()) endBlock = loader->getDecodedSeqBlocks().size() - 1;
@@ -1764,12 +1758,22 @@ void TRManager::onShowGzToggled(bool checked)
 
 void TRManager::onShowTeToggled(bool checked)
 {
+    m_teOverlayPending = false;
     WaveformDrawer* drawer = m_mainWindow->getWaveformDrawer();
     if (!drawer)
         return;
 
     if (checked)
     {
+        // The excitation centers are still streaming in: show the guides found so far (the
+        // trajectory progress refreshes them) and run the checks when the pass is done
+        PulseqLoader* loader = m_mainWindow->getPulseqLoader();
+        if (loader && loader->isTrajectoryComputing() && loader->hasEchoTimeDefinition())
+        {
+            m_teOverlayPending = true;
+            drawer->setShowTeGuides(true);
+            return;
+        }
         QString reason;
         if (!canEnableTeOverlay(reason))
         {
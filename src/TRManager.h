@@ -53,6 +53,8 @@ public:
     void setShowGy(bool visible);
     void setShowGz(bool visible);
     void refreshShowTeOverlay();
+    // Runs the TE overlay checks deferred while the trajectory was still being computed
+    void onTrajectoryReady();
     void setShowTrajectory(bool visible);
     void refreshExtensionLegend();
 
@@ -211,6 +213,9 @@ private:
     QTimer* m_pUpdateTimer;
     bool m_bPendingUpdate;
 
+    // TE overlay shown but not yet checked, waiting for the background trajectory pass
+    bool m_teOverlayPending {false};
+
     // Preserve last relative time window across TR changes in TR mode
     double m_lastRelStartMs {0.0};
     double m_lastRelEndMs {0.0};
@@ -0,0 +1,39 @@
+#ifndef VIEWPORTSERIES_H
+#define VIEWPORTSERIES_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Plot channels produced by one viewport extraction pass (PulseqLoader::getViewportDecimated)
+enum ViewportChannel
+{
+    ViewportRfAmp = 0,
+    ViewportRfPhase,
+    ViewportAdcPhase,
+    ViewportGx,
+    ViewportGy,
+    ViewportGz,
+    NumViewportChannels
+};
+
+// Visible window (axis units) and the plot width of each channel in device pixels. A pixel
+// width of 0 skips the channel.
+struct ViewportQuery
+{
+    double visibleStart {0.0};
+    double visibleEnd {0.0};
+    int pixelWidth[NumViewportChannels] {};
+};
+
+// Decimated series per channel, NaN-separated between events, plus the time each channel's
+// decimation took (for profiling; RF and gradients answered from the envelope pyramids are
+// near zero). Meant to be reused: the kernels clear() and append, so the buffers keep the
+// capacity of earlier viewports.
+struct ViewportSeries
+{
+    QVector<double> t[NumViewportChannels];
+    QVector<double> v[NumViewportChannels];
+    qint64 elapsedNs[NumViewportChannels] {};
+};
+
+#endif // VIEWPORTSERIES_H
@@ -6,7 +6,6 @@
 #include "Settings.h"
 #include "ZoomManager.h"
 #include "TRManager.h"
-#include "PulseqLabelAnalyzer.h"
 #include "ExtensionPlotter.h"
 #include <QFile>
 #include <QJsonDocument>
@@ -17,6 +16,7 @@
 #include <QTimer>
 #include <QPen>
 #include <QtGlobal>
+#include <algorithm>
 #include <chrono>
 
 // Debug control for LTTB algorithm
@@ -57,6 +57,12 @@ Overview of rendering strategy (performance-aware):
 5) Incremental redraws
    - When viewport or LOD level changes, ensureRenderedForCurrentViewport() clears graphs
      and re-renders only the visible content at the appropriate complexity level.
+   - RF, ADC phase and the three gradients are decimated in one loader pass on m_renderPool
+     (PulseqLoader::getViewportDecimated, channels in parallel), which also fills the graph
+     data containers; the GUI thread only swaps those containers into the graphs. Two frames
+     alternate, so buffers and containers keep their capacity across pan/zoom steps.
+     Viewport changes arriving while a frame is in flight collapse into one pending request
+     for the newest viewport.
 */
 static void applyZoomSettingsToManager(ZoomManager* zm)
 {
@@ -101,6 +107,7 @@ WaveformDrawer::WaveformDrawer(MainWindow* mainWindow)
 WaveformDrawer::~WaveformDrawer()
 {
     // All QCustomPlot items are owned by the plot itself.
+    cancelRenderPreparation();
 }
 
 void WaveformDrawer::InitSequenceFigure()
@@ -303,7 +310,7 @@ void WaveformDrawer::InitSequenceFigure()
     // individually (per-point QPainter::drawEllipse), while line segments are batched into
     // a single QPainterPath — the difference is ~10x. Scatter caused severe UI lag on
     // mouse move because every replot() had to re-render thousands of individual circles.
-    // NaN breaks in the data (inserted by getAdcPhaseViewport) prevent lines from connecting
+    // NaN breaks in the data (inserted by decimateAdcPhaseViewport) prevent lines from connecting
     // separate ADC blocks. MATLAB SeqPlot.m uses 'b.' MarkerSize=1 but that is acceptable
     // in MATLAB's retained-mode renderer; QCustomPlot is immediate-mode and much slower.
     m_graphADCPh = customPlot->addGraph(m_pRfADCPhaseRect->axis(QCPAxis::atBottom), m_pRfADCPhaseRect->axis(QCPAxis::atLeft));
@@ -839,35 +846,21 @@ void WaveformDrawer::ResetView()
     customPlot->replot();
 }
 
-void WaveformDrawer::DrawRFWaveform(const double& dStartTime, double dEndTime)
+bool WaveformDrawer::captureRenderRequest(RenderRequest& request) const
 {
-    static int callCount = 0;
-    callCount++;
-    // Debug logging removed
-    
     PulseqLoader* loader = m_mainWindow->getPulseqLoader();
-    if (loader->getDecodedSeqBlocks().empty()) return;
-
-    // Validate input parameters - ensure non-negative time coordinates
-    double safeStartTime = dStartTime;
-    double safeEndTime = dEndTime;
-
-    // Ensure non-negative time coordinates regardless of mode
-    if (safeStartTime < 0) safeStartTime = 0;
-    if (safeEndTime <= safeStartTime) safeEndTime = safeStartTime + 1.0;
+    if (!loader || loader->getDecodedSeqBlocks().empty()) return false;
 
     // Determine visible viewport in internal time units
     if (m_vecRects.isEmpty() || !m_vecRects[0]) {
         qDebug() << "ERROR: m_vecRects not initialized!";
-        return;
+        return false;
     }
     QCPRange viewport = m_vecRects[0]->axis(QCPAxis::atBottom)->range();
     double visibleStart = viewport.lower;
     double visibleEnd = viewport.upper;
-    
-    // Debug logging removed
 
-    // Ensure visible range is also valid
+    // Ensure visible range is valid
     if (visibleStart < 0) visibleStart = 0;
     if (visibleEnd <= visibleStart) visibleEnd = visibleStart + 1.0;
 
@@ -881,7 +874,7 @@ void WaveformDrawer::DrawRFWaveform(const double& dStartTime, double dEndTime)
 
     // Clamp viewport to TR bounds if TR-Segmented mode is active
     TRManager* trm = m_mainWindow->getTRManager();
-    if (trm && m_mainWindow->getPulseqLoader()->hasRepetitionTime() && trm->isTrBasedMode())
+    if (trm && loader->hasRepetitionTime() && trm->isTrBasedMode())
     {
         int startTr = trm->getTrStartInput()->text().toInt();
         int endTr = trm->getTrEndInput()->text().toInt();
@@ -897,398 +890,179 @@ void WaveformDrawer::DrawRFWaveform(const double& dStartTime, double dEndTime)
             visibleEnd = std::max(trStart + 1e-6, trEnd);
         }
     }
-    updateTeGuides(visibleStart, visibleEnd);
-    updateKxKyZeroGuides(visibleStart, visibleEnd);
+    ViewportQuery& query = request.query;
+    query.visibleStart = visibleStart;
+    query.visibleEnd = visibleEnd;
 
-    // Use simple LOD system
-    LODLevel currentLODLevel = getCurrentLODLevel();
+    // Pixel widths per rect. If LOD is FULL_DETAIL, force an effectively huge pixel width to
+    // disable decimation in the loader.
+    const bool fullDetail = getCurrentLODLevel() != LODLevel::DOWNSAMPLED;
+    auto rectPixels = [this](int index) {
+        if (m_vecRects.size() <= index || !m_vecRects[index]) return 0;
+        return qMax(1, static_cast<int>(qRound(m_vecRects[index]->width() * m_mainWindow->devicePixelRatioF())));
+    };
+    int pxRf = rectPixels(1);
+    if (fullDetail) pxRf = qMax(pxRf, 100000);
+    int pxAdcPhase = rectPixels(2);
+    if (pxAdcPhase == 0) pxAdcPhase = pxRf; // reuse RF effective pixel width
+    if (fullDetail) pxAdcPhase = qMax(pxAdcPhase, 100000);
+    query.pixelWidth[ViewportRfAmp] = pxRf;
+    query.pixelWidth[ViewportRfPhase] = pxRf;
+    query.pixelWidth[ViewportAdcPhase] = pxAdcPhase;
+    for (int channel = 0; channel < 3; ++channel) {
+        int px = rectPixels(channel + 3);
+        if (fullDetail) px = qMax(px, 100000);
+        query.pixelWidth[ViewportGx + channel] = px;
+    }
 
-    // Fast path: RF on-demand viewport rendering via shape cache
-    {
-        int pxRF = 0;
-        if (m_vecRects.size() > 1 && m_vecRects[1])
-            pxRF = qMax(1, static_cast<int>(qRound(m_vecRects[1]->width() * m_mainWindow->devicePixelRatioF())));
-        // If LOD is FULL_DETAIL, force an effectively huge pixel width to disable decimation in loader
-        int pxRFEffective = (currentLODLevel == LODLevel::DOWNSAMPLED ? pxRF : qMax(pxRF, 100000));
-
-        QVector<double> tAmp, vAmp, tPh, vPh;
-        loader->getRfViewportDecimated(visibleStart, visibleEnd, pxRFEffective, tAmp, vAmp, tPh, vPh);
-        if (m_graphRFMag) { m_graphRFMag->setData(tAmp, vAmp); m_graphRFMag->setVisible(m_curveVisibility.value(1, true)); }
-        if (m_graphRFPh)  { m_graphRFPh->setData(tPh, vPh);   m_graphRFPh->setVisible(m_curveVisibility.value(2, true)); }
-
-        // Added: ADC Phase (pixel-aware decimation like RF)
-        QVector<double> tAdcPh, vAdcPh;
-        int pxADCPh = pxRFEffective; // reuse RF effective pixel width for phase rect
-        if (m_vecRects.size() > 2 && m_vecRects[2])
-            pxADCPh = qMax(1, static_cast<int>(qRound(m_vecRects[2]->width() * m_mainWindow->devicePixelRatioF())));
-        if (currentLODLevel != LODLevel::DOWNSAMPLED)
-            pxADCPh = qMax(pxADCPh, 100000); // full detail mode
-        loader->getAdcPhaseViewport(visibleStart, visibleEnd, pxADCPh, tAdcPh, vAdcPh);
-        if (m_graphADCPh) {
-             m_graphADCPh->setData(tAdcPh, vAdcPh);
-             m_graphADCPh->setVisible(m_curveVisibility.value(2, true)); // controlled by RF Phase visibility checkbox
-        }
+    // Unit conversion from internal standard (Hz/m) to selected display unit (a plain scale)
+    Settings& s = Settings::getInstance();
+    const QString toUnit = s.getGradientUnitString();
+    request.gradScale = (toUnit != "Hz/m") ? s.convertGradient(1.0, "Hz/m", toUnit) : 1.0;
+    return true;
+}
 
-        if (!m_lockYAxisRanges)
-        {
-            auto upd = [](const QVector<double>& arr, double& mn, double& mx){ for (double v: arr){ if (std::isnan(v)) continue; if (v<mn) mn=v; if (v>mx) mx=v; } };
-            double minMag = std::numeric_limits<double>::max();
-            double maxMag = -std::numeric_limits<double>::infinity();
-            double minPh  = std::numeric_limits<double>::max();
-            double maxPh  = -std::numeric_limits<double>::infinity();
-            upd(vAmp, minMag, maxMag); upd(vPh, minPh, maxPh);
-            upd(vAdcPh, minPh, maxPh); // Include ADC phase in range computation
-
-            if (maxMag >= minMag && m_vecRects.size() > 1 && m_vecRects[1]){
-                double pad = (maxMag - minMag) * 0.05; if (pad == 0) pad = 1.0;
-                m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(minMag - pad, maxMag + pad);
-            }
-            if (maxPh >= minPh && m_vecRects.size() > 2 && m_vecRects[2]){
-                // Force full [-pi, pi] range coverage to ensure negative values are visible
-                double forceMin = -3.2; // slightly more than -pi
-                double forceMax = 3.2;  // slightly more than pi
-                if (minPh > forceMin) minPh = forceMin;
-                if (maxPh < forceMax) maxPh = forceMax;
-                
-                double pad = (maxPh - minPh) * 0.05; if (pad == 0) pad = 1.0;
-                m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(minPh - pad, maxPh + pad);
-            }
-        } else {
-            if (m_vecRects.size() > 1 && m_vecRects[1]) m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[1].first, m_fixedYRanges[1].second);
-            if (m_vecRects.size() > 2 && m_vecRects[2]) m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[2].first, m_fixedYRanges[2].second);
-        }
-        
-        // DEBUG: Unconditionally force phase Y-axis range to [-3.5, 3.5] to reveal negative values
-        if (m_vecRects.size() > 2 && m_vecRects[2]) {
-             m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(-3.5, 3.5);
+void WaveformDrawer::prepareRenderFrame(PulseqLoader* loader, RenderFrame& frame)
+{
+    // One loader pass decimates every requested channel (in parallel, via the loader's pool)
+    const ViewportSeries& series = frame.series;
+    loader->getViewportDecimated(frame.request.query, frame.series);
+
+    // Build each channel's points in one pass and hand them to the frame's graph container in
+    // bulk. The series are time-sorted, so set() skips the sort and shares the vector instead of
+    // copying it. Gradient unit conversion (Hz/m -> display unit) and the Y range ride along.
+    for (int c = 0; c < NumViewportChannels; ++c) {
+        QSharedPointer<QCPGraphDataContainer>& data = frame.graphData[c];
+        if (!data) data.reset(new QCPGraphDataContainer);
+        const double scale = (c >= ViewportGx) ? frame.request.gradScale : 1.0;
+        const QVector<double>& t = series.t[c];
+        const QVector<double>& v = series.v[c];
+        QVector<QCPGraphData> points(t.size());
+        double mn = std::numeric_limits<double>::max();
+        double mx = -std::numeric_limits<double>::infinity();
+        for (int i = 0; i < t.size(); ++i) {
+            const double value = v[i] * scale;
+            points[i].key = t[i];
+            points[i].value = value;
+            if (std::isnan(value)) continue;
+            if (value < mn) mn = value;
+            if (value > mx) mx = value;
         }
-        return;
+        data->set(points, true);
+        frame.vMin[c] = mn;
+        frame.vMax[c] = mx;
     }
+}
 
-    // Visible block range
-    const auto& edges = loader->getBlockEdges();
-    int startBlock = loader->getBlockRangeStart();
-    int endBlock = loader->getBlockRangeEnd();
-    for (int i = startBlock; i <= endBlock; ++i)
-    {
-        if (i + 1 < edges.size() && edges[i + 1] > visibleStart) { startBlock = i; break; }
+void WaveformDrawer::swapGraphData(QCPGraph* graph, QSharedPointer<QCPGraphDataContainer>& data)
+{
+    // The graph shares the prepared container instead of copying it; the one it held so far goes
+    // back into the frame to be refilled for a later viewport
+    if (!graph || !data) return;
+    QSharedPointer<QCPGraphDataContainer> previous = graph->data();
+    graph->setData(data);
+    data = previous;
+}
+
+void WaveformDrawer::applyRfSeries(RenderFrame& frame)
+{
+    if (m_graphRFMag) { swapGraphData(m_graphRFMag, frame.graphData[ViewportRfAmp]); m_graphRFMag->setVisible(m_curveVisibility.value(1, true)); }
+    if (m_graphRFPh)  { swapGraphData(m_graphRFPh, frame.graphData[ViewportRfPhase]); m_graphRFPh->setVisible(m_curveVisibility.value(2, true)); }
+    if (m_graphADCPh) {
+         swapGraphData(m_graphADCPh, frame.graphData[ViewportAdcPhase]);
+         m_graphADCPh->setVisible(m_curveVisibility.value(2, true)); // controlled by RF Phase visibility checkbox
     }
-    for (int i = endBlock; i >= startBlock; --i)
+
+    if (!m_lockYAxisRanges)
     {
-        if (edges[i] < visibleEnd) { endBlock = i; break; }
-    }
-    if (startBlock > endBlock) return;
+        // Value ranges were taken while the containers were filled
+        double minMag = frame.vMin[ViewportRfAmp];
+        double maxMag = frame.vMax[ViewportRfAmp];
+        double minPh  = std::min(frame.vMin[ViewportRfPhase], frame.vMin[ViewportAdcPhase]); // Include ADC phase
+        double maxPh  = std::max(frame.vMax[ViewportRfPhase], frame.vMax[ViewportAdcPhase]);
 
-    if (startBlock >= edges.size() || startBlock < 0) {
-        qDebug() << "ERROR: startBlock out of bounds - startBlock:" << startBlock << "edges.size():" << edges.size();
-        return;
-    }
-    double t0 = edges[startBlock];
-    int cnt = 0;
-    double min1 = std::numeric_limits<double>::max(), max1 = std::numeric_limits<double>::min();
-    double min2 = std::numeric_limits<double>::max(), max2 = std::numeric_limits<double>::min();
-    double tFactor = loader->getTFactor();
-
-    // Prefer merged RF series built at load-time
-    const QVector<double>& mergedTimeAmp = loader->getRfTimeAmp();
-    const QVector<double>& mergedAmp = loader->getRfAmp();
-
-    // Debug output for RF data
-    // Debug logging removed
-    if (!mergedTimeAmp.isEmpty()) {
-        // Debug logging removed
-    }
-    // Debug logging removed
-
-    if (!mergedTimeAmp.isEmpty() && !mergedAmp.isEmpty()) {
-        // Slice by viewport with small margin
-        const double margin = (visibleEnd - visibleStart) * 0.02;
-        const double x0 = visibleStart - margin;
-        const double x1 = visibleEnd + margin;
-
-        // Compute viewport-aware target points for RF Mag
-        int pxRF = 0;
-        if (m_vecRects.size() > 1 && m_vecRects[1]) {
-            pxRF = qMax(1, static_cast<int>(qRound(m_vecRects[1]->width() * m_mainWindow->devicePixelRatioF())));
+        if (maxMag >= minMag && m_vecRects.size() > 1 && m_vecRects[1]){
+            double pad = (maxMag - minMag) * 0.05; if (pad == 0) pad = 1.0;
+            m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(minMag - pad, maxMag + pad);
+        }
+        if (maxPh >= minPh && m_vecRects.size() > 2 && m_vecRects[2]){
+            // Force full [-pi, pi] range coverage to ensure negative values are visible
+            double forceMin = -3.2; // slightly more than -pi
+            double forceMax = 3.2;  // slightly more than pi
+            if (minPh > forceMin) minPh = forceMin;
+            if (maxPh < forceMax) maxPh = forceMax;
+            
+            double pad = (maxPh - minPh) * 0.05; if (pad == 0) pad = 1.0;
+            m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(minPh - pad, maxPh + pad);
         }
-        const double noDecimThresholdRF = 1.2; // pts/px -> draw 1:1 if below
-        const int smallSegThresholdRF = 64;     // small segments -> pass-through
-        const double lttbFactorRF = 2.0;        // ~2 samples per pixel
-        const int capPointsRF = 10000;          // safety cap
-
-        auto sliceAndProcess = [&](const QVector<double>& tIn, const QVector<double>& vIn, QVector<double>& tOut, QVector<double>& vOut) {
-            tOut.clear(); vOut.clear();
-            QVector<double> segT, segV;
-            segT.reserve(1024); segV.reserve(1024);
-            double minDt = std::numeric_limits<double>::infinity();
-            auto flushSegment = [&]() {
-                if (segT.isEmpty()) return;
-                if (currentLODLevel == LODLevel::DOWNSAMPLED) {
-                    QVector<double> dsT, dsV;
-                    int n = segT.size();
-                    if (pxRF <= 0) { dsT = segT; dsV = segV; }
-                    else {
-                        double ppp = static_cast<double>(n) / static_cast<double>(pxRF);
-                        if (n <= smallSegThresholdRF || ppp <= noDecimThresholdRF) { dsT = segT; dsV = segV; }
-                        else {
-                            // Hybrid: very large ppp uses fast min-max; otherwise LTTB
-                            if (ppp >= 8.0) {
-                                applyMinMaxDownsampling(segT, segV, pxRF, dsT, dsV);
-                            } else {
-                                int target = qMin(static_cast<int>(qRound(pxRF * lttbFactorRF)), capPointsRF);
-                                target = qMin(target, n);
-                                applyLTTBDownsampling(segT, segV, target, dsT, dsV);
-                            }
-                        }
-                    }
-                    // Debug logging removed
-                    tOut += dsT; vOut += dsV;
-                } else {
-                    tOut += segT; vOut += segV;
-                }
-                segT.clear(); segV.clear();
-                minDt = std::numeric_limits<double>::infinity();
-                // keep NaN separator between segments (values only)
-                if (!tOut.isEmpty()) {
-                    // duplicate last valid time to maintain monotonic keys, mark value as NaN to break line
-                    tOut.append(tOut.last());
-                    vOut.append(std::numeric_limits<double>::quiet_NaN());
-                }
-            };
-
-            // Restrict to indices within [x0, x1] using binary search to avoid O(n_total) scans
-            int iStart = 0;
-            int iEnd = tIn.size();
-            if (!tIn.isEmpty()) {
-                auto itL = std::lower_bound(tIn.begin(), tIn.end(), x0);
-                auto itU = std::upper_bound(tIn.begin(), tIn.end(), x1);
-                iStart = std::distance(tIn.begin(), itL);
-                iEnd = std::distance(tIn.begin(), itU);
-                if (iStart > 0) --iStart; // include margin just before
-                if (iEnd < tIn.size()) ++iEnd; // include margin just after
-            }
-            for (int i = iStart; i < iEnd; ++i) {
-                const double tx = tIn[i];
-                const double vy = (i < vIn.size() ? vIn[i] : std::numeric_limits<double>::quiet_NaN());
-                const bool isBreak = std::isnan(vy);
-                if (isBreak) { flushSegment(); continue; }
-                if (!segT.isEmpty()) {
-                    double dt = tx - segT.last();
-                    if (dt > 0) {
-                        if (!std::isfinite(minDt)) minDt = dt; else minDt = std::min(minDt, dt);
-                        // Heuristic: if current gap is much larger than local sampling, start a new segment
-                        if (minDt < std::numeric_limits<double>::infinity() && dt > 10.0 * minDt) {
-                            flushSegment();
-                        }
-                    }
-                }
-                segT.append(tx); segV.append(vy);
-            }
-            flushSegment();
-            // remove trailing NaN in values (time stays finite)
-            if (!vOut.isEmpty() && std::isnan(vOut.last())) { tOut.removeLast(); vOut.removeLast(); }
-
-            // Fallback: if nothing in slice, pick nearest segment around viewport center
-            if (tOut.isEmpty()) {
-                double xc = 0.5 * (visibleStart + visibleEnd);
-                // find nearest index by linear scan (acceptable once at draw time)
-                int best = -1; double bestDist = std::numeric_limits<double>::infinity();
-                for (int i = 0; i < tIn.size(); ++i) {
-                    const double tx = tIn[i];
-                    if (i >= vIn.size() || std::isnan(vIn[i])) continue;
-                    double d = std::abs(tx - xc);
-                    if (d < bestDist) { bestDist = d; best = i; }
-                }
-                if (best != -1) {
-                    // expand to contiguous non-NaN segment around best
-                    int L = best, R = best;
-                    while (L > 0 && !std::isnan(vIn[L-1])) L--;
-                    while (R+1 < tIn.size() && !std::isnan(vIn[R+1])) R++;
-                    segT.clear(); segV.clear();
-                    for (int i = L; i <= R; ++i) { segT.append(tIn[i]); segV.append(vIn[i]); }
-                    if (!segT.isEmpty()) {
-                        if (currentLODLevel == LODLevel::DOWNSAMPLED) {
-                            QVector<double> dsT, dsV; applyLTTBDownsampling(segT, segV, 1000, dsT, dsV); tOut = dsT; vOut = dsV;
     } else {
-                            tOut = segT; vOut = segV;
-                        }
-                    }
-                }
-            }
-        };
+        if (m_vecRects.size() > 1 && m_vecRects[1]) m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[1].first, m_fixedYRanges[1].second);
+        if (m_vecRects.size() > 2 && m_vecRects[2]) m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[2].first, m_fixedYRanges[2].second);
+    }
+    
+    // DEBUG: Unconditionally force phase Y-axis range to [-3.5, 3.5] to reveal negative values
+    if (m_vecRects.size() > 2 && m_vecRects[2]) {
+         m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(-3.5, 3.5);
+    }
+}
 
-        QVector<double> tAmp, vAmp;
-        sliceAndProcess(mergedTimeAmp, mergedAmp, tAmp, vAmp);
-        
-        // Prepare pen for RF Mag if needed (kept once at graph creation)
+void WaveformDrawer::applyGradSeries(RenderFrame& frame)
+{
+    for (int channel = 0; channel < 3; ++channel) {
+        int curveIndex = channel + 3;
+        const int c = ViewportGx + channel;
 
-        if (m_graphRFMag)
-        {
-            m_graphRFMag->setData(tAmp, vAmp);
-            m_graphRFMag->setVisible(m_curveVisibility.value(1, true));
-        }
-        
-        // Draw RF Phase if visible
-        if (m_curveVisibility[2] && m_vecRects.size() > 2 && m_vecRects[2]) {
-            const QVector<double>& mergedTimePh = loader->getRfTimePh();
-            const QVector<double>& mergedPh = loader->getRfPh();
-            
-            if (!mergedTimePh.isEmpty() && !mergedPh.isEmpty()) {
-                QVector<double> tPh, vPh;
-                
-                // LTTB viewport-aware target for RF Phase
-                int pxPh = 0; if (m_vecRects.size()>2 && m_vecRects[2]) { pxPh = qMax(1, static_cast<int>(qRound(m_vecRects[2]->width() * m_mainWindow->devicePixelRatioF()))); }
-                const double noDecimThresholdPh = 1.2; const int smallSegThresholdPh = 64; const double lttbFactorPh = 2.0; const int capPointsPh = 10000;
-                // Slice merged RF Phase data based on viewport
-                auto itLowerPh = std::lower_bound(mergedTimePh.begin(), mergedTimePh.end(), visibleStart);
-                auto itUpperPh = std::upper_bound(mergedTimePh.begin(), mergedTimePh.end(), visibleEnd);
-                
-                int idxStartPh = std::distance(mergedTimePh.begin(), itLowerPh);
-                int idxEndPh = std::distance(mergedTimePh.begin(), itUpperPh);
-                
-                // Add margin for continuity
-                if (idxStartPh > 0) idxStartPh--;
-                if (idxEndPh < mergedTimePh.size()) idxEndPh++;
-                
-                if (idxStartPh < idxEndPh) {
-                    // Extract visible data
-                    for (int k = idxStartPh; k < idxEndPh; ++k) {
-                        tPh.append(mergedTimePh[k]);
-                        vPh.append(mergedPh[k]);
-                    }
-                    
-                    // Process segments separated by NaN
-                    QVector<double> processedTimePh, processedValuesPh;
-                    int segmentStartIdx = 0;
-                    for (int k = 0; k < vPh.size(); ++k) {
-                        if (std::isnan(vPh[k])) {
-                            if (k > segmentStartIdx) {
-                                QVector<double> currentSegmentTime;
-                                QVector<double> currentSegmentValues;
-                                for (int m = segmentStartIdx; m < k; ++m) {
-                                    currentSegmentTime.append(tPh[m]);
-                                    currentSegmentValues.append(vPh[m]);
-                                }
-                                
-                                if (currentLODLevel == LODLevel::DOWNSAMPLED) {
-                                    QVector<double> downsampledSegmentTime, downsampledSegmentValues;
-                                    int n=currentSegmentTime.size();
-                            if (pxPh <= 0) { downsampledSegmentTime=currentSegmentTime; downsampledSegmentValues=currentSegmentValues; }
-                            else {
-                                double ppp = static_cast<double>(n) / static_cast<double>(pxPh);
-                                if (n <= smallSegThresholdPh || ppp <= noDecimThresholdPh) { downsampledSegmentTime=currentSegmentTime; downsampledSegmentValues=currentSegmentValues; }
-                                else {
-                                    if (ppp >= 8.0) { applyMinMaxDownsampling(currentSegmentTime, currentSegmentValues, pxPh, downsampledSegmentTime, downsampledSegmentValues); }
-                                    else { int target = qMin(static_cast<int>(qRound(pxPh * lttbFactorPh)), capPointsPh); target = qMin(target, n); applyLTTBDownsampling(currentSegmentTime, currentSegmentValues, target, downsampledSegmentTime, downsampledSegmentValues); }
-                                }
-                            }
-                                    processedTimePh.append(downsampledSegmentTime);
-                                    processedValuesPh.append(downsampledSegmentValues);
-                                } else {
-                                    processedTimePh.append(currentSegmentTime);
-                                    processedValuesPh.append(currentSegmentValues);
-                                }
-                                // Add NaN to separate segments
-                                processedTimePh.append(tPh[k]);
-                                processedValuesPh.append(std::numeric_limits<double>::quiet_NaN());
-                            }
-                            segmentStartIdx = k + 1;
-                        }
-                    }
-                    // Process the last segment
-                    if (vPh.size() > segmentStartIdx) {
-                        QVector<double> currentSegmentTime;
-                        QVector<double> currentSegmentValues;
-                        for (int m = segmentStartIdx; m < vPh.size(); ++m) {
-                            currentSegmentTime.append(tPh[m]);
-                            currentSegmentValues.append(vPh[m]);
-                        }
-                        if (currentLODLevel == LODLevel::DOWNSAMPLED) {
-                            QVector<double> downsampledSegmentTime, downsampledSegmentValues;
-                            int n=currentSegmentTime.size();
-                            if (pxPh <= 0) { downsampledSegmentTime=currentSegmentTime; downsampledSegmentValues=currentSegmentValues; }
-                            else {
-                                double ppp = static_cast<double>(n) / static_cast<double>(pxPh);
-                                if (n <= smallSegThresholdPh || ppp <= noDecimThresholdPh) { downsampledSegmentTime=currentSegmentTime; downsampledSegmentValues=currentSegmentValues; }
-                                else {
-                                    if (ppp >= 8.0) { applyMinMaxDownsampling(currentSegmentTime, currentSegmentValues, pxPh, downsampledSegmentTime, downsampledSegmentValues); }
-                                    else { int target = qMin(static_cast<int>(qRound(pxPh * lttbFactorPh)), capPointsPh); target = qMin(target, n); applyLTTBDownsampling(currentSegmentTime, currentSegmentValues, target, downsampledSegmentTime, downsampledSegmentValues); }
-                                }
-                            }
-                            processedTimePh.append(downsampledSegmentTime);
-                            processedValuesPh.append(downsampledSegmentValues);
-                        } else {
-                            processedTimePh.append(currentSegmentTime);
-                            processedValuesPh.append(currentSegmentValues);
-                        }
-                    }
-                    
-                    // Draw RF Phase via persistent graph
-                    if (!processedTimePh.isEmpty() && m_graphRFPh) {
-                        m_graphRFPh->setData(processedTimePh, processedValuesPh);
-                        m_graphRFPh->setVisible(m_curveVisibility.value(2, true));
-                        
-                        // Update Y-axis range for RF Phase
-                        double minPh = std::numeric_limits<double>::max();
-                        double maxPh = std::numeric_limits<double>::min();
-                        for (const auto& val : processedValuesPh) {
-                            if (!std::isnan(val)) {
-                                minPh = std::min(minPh, val);
-                                maxPh = std::max(maxPh, val);
-                            }
-                        }
-                        if (maxPh >= minPh) {
-                            double pad = (maxPh - minPh) * 0.05;
-                            pad = (pad == 0) ? 1.0 : pad;
-                            m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(minPh - pad, maxPh + pad);
-                        }
-                    }
+        QCPGraph* target = (channel == 0 ? m_graphGx : (channel == 1 ? m_graphGy : m_graphGz));
+        if (target) {
+            const bool empty = frame.series.t[c].isEmpty();
+            swapGraphData(target, frame.graphData[c]);
+            target->setVisible(m_curveVisibility.value(curveIndex, true) && !empty);
+
+            if (!m_lockYAxisRanges) {
+                const double mn = frame.vMin[c];
+                const double mx = frame.vMax[c];
+                if (mx >= mn) {
+                    double pad = (mx - mn) * 0.05; if (pad == 0) pad = 0.1;
+                    m_vecRects[curveIndex]->axis(QCPAxis::atLeft)->setRange(mn - pad, mx + pad);
                 }
+            } else {
+                if (m_vecRects.size() > curveIndex && m_vecRects[curveIndex])
+                    m_vecRects[curveIndex]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[curveIndex].first, m_fixedYRanges[curveIndex].second);
             }
         }
-
-        auto updateMinMax = [&](const QVector<double>& arr, double& mn, double& mx) {
-            for (int i = 0; i < arr.size(); ++i) {
-                const double v = arr[i];
-                if (std::isnan(v)) continue;
-                if (v < mn) mn = v; if (v > mx) mx = v;
-            }
-        };
-        min1 = std::min(min1, std::numeric_limits<double>::max());
-        max1 = std::max(max1, std::numeric_limits<double>::min());
-        min2 = std::min(min2, std::numeric_limits<double>::max());
-        max2 = std::max(max2, std::numeric_limits<double>::min());
-        updateMinMax(vAmp, min1, max1);
-    } else {
-        // Fallback: keep previous per-block path if merged series unavailable (should not happen)
-        // No-op; axes range update below will keep previous values
     }
+}
 
-    if (!m_lockYAxisRanges) {
-        if (max1 >= min1 && m_vecRects.size() > 1 && m_vecRects[1]) { double pad = (max1 - min1) * 0.05; pad = (pad == 0) ? 1.0 : pad; m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(min1 - pad, max1 + pad); }
-        if (max2 >= min2 && m_vecRects.size() > 2 && m_vecRects[2]) { double pad = (max2 - min2) * 0.05; pad = (pad == 0) ? 1.0 : pad; m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(min2 - pad, max2 + pad); }
-    } else {
-        if (m_vecRects.size() > 1 && m_vecRects[1]) m_vecRects[1]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[1].first, m_fixedYRanges[1].second);
-        if (m_vecRects.size() > 2 && m_vecRects[2]) m_vecRects[2]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[2].first, m_fixedYRanges[2].second);
-    }
+void WaveformDrawer::DrawRFWaveform(const double& dStartTime, double dEndTime)
+{
+    Q_UNUSED(dStartTime);
+    Q_UNUSED(dEndTime);
+    // Synchronous redraw supersedes any frame still being prepared
+    cancelRenderPreparation();
+    std::shared_ptr<RenderFrame> frame = takeRenderFrame();
+    m_spareRenderFrame = frame; // nothing in flight after the cancel; the frame stays spare
+    if (!captureRenderRequest(frame->request)) return;
+    const ViewportQuery& query = frame->request.query;
+    updateTeGuides(query.visibleStart, query.visibleEnd);
+    updateKxKyZeroGuides(query.visibleStart, query.visibleEnd);
+
+    for (int c = ViewportGx; c <= ViewportGz; ++c) frame->request.query.pixelWidth[c] = 0;
+    prepareRenderFrame(m_mainWindow->getPulseqLoader(), *frame);
+    applyRfSeries(*frame);
+}
+
+double WaveformDrawer::adcRectHeight(const PulseqLoader* loader)
+{
+    // Label range recorded once at load (LabelHistory), so redraws do not visit label blocks
+    int maxAbsLabel = loader->getLabelHistory().maxAbsEventValue;
+    if (maxAbsLabel <= 0) maxAbsLabel = 1;
+    return maxAbsLabel * 1.2;
 }
 
 void WaveformDrawer::DrawADCWaveform(const double& dStartTime, double dEndTime)
 {
     PulseqLoader* loader = m_mainWindow->getPulseqLoader();
     if (loader->getDecodedSeqBlocks().empty()) return;
-    
-    // ʹ��PulseqLabelAnalyzer����ȷ������ǩ״̬
-    static PulseqLabelAnalyzer* labelAnalyzer = nullptr;
-    if (!labelAnalyzer) {
-        auto seq = loader->getSequence();
-        if (seq) {
-            labelAnalyzer = new PulseqLabelAnalyzer(*seq);
-            if (DEBUG_LABEL_EVENTS) {
-                qDebug().noquote() << "PulseqLabelAnalyzer initialized with" << seq->GetNumberOfBlocks() << "blocks";
-            }
-        }
-    }
 
     // Determine visible viewport in internal time units
     if (m_vecRects.isEmpty() || !m_vecRects[0]) {
@@ -1319,25 +1093,8 @@ void WaveformDrawer::DrawADCWaveform(const double& dStartTime, double dEndTime)
     // Use simple LOD system
     LODLevel currentLODLevel = getCurrentLODLevel();
 
-    // Compute unified ADC rectangle height based on label range across the sequence
-    double adcHeight = 1.0; // default when no label exists
-    {
-        double maxAbsLabel = 0.0;
-        const auto& blocks = loader->getDecodedSeqBlocks();
-        for (auto* blk : blocks)
-        {
-            if (!blk) continue;
-            if (blk->isLabel())
-            {
-                const auto& sets = blk->GetLabelSetEvents();
-                const auto& incs = blk->GetLabelIncEvents();
-                for (const auto& e : sets) { maxAbsLabel = std::max(maxAbsLabel, std::abs((double)e.numVal.second)); }
-                for (const auto& e : incs) { maxAbsLabel = std::max(maxAbsLabel, std::abs((double)e.numVal.second)); }
-            }
-        }
-        if (maxAbsLabel <= 0.0) maxAbsLabel = 1.0;
-        adcHeight = maxAbsLabel * 1.2;
-    }
+    // Unified ADC rectangle height based on the label range across the sequence
+    const double adcHeight = adcRectHeight(loader);
 
     // Use merged ADC series for drawing
     const QVector<double>& mergedAdcTime = loader->getAdcTime();
@@ -1445,34 +1202,19 @@ void WaveformDrawer::DrawADCWaveform(const double& dStartTime, double dEndTime)
                 {"PMC", true, PMC}, {"NOROT", true, NOROT}, {"NOPOS", true, NOPOS}, {"NOSCL", true, NOSCL},
             };
 
-            // Find block indices intersecting the viewport
-            const auto& edges = loader->getBlockEdges();
-            if (edges.size() > 1)
+            // Largest value over the blocks intersecting the viewport, from the label transitions
+            const PulseqLoader::LabelHistory& history = loader->getLabelHistory();
+            int b0 = 0, b1 = -1;
+            if (loader->findVisibleBlockRange(visibleStart, visibleEnd, b0, b1))
             {
-                auto itL = std::upper_bound(edges.begin(), edges.end(), visibleStart);
-                int b0 = std::max(0, int(std::distance(edges.begin(), itL)) - 1);
-                auto itU = std::upper_bound(edges.begin(), edges.end(), visibleEnd);
-                int b1 = std::min(int(loader->getDecodedSeqBlocks().size()) - 1,
-                                  std::max(b0, int(std::distance(edges.begin(), itU)) - 1));
-                for (int b = b0; b <= b1; ++b)
+                b1 = std::min(b1, history.blockCount - 1);
+                for (const auto& s : specs)
                 {
-                    for (const auto& s : specs)
-                    {
-                        if (!st.isExtensionLabelEnabled(s.name))
-                            continue;
-                        if (s.isFlag)
-                        {
-                            bool v = false;
-                            if (loader->getFlagValueAfterBlock(b, s.id, v))
-                                maxExt = std::max(maxExt, v ? 1 : 0);
-                        }
-                        else
-                        {
-                            int v = 0;
-                            if (loader->getCounterValueAfterBlock(b, s.id, v))
-                                maxExt = std::max(maxExt, v);
-                        }
-                    }
+                    if (b0 > b1 || !st.isExtensionLabelEnabled(s.name))
+                        continue;
+                    const int v = PulseqLoader::LabelHistory::maxValueInBlocks(
+                        s.isFlag ? history.flags[s.id] : history.counters[s.id], b0, b1);
+                    maxExt = std::max(maxExt, s.isFlag ? (v != 0 ? 1 : 0) : v);
                 }
             }
 
@@ -1496,18 +1238,17 @@ void WaveformDrawer::DrawADCWaveform(const double& dStartTime, double dEndTime)
         xSeg.reserve(128);
         ySeg.reserve(128);
 
+        // Only the blocks that carry a trigger are decoded
         const auto& edges = loader->getBlockEdges();
-        if (edges.size() > 1)
+        const QVector<PulseqLoader::EventInterval>& triggers = loader->getChannelEvents(PulseqLoader::ChannelTrigger);
+        int first = 0, last = -1;
+        if (edges.size() > 1 && loader->findVisibleEvents(PulseqLoader::ChannelTrigger, visibleStart, visibleEnd, first, last))
         {
-            auto itL = std::upper_bound(edges.begin(), edges.end(), visibleStart);
-            int b0 = std::max(0, int(std::distance(edges.begin(), itL)) - 1);
-            auto itU = std::upper_bound(edges.begin(), edges.end(), visibleEnd);
-            int b1 = std::min(int(loader->getDecodedSeqBlocks().size()) - 1,
-                              std::max(b0, int(std::distance(edges.begin(), itU)) - 1));
-
-            for (int b = b0; b <= b1; ++b)
+            const BlockSource blocks = loader->getDecodedSeqBlocks();
+            for (int e = first; e <= last; ++e)
             {
-                SeqBlock* blk = loader->getDecodedSeqBlocks()[b];
+                const int b = triggers[e].block;
+                SeqBlock* blk = blocks[b];
                 if (!blk || !blk->isTrigger())
                     continue;
                 const TriggerEvent& trg = blk->GetTriggerEvent();
@@ -1551,82 +1292,17 @@ void WaveformDrawer::DrawADCWaveform(const double& dStartTime, double dEndTime)
 
 void WaveformDrawer::DrawGWaveform(const double& dStartTime, double dEndTime)
 {
-    PulseqLoader* loader = m_mainWindow->getPulseqLoader();
-    if (loader->getDecodedSeqBlocks().empty()) return;
-
-    // Determine visible viewport in internal time units
-    if (m_vecRects.isEmpty() || !m_vecRects[0]) {
-        qDebug() << "ERROR: m_vecRects not initialized!";
-        return;
-    }
-    QCPRange viewport = m_vecRects[0]->axis(QCPAxis::atBottom)->range();
-    double visibleStart = viewport.lower;
-    double visibleEnd = viewport.upper;
-
-    // Clamp viewport to TR bounds if TR-Segmented mode is active
-    TRManager* trm2 = m_mainWindow->getTRManager();
-    if (trm2 && m_mainWindow->getPulseqLoader()->hasRepetitionTime() && trm2->isTrBasedMode())
-    {
-        int startTr = trm2->getTrStartInput()->text().toInt();
-        int endTr = trm2->getTrEndInput()->text().toInt();
-        double trStart = (startTr - 1) * loader->getRepetitionTime_us() * loader->getTFactor();
-        double trEnd = endTr * loader->getRepetitionTime_us() * loader->getTFactor();
-        // Intersect with TR bounds to keep zoom fidelity
-        visibleStart = std::max(visibleStart, trStart);
-        visibleEnd = std::min(visibleEnd, trEnd);
-        if (visibleEnd <= visibleStart) {
-            visibleStart = trStart;
-            visibleEnd = std::max(trStart + 1e-6, trEnd);
-        }
-    }
-
-    // Use simple LOD system
-    LODLevel currentLODLevel = getCurrentLODLevel();
-    double tFactor = loader->getTFactor();
-
-    // Phase 2: On-demand gradients per channel using loader cache
-    for (int channel = 0; channel < 3; ++channel) {
-        int curveIndex = channel + 3;
-        int px = 0;
-        if (m_vecRects.size() > curveIndex && m_vecRects[curveIndex])
-            px = qMax(1, static_cast<int>(qRound(m_vecRects[curveIndex]->width() * m_mainWindow->devicePixelRatioF())));
-        // Respect LOD: in FULL_DETAIL mode, disable decimation by faking a huge pixel width
-        int pxEffective = (currentLODLevel == LODLevel::DOWNSAMPLED ? px : qMax(px, 100000));
-
-        QVector<double> tG, vG;
-        loader->getGradViewportDecimated(channel, visibleStart, visibleEnd, pxEffective, tG, vG);
-
-        // Apply unit conversion from internal standard (Hz/m) to selected display unit
-        {
-            Settings& s = Settings::getInstance();
-            const QString toUnit = s.getGradientUnitString();
-            if (toUnit != "Hz/m") {
-                for (int i = 0; i < vG.size(); ++i) {
-                    double v = vG[i];
-                    if (!std::isnan(v)) vG[i] = s.convertGradient(v, "Hz/m", toUnit);
-                }
-            }
-        }
-
-        QCPGraph* target = (channel == 0 ? m_graphGx : (channel == 1 ? m_graphGy : m_graphGz));
-        if (target) {
-            target->setData(tG, vG);
-            target->setVisible(m_curveVisibility.value(curveIndex, true) && !tG.isEmpty());
-
-            if (!m_lockYAxisRanges) {
-                double mn = std::numeric_limits<double>::max();
-                double mx = -std::numeric_limits<double>::infinity();
-                for (double v : vG) { if (!std::isnan(v)) { if (v < mn) mn = v; if (v > mx) mx = v; } }
-                if (mx >= mn) {
-                    double pad = (mx - mn) * 0.05; if (pad == 0) pad = 0.1;
-                    m_vecRects[curveIndex]->axis(QCPAxis::atLeft)->setRange(mn - pad, mx + pad);
-                }
-            } else {
-                if (m_vecRects.size() > curveIndex && m_vecRects[curveIndex])
-                    m_vecRects[curveIndex]->axis(QCPAxis::atLeft)->setRange(m_fixedYRanges[curveIndex].first, m_fixedYRanges[curveIndex].second);
-            }
-        }
-    }
+    Q_UNUSED(dStartTime);
+    Q_UNUSED(dEndTime);
+    // Synchronous redraw supersedes any frame still being prepared
+    cancelRenderPreparation();
+    std::shared_ptr<RenderFrame> frame = takeRenderFrame();
+    m_spareRenderFrame = frame; // nothing in flight after the cancel; the frame stays spare
+    if (!captureRenderRequest(frame->request)) return;
+
+    for (int c = ViewportRfAmp; c <= ViewportAdcPhase; ++c) frame->request.query.pixelWidth[c] = 0;
+    prepareRenderFrame(m_mainWindow->getPulseqLoader(), *frame);
+    applyGradSeries(*frame);
 }
 
 void WaveformDrawer::computeAndLockYAxisRanges()
@@ -1644,17 +1320,8 @@ void WaveformDrawer::computeAndLockYAxisRanges()
         double pad = (mx - mn) * 0.05; if (pad == 0) pad = 1.0; return qMakePair(mn - pad, mx + pad);
     };
 
-    // 0: ADC/labels -> use computed adcHeight similar to DrawADCWaveform
-    double maxAbsLabel = 0.0;
-    for (auto* blk : loader->getDecodedSeqBlocks()) {
-        if (!blk) continue; if (blk->isLabel()) {
-            const auto& sets = blk->GetLabelSetEvents(); const auto& incs = blk->GetLabelIncEvents();
-            for (const auto& e : sets) maxAbsLabel = std::max(maxAbsLabel, std::abs((double)e.numVal.second));
-            for (const auto& e : incs) maxAbsLabel = std::max(maxAbsLabel, std::abs((double)e.numVal.second));
-        }
-    }
-    if (maxAbsLabel <= 0.0) maxAbsLabel = 1.0;
-    double adcHeight = maxAbsLabel * 1.2;
+    // 0: ADC/labels -> same height as DrawADCWaveform
+    double adcHeight = adcRectHeight(loader);
     double adcPad = adcHeight * 0.1;
     m_fixedYRanges[0] = qMakePair(0.0 - adcPad, adcHeight + adcPad);
 
@@ -1707,22 +1374,26 @@ void WaveformDrawer::DrawBlockEdges()
     double visibleStart = viewport.lower;
     double visibleEnd = viewport.upper;
 
+    // Edges inside the viewport, located once by binary search and shared by all rects
+    const int iFirst = int(std::distance(edges.begin(), std::lower_bound(edges.begin(), edges.end(), visibleStart)));
+    const int iLast = int(std::distance(edges.begin(), std::upper_bound(edges.begin(), edges.end(), visibleEnd)));
+    const int nVisible = std::max(0, iLast - iFirst);
+
     // Build per-rect vertical line segments with NaN breaks
     for (int r = 0; r < m_vecRects.size(); ++r)
     {
         if (!m_blockEdgeGraphs.value(r)) continue;
-        QVector<double> xs; xs.reserve(edges.size()*3);
-        QVector<double> ys; ys.reserve(edges.size()*3);
+        QVector<double> xs; xs.reserve(nVisible*3);
+        QVector<double> ys; ys.reserve(nVisible*3);
 
         // Use current y-range of the rect to span full height
         QCPRange yr = m_vecRects[r]->axis(QCPAxis::atLeft)->range();
         double yMin = yr.lower;
         double yMax = yr.upper;
 
-        for (int i = 0; i < edges.size(); ++i)
+        for (int i = iFirst; i < iLast; ++i)
         {
             double t = edges[i];
-            if (t < visibleStart || t > visibleEnd) continue;
             xs.append(t); ys.append(yMin);
             xs.append(t); ys.append(yMax);
             xs.append(t); ys.append(std::numeric_limits<double>::quiet_NaN()); // break
@@ -1912,12 +1583,14 @@ void WaveformDrawer::ensureRenderedForCurrentViewport()
             }
             return;
         }
-        // Redraw visible content for all channels based on the current viewport
-        DrawRFWaveform();
-        DrawADCWaveform();
-        DrawGWaveform();
-        if (getShowBlockEdges()) DrawBlockEdges();
-        m_mainWindow->ui->customPlot->replot();
+        // The decimated series are prepared on m_renderPool. While a frame is in flight, further
+        // viewport changes only mark a request pending; the newest viewport is prepared once the
+        // frame lands, so a fast pan never queues up more than one frame behind the axes.
+        if (m_renderInFlight) {
+            m_renderPending = true;
+            return;
+        }
+        startRenderPreparation();
     } catch (const std::exception& e) {
         if (DEBUG_LOD_SYSTEM) {
             qDebug().noquote() << "[LOD] Exception in ensureRenderedForCurrentViewport:" << e.what();
@@ -1929,6 +1602,86 @@ void WaveformDrawer::ensureRenderedForCurrentViewport()
     }
 }
 
+std::shared_ptr<WaveformDrawer::RenderFrame> WaveformDrawer::takeRenderFrame()
+{
+    // At most one frame is in flight and one being applied, so two frames alternate and their
+    // buffers are reused instead of reallocated on every pan/zoom step
+    std::shared_ptr<RenderFrame> frame = std::move(m_spareRenderFrame);
+    if (!frame) frame = std::make_shared<RenderFrame>();
+    return frame;
+}
+
+void WaveformDrawer::startRenderPreparation()
+{
+    PulseqLoader* loader = m_mainWindow->getPulseqLoader();
+    std::shared_ptr<RenderFrame> frame = takeRenderFrame();
+    if (!captureRenderRequest(frame->request)) {
+        // Nothing loaded: only the axes moved
+        m_spareRenderFrame = frame;
+        m_mainWindow->ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+        return;
+    }
+    frame->generation = m_renderGeneration;
+    m_renderInFlight = true;
+
+    m_renderPool.start([this, loader, frame]() {
+        try {
+            prepareRenderFrame(loader, *frame);
+        } catch (...) {
+            // Hand back whatever was prepared; the next viewport change retries
+        }
+        QMetaObject::invokeMethod(this, [this, frame]() {
+            applyRenderFrame(*frame);
+            m_spareRenderFrame = frame;
+        }, Qt::QueuedConnection);
+    });
+}
+
+void WaveformDrawer::applyRenderFrame(RenderFrame& frame)
+{
+    // Frame of a preparation that has been cancelled since (reload, rescale, synchronous draw)
+    if (frame.generation != m_renderGeneration) return;
+    m_renderInFlight = false;
+    // Start on the newest viewport right away, so it is prepared while this frame is drawn
+    if (m_renderPending) {
+        m_renderPending = false;
+        startRenderPreparation();
+    }
+
+    // GUI side: swap the prepared series in, then the cheap per-viewport overlays
+    const ViewportQuery& query = frame.request.query;
+    updateTeGuides(query.visibleStart, query.visibleEnd);
+    updateKxKyZeroGuides(query.visibleStart, query.visibleEnd);
+    applyRfSeries(frame);
+    applyGradSeries(frame);
+    DrawADCWaveform();
+    if (getShowBlockEdges()) DrawBlockEdges();
+    m_mainWindow->ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+
+    std::copy(std::begin(frame.series.elapsedNs), std::end(frame.series.elapsedNs), std::begin(m_lastRenderNs));
+    if (DEBUG_LOD_RENDERING_PERFORMANCE) {
+        const qint64* ns = m_lastRenderNs;
+        qDebug().noquote() << QString("[LOD] viewport decimation (us): RF mag %1, RF ph %2, ADC ph %3, GX %4, GY %5, GZ %6")
+                                  .arg(ns[ViewportRfAmp] / 1000).arg(ns[ViewportRfPhase] / 1000)
+                                  .arg(ns[ViewportAdcPhase] / 1000).arg(ns[ViewportGx] / 1000)
+                                  .arg(ns[ViewportGy] / 1000).arg(ns[ViewportGz] / 1000);
+    }
+}
+
+QVector<qint64> WaveformDrawer::lastRenderTimingsNs() const
+{
+    return QVector<qint64>(std::begin(m_lastRenderNs), std::end(m_lastRenderNs));
+}
+
+void WaveformDrawer::cancelRenderPreparation()
+{
+    // Tasks are short (one viewport of one channel); wait for them rather than interrupting
+    m_renderPool.waitForDone();
+    ++m_renderGeneration;
+    m_renderInFlight = false;
+    m_renderPending = false;
+}
+
 void WaveformDrawer::updateAxisLabels()
 {
     // Update Y-axis labels using each rect's fixed identity (matching InitSequenceFigure).
@@ -2022,6 +1775,19 @@ void WaveformDrawer::setShowKxKyZeroGuides(bool show)
     }
 }
 
+void WaveformDrawer::refreshTrajectoryGuides()
+{
+    if (!m_showTeGuides && !m_showKxKyZeroGuides)
+        return;
+    if (!m_vecRects.isEmpty() && m_vecRects[0])
+    {
+        const QCPRange viewport = m_vecRects[0]->axis(QCPAxis::atBottom)->range();
+        updateTeGuides(viewport.lower, viewport.upper);
+        updateKxKyZeroGuides(viewport.lower, viewport.upper);
+        if (m_mainWindow && m_mainWindow->ui && m_mainWindow->ui->customPlot)
+            m_mainWindow->ui->customPlot->replot(QCustomPlot::rpQueuedReplot);
+    }
+}
 
 void WaveformDrawer::applyLTTBDownsampling(const QVector<double>& time, const QVector<double>& values,
                                           int targetPoints,
@@ -2272,6 +2038,7 @@ void WaveformDrawer::updateTeGuides(double visibleStart, double visibleEnd)
         return;
     }
 
+    // Centers stream in with the background trajectory pass (refreshTrajectoryGuides)
     const auto& centers = loader->getExcitationCenters();
     const double teOffset = loader->getTeDurationAxis();
 
@@ -2417,8 +2184,7 @@ void WaveformDrawer::updateKxKyZeroGuides(double visibleStart, double visibleEnd
         return;
     }
 
-    // Ensure trajectory is prepared
-    loader->ensureTrajectoryPrepared();
+    // Drawn once the background trajectory pass has finished (refreshTrajectoryGuides)
     if (!loader->hasTrajectoryData())
     {
         hideKxKyZeroGuideItems();
@@ -8,16 +8,23 @@
 #include <QDateTime>
 #include <QString>
 #include <QTimer>
+#include <QThreadPool>
+#include <QSharedPointer>
 #include <memory>
 
+#include "ViewportSeries.h"
+
 class ExtensionPlotter;
 
 // Forward declarations
 class MainWindow;
+class PulseqLoader;
 class QCPAxisRect;
 class QCPItemTracer;
 class QCPItemStraightLine;
 class QCPGraph;
+class QCPGraphData;
+template <class DataType> class QCPDataContainer;
 class QCPMarginGroup;
 class QCPItemText;
 class Settings;
@@ -55,8 +62,14 @@ public:
     // Update axis labels when settings change
     void updateAxisLabels();
     
-    // Ensure current viewport has been rendered at the correct detail
+    // Ensure current viewport has been rendered at the correct detail. The series are
+    // prepared on worker threads and swapped into the graphs once ready.
     void ensureRenderedForCurrentViewport();
+    // Drops the viewport frame being prepared, if any, and waits for its tasks. Called before
+    // the loader changes the data the tasks read (reload, time-unit rescale).
+    void cancelRenderPreparation();
+    // Per-channel decimation time (ns, indexed by ViewportChannel) of the last frame swapped in
+    QVector<qint64> lastRenderTimingsNs() const;
     
     // Simple viewport change processing
     void processViewportChangeSimple(double visibleStart, double visibleEnd);
@@ -112,6 +125,8 @@ public:
     LODLevel getCurrentLODLevel() const;
     void setShowTeGuides(bool show);
     void setShowKxKyZeroGuides(bool show);
+    // Redraws the TE / k=0 guides after more trajectory data has arrived
+    void refreshTrajectoryGuides();
 
 public slots:
     void ResetView();
@@ -122,6 +137,35 @@ public slots:
 
 private:
     // Old time-based LOD functions removed - replaced with complexity-based LOD system
+    // Height of the ADC rectangles: 1.2 x the largest label value of the sequence
+    static double adcRectHeight(const PulseqLoader* loader);
+
+    // Viewport (clamped to the sequence and TR range) and per-channel pixel widths a frame is
+    // prepared for, captured on the GUI thread
+    struct RenderRequest {
+        ViewportQuery query;
+        double gradScale {1.0}; // Hz/m -> display gradient unit
+    };
+    // Frames are recycled: the series keep their capacity from one viewport to the next, and
+    // graphData holds the containers the graphs dropped when this frame's were last swapped in
+    struct RenderFrame {
+        RenderRequest request;
+        quint64 generation {0};
+        ViewportSeries series;
+        QSharedPointer<QCPDataContainer<QCPGraphData>> graphData[NumViewportChannels];
+        double vMin[NumViewportChannels] {}; // finite value range per channel (min > max if none)
+        double vMax[NumViewportChannels] {};
+    };
+    bool captureRenderRequest(RenderRequest& request) const;
+    // Worker side: loader queries and filling the frame's own graph containers, no plot access
+    static void prepareRenderFrame(PulseqLoader* loader, RenderFrame& frame);
+    // GUI side: swap the frame's containers into the graphs, set Y ranges
+    void applyRfSeries(RenderFrame& frame);
+    void applyGradSeries(RenderFrame& frame);
+    static void swapGraphData(QCPGraph* graph, QSharedPointer<QCPDataContainer<QCPGraphData>>& data);
+    std::shared_ptr<RenderFrame> takeRenderFrame();
+    void startRenderPreparation();
+    void applyRenderFrame(RenderFrame& frame);
 
 private:
     MainWindow* m_mainWindow;
@@ -239,6 +283,14 @@ private:
     bool m_lockYAxisRanges {false};
     QVector<QPair<double,double>> m_fixedYRanges; // size 6, (min,max) per axis rect
 
+    // Background viewport preparation; frames of an older generation are dropped on arrival
+    QThreadPool m_renderPool;
+    quint64 m_renderGeneration {0};
+    bool m_renderInFlight {false};
+    bool m_renderPending {false}; // viewport changed while a frame was in flight
+    qint64 m_lastRenderNs[NumViewportChannels] {};
+    std::shared_ptr<RenderFrame> m_spareRenderFrame; // not in flight; reused by the next frame
+
     // Simple cached render state
     double m_lastViewportLower { std::numeric_limits<double>::infinity() };
     double m_lastViewportUpper { -std::numeric_limits<double>::infinity() };
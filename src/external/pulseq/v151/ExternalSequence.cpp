@@ -1,15 +1,20 @@
 #include "ExternalSequence.h"
+#include "SeqTextScan.h"
 #include "../../compat_bind.hpp"  // Compatibility for std::bind1st in C++17
 extern "C" {
     #include "md5.h"
 }
 
-#include <stdio.h>		// sscanf
+#include <stdio.h>		// sprintf
 #include <cstring>		// strlen etc
 #include <iomanip>		// std::setw etc
 
 #include <algorithm>	// for std::max_element
 #include <functional>	// for std::bind...
+#include <iterator>	// std::istreambuf_iterator
+#include <thread>		// std::thread for the concurrent section readers
+#include <type_traits>	// std::is_arithmetic for the snapshot fields
+#include <stdint.h>		// fixed-size snapshot fields
 
 #include <math.h>		// fabs etc
 
@@ -27,6 +32,42 @@ std::string& str_trim(std::string& str);
 std::string str_tolower(std::string str);
 double SeqBlock::s_blockDurationRaster = 10.0;
 
+// Texts smaller than this are read on the calling thread only
+static const std::size_t PARALLEL_MIN_BYTES = std::size_t(256) << 10;
+// Smallest piece of [SHAPES] or [BLOCKS] worth handing to a separate thread
+static const std::size_t MIN_CHUNK_BYTES = std::size_t(1) << 20;
+
+// Number of chunks to split a section of the given size into
+static int chunkCount(std::size_t bytes)
+{
+	const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	return (int)std::max<std::size_t>(1, std::min(threads, bytes / MIN_CHUNK_BYTES));
+}
+
+// Run the tasks on their own threads (the last one on the calling thread) and wait for all of them
+static void runTasks(std::vector<std::function<void()> >& tasks, bool parallel)
+{
+	std::vector<std::thread> workers;
+	if (parallel && tasks.size() > 1) {
+		workers.reserve(tasks.size()-1);
+		for (std::size_t i=0; i+1<tasks.size(); ++i)
+			workers.push_back(std::thread(tasks[i]));
+		tasks.back()();
+	}
+	else {
+		for (std::size_t i=0; i<tasks.size(); ++i)
+			tasks[i]();
+	}
+	for (std::size_t i=0; i<workers.size(); ++i)
+		workers[i].join();
+}
+
+// next line of a plain table section; the table ends at an empty line or the next section
+static inline bool nextTableLine(SeqLineReader& reader, SeqLine& line)
+{
+	return reader.next(line) && !line.empty() && line.first()!='[';
+}
+
 /***********************************************************/
 ExternalSequence::ExternalSequence()
 {
@@ -37,6 +78,8 @@ ExternalSequence::ExternalSequence()
 	version_combined=0;
 	m_bSignatureDefined=false;
 	m_bSignatureCheckSucceeded=false;
+	m_bSignatureCheck=true;
+	m_signedSize=0;
 }
 
 /***********************************************************/
@@ -45,6 +88,9 @@ ExternalSequence::~ExternalSequence(){}
 /***********************************************************/
 void ExternalSequence::print_msg(MessageType level, std::ostream& ss) {
 	if (MSG_LEVEL>=level) {
+		// sections are read on several threads during load()
+		static std::mutex printMutex;
+		std::lock_guard<std::mutex> lock(printMutex);
 #if defined(VXWORKS) || defined (BUILD_PLATFORM_LINUX)
 		// we skip messages on the scanner platforms due to performance limitations
 		// we could trivially use UTRACE on newer scanners, but it is not compatible with older platforms
@@ -72,12 +118,18 @@ void ExternalSequence::reset()
 	m_bSignatureCheckSucceeded=false;
 	// not on vb17 // m_strCalculatedMD5Signature.clear();
 	m_strCalculatedMD5Signature="";
+	m_signedSize=0;
 	m_definitions.clear();
 	m_definitions_str.clear();
 	m_extensionLibrary.clear();
 	m_extensionNameIDs.clear();
 	m_fileIndex.clear();
 	m_fileSections.clear();
+	{
+		std::unique_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+		m_decodedShapes.clear();
+		m_decodedTimeShapes.clear();
+	}
 	m_gradLibrary.clear();
 	m_labelincLibrary.clear();
 	m_labelsetLibrary.clear();
@@ -182,58 +234,81 @@ bool ExternalSequence::load_from_buffer(char * buffer)
 	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "Loading sequence from a text buffer");
 
 	// Try single file mode (everything in a single .seq file)
-	std::istringstream string_stream(buffer);
-	string_stream.seekg(0, std::ios::beg);
-	return load(string_stream);
+	return load_from_memory(buffer, strlen(buffer));
 }
 
 bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_singlefile*/)
+{
+	if (!data_stream.good())
+	{
+		if (loadMode == lm_singlefile)
+			reset();
+		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Function load() failed to read from the stream provided");
+		return false;
+	}
+
+	// The parser works on memory: pull the stream in once
+	std::string text((std::istreambuf_iterator<char>(data_stream)), std::istreambuf_iterator<char>());
+	return load_from_memory(text.data(), text.size(), loadMode);
+}
+
+bool ExternalSequence::load_from_memory(const char* data, std::size_t size, load_mode loadMode /*=lm_singlefile*/)
 {
 	if (loadMode == lm_singlefile)
 	{
 		reset();
 	}
 
-	if (!data_stream.good())
+	if (!data)
 	{
-		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Function load() failed to read from the stream provided");
+		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Function load() failed to read from the buffer provided");
 		return false;
 	}
 
-	char buffer[MAX_LINE_SIZE];
-	char tmpStr[MAX_LINE_SIZE];
-
 	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Building index" );
 
 	// Save locations of section tags
-	buildFileIndex(data_stream);
+	buildFileIndex(data, size);
+
+	// All sections are read in place: lines are views into 'data' and fields are
+	// converted without sscanf or intermediate copies
+	SeqLineReader reader(data, size);
+	SeqLine line;
+	// positions the reader at the first line of a section; false if the section is absent
+	auto seekSection = [&](const char* name) -> bool {
+		std::size_t offset;
+		if (!findSection(name, offset))
+			return false;
+		reader.seek(offset);
+		return true;
+	};
 
 	// Read version section
-	if (m_fileIndex.find("[VERSION]") != m_fileIndex.end()) {
+	if (seekSection("[VERSION]")) {
 		print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "decoding VERSION section");
 		// Version is a recommended but not a compulsory section
 		// very basic reading code, repeated keywords will overwrite previous values, no serious error checking
-		data_stream.seekg(m_fileIndex["[VERSION]"], std::ios::beg);
-		skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
-		while (data_stream.good() && buffer[0]!='[')
+		while (reader.nextContent(line, COMMENT_CHAR) && line.first()!='[')	// ignore comments & empty lines
 		{
-			//print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "buffer: \n" << buffer << std::endl );
-			if (0==strncmp(buffer,"major",5)) {
-				    if (1!=sscanf(buffer+5, "%d", &version_major)) {
+			if (line.startsWith("major")) {
+				SeqFieldScanner fields(SeqLine(line.begin+5, line.end));
+				if (!fields.readInt(version_major)) {
 					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_major");
 					return false;
 				}
 			    print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "major=" << version_major);		
-			} else if (0==strncmp(buffer,"minor",5)) {
-				if (1!=sscanf(buffer+5, "%d", &version_minor)) {
+			} else if (line.startsWith("minor")) {
+				SeqFieldScanner fields(SeqLine(line.begin+5, line.end));
+				if (!fields.readInt(version_minor)) {
 					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_minor");
 					return false;
 				}
 				print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "minor=" << version_minor);
 			}
-			else if (0==strncmp(buffer,"revision",8)) {
-				if (1!=sscanf(buffer+8, "%d", &version_revision)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_revision \n" << buffer << std::endl );
+			else if (line.startsWith("revision")) {
+				SeqFieldScanner fields(SeqLine(line.begin+8, line.end));
+				if (!fields.readInt(version_revision)) {
+					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode version_revision \n" << line.str() << std::endl );
 					return false;
 				}
 				print_msg(DEBUG_MEDIUM_LEVEL, std::ostringstream().flush() << "revision=" << version_revision);
@@ -243,8 +318,6 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 				print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown field in the [VERSION] block");
 				return false;
 			}
-			//getline(data_stream, buffer, MAX_LINE_SIZE);
-			skipComments(data_stream,buffer);			// load up some data and ignore comments & empty lines
 		}
 		version_combined=version_major*1000000L+version_minor*1000L+version_revision;
 	}
@@ -261,62 +334,82 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 	}
 	
 	// **********************************************************************************************************************
-	// ************************ READ SHAPES ***********************************
+	// ************************ READ SHAPES, EVENTS AND BLOCKS ***********************************
+
+	// The shape and event libraries and the block table are independent of each other while being
+	// read, so they are parsed concurrently: one task per event library section, while the two
+	// large sections, [SHAPES] and [BLOCKS], are split into line-aligned chunks whose results are
+	// merged in file order below. Block references are checked once all libraries are complete.
+	const bool readShapes = (loadMode == lm_singlefile || loadMode == lm_shapes);
+	const bool readEvents = (loadMode == lm_singlefile || loadMode == lm_events);
+	const bool readBlocks = (loadMode == lm_singlefile || loadMode == lm_blocks);
+	const bool parallel = size >= PARALLEL_MIN_BYTES;
+	std::vector<std::function<void()> > tasks;
+
+	std::size_t shapesOffset = 0;
+	const bool haveShapes = readShapes && findSection("[SHAPES]", shapesOffset);
+	std::vector<ShapeChunk> shapeChunks;
+	if (haveShapes) {
+		const std::size_t shapesEnd = sectionEnd(shapesOffset);
+		const std::vector<std::size_t> bounds = splitSection(data, shapesOffset, shapesEnd,
+			parallel ? chunkCount(shapesEnd-shapesOffset) : 1, "shape_id");
+		shapeChunks.resize(bounds.size()-1);
+		for (std::size_t c=0; c<shapeChunks.size(); ++c) {
+			ShapeChunk& chunk = shapeChunks[c];
+			chunk.begin = bounds[c];
+			chunk.end = bounds[c+1];
+			chunk.sectionEnded = false;
+			tasks.push_back([this, data, &chunk]() { readShapeChunk(data, chunk); });
+		}
+	}
+
+	bool eventsOk[5] = { true, true, true, true, true };
+	if (readEvents) {
+		tasks.push_back([this, data, size, &eventsOk]() { eventsOk[0] = readRFSection(data, size); });
+		tasks.push_back([this, data, size, &eventsOk]() { eventsOk[1] = readGradientSections(data, size); });
+		tasks.push_back([this, data, size, &eventsOk]() { eventsOk[2] = readADCSection(data, size); });
+		tasks.push_back([this, data, size, &eventsOk]() { eventsOk[3] = readDelaySection(data, size); });
+		tasks.push_back([this, data, size, &eventsOk]() { eventsOk[4] = readExtensionSection(data, size); });
+	}
+
+	std::size_t blocksOffset = 0;
+	const bool haveBlocks = readBlocks && findSection("[BLOCKS]", blocksOffset);
+	std::vector<BlockChunk> blockChunks;
+	if (haveBlocks) {
+		const std::size_t blocksEnd = sectionEnd(blocksOffset);
+		const std::vector<std::size_t> bounds = splitSection(data, blocksOffset, blocksEnd,
+			parallel ? chunkCount(blocksEnd-blocksOffset) : 1, NULL);
+		blockChunks.resize(bounds.size()-1);
+		for (std::size_t c=0; c<blockChunks.size(); ++c) {
+			BlockChunk& chunk = blockChunks[c];
+			chunk.begin = bounds[c];
+			chunk.end = bounds[c+1];
+			chunk.sectionEnded = false;
+			chunk.firstInvalid = std::size_t(-1);
+			tasks.push_back([this, data, &chunk]() { readBlockChunk(data, chunk); });
+		}
+	}
 
-	if (loadMode == lm_singlefile || loadMode == lm_shapes) 
+	runTasks(tasks, parallel);
+
+	if (readShapes)
 	{
-		// Read shapes section
+		// Merge the shape chunks
 		// ------------------------
 		m_shapeLibrary.clear();
-		if (m_fileIndex.find("[SHAPES]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[SHAPES]"], std::ios::beg);
-			skipComments(data_stream,buffer);			// Ignore comments & empty lines
-
-			int shapeId, numSamples;
-			float sample;
-
-			while (data_stream.good() && buffer[0]=='s')
-			{
-				if (2!=sscanf(buffer, "%s%d", tmpStr, &shapeId)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'shapeId'\n" << buffer << std::endl );
+		if (haveShapes) {
+			for (std::size_t c=0; c<shapeChunks.size(); ++c) {
+				ShapeChunk& chunk = shapeChunks[c];
+				if (!chunk.error.empty()) {
+					print_msg(ERROR_MSG, std::ostringstream().flush() << chunk.error);
 					return false;
 				}
-				getline(data_stream, buffer, MAX_LINE_SIZE);
-				if (2!=sscanf(buffer, "%s%d", tmpStr, &numSamples)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'numSamples'\n" << buffer << std::endl );
-					return false;
-				}
-
-				//print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Reading shape " << shapeId );
-
-				CompressedShape shape;
-				shape.samples.clear();
-				while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-					if (buffer[0]=='s' || strlen(buffer)==0) {
-						break;
-					}
-					if (1!=sscanf(buffer, "%f", &sample)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode 'sample'\n" << buffer << std::endl );
-						return false;
-					}
-					shape.samples.push_back(sample);
-				}
-				// number of samples equal to the data length is used as a non-compressed flag
-				// but only for v1.4.0 or above
-				if (version_combined >= 1004000 && numSamples==shape.samples.size())
-					shape.isCompressed=false;
-				else 
-					shape.isCompressed=true;
-				shape.numUncompressedSamples=numSamples;
-
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape index " << shapeId << " has " << shape.samples.size()
-					<< " compressed and " << shape.numUncompressedSamples << " uncompressed samples" );
-
-				m_shapeLibrary[shapeId] = shape;
-
-				skipComments(data_stream,buffer);			// Ignore comments & empty lines
+				for (std::size_t i=0; i<chunk.shapes.size(); ++i)
+					m_shapeLibrary[chunk.shapes[i].first] = std::move(chunk.shapes[i].second);
+				if (chunk.sectionEnded)
+					break;
 			}
-			data_stream.clear();	// In case EOF reached
+			shapeChunks.clear();
 
 			print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- SHAPES READ numShapes: " << m_shapeLibrary.size() );
 		}
@@ -326,396 +419,13 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 		}
 	}
 
-	// **********************************************************************************************************************
-	// ************************ READ EVENTS ********************
-	
-	if (loadMode == lm_singlefile || loadMode == lm_events) 
+	if (readEvents)
 	{
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading RF section");
-		// Read RF section
-		// ------------------------
-		if (m_fileIndex.find("[RF]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[RF]"], std::ios::beg);
-
-			int rfId;
-			m_rfLibrary.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				RFEvent event;
-				if (version_combined<1004000L)
-				{
-					// pre v1.4.0
-					if (7!=sscanf(buffer, "%d%f%d%d%d%f%f", &rfId, &(event.amplitude),
-								&(event.magShape),&(event.phaseShape), &(event.delay),
-								&(event.freqOffset), &(event.phaseOffset)
-								)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
-						return false;
-					}
-                    event.freqPPM=0.0;
-                    event.phasePPM = 0.0;
-                    event.timeShape = 0;
-					event.use='u'; // undefined use
-					event.center=-1.0; // mark as invalid
-				}
-				else if (version_combined < 1005000) 
-				{
-					// 1.4.0
-					if (8!=sscanf(buffer, "%d%f%d%d%d%d%f%f", &rfId, &(event.amplitude),
-								&(event.magShape), &(event.phaseShape), &(event.timeShape),
-								&(event.delay), &(event.freqOffset), &(event.phaseOffset)
-								)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
-						return false;
-					}
-                    event.freqPPM = 0.0;
-                    event.phasePPM = 0.0;
-                    event.use       = 'u';  // undefined use
-					event.center=-1.0; // mark as invalid
-				}
-				else 
-				{
-					// 1.5.0
-					if (12!=sscanf(buffer, "%d%f%d%d%d%f%d%f%f%f%f %c", &rfId, &(event.amplitude),
-								&(event.magShape),&(event.phaseShape), &(event.timeShape), &(event.center),
-								&(event.delay), &(event.freqPPM), &(event.phasePPM), &(event.freqOffset), &(event.phaseOffset), &(event.use)
-								)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				m_rfLibrary[rfId] = event;
-                ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "m_rfLibrary["<<rfId<<"].use="<<event.use);
-			}
-		}
-		
-		// Read *arbitrary* gradient section
-		// -------------------------------
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading arbitrary gradient section");
-		m_gradLibrary.clear();
-		if (m_fileIndex.find("[GRADIENTS]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[GRADIENTS]"], std::ios::beg);
-
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "got line: " << buffer);
-				int gradId;
-				GradEvent event;
-				if ( version_combined>=1005000L )
-				{
-					// v1.5.0
-					if (7!=sscanf(buffer, "%d%f%f%f%d%d%d", &gradId, &(event.amplitude), &(event.first), &(event.last), &(event.waveShape), &(event.timeShape), &(event.delay))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.4.x gradient event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				else if ( version_combined>=1004000L )
-				{
-					// v1.4.0
-					if (5!=sscanf(buffer, "%d%f%d%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.timeShape), &(event.delay))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.4.x gradient event\n" << buffer << std::endl );
-						return false;
-					}
-					event.first=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
-					event.last=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
-				}
-				else
-				{
-					// pre v1.4.0
-					event.timeShape=0;
-					if (4!=sscanf(buffer, "%d%f%d%d", &gradId, &(event.amplitude), &(event.waveShape), &(event.delay))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.2.x gradient event\n" << buffer << std::endl );
-						return false;
-					}
-					event.first=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
-					event.last=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
-				}
-				print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "assigning the event to the library under the ID " << gradId);
-				m_gradLibrary[gradId] = event;
-				print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "done");
-			}
-		}
-
-		// Read *trapezoid* gradient section
-		// -------------------------------
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading trapezoids section");
-		if (m_fileIndex.find("[TRAP]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[TRAP]"], std::ios::beg);
-
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				int gradId;
-				GradEvent event;
-				if (6!=sscanf(buffer, "%d%f%ld%ld%ld%d", &gradId, &(event.amplitude),
-					&(event.rampUpTime),&(event.flatTime),&(event.rampDownTime),&(event.delay))) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trapezoid gradient entry" << buffer << std::endl );
-					return false;
-				}					
-				event.waveShape=0;
-				event.timeShape=0;
-				m_gradLibrary[gradId] = event;
-			}
-		}
-
-		// Sort gradients based on index
-		// -----------------------------
-		//std::sort(m_gradLibrary.begin(),m_gradLibrary.end(),compareGradEvents);
-
-		// Read ADC section
-		// -------------------------------
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading ADC section");
-		if (m_fileIndex.find("[ADC]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[ADC]"], std::ios::beg);
-
-			int adcId;
-			m_adcLibrary.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				ADCEvent event;
-				if ( version_combined>=1005000L )
-				{
-					// v1.5.0
-					if (9!=sscanf(buffer, "%d%d%d%d%f%f%f%f%d", &adcId, &(event.numSamples),
-								&(event.dwellTime),&(event.delay),&(event.freqPPM),&(event.phasePPM),&(event.freqOffset),&(event.phaseOffset),&(event.phaseModulationShape))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode ADC event\n" << buffer << std::endl );
-						return false;
-					}
-				}
-				else
-				{
-					// v1.4.0 and older
-					if (6!=sscanf(buffer, "%d%d%d%d%f%f", &adcId, &(event.numSamples),
-								&(event.dwellTime),&(event.delay),&(event.freqOffset),&(event.phaseOffset))) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode ADC event\n" << buffer << std::endl );
-						return false;
-					}
-                    event.freqPPM=0.0; // no ppmOffset in older formats
-                    event.phasePPM= 0.0; 
-					event.phaseModulationShape=0; // no phase modulation shape provided 
-				}
-				
-				m_adcLibrary[adcId] = event;
-			}
-		}
-
-		// Read delays section (comatibility with Pulseq version prior to 1.4.0)
-		// ---------------------------------------------------------------------
-		//std::map<int,long> tmpDelayLibrary;
-		m_tmpDelayLibrary.clear();
-		if (m_fileIndex.find("[DELAYS]") != m_fileIndex.end()) {
-			print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading DELAYS section (compatibility)");
-			data_stream.seekg(m_fileIndex["[DELAYS]"], std::ios::beg);
-
-			int delayId;
-			long delay;
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				if (2!=sscanf(buffer, "%d%ld", &delayId, &delay)) {
-					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode delay event\n" << buffer << std::endl );
-					return false;
-				}
-				m_tmpDelayLibrary[delayId] = delay;
-			}
-		}
-
-		// Read extensions section
-		// -------------------------------
-		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading and processing extensions");
-		m_extensionLibrary.clear();
-		m_extensionNameIDs.clear();
-		m_triggerLibrary.clear(); // clear also all known extension libraries
-		m_labelsetLibrary.clear();
-		m_labelincLibrary.clear();
-		std::map<std::string,int>::iterator itFI = m_fileIndex.find("[EXTENSIONS]");
-		if ( itFI != m_fileIndex.end()) {
-			data_stream.seekg(itFI->second, std::ios::beg);
-			std::set<int>::iterator itSFI = m_fileSections.find(itFI->second);
-			if ( itSFI==m_fileSections.end() ||
-				 (++itSFI)==m_fileSections.end() )
-			{
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed find the end of the section while reading EXTENSIONS");
+		for (int i=0; i<5; ++i) {
+			if (!eventsOk[i])
 				return false;
-			}
-			int sectionEnd = *itSFI;
-			// we first read in the extension list
-			int nID;
-			int nExtensionID=EXT_LIST; // EXT_LIST means we are reading the extension list
-			while ( data_stream.tellg()<sectionEnd &&
-					getline(data_stream, buffer, MAX_LINE_SIZE)) 
-			{
-				if (buffer[0]=='#' || buffer[0]=='[' || strlen(buffer)==0) {
-					continue;
-				}
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "input line: " << buffer);
-				if (0==strncmp(buffer,"extension",9)) {
-					// read new extension ID from the header
-					char szStrID[MAX_LINE_SIZE];
-					int nInternalID=0;
-					int nKnownID=EXT_UNKNOWN;
-					if (2!=sscanf(buffer, "extension %s %d", szStrID, &nInternalID)) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension header entry\n" << buffer << std::endl );
-						return false;
-					}
-					// here is the list of extensions we currently recognize
-					if (0==strcmp("TRIGGERS",szStrID))
-						nKnownID=EXT_TRIGGER;
-					else if (0==strcmp("ROTATIONS",szStrID))
-						nKnownID=EXT_ROTATION;
-					else if (0==strcmp("LABELSET",szStrID))
-						nKnownID=EXT_LABELSET;
-					else if (0==strcmp("LABELINC",szStrID))
-						nKnownID=EXT_LABELINC;
-					else if (0==strcmp("DELAYS",szStrID))
-						nKnownID=EXT_DELAY;
-					else if (0==strcmp("RF_SHIMS",szStrID))
-						nKnownID=EXT_RF_SHIM;
-					if (nKnownID!=EXT_UNKNOWN)
-						m_extensionNameIDs[nInternalID]=std::make_pair(std::string(szStrID),nKnownID);
-					else {
-						print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown extension ignored\n" << buffer << std::endl );
-					}
-					nExtensionID=nKnownID;
-				}
-				else
-				{
-					ExtensionListEntry extEntry;
-					TriggerEvent trigger;
-					RotationEvent rotation;
-					SoftDelayEvent delay;
-                    RfShimmingEvent rfShim;
-					int  nVal;					   // read label set/inc values from label set/inc extension
-					int  nRet;                     // conversion result / return value
-					char szLabelID[MAX_LINE_SIZE]; // read labels strings from label set/inc extension
-					LabelEvent	label;			   // write label event
-					switch (nExtensionID) {
-						case EXT_LIST: 
-							if (4!=sscanf(buffer, "%d%d%d%ld", &nID, &(extEntry.type), &(extEntry.ref), &(extEntry.next))) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension list entry\n" << buffer << std::endl );
-								return false;
-							}
-							print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoding extension list entry " << buffer);
-							m_extensionLibrary[nID] = extEntry;
-							print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "nID:" << nID << " type:" << extEntry.type << " ref" << extEntry.ref << " next:" << extEntry.next);
-							break;
-						case EXT_TRIGGER: 
-							if (5!=sscanf(buffer, "%d%d%d%ld%ld", &nID, &(trigger.triggerType), &(trigger.triggerChannel), &(trigger.delay), &(trigger.duration))) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trigger event\n" << buffer << std::endl );
-								return false;
-							}
-							m_triggerLibrary[nID] = trigger;
-							break;
-						case EXT_ROTATION: 
-							if (5!=sscanf(buffer, "%d%lf%lf%lf%lf", &nID, &rotation.rotQuaternion[0], &rotation.rotQuaternion[1], &rotation.rotQuaternion[2], &rotation.rotQuaternion[3])) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode rotation event\n" << buffer << std::endl );
-                                return false;
-							}
-                            {
-								double dNorm=sqrt(rotation.rotQuaternion[0]*rotation.rotQuaternion[0]+rotation.rotQuaternion[1]*rotation.rotQuaternion[1]+rotation.rotQuaternion[2]*rotation.rotQuaternion[2]+rotation.rotQuaternion[3]*rotation.rotQuaternion[3]);
-                                if (fabs(dNorm-1.0)>1e-3) {
-									print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: rotation extension loaded a non-normalized quaternion " << buffer << std::endl );
-									return false;
-								}
-								for (int i = 0; i < 4; ++i)
-                                    rotation.rotQuaternion[i] /= dNorm; 
-                            }
-							rotation.defined=true;
-							m_rotationLibrary[nID] = rotation; 
-							break;
-						case EXT_LABELSET: 
-							if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to load labelset event\n" << buffer << std::endl );
-								return false;
-							}
-							nRet = decodeLabel(EXT_LABELSET,nVal,szLabelID,label);
-							if (nRet<0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelset event\n" << buffer << std::endl );
-								return false;
-							}else if(nRet>0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** decoding labelset event returned 0\n" << buffer << std::endl );
-							} 
-							m_labelsetLibrary[nID] = label;
-							break;
-						case EXT_LABELINC: 
-							if (3!=sscanf(buffer, "%d%d%s", &nID, &nVal, szLabelID)) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
-								return false;
-							}
-							nRet = decodeLabel(EXT_LABELINC,nVal,szLabelID,label);
-							if (nRet<0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << buffer << std::endl );
-								return false;
-							}else if(nRet>0) {
-								print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: decoding labelinc event returnd 0\n" << buffer << std::endl );
-							}
+		}
 
-							m_labelincLibrary[nID] = label;
-							break;
-						case EXT_DELAY: 
-							{
-								int n=0;
-								if (4!=sscanf(buffer, "%d%d%d%d%n", &nID, &(delay.numID), &(delay.offset), &(delay.factor), &n)) {
-									print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode soft delay event\n" << buffer << std::endl );
-									return false;
-								}
-								strncpy(delay.hint,stripWhiteSpace(buffer+n),SOFT_DELAY_HINT_LENGTH);
-								delay.hint[SOFT_DELAY_HINT_LENGTH-1]=0;
-								print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoded soft delay " << delay.numID << " with the hint:" << delay.hint);
-								m_softDelayLibrary[nID] = delay;
-							}
-							break;
-                        case EXT_RF_SHIM:
-                            {
-								int nPos=0; 
-								if (2!= sscanf(buffer, "%d%d%n", &rfShim.id, &(rfShim.nchan), &(nPos)))
-                                {
-                                    print_msg(
-                                        ERROR_MSG,
-                                        std::ostringstream().flush() << "*** ERROR: failed to decode RF shim event\n"
-                                                                     << buffer << std::endl);
-                                    return false;
-                                }
-								print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoded initial part of the RF shim event, id:" << rfShim.id << " nChan:" << rfShim.nchan << " curren position:" << nPos);
-								rfShim.amplitudes.reserve(rfShim.nchan);
-								rfShim.phases.reserve(rfShim.nchan);
-								int n=nPos;
-								for (int i=0;i<rfShim.nchan; ++i) 
-								{
-									float fa,fp;
-									if (2!= sscanf(buffer+n, "%f%f%n", &(fa), &(fp), &(nPos)))
-									{
-										print_msg(
-											ERROR_MSG,
-											std::ostringstream().flush() << "*** ERROR: failed to decode RF shim event for channel " << i << " in\n"
-																		 << buffer << std::endl);
-										return false;
-									}
-									print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoded a further part of the RF shim event, fa:" << fa << " fp:" << fp << " curren position:" << n+nPos);
-									rfShim.amplitudes.push_back(fa);
-									rfShim.phases.push_back(fp);								
-									n+=nPos;
-								}
-								print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "finished decoding RF shim event");
-                                m_rfShimLibrary[rfShim.id] = rfShim;
-                            }
-                            break;
-						case EXT_UNKNOWN:
-							print_msg(WARNING_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode unknown extension event\n" << buffer << std::endl );
-							break; // just ignore unknown extensions
-					}
-				}
-			}
-		}		
-		
 		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- EVENTS READ: "
 			<<" RF: " << m_rfLibrary.size()
 			<<" GRAD: " << m_gradLibrary.size()
@@ -731,57 +441,29 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 		
 		// Read definition section
 		// ------------------------
-		if (m_fileIndex.find("[DEFINITIONS]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[DEFINITIONS]"], std::ios::beg);
-
+		if (seekSection("[DEFINITIONS]")) {
 			// Read each definition line
 			m_definitions.clear();
 			m_definitions_str.clear();
-			int retgl=0;
-			while (retgl=getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				// this was not compatible with Numaris4 VB line (MSVC6)
-				/*std::istringstream ss(buffer);
-				while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the stream/buffer
-					retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
-					ss.str(ss.str()+buffer); 
-				}*/
-				// stupid compatible code
-				std::string stmp(buffer);
-				while(retgl==gl_truncated) { // if the line was truncated read in the rest of it into the temporary string
-					retgl=getline(data_stream, buffer, MAX_LINE_SIZE);
-					stmp+=buffer;
-				}
-				char* tmp_buff1= new char[stmp.length()+1]; // old compilers like MSVC6 require such stupid conversions
-				strcpy(tmp_buff1,stmp.c_str());
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- reading definitions, tmp_buff1=`"<<tmp_buff1<<"'"<<std::endl);
-				std::istringstream ss(tmp_buff1);
-				// delete [] tmp_buff1; // moved few lines below
-				// end of stupid compatible code (except for the delete line below)
-				std::string key;
-				ss >> key;
-				std::string str_value;
-				if (std::getline(ss,str_value)) {
-					str_value = str_trim(str_value);
-					m_definitions_str[key] = str_value; 
-					// old compilers like MSVC6 require such stupid conversions
-					char* tmp_buff2= new char[str_value.length()+1];
-					strcpy(tmp_buff2,str_value.c_str());
-					print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- reading definitions(2), tmp_buff2=`"<<tmp_buff2<<"'"<<std::endl);
-					std::istringstream ssv(tmp_buff2);
-					double value;
-					std::vector<double> values;
-					while (ssv >> value) {
-						//print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "v["<<values.size()<<"]="<<value);
-						values.push_back(value);
-					}
-					delete [] tmp_buff2;
-					m_definitions[key] = values;
+			while (nextTableLine(reader, line)) {
+				SeqFieldScanner fields(line);
+				SeqLine key;
+				if (!fields.readWord(key))
+					continue;
+				// a key without anything after it is not a definition
+				if (key.end==line.end)
+					continue;
+				const SeqLine valueText = fields.rest();
+				const std::string strKey = key.str();
+				m_definitions_str[strKey] = valueText.str();
+				// numeric view: leading run of numbers, as many as parse
+				SeqFieldScanner valueFields(valueText);
+				double value;
+				std::vector<double> values;
+				while (valueFields.readDouble(value)) {
+					values.push_back(value);
 				}
-				// this 'delete' should be here because some compilers pass the buffer by reference
-				delete [] tmp_buff1;
+				m_definitions[strKey] = values;
 			}
 
 			std::ostringstream out;
@@ -879,49 +561,54 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 		// Read blocks section
 		// ------------------------
-		if (m_fileIndex.find("[BLOCKS]") == m_fileIndex.end()) {
+		if (!haveBlocks) {
 			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Required: [BLOCKS] section");
 			return false;
 		}
-		data_stream.seekg(m_fileIndex["[BLOCKS]"], std::ios::beg);
 
-		int blockIdx;
-		EventIDs events;
+		// Check the event references of every chunk now that the libraries are complete
+		tasks.clear();
+		for (std::size_t c=0; c<blockChunks.size(); ++c) {
+			BlockChunk& chunk = blockChunks[c];
+			tasks.push_back([this, &chunk]() {
+				for (std::size_t i=0; i<chunk.blocks.size(); ++i) {
+					if (!checkBlockReferences(chunk.blocks[i])) {
+						chunk.firstInvalid = i;
+						break;
+					}
+				}
+			});
+		}
+		runTasks(tasks, parallel);
 
-		// Read blocks
+		// Merge the block chunks
+		std::size_t totalBlocks = 0;
+		for (std::size_t c=0; c<blockChunks.size(); ++c)
+			totalBlocks += blockChunks[c].blocks.size();
 		m_blocks.clear();
-		while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-			if (buffer[0]=='[' || strlen(buffer)==0) {
-				break;
-			}
-
-			memset(events.id, 0, NUM_EVENTS*sizeof(int));
-			long dur_ru =0;
-
-			int ret=sscanf(buffer, "%d%d%d%d%d%d%d%d", &blockIdx,
-					&dur_ru,                                        // block duration
-					&events.id[RF],                                 // RF
-					&events.id[GX],&events.id[GY],&events.id[GZ],   // Gradients
-					&events.id[ADC],                                // ADCs
-					&events.id[EXT]                                 // Extensions
-					);
-			if (7>ret
-					) {
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode event table entry:\n" << buffer << std::endl );
-						print_msg(ERROR_MSG, std::ostringstream().flush() << "***        number of fields read: " << ret << std::endl );
-				return false;
-			}
-
-			if (!checkBlockReferences(events)) {
-				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Block " << blockIdx
+		m_blockDurations_ru.clear();
+		m_blocks.reserve(totalBlocks);
+		m_blockDurations_ru.reserve(totalBlocks);
+		for (std::size_t c=0; c<blockChunks.size(); ++c) {
+			const BlockChunk& chunk = blockChunks[c];
+			if (chunk.firstInvalid != std::size_t(-1)) {
+				const EventIDs& events = chunk.blocks[chunk.firstInvalid];
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: Block " << m_blocks.size()+chunk.firstInvalid+1
 					<< " contains references to undefined events" );
 				print_msg(ERROR_MSG, std::ostringstream().flush() << "***        RF:" << events.id[RF] << " GX:" << events.id[GX] << " GY:" << events.id[GY] << " GZ:" << events.id[GZ] << " ADC:" << events.id[ADC] << " EXT:" << events.id[EXT]);
 				return false;
 			}
+			if (!chunk.error.empty()) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << chunk.error);
+				return false;
+			}
 			// Add event IDs to list of blocks
-			m_blocks.push_back(events);
-			m_blockDurations_ru.push_back(dur_ru); // ATTENTION, for versions prior to 1.4.0 this will contain delayIDs, we fix it below
+			m_blocks.insert(m_blocks.end(), chunk.blocks.begin(), chunk.blocks.end());
+			m_blockDurations_ru.insert(m_blockDurations_ru.end(), chunk.durations.begin(), chunk.durations.end()); // ATTENTION, for versions prior to 1.4.0 this will contain delayIDs, we fix it below
+			if (chunk.sectionEnded)
+				break;
 		}
+		blockChunks.clear();
 
 		print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- BLOCKS READ: " << m_blocks.size());
 		// Num_Blocks definition (if defined) is used to check the correct number of blocks are read
@@ -934,24 +621,16 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Reading signature...");
 		// Read signature section
 		// ------------------------
-		if (m_fileIndex.find("[SIGNATURE]") != m_fileIndex.end()) {
-			data_stream.seekg(m_fileIndex["[SIGNATURE]"], std::ios::beg);
-
+		if (seekSection("[SIGNATURE]")) {
 			// Read each signature line
 			m_signatureMap.clear();
-			while (getline(data_stream, buffer, MAX_LINE_SIZE)) {
-				if (buffer[0]=='[' || strlen(buffer)==0) {
-					break;
-				}
-				if (buffer[0]=='#')
+			while (nextTableLine(reader, line)) {
+				if (line.first()=='#')
 					continue;
-				std::istringstream ss(buffer);
-				std::string key;
-				ss >> key;
-				std::string str_value;
-				if (std::getline(ss,str_value)) {
-					str_value = str_trim(str_value);
-					m_signatureMap[key] = str_value; // old compilers like MSVC6 require such stupid conversions
+				SeqFieldScanner fields(line);
+				SeqLine key;
+				if (fields.readWord(key) && key.end!=line.end) {
+					m_signatureMap[key.str()] = fields.rest().str();
 				}
 			}
 
@@ -972,31 +651,21 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "--- Finished reading signature");
 
-		m_bSignatureCheckSucceeded=false;
-		if (!m_bSignatureDefined) {
-			print_msg(NORMAL_MSG, std::ostringstream().flush() << "signature block not found");
-		}
+		if (m_bSignatureCheck)
+			checkSignature();
 		else
-		{
-			if (m_strSignatureType!="md5") {
-				print_msg(NORMAL_MSG, std::ostringstream().flush() << "signature validation is not supported for " << m_strSignatureType);
-			}
-			else {
-				m_bSignatureCheckSucceeded=(m_strSignature==m_strCalculatedMD5Signature);
-				if (!m_bSignatureCheckSucceeded){
-					print_msg(WARNING_MSG, std::ostringstream().flush() << "WARNING: signature validation failed! stored signature: " << m_strSignature << "; calculated hash: " << m_strCalculatedMD5Signature);
-				}
-			}
-		}
+			m_bSignatureCheckSucceeded=false;
 
 		if (version_combined<1004000L) 
 		{
 			print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "-- converting blocks from version " << version_combined);
 			// we need to calculate dutation of every block and save it in m_blockDurations_ru
 
+			SeqBlock blockStorage; // refilled for every block
 			for (int b=0; b<m_blocks.size(); ++b) 
 			{
-				SeqBlock* block=GetBlock(b);
+				SeqBlock* block=&blockStorage;
+				GetBlock(b, block);
 				// Calculate duration of block
 				long duration = 0;
 				// special processing of the delay objects (which are now eliminated)
@@ -1034,8 +703,6 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 					TriggerEvent &trigger = block->GetTriggerEvent();
 					duration = MAX(duration, trigger.delay+trigger.duration );
 				}
-				// clean up memory
-				delete block;
 				// convert duration to raster units and store it
 				m_blockDurations_ru[b]=ceil(duration/SeqBlock::s_blockDurationRaster - 1e-12);
 				// sanity check
@@ -1058,115 +725,1201 @@ bool ExternalSequence::load(std::istream& data_stream, load_mode loadMode /*=lm_
 
 
 /***********************************************************/
-void ExternalSequence::skipComments(std::istream &fileStream, char *buffer)
+// End of the signed text given the offset of the [SIGNATURE] line: the empty line right
+// before [SIGNATURE] belongs to the signature
+static std::size_t signedEnd(const char* data, std::size_t hashEnd)
 {
-	while (getline(fileStream, buffer, MAX_LINE_SIZE)) {
-		if (buffer[0]!=COMMENT_CHAR && strlen(buffer)>0) {
-			break;
+	if (hashEnd >= 1 && data[hashEnd-1]=='\n' && (hashEnd == 1 || data[hashEnd-2]=='\n'))
+		hashEnd -= 1;
+	else if (hashEnd >= 2 && data[hashEnd-2]=='\r' && data[hashEnd-1]=='\n' && (hashEnd == 2 || data[hashEnd-3]=='\n'))
+		hashEnd -= 2;
+	return hashEnd;
+}
+
+/***********************************************************/
+void ExternalSequence::buildFileIndex(const char* data, std::size_t size)
+{
+	// One pass over the raw lines: record where each section's content starts and where
+	// [SIGNATURE] begins, as everything before it is covered by the MD5 hash
+	std::size_t hashEnd = size;
+	bool bSignatureSectionFound = false;
+	std::size_t pos = 0;
+	while (pos < size) {
+		const char* lineStart = data + pos;
+		const char* eol = (const char*)memchr(lineStart, '\n', size - pos);
+		const std::size_t next = eol ? std::size_t(eol - data) + 1 : size;
+		if (lineStart[0]=='[') {
+			const char* pBr = (const char*)memchr(lineStart + 1, ']', (data + next) - (lineStart + 1));
+			if (pBr) {
+				std::string section(lineStart, pBr - lineStart + 1);
+				m_fileIndex[section] = next;
+				m_fileSections.insert(next);
+				if (!bSignatureSectionFound && section == "[SIGNATURE]") {
+					bSignatureSectionFound = true;
+					hashEnd = pos;
+				}
+			}
 		}
+		pos = next;
 	}
-};
+	m_fileSections.insert(size); // add the end-of-file
 
+	if (bSignatureSectionFound)
+		hashEnd = signedEnd(data, hashEnd);
 
-/***********************************************************/
-char* ExternalSequence::stripWhiteSpace(char *buffer)
-{
-	while (*buffer && (*buffer==' ' || *buffer=='\t')) 
-		buffer+=1;
-	int n=strlen(buffer);
-	while (n>0 && (buffer[n]==' ' || buffer[n]=='\t' || buffer[n]=='\r' || buffer[n]=='\n')) {
-		buffer[n]=0;
-		n-=1;
+	m_signedSize = hashEnd;
+	if (m_bSignatureCheck) {
+		m_strCalculatedMD5Signature = CalculateMD5(data, hashEnd);
+		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "calculated md5 hash of the current pulseq file is: " << m_strCalculatedMD5Signature);
 	}
-	return buffer;
 };
 
+/***********************************************************/
+bool ExternalSequence::FindSignedSize(const char* data, std::size_t size, std::size_t& signedSize)
+{
+	// Same line rule as buildFileIndex(), without indexing the other sections
+	std::size_t pos = 0;
+	while (pos < size) {
+		const char* lineStart = data + pos;
+		const char* eol = (const char*)memchr(lineStart, '\n', size - pos);
+		const std::size_t next = eol ? std::size_t(eol - data) + 1 : size;
+		static const char SIGNATURE_SECTION[] = "[SIGNATURE]";
+		const std::size_t n = sizeof(SIGNATURE_SECTION) - 1;
+		if (lineStart[0]=='[' && next - pos >= n && memcmp(lineStart, SIGNATURE_SECTION, n)==0) {
+			signedSize = signedEnd(data, pos);
+			return true;
+		}
+		pos = next;
+	}
+	return false;
+}
 
 /***********************************************************/
-void ExternalSequence::buildFileIndex(std::istream &fileStream)
+std::string ExternalSequence::CalculateMD5(const char* data, std::size_t size, const std::function<bool()>& cancelled)
 {
-	char buffer[MAX_LINE_SIZE];
-    char* pBr;
+	static const std::size_t CHUNK_SIZE = std::size_t(16) << 20;
     struct MD5Context mdc;
     unsigned char dg[16];
     MD5Init(&mdc);
-    bool bSignatureSectionFound = false;
-    std::string strippedLine;
-    		
-	while (getline(fileStream, buffer, MAX_LINE_SIZE, true)) {		
-		//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "buildFileIndex(): read line: [" << line << "]");
-		if (buffer[0]=='[' ) {
-            //print_msg(NORMAL_MSG, std::ostringstream().flush() << "opening bracket found in " << buffer);
-            pBr=strchr(buffer+1,']');
-			if (pBr) {
-                std::string line  = std::string(buffer, pBr - buffer + 1);
-                //print_msg(NORMAL_MSG, std::ostringstream().flush() << "closing bracket found, line " << line);
-                m_fileIndex[line] = fileStream.tellg();
-                m_fileSections.insert(fileStream.tellg());
-                if (line == "[SIGNATURE]") {
-                    bSignatureSectionFound = true;
-                    // not on vb17 // strippedLine.clear();
-					strippedLine="";
-					//print_msg(NORMAL_MSG, std::ostringstream().flush() << "signature block found");
-				}
-			}
-		}
-        if (!bSignatureSectionFound) {
-            if (!strippedLine.empty())
-                MD5Update(&mdc, (unsigned char*)strippedLine.c_str(), strippedLine.length());
-            if (0==strcmp(buffer, "\n") || 0==strcmp(buffer, "\r\n"))
-                strippedLine = buffer;
-			else {
-                MD5Update(&mdc, (unsigned char*)buffer, strlen(buffer));
-                // not on vb17 // strippedLine.clear();
-				strippedLine="";
-			}
-		}			
+	for (std::size_t done = 0; done < size; ) {
+		if (cancelled && cancelled())
+			return std::string();
+		const unsigned chunk = (unsigned)std::min<std::size_t>(size - done, CHUNK_SIZE);
+		MD5Update(&mdc, (const unsigned char*)data + done, chunk);
+		done += chunk;
 	}
-	m_fileSections.insert(fileStream.tellg()); // add the end-of-file (+1?)
-	fileStream.clear();		// reset EOF flag
-	fileStream.seekg(0, std::ios::beg);
-    if (!strippedLine.empty())
-        MD5Update(&mdc, (unsigned char*)strippedLine.c_str(), strippedLine.length());
     // finalize the MD5 hash calculation
 	MD5Final(dg, &mdc);
     char hash[33];
     sprintf(hash,"%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x",dg[0],dg[1],dg[2],dg[3],dg[4],dg[5],dg[6],dg[7],dg[8],dg[9],dg[10],dg[11],dg[12],dg[13],dg[14],dg[15]);
-    print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "calculated md5 hash of the current pulseq file is: " << hash);
-	m_strCalculatedMD5Signature=hash;    
-};
+	return hash;
+}
 
+/***********************************************************/
+bool ExternalSequence::SetCalculatedSignature(const std::string& hash)
+{
+	m_strCalculatedMD5Signature = hash;
+	checkSignature();
+	return isSignatureCheckSucceeded();
+}
 
-std::vector<std::string> ExternalSequence::GetAllDefinitions()
+/***********************************************************/
+void ExternalSequence::checkSignature()
 {
-    assert(m_definitions_str.size() == m_definitions.size());
-    int n = m_definitions_str.size();
-    std::vector<std::string> keys(n);
-    std::map<std::string, std::string>::iterator it = m_definitions_str.begin();
-    for (int i = 0; i < n; ++i)
-    {
-        keys[i] = it->first;
-        ++it;
+	m_bSignatureCheckSucceeded=false;
+	if (!m_bSignatureDefined) {
+		print_msg(NORMAL_MSG, std::ostringstream().flush() << "signature block not found");
+	}
+	else
+	{
+		if (m_strSignatureType!="md5") {
+			print_msg(NORMAL_MSG, std::ostringstream().flush() << "signature validation is not supported for " << m_strSignatureType);
+		}
+		else {
+			m_bSignatureCheckSucceeded=(m_strSignature==m_strCalculatedMD5Signature);
+			if (!m_bSignatureCheckSucceeded){
+				print_msg(WARNING_MSG, std::ostringstream().flush() << "WARNING: signature validation failed! stored signature: " << m_strSignature << "; calculated hash: " << m_strCalculatedMD5Signature);
+			}
+		}
 	}
-    return keys;
 }
 
 /***********************************************************/
-SeqBlock*	ExternalSequence::GetBlock(int index) {
-	SeqBlock *block = new SeqBlock();
+bool ExternalSequence::findSection(const char* name, std::size_t& offset) const
+{
+	std::map<std::string,std::size_t>::const_iterator it = m_fileIndex.find(name);
+	if (it == m_fileIndex.end())
+		return false;
+	offset = it->second;
+	return true;
+}
 
-	// Copy event IDs
-	EventIDs events = m_blocks[index];
-	std::copy(events.id,events.id+NUM_EVENTS,&block->events[0]);
+/***********************************************************/
+std::size_t ExternalSequence::sectionEnd(std::size_t offset) const
+{
+	// the content of the next section (or the end of the file) bounds this one
+	std::set<std::size_t>::const_iterator it = m_fileSections.upper_bound(offset);
+	return it != m_fileSections.end() ? *it : offset;
+}
 
-	//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "GetBlock(" << index << ") : [ " << events.id[0] << " " << events.id[1] << " " << events.id[2] << " " << events.id[3] << " " << events.id[4] << " " << events.id[5] << " " << events.id[6] << "  ]");
+/***********************************************************/
+std::vector<std::size_t> ExternalSequence::splitSection(const char* data, std::size_t begin, std::size_t end, int numChunks, const char* linePrefix)
+{
+	std::vector<std::size_t> bounds(1, begin);
+	const std::size_t prefixLength = linePrefix ? strlen(linePrefix) : 0;
+	bool done = false;
+	for (int k=1; k<numChunks && !done; ++k) {
+		std::size_t pos = std::max(begin + (end-begin)/numChunks*k, bounds.back());
+		for (;;) {
+			// move to the start of the next line
+			while (pos<end && data[pos]!='\n' && data[pos]!='\r')
+				++pos;
+			if (pos+1<end && data[pos]=='\r' && data[pos+1]=='\n')
+				++pos;
+			if (pos<end)
+				++pos;
+			if (pos>=end || data[pos]=='[') {
+				done = true;
+				break;
+			}
+			if (!linePrefix || (end-pos>=prefixLength && 0==memcmp(data+pos, linePrefix, prefixLength))) {
+				bounds.push_back(pos);
+				break;
+			}
+		}
+	}
+	bounds.push_back(end);
+	return bounds;
+}
 
-	// Set some defaults
-	block->index = index;
-	block->duration_ru = m_blockDurations_ru[index];
-	block->adc.numSamples = 0;
-	block->trigger.triggerType=0;
-	block->trigger.triggerChannel=0;
+/***********************************************************/
+void ExternalSequence::readShapeChunk(const char* data, ShapeChunk& chunk) const
+{
+	SeqLineReader reader(data, chunk.end);
+	reader.seek(chunk.begin);
+	SeqLine line;
+	bool haveLine = reader.nextContent(line, COMMENT_CHAR);	// Ignore comments & empty lines
+
+	int shapeId, numSamples;
+	float sample;
+	SeqLine word;
+	std::ostringstream error;
+
+	while (haveLine && line.first()=='s')
+	{
+		SeqFieldScanner idFields(line);
+		if (!idFields.readWord(word) || !idFields.readInt(shapeId)) {
+			error << "*** ERROR: failed to decode 'shapeId'\n" << line.str() << std::endl;
+			chunk.error = error.str();
+			return;
+		}
+		if (!reader.next(line)) line = SeqLine();
+		SeqFieldScanner countFields(line);
+		if (!countFields.readWord(word) || !countFields.readInt(numSamples)) {
+			error << "*** ERROR: failed to decode 'numSamples'\n" << line.str() << std::endl;
+			chunk.error = error.str();
+			return;
+		}
+
+		CompressedShape shape;
+		bool nextShapeLine = false;
+		while (reader.next(line)) {
+			if (line.first()=='s' || line.empty()) {
+				nextShapeLine = !line.empty();	// header of the next shape without a blank line in between
+				break;
+			}
+			SeqFieldScanner sampleField(line);
+			if (!sampleField.readFloat(sample)) {
+				error << "*** ERROR: failed to decode 'sample'\n" << line.str() << std::endl;
+				chunk.error = error.str();
+				return;
+			}
+			shape.samples.push_back(sample);
+		}
+		// number of samples equal to the data length is used as a non-compressed flag
+		// but only for v1.4.0 or above
+		if (version_combined >= 1004000 && numSamples==shape.samples.size())
+			shape.isCompressed=false;
+		else 
+			shape.isCompressed=true;
+		shape.numUncompressedSamples=numSamples;
+
+		chunk.shapes.push_back(std::make_pair(shapeId, std::move(shape)));
+
+		if (!nextShapeLine)
+			haveLine = reader.nextContent(line, COMMENT_CHAR);	// Ignore comments & empty lines
+	}
+	// any other content line ends the section
+	chunk.sectionEnded = haveLine;
+}
+
+/***********************************************************/
+void ExternalSequence::readBlockChunk(const char* data, BlockChunk& chunk) const
+{
+	SeqLineReader reader(data, chunk.end);
+	reader.seek(chunk.begin);
+	SeqLine line;
+	int blockIdx;
+	EventIDs events;
+
+	while (reader.next(line)) {
+		if (line.empty() || line.first()=='[') {
+			chunk.sectionEnded = true;
+			return;
+		}
+		memset(events.id, 0, NUM_EVENTS*sizeof(int));
+		long dur_ru =0;
+
+		// block index, duration, RF, GX, GY, GZ, ADC and (optionally) extensions
+		SeqFieldScanner fields(line);
+		int ret=0;
+		if (fields.readInt(blockIdx)) {
+			++ret;
+			if (fields.readLong(dur_ru)) {
+				++ret;
+				const int eventOrder[] = { RF, GX, GY, GZ, ADC, EXT };
+				for (int k=0; k<6 && fields.readInt(events.id[eventOrder[k]]); ++k)
+					++ret;
+			}
+		}
+		if (7>ret) {
+			std::ostringstream error;
+			error << "*** ERROR: failed to decode event table entry:\n" << line.str() << std::endl
+				  << "***        number of fields read: " << ret << std::endl;
+			chunk.error = error.str();
+			return;
+		}
+		chunk.blocks.push_back(events);
+		chunk.durations.push_back(dur_ru);
+	}
+}
+bool ExternalSequence::readRFSection(const char* data, std::size_t size)
+{
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading RF section");
+	std::size_t offset;
+	if (!findSection("[RF]", offset))
+		return true;
+	SeqLineReader reader(data, size);
+	reader.seek(offset);
+	SeqLine line;
+	int rfId;
+	m_rfLibrary.clear();
+	while (nextTableLine(reader, line)) {
+		SeqFieldScanner fields(line);
+		RFEvent event;
+		if (version_combined<1004000L)
+		{
+			// pre v1.4.0
+			if (!(fields.readInt(rfId) && fields.readFloat(event.amplitude) &&
+				  fields.readInt(event.magShape) && fields.readInt(event.phaseShape) && fields.readInt(event.delay) &&
+				  fields.readFloat(event.freqOffset) && fields.readFloat(event.phaseOffset)
+				  )) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << line.str() << std::endl );
+				return false;
+			}
+            event.freqPPM=0.0;
+            event.phasePPM = 0.0;
+            event.timeShape = 0;
+			event.use='u'; // undefined use
+			event.center=-1.0; // mark as invalid
+		}
+		else if (version_combined < 1005000) 
+		{
+			// 1.4.0
+			if (!(fields.readInt(rfId) && fields.readFloat(event.amplitude) &&
+				  fields.readInt(event.magShape) && fields.readInt(event.phaseShape) && fields.readInt(event.timeShape) &&
+				  fields.readInt(event.delay) && fields.readFloat(event.freqOffset) && fields.readFloat(event.phaseOffset)
+				  )) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << line.str() << std::endl );
+				return false;
+			}
+            event.freqPPM = 0.0;
+            event.phasePPM = 0.0;
+            event.use       = 'u';  // undefined use
+			event.center=-1.0; // mark as invalid
+		}
+		else 
+		{
+			// 1.5.0
+			if (!(fields.readInt(rfId) && fields.readFloat(event.amplitude) &&
+				  fields.readInt(event.magShape) && fields.readInt(event.phaseShape) && fields.readInt(event.timeShape) && fields.readFloat(event.center) &&
+				  fields.readInt(event.delay) && fields.readFloat(event.freqPPM) && fields.readFloat(event.phasePPM) &&
+				  fields.readFloat(event.freqOffset) && fields.readFloat(event.phaseOffset) && fields.readChar(event.use)
+				  )) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode RF event\n" << line.str() << std::endl );
+				return false;
+			}
+		}
+		m_rfLibrary[rfId] = event;
+	}
+	return true;
+}
+
+/***********************************************************/
+bool ExternalSequence::readGradientSections(const char* data, std::size_t size)
+{
+	// Read *arbitrary* gradient section
+	// -------------------------------
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading arbitrary gradient section");
+	m_gradLibrary.clear();
+	SeqLineReader reader(data, size);
+	SeqLine line;
+	std::size_t offset;
+	if (findSection("[GRADIENTS]", offset)) {
+		reader.seek(offset);
+		while (nextTableLine(reader, line)) {
+			SeqFieldScanner fields(line);
+			int gradId;
+			GradEvent event;
+			if ( version_combined>=1005000L )
+			{
+				// v1.5.0
+				if (!(fields.readInt(gradId) && fields.readFloat(event.amplitude) && fields.readFloat(event.first) && fields.readFloat(event.last) &&
+					  fields.readInt(event.waveShape) && fields.readInt(event.timeShape) && fields.readInt(event.delay))) {
+					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.4.x gradient event\n" << line.str() << std::endl );
+					return false;
+				}
+			}
+			else if ( version_combined>=1004000L )
+			{
+				// v1.4.0
+				if (!(fields.readInt(gradId) && fields.readFloat(event.amplitude) &&
+					  fields.readInt(event.waveShape) && fields.readInt(event.timeShape) && fields.readInt(event.delay))) {
+					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.4.x gradient event\n" << line.str() << std::endl );
+					return false;
+				}
+				event.first=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
+				event.last=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
+			}
+			else
+			{
+				// pre v1.4.0
+				event.timeShape=0;
+				if (!(fields.readInt(gradId) && fields.readFloat(event.amplitude) && fields.readInt(event.waveShape) && fields.readInt(event.delay))) {
+					print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode v1.2.x gradient event\n" << line.str() << std::endl );
+					return false;
+				}
+				event.first=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
+				event.last=FLOAT_UNDEFINED; // std::numeric_limits<float>::quiet_NaN(); <- did not work with older MSVC
+			}
+			m_gradLibrary[gradId] = event;
+		}
+	}
+
+	// Read *trapezoid* gradient section
+	// -------------------------------
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading trapezoids section");
+	if (findSection("[TRAP]", offset)) {
+		reader.seek(offset);
+		while (nextTableLine(reader, line)) {
+			SeqFieldScanner fields(line);
+			int gradId;
+			GradEvent event;
+			if (!(fields.readInt(gradId) && fields.readFloat(event.amplitude) &&
+				  fields.readLong(event.rampUpTime) && fields.readLong(event.flatTime) && fields.readLong(event.rampDownTime) &&
+				  fields.readInt(event.delay))) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trapezoid gradient entry" << line.str() << std::endl );
+				return false;
+			}					
+			event.waveShape=0;
+			event.timeShape=0;
+			m_gradLibrary[gradId] = event;
+		}
+	}
+	return true;
+}
+
+/***********************************************************/
+bool ExternalSequence::readADCSection(const char* data, std::size_t size)
+{
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading ADC section");
+	std::size_t offset;
+	if (!findSection("[ADC]", offset))
+		return true;
+	SeqLineReader reader(data, size);
+	reader.seek(offset);
+	SeqLine line;
+	int adcId;
+	m_adcLibrary.clear();
+	while (nextTableLine(reader, line)) {
+		SeqFieldScanner fields(line);
+		ADCEvent event;
+		if ( version_combined>=1005000L )
+		{
+			// v1.5.0
+			if (!(fields.readInt(adcId) && fields.readInt(event.numSamples) &&
+				  fields.readInt(event.dwellTime) && fields.readInt(event.delay) &&
+				  fields.readFloat(event.freqPPM) && fields.readFloat(event.phasePPM) && fields.readFloat(event.freqOffset) && fields.readFloat(event.phaseOffset) &&
+				  fields.readInt(event.phaseModulationShape))) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode ADC event\n" << line.str() << std::endl );
+				return false;
+			}
+		}
+		else
+		{
+			// v1.4.0 and older
+			if (!(fields.readInt(adcId) && fields.readInt(event.numSamples) &&
+				  fields.readInt(event.dwellTime) && fields.readInt(event.delay) &&
+				  fields.readFloat(event.freqOffset) && fields.readFloat(event.phaseOffset))) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode ADC event\n" << line.str() << std::endl );
+				return false;
+			}
+            event.freqPPM=0.0; // no ppmOffset in older formats
+            event.phasePPM= 0.0; 
+			event.phaseModulationShape=0; // no phase modulation shape provided 
+		}
+		
+		m_adcLibrary[adcId] = event;
+	}
+	return true;
+}
+
+/***********************************************************/
+bool ExternalSequence::readDelaySection(const char* data, std::size_t size)
+{
+	// Compatibility with Pulseq versions prior to 1.4.0
+	m_tmpDelayLibrary.clear();
+	std::size_t offset;
+	if (!findSection("[DELAYS]", offset))
+		return true;
+	SeqLineReader reader(data, size);
+	reader.seek(offset);
+	SeqLine line;
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading DELAYS section (compatibility)");
+
+	int delayId;
+	long delay;
+	while (nextTableLine(reader, line)) {
+		SeqFieldScanner fields(line);
+		if (!(fields.readInt(delayId) && fields.readLong(delay))) {
+			print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode delay event\n" << line.str() << std::endl );
+			return false;
+		}
+		m_tmpDelayLibrary[delayId] = delay;
+	}
+	return true;
+}
+
+/***********************************************************/
+bool ExternalSequence::readExtensionSection(const char* data, std::size_t size)
+{
+	print_msg(DEBUG_HIGH_LEVEL, std::ostringstream().flush() << "reading and processing extensions");
+	m_extensionLibrary.clear();
+	m_extensionNameIDs.clear();
+	m_triggerLibrary.clear(); // clear also all known extension libraries
+	m_labelsetLibrary.clear();
+	m_labelincLibrary.clear();
+	std::size_t offset;
+	if (!findSection("[EXTENSIONS]", offset))
+		return true;
+	SeqLineReader reader(data, size);
+	reader.seek(offset);
+	SeqLine line;
+	std::set<std::size_t>::iterator itSFI = m_fileSections.find(offset);
+	if ( itSFI==m_fileSections.end() ||
+		 (++itSFI)==m_fileSections.end() )
+	{
+		print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed find the end of the section while reading EXTENSIONS");
+		return false;
+	}
+	const std::size_t sectionEnd = *itSFI;
+	// we first read in the extension list
+	int nID;
+	int nExtensionID=EXT_LIST; // EXT_LIST means we are reading the extension list
+	while ( reader.tell()<sectionEnd &&
+			reader.next(line)) 
+	{
+		if (line.first()=='#' || line.first()=='[' || line.empty()) {
+			continue;
+		}
+		SeqFieldScanner fields(line);
+		if (line.startsWith("extension")) {
+			// read new extension ID from the header
+			char szStrID[MAX_LINE_SIZE];
+			int nInternalID=0;
+			int nKnownID=EXT_UNKNOWN;
+			SeqLine keyword;
+			if (!(fields.readWord(keyword) && keyword.equals("extension") &&
+				  fields.readWord(szStrID, sizeof(szStrID)) && fields.readInt(nInternalID))) {
+				print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension header entry\n" << line.str() << std::endl );
+				return false;
+			}
+			// here is the list of extensions we currently recognize
+			if (0==strcmp("TRIGGERS",szStrID))
+				nKnownID=EXT_TRIGGER;
+			else if (0==strcmp("ROTATIONS",szStrID))
+				nKnownID=EXT_ROTATION;
+			else if (0==strcmp("LABELSET",szStrID))
+				nKnownID=EXT_LABELSET;
+			else if (0==strcmp("LABELINC",szStrID))
+				nKnownID=EXT_LABELINC;
+			else if (0==strcmp("DELAYS",szStrID))
+				nKnownID=EXT_DELAY;
+			else if (0==strcmp("RF_SHIMS",szStrID))
+				nKnownID=EXT_RF_SHIM;
+			if (nKnownID!=EXT_UNKNOWN)
+				m_extensionNameIDs[nInternalID]=std::make_pair(std::string(szStrID),nKnownID);
+			else {
+				print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: unknown extension ignored\n" << line.str() << std::endl );
+			}
+			nExtensionID=nKnownID;
+		}
+		else
+		{
+			ExtensionListEntry extEntry;
+			TriggerEvent trigger;
+			RotationEvent rotation;
+			SoftDelayEvent delay;
+            RfShimmingEvent rfShim;
+			int  nVal;					   // read label set/inc values from label set/inc extension
+			int  nRet;                     // conversion result / return value
+			char szLabelID[MAX_LINE_SIZE]; // read labels strings from label set/inc extension
+			LabelEvent	label;			   // write label event
+			switch (nExtensionID) {
+				case EXT_LIST: 
+					if (!(fields.readInt(nID) && fields.readInt(extEntry.type) && fields.readInt(extEntry.ref) && fields.readInt(extEntry.next))) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode extension list entry\n" << line.str() << std::endl );
+						return false;
+					}
+					m_extensionLibrary[nID] = extEntry;
+					break;
+				case EXT_TRIGGER: 
+					if (!(fields.readInt(nID) && fields.readInt(trigger.triggerType) && fields.readInt(trigger.triggerChannel) &&
+						  fields.readLong(trigger.delay) && fields.readLong(trigger.duration))) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode trigger event\n" << line.str() << std::endl );
+						return false;
+					}
+					m_triggerLibrary[nID] = trigger;
+					break;
+				case EXT_ROTATION: 
+					if (!(fields.readInt(nID) && fields.readDouble(rotation.rotQuaternion[0]) && fields.readDouble(rotation.rotQuaternion[1]) &&
+						  fields.readDouble(rotation.rotQuaternion[2]) && fields.readDouble(rotation.rotQuaternion[3]))) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode rotation event\n" << line.str() << std::endl );
+                        return false;
+					}
+                    {
+						double dNorm=sqrt(rotation.rotQuaternion[0]*rotation.rotQuaternion[0]+rotation.rotQuaternion[1]*rotation.rotQuaternion[1]+rotation.rotQuaternion[2]*rotation.rotQuaternion[2]+rotation.rotQuaternion[3]*rotation.rotQuaternion[3]);
+                        if (fabs(dNorm-1.0)>1e-3) {
+							print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: rotation extension loaded a non-normalized quaternion " << line.str() << std::endl );
+							return false;
+						}
+						for (int i = 0; i < 4; ++i)
+                            rotation.rotQuaternion[i] /= dNorm; 
+                    }
+					rotation.defined=true;
+					m_rotationLibrary[nID] = rotation; 
+					break;
+				case EXT_LABELSET: 
+					if (!(fields.readInt(nID) && fields.readInt(nVal) && fields.readWord(szLabelID, sizeof(szLabelID)))) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to load labelset event\n" << line.str() << std::endl );
+						return false;
+					}
+					nRet = decodeLabel(EXT_LABELSET,nVal,szLabelID,label);
+					if (nRet<0) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelset event\n" << line.str() << std::endl );
+						return false;
+					}else if(nRet>0) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** decoding labelset event returned 0\n" << line.str() << std::endl );
+					} 
+					m_labelsetLibrary[nID] = label;
+					break;
+				case EXT_LABELINC: 
+					if (!(fields.readInt(nID) && fields.readInt(nVal) && fields.readWord(szLabelID, sizeof(szLabelID)))) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << line.str() << std::endl );
+						return false;
+					}
+					nRet = decodeLabel(EXT_LABELINC,nVal,szLabelID,label);
+					if (nRet<0) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode labelinc event\n" << line.str() << std::endl );
+						return false;
+					}else if(nRet>0) {
+						print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: decoding labelinc event returnd 0\n" << line.str() << std::endl );
+					}
+
+					m_labelincLibrary[nID] = label;
+					break;
+				case EXT_DELAY: 
+					{
+						if (!(fields.readInt(nID) && fields.readInt(delay.numID) && fields.readInt(delay.offset) && fields.readInt(delay.factor))) {
+							print_msg(ERROR_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode soft delay event\n" << line.str() << std::endl );
+							return false;
+						}
+						const SeqLine hint = fields.rest();
+						const std::size_t hintLength = hint.length()<SOFT_DELAY_HINT_LENGTH-1 ? hint.length() : SOFT_DELAY_HINT_LENGTH-1;
+						memset(delay.hint,0,SOFT_DELAY_HINT_LENGTH);
+						memcpy(delay.hint,hint.begin,hintLength);
+						print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "decoded soft delay " << delay.numID << " with the hint:" << delay.hint);
+						m_softDelayLibrary[nID] = delay;
+					}
+					break;
+                case EXT_RF_SHIM:
+                    {
+						if (!(fields.readInt(rfShim.id) && fields.readInt(rfShim.nchan)))
+                        {
+                            print_msg(
+                                ERROR_MSG,
+                                std::ostringstream().flush() << "*** ERROR: failed to decode RF shim event\n"
+                                                             << line.str() << std::endl);
+                            return false;
+                        }
+						rfShim.amplitudes.reserve(rfShim.nchan);
+						rfShim.phases.reserve(rfShim.nchan);
+						for (int i=0;i<rfShim.nchan; ++i) 
+						{
+							float fa,fp;
+							if (!(fields.readFloat(fa) && fields.readFloat(fp)))
+							{
+								print_msg(
+									ERROR_MSG,
+									std::ostringstream().flush() << "*** ERROR: failed to decode RF shim event for channel " << i << " in\n"
+																 << line.str() << std::endl);
+								return false;
+							}
+							rfShim.amplitudes.push_back(fa);
+							rfShim.phases.push_back(fp);								
+						}
+						print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "finished decoding RF shim event");
+                        m_rfShimLibrary[rfShim.id] = rfShim;
+                    }
+                    break;
+				case EXT_UNKNOWN:
+					print_msg(WARNING_MSG, std::ostringstream().flush() << "*** ERROR: failed to decode unknown extension event\n" << line.str() << std::endl );
+					break; // just ignore unknown extensions
+			}
+		}
+	}
+	return true;
+}
+
+
+
+/***********************************************************/
+// Binary snapshot of the parsed sequence (see saveSnapshot())
+
+static const char SNAPSHOT_MAGIC[8] = { 'P','S','Q','S','N','A','P','\0' };
+static const uint32_t SNAPSHOT_VERSION = 2;
+
+// Appends numbers and 8-byte aligned number arrays to a byte string. Records are written field
+// by field (see the writeEvent() overloads), so the snapshot does not depend on struct layout.
+class SnapshotWriter
+{
+public:
+	explicit SnapshotWriter(std::string& out) : m_out(out) {}
+
+	template<typename T> void value(const T& v)
+	{
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T,bool>::value, "snapshot values must be numbers");
+		m_out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+	template<typename T> void array(const T* p, std::size_t n)
+	{
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T,bool>::value, "snapshot arrays must hold numbers");
+		value<uint64_t>(n);
+		m_out.append((8 - m_out.size()%8)%8, '\0');
+		if (n)
+			m_out.append(reinterpret_cast<const char*>(p), n*sizeof(T));
+	}
+	void flag(bool b) { value<uint8_t>(b ? 1 : 0); }
+	void string(const std::string& s) { array(s.data(), s.size()); }
+
+private:
+	std::string& m_out;
+};
+
+// Reads what SnapshotWriter wrote; every read fails (and keeps failing) once the data runs out
+// or a flag or enumerator is out of range
+class SnapshotReader
+{
+public:
+	SnapshotReader(const char* data, std::size_t size) : m_begin(data), m_p(data), m_end(data+size), m_ok(true) {}
+
+	bool ok() const { return m_ok; }
+
+	template<typename T> bool value(T& v)
+	{
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T,bool>::value, "snapshot values must be numbers");
+		if (!take(sizeof(T))) return false;
+		memcpy(&v, m_p-sizeof(T), sizeof(T));
+		return true;
+	}
+	// Reads a value written as S into a field of another width (e.g. long written as int64_t)
+	template<typename S, typename T> bool valueAs(T& v)
+	{
+		S s;
+		if (!value(s)) return false;
+		v = T(s);
+		return true;
+	}
+	template<typename T> bool array(std::vector<T>& v)
+	{
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T,bool>::value, "snapshot arrays must hold numbers");
+		uint64_t n;
+		if (!value(n)) return false;
+		if (!take((8 - std::size_t(m_p-m_begin)%8)%8)) return false;
+		if (n > std::size_t(m_end-m_p)/sizeof(T)) return fail();
+		v.resize(std::size_t(n));
+		if (n) memcpy(&v[0], m_p, std::size_t(n)*sizeof(T));
+		m_p += std::size_t(n)*sizeof(T);
+		return true;
+	}
+	bool flag(bool& b)
+	{
+		uint8_t v;
+		if (!value(v)) return false;
+		if (v > 1) return fail();
+		b = v!=0;
+		return true;
+	}
+	// Enumerators are written as int32_t and must lie in [0, last]
+	template<typename E> bool enumerator(E& e, E last)
+	{
+		int32_t v;
+		if (!value(v)) return false;
+		if (v < 0 || v > int32_t(last)) return fail();
+		e = E(v);
+		return true;
+	}
+	bool string(std::string& s)
+	{
+		std::vector<char> chars;
+		if (!array(chars)) return false;
+		s.assign(chars.begin(), chars.end());
+		return true;
+	}
+
+private:
+	bool take(std::size_t n)
+	{
+		if (!m_ok || n > std::size_t(m_end-m_p)) return fail();
+		m_p += n;
+		return true;
+	}
+	bool fail() { m_ok = false; return false; }
+
+	const char* m_begin;
+	const char* m_p;
+	const char* m_end;
+	bool m_ok;
+};
+
+static void writeEvent(SnapshotWriter& out, const RFEvent& rf)
+{
+	out.value(rf.amplitude);
+	out.value(rf.magShape);
+	out.value(rf.phaseShape);
+	out.value(rf.timeShape);
+	out.value(rf.center);
+	out.value(rf.freqPPM);
+	out.value(rf.phasePPM);
+	out.value(rf.freqOffset);
+	out.value(rf.phaseOffset);
+	out.value(rf.delay);
+	out.value(rf.use);
+}
+
+static bool readEvent(SnapshotReader& in, RFEvent& rf)
+{
+	return in.value(rf.amplitude) && in.value(rf.magShape) && in.value(rf.phaseShape) && in.value(rf.timeShape) &&
+		in.value(rf.center) && in.value(rf.freqPPM) && in.value(rf.phasePPM) && in.value(rf.freqOffset) &&
+		in.value(rf.phaseOffset) && in.value(rf.delay) && in.value(rf.use);
+}
+
+static void writeEvent(SnapshotWriter& out, const GradEvent& grad)
+{
+	out.value(grad.amplitude);
+	out.value(grad.delay);
+	out.value<int64_t>(grad.rampUpTime);
+	out.value<int64_t>(grad.flatTime);
+	out.value<int64_t>(grad.rampDownTime);
+	out.value(grad.waveShape);
+	out.value(grad.timeShape);
+	out.value(grad.first);
+	out.value(grad.last);
+}
+
+static bool readEvent(SnapshotReader& in, GradEvent& grad)
+{
+	return in.value(grad.amplitude) && in.value(grad.delay) &&
+		in.valueAs<int64_t>(grad.rampUpTime) && in.valueAs<int64_t>(grad.flatTime) && in.valueAs<int64_t>(grad.rampDownTime) &&
+		in.value(grad.waveShape) && in.value(grad.timeShape) && in.value(grad.first) && in.value(grad.last);
+}
+
+static void writeEvent(SnapshotWriter& out, const ADCEvent& adc)
+{
+	out.value(adc.numSamples);
+	out.value(adc.dwellTime);
+	out.value(adc.delay);
+	out.value(adc.freqPPM);
+	out.value(adc.phasePPM);
+	out.value(adc.freqOffset);
+	out.value(adc.phaseOffset);
+	out.value(adc.phaseModulationShape);
+}
+
+static bool readEvent(SnapshotReader& in, ADCEvent& adc)
+{
+	return in.value(adc.numSamples) && in.value(adc.dwellTime) && in.value(adc.delay) &&
+		in.value(adc.freqPPM) && in.value(adc.phasePPM) && in.value(adc.freqOffset) && in.value(adc.phaseOffset) &&
+		in.value(adc.phaseModulationShape);
+}
+
+static void writeEvent(SnapshotWriter& out, const ExtensionListEntry& ext)
+{
+	out.value(ext.type);
+	out.value(ext.ref);
+	out.value(ext.next);
+}
+
+static bool readEvent(SnapshotReader& in, ExtensionListEntry& ext)
+{
+	return in.value(ext.type) && in.value(ext.ref) && in.value(ext.next);
+}
+
+static void writeEvent(SnapshotWriter& out, const TriggerEvent& trigger)
+{
+	out.value<int64_t>(trigger.duration);
+	out.value<int64_t>(trigger.delay);
+	out.value(trigger.triggerType);
+	out.value(trigger.triggerChannel);
+}
+
+static bool readEvent(SnapshotReader& in, TriggerEvent& trigger)
+{
+	return in.valueAs<int64_t>(trigger.duration) && in.valueAs<int64_t>(trigger.delay) &&
+		in.value(trigger.triggerType) && in.value(trigger.triggerChannel);
+}
+
+static void writeEvent(SnapshotWriter& out, const RotationEvent& rotation)
+{
+	out.flag(rotation.defined);
+	for (int i=0; i<4; ++i)
+		out.value(rotation.rotQuaternion[i]);
+}
+
+static bool readEvent(SnapshotReader& in, RotationEvent& rotation)
+{
+	bool ok = in.flag(rotation.defined);
+	for (int i=0; ok && i<4; ++i)
+		ok = in.value(rotation.rotQuaternion[i]);
+	return ok;
+}
+
+static void writeEvent(SnapshotWriter& out, const LabelEvent& label)
+{
+	out.value(label.numVal.first);
+	out.value(label.numVal.second);
+	out.value(label.flagVal.first);
+	out.flag(label.flagVal.second);
+}
+
+static bool readEvent(SnapshotReader& in, LabelEvent& label)
+{
+	return in.value(label.numVal.first) && in.value(label.numVal.second) &&
+		in.value(label.flagVal.first) && in.flag(label.flagVal.second);
+}
+
+static void writeEvent(SnapshotWriter& out, const SoftDelayEvent& delay)
+{
+	out.value(delay.numID);
+	out.value(delay.offset);
+	out.value(delay.factor);
+	out.string(std::string(delay.hint, strnlen(delay.hint, SOFT_DELAY_HINT_LENGTH)));
+}
+
+static bool readEvent(SnapshotReader& in, SoftDelayEvent& delay)
+{
+	std::string hint;
+	if (!(in.value(delay.numID) && in.value(delay.offset) && in.value(delay.factor) && in.string(hint)) ||
+		hint.size() >= SOFT_DELAY_HINT_LENGTH)
+		return false;
+	memset(delay.hint, 0, SOFT_DELAY_HINT_LENGTH);
+	memcpy(delay.hint, hint.data(), hint.size());
+	return true;
+}
+
+static void writeEvent(SnapshotWriter& out, const RfShimmingEvent& rfShim)
+{
+	out.value(rfShim.id);
+	out.value(rfShim.nchan);
+	out.array(rfShim.amplitudes.empty() ? NULL : &rfShim.amplitudes[0], rfShim.amplitudes.size());
+	out.array(rfShim.phases.empty() ? NULL : &rfShim.phases[0], rfShim.phases.size());
+}
+
+static bool readEvent(SnapshotReader& in, RfShimmingEvent& rfShim)
+{
+	return in.value(rfShim.id) && in.value(rfShim.nchan) && in.array(rfShim.amplitudes) && in.array(rfShim.phases);
+}
+
+static void writeEvent(SnapshotWriter& out, const CompressedShape& shape)
+{
+	out.value(shape.numUncompressedSamples);
+	out.flag(shape.isCompressed);
+	out.array(shape.samples.empty() ? NULL : &shape.samples[0], shape.samples.size());
+}
+
+static bool readEvent(SnapshotReader& in, CompressedShape& shape)
+{
+	return in.value(shape.numUncompressedSamples) && in.flag(shape.isCompressed) && in.array(shape.samples);
+}
+
+template<typename T> static void writeLibrary(SnapshotWriter& out, const std::map<int,T>& lib)
+{
+	out.value<uint64_t>(lib.size());
+	for (typename std::map<int,T>::const_iterator it=lib.begin(); it!=lib.end(); ++it) {
+		out.value(it->first);
+		writeEvent(out, it->second);
+	}
+}
+
+template<typename T> static bool readLibrary(SnapshotReader& in, std::map<int,T>& lib)
+{
+	uint64_t n;
+	if (!in.value(n)) return false;
+	lib.clear();
+	for (uint64_t i=0; i<n; ++i) {
+		int id;
+		T item;
+		if (!in.value(id) || !readEvent(in, item)) return false;
+		lib[id] = std::move(item);
+	}
+	return true;
+}
+
+static void writeStringMap(SnapshotWriter& out, const std::map<std::string,std::string>& map)
+{
+	out.value<uint64_t>(map.size());
+	for (std::map<std::string,std::string>::const_iterator it=map.begin(); it!=map.end(); ++it) {
+		out.string(it->first);
+		out.string(it->second);
+	}
+}
+
+static bool readStringMap(SnapshotReader& in, std::map<std::string,std::string>& map)
+{
+	uint64_t n;
+	if (!in.value(n)) return false;
+	map.clear();
+	for (uint64_t i=0; i<n; ++i) {
+		std::string key, value;
+		if (!in.string(key) || !in.string(value)) return false;
+		map[key] = value;
+	}
+	return true;
+}
+
+static void writeIdNameMap(SnapshotWriter& out, const std::map<int,std::string>& map)
+{
+	out.value<uint64_t>(map.size());
+	for (std::map<int,std::string>::const_iterator it=map.begin(); it!=map.end(); ++it) {
+		out.value(it->first);
+		out.string(it->second);
+	}
+}
+
+static bool readIdNameMap(SnapshotReader& in, std::map<int,std::string>& map)
+{
+	uint64_t n;
+	if (!in.value(n)) return false;
+	map.clear();
+	for (uint64_t i=0; i<n; ++i) {
+		int id;
+		std::string name;
+		if (!in.value(id) || !in.string(name)) return false;
+		map[id] = name;
+	}
+	return true;
+}
+
+void ExternalSequence::saveSnapshot(std::string& out) const
+{
+	SnapshotWriter w(out);
+	w.array(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	w.value(SNAPSHOT_VERSION);
+
+	w.value(version_major);
+	w.value(version_minor);
+	w.value(version_revision);
+	w.value(version_combined);
+	w.value(m_dAdcRasterTime_us);
+	w.value(m_dGradientRasterTime_us);
+	w.value(m_dRadiofrequencyRasterTime_us);
+	w.value(m_dBlockDurationRaster_us);
+
+	// definitions: the numeric view is derived from the strings but stored as parsed
+	writeStringMap(w, m_definitions_str);
+	w.value<uint64_t>(m_definitions.size());
+	for (std::map<std::string,std::vector<double> >::const_iterator it=m_definitions.begin(); it!=m_definitions.end(); ++it) {
+		w.string(it->first);
+		w.array(it->second.empty() ? NULL : &it->second[0], it->second.size());
+	}
+
+	writeStringMap(w, m_signatureMap);
+	w.flag(m_bSignatureDefined);
+	w.string(m_strSignature);
+	w.string(m_strSignatureType);
+	// the calculated hash and the check verdict are not stored: a restored sequence is checked again
+	w.value<uint64_t>(m_signedSize);
+
+	// block table, as NUM_EVENTS event IDs per block
+	std::vector<int32_t> blockIDs(m_blocks.size()*NUM_EVENTS);
+	for (std::size_t i=0; i<m_blocks.size(); ++i)
+		for (int e=0; e<NUM_EVENTS; ++e)
+			blockIDs[i*NUM_EVENTS+e] = m_blocks[i].id[e];
+	const std::vector<int64_t> blockDurations(m_blockDurations_ru.begin(), m_blockDurations_ru.end());
+	w.value<int32_t>(NUM_EVENTS);
+	w.array(blockIDs.empty() ? NULL : &blockIDs[0], blockIDs.size());
+	w.array(blockDurations.empty() ? NULL : &blockDurations[0], blockDurations.size());
+
+	// event libraries
+	writeLibrary(w, m_rfLibrary);
+	writeLibrary(w, m_gradLibrary);
+	writeLibrary(w, m_adcLibrary);
+	writeLibrary(w, m_extensionLibrary);
+	w.value<uint64_t>(m_extensionNameIDs.size());
+	for (std::map<int,std::pair<std::string,int> >::const_iterator it=m_extensionNameIDs.begin(); it!=m_extensionNameIDs.end(); ++it) {
+		w.value(it->first);
+		w.string(it->second.first);
+		w.value(it->second.second);
+	}
+	writeLibrary(w, m_triggerLibrary);
+	writeLibrary(w, m_rotationLibrary);
+	writeLibrary(w, m_labelsetLibrary);
+	writeLibrary(w, m_labelincLibrary);
+	writeLibrary(w, m_softDelayLibrary);
+	writeLibrary(w, m_rfShimLibrary);
+	// label names, including the IDs assigned to unknown labels while reading
+	writeIdNameMap(w, m_labelMap.mapLabelIdToStr);
+	writeIdNameMap(w, m_labelMap.mapFlagIdToStr);
+	w.value<uint64_t>(m_labelMap.mapStrToLabel.size());
+	for (LabelMap::tM::const_iterator it=m_labelMap.mapStrToLabel.begin(); it!=m_labelMap.mapStrToLabel.end(); ++it) {
+		w.string(it->first);
+		w.value<int32_t>(it->second.first);
+		w.value<int32_t>(it->second.second);
+	}
+
+	// compressed shapes
+	writeLibrary(w, m_shapeLibrary);
+}
+
+bool ExternalSequence::loadSnapshot(const char* data, std::size_t size)
+{
+	reset();
+	m_softDelayLibrary.clear();
+	m_rfShimLibrary.clear();
+	m_labelMap = LabelMap();
+
+	SnapshotReader r(data, size);
+	std::vector<char> magic;
+	uint32_t version = 0;
+	if (!(r.array(magic) && magic.size()==sizeof(SNAPSHOT_MAGIC) && 0==memcmp(&magic[0], SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) &&
+		  r.value(version) && version==SNAPSHOT_VERSION)) {
+		print_msg(NORMAL_MSG, std::ostringstream().flush() << "sequence snapshot is from a different format version and is ignored");
+		return false;
+	}
+
+	bool ok = r.value(version_major) && r.value(version_minor) && r.value(version_revision) && r.value(version_combined) &&
+		r.value(m_dAdcRasterTime_us) && r.value(m_dGradientRasterTime_us) && r.value(m_dRadiofrequencyRasterTime_us) && r.value(m_dBlockDurationRaster_us);
+
+	ok = ok && readStringMap(r, m_definitions_str);
+	uint64_t n = 0;
+	ok = ok && r.value(n);
+	for (uint64_t i=0; ok && i<n; ++i) {
+		std::string key;
+		ok = r.string(key) && r.array(m_definitions[key]);
+	}
+
+	ok = ok && readStringMap(r, m_signatureMap) && r.flag(m_bSignatureDefined) &&
+		r.string(m_strSignature) && r.string(m_strSignatureType);
+	uint64_t signedSize = 0;
+	ok = ok && r.value(signedSize);
+	m_signedSize = std::size_t(signedSize);
+
+	int32_t numEvents = 0;
+	std::vector<int32_t> blockIDs;
+	std::vector<int64_t> blockDurations;
+	ok = ok && r.value(numEvents) && numEvents==NUM_EVENTS && r.array(blockIDs) && r.array(blockDurations) &&
+		blockIDs.size()==blockDurations.size()*NUM_EVENTS;
+	if (ok) {
+		m_blocks.resize(blockDurations.size());
+		for (std::size_t i=0; i<m_blocks.size(); ++i)
+			for (int e=0; e<NUM_EVENTS; ++e)
+				m_blocks[i].id[e] = blockIDs[i*NUM_EVENTS+e];
+		m_blockDurations_ru.assign(blockDurations.begin(), blockDurations.end());
+	}
+
+	ok = ok && readLibrary(r, m_rfLibrary) && readLibrary(r, m_gradLibrary) && readLibrary(r, m_adcLibrary) &&
+		readLibrary(r, m_extensionLibrary);
+	ok = ok && r.value(n);
+	for (uint64_t i=0; ok && i<n; ++i) {
+		int id, knownID;
+		std::string name;
+		ok = r.value(id) && r.string(name) && r.value(knownID);
+		if (ok) m_extensionNameIDs[id] = std::make_pair(name, knownID);
+	}
+	ok = ok && readLibrary(r, m_triggerLibrary) && readLibrary(r, m_rotationLibrary) &&
+		readLibrary(r, m_labelsetLibrary) && readLibrary(r, m_labelincLibrary) &&
+		readLibrary(r, m_softDelayLibrary) && readLibrary(r, m_rfShimLibrary);
+	ok = ok && readIdNameMap(r, m_labelMap.mapLabelIdToStr) && readIdNameMap(r, m_labelMap.mapFlagIdToStr) && r.value(n);
+	for (uint64_t i=0; ok && i<n; ++i) {
+		std::string name;
+		LabelMap::tP label;
+		ok = r.string(name) && r.enumerator(label.first, LABEL_UNKNOWN) && r.enumerator(label.second, FLAG_UNKNOWN);
+		if (ok) m_labelMap.mapStrToLabel[name] = label;
+	}
+
+	ok = ok && readLibrary(r, m_shapeLibrary);
+
+	if (!ok) {
+		print_msg(WARNING_MSG, std::ostringstream().flush() << "*** WARNING: sequence snapshot is truncated or damaged");
+		reset();
+		m_softDelayLibrary.clear();
+		m_rfShimLibrary.clear();
+		m_labelMap = LabelMap();
+		return false;
+	}
+	SeqBlock::s_blockDurationRaster=m_dBlockDurationRaster_us;
+	return true;
+}
+
+
+std::vector<std::string> ExternalSequence::GetAllDefinitions()
+{
+    assert(m_definitions_str.size() == m_definitions.size());
+    int n = m_definitions_str.size();
+    std::vector<std::string> keys(n);
+    std::map<std::string, std::string>::iterator it = m_definitions_str.begin();
+    for (int i = 0; i < n; ++i)
+    {
+        keys[i] = it->first;
+        ++it;
+	}
+    return keys;
+}
+
+/***********************************************************/
+SeqBlock*	ExternalSequence::GetBlock(int index) {
+	SeqBlock *block = new SeqBlock();
+	GetBlock(index, block);
+	return block;
+}
+
+/***********************************************************/
+void	ExternalSequence::GetBlock(int index, SeqBlock *block) {
+	// The block may be recycled: drop the shapes of whatever it held before
+	block->free();
+
+	// Copy event IDs
+	EventIDs events = m_blocks[index];
+	std::copy(events.id,events.id+NUM_EVENTS,&block->events[0]);
+
+	//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "GetBlock(" << index << ") : [ " << events.id[0] << " " << events.id[1] << " " << events.id[2] << " " << events.id[3] << " " << events.id[4] << " " << events.id[5] << " " << events.id[6] << "  ]");
+
+	// Set some defaults
+	block->index = index;
+	block->duration_ru = m_blockDurations_ru[index];
+	block->adc.numSamples = 0;
+	block->trigger.triggerType=0;
+	block->trigger.triggerChannel=0;
 	block->rotation.defined=false;
 	block->labelset.clear();
 	block->labelinc.clear();
@@ -1174,24 +1927,26 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 	block->actualSoftDelay_ru=-1;
 	block->rfShim.nchan=-1;
 	block->rfShim.id=0;
+	block->rfShim.amplitudes.clear();
+	block->rfShim.phases.clear();
 	// Set event structures (if applicable) so e.g. gradient type can be determined
-	if (events.id[RF]>0)     block->rf      = m_rfLibrary[events.id[RF]];
-	if (events.id[ADC]>0)    block->adc     = m_adcLibrary[events.id[ADC]];
+	if (events.id[RF]>0)     block->rf      = findInLibrary(m_rfLibrary, events.id[RF]);
+	if (events.id[ADC]>0)    block->adc     = findInLibrary(m_adcLibrary, events.id[ADC]);
 	for (unsigned int i=0; i<NUM_GRADS; i++)
-		if (events.id[GX+i]>0) block->grad[i] = m_gradLibrary[events.id[GX+i]];
+		if (events.id[GX+i]>0) block->grad[i] = findInLibrary(m_gradLibrary, events.id[GX+i]);
 	// unpack (known) extension objects
 	if (events.id[EXT]>0) {
 		// oh yeah, the current data stuctures seem to be really ugly and slow...
 		int nNextExtID=events.id[EXT];
 		while (nNextExtID) {
-			std::map<int,ExtensionListEntry>::iterator itEL = m_extensionLibrary.find(nNextExtID);
+			std::map<int,ExtensionListEntry>::const_iterator itEL = m_extensionLibrary.find(nNextExtID);
 			if (itEL == m_extensionLibrary.end()) {
 				print_msg(ERROR_MSG, std::ostringstream().flush() << "ERROR: could not find extension list entry " << nNextExtID);
 				//return NULL;
 				break;
 			}
 			// attempt to recognize the extension reference
-			std::map<int,std::pair<std::string,int> >::iterator itEN=m_extensionNameIDs.find(itEL->second.type);
+			std::map<int,std::pair<std::string,int> >::const_iterator itEN=m_extensionNameIDs.find(itEL->second.type);
 			if (itEN!=m_extensionNameIDs.end()) {
 				// we have a known extension
 				switch (itEN->second.second) {
@@ -1201,7 +1956,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 						}
 						else {
 							// ok, lets find the trigger in the library
-							block->trigger=m_triggerLibrary[itEL->second.ref]; // do we have to check whether it can be found?
+							block->trigger=findInLibrary(m_triggerLibrary, itEL->second.ref); // do we have to check whether it can be found?
 						}
 						break;
 					case EXT_ROTATION:
@@ -1210,18 +1965,18 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 						}
 						else {
 							// ok, lets find the rotation in the library
-							block->rotation=m_rotationLibrary[itEL->second.ref]; // do we have to check whether it can be found?
+							block->rotation=findInLibrary(m_rotationLibrary, itEL->second.ref); // do we have to check whether it can be found?
 						}
 						break;
 					case EXT_LABELSET:
 						//do we have to check anything ? //MZ: TODO: check that we find the evet in the library TODO: check for conflicts between set and inc
 							// ok, lets find the labelset in the library
-							block->labelset.push_back(m_labelsetLibrary[itEL->second.ref]); // do we have to check whether it can be found?
+							block->labelset.push_back(findInLibrary(m_labelsetLibrary, itEL->second.ref)); // do we have to check whether it can be found?
 						break;
 					case EXT_LABELINC:
 						//do we have to check anything ? //MZ: TODO: check that we find the evet in the library TODO: check for conflicts between set and inc
 							// ok, lets find the labelinc in the library
-							block->labelinc.push_back(m_labelincLibrary[itEL->second.ref]); // do we have to check whether it can be found?
+							block->labelinc.push_back(findInLibrary(m_labelincLibrary, itEL->second.ref)); // do we have to check whether it can be found?
 						break;
 					case EXT_DELAY:
 						if (block->softDelay.numID>=0) {
@@ -1229,7 +1984,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 						}
 						else {
 							// ok, lets find the soft delay in the library
-							block->softDelay=m_softDelayLibrary[itEL->second.ref]; // do we have to check whether it can be found?
+							block->softDelay=findInLibrary(m_softDelayLibrary, itEL->second.ref); // do we have to check whether it can be found?
 						}
 						break;
 					case EXT_RF_SHIM:
@@ -1238,7 +1993,7 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 						}
 						else {
 							// ok, lets find the RF shim event in the library
-							block->rfShim=m_rfShimLibrary[itEL->second.ref]; // do we have to check whether it can be found?
+							block->rfShim=findInLibrary(m_rfShimLibrary, itEL->second.ref); // do we have to check whether it can be found?
 						}
 						break;
 					default:
@@ -1299,8 +2054,6 @@ SeqBlock*	ExternalSequence::GetBlock(int index) {
 	*/
 
 	//ExternalSequence::print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "block duration: " << block->duration);
-    
-	return block;
 }
 
 /***********************************************************/
@@ -1311,29 +2064,15 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 		<< events[0]+1 << " " << events[1]+1 << " " << events[2]+1 << " "
 		<< events[3]+1 << " " << events[4]+1 );
 	
-	std::vector<float> waveform;	
 	// Decode RF
 	if (block->isRF())
 	{
-		// Decompress the shape for this channel
-		CompressedShape& shape = m_shapeLibrary[block->rf.magShape];
-		waveform.resize(shape.numUncompressedSamples);
-		if (!decompressShape(shape,&waveform[0]))
+		std::shared_ptr<const std::vector<float> > amplitude = getDecodedRFShape(block->rf.magShape, block->rf.timeShape, false);
+		if (!amplitude)
 			return false;
-
-		//MZ: original Kelvin's code follows
-		CompressedShape& shapePhase = m_shapeLibrary[block->rf.phaseShape];
-		std::vector<float> waveform_p;
-		waveform_p.resize(shapePhase.numUncompressedSamples);
-		if (!decompressShape(shapePhase,&waveform_p[0]))
+		std::shared_ptr<const std::vector<float> > phase = getDecodedRFShape(block->rf.phaseShape, block->rf.timeShape, true);
+		if (!phase)
 			return false;
-		// Scale phase by 2pi
-		std::transform(
-			waveform_p.begin(),
-			waveform_p.end(),
-			waveform_p.begin(),
-			[](float x) { return x * static_cast<float>(TWO_PI); }
-		);
 
 		float fDwellTime_us=0;
 		// feature of v1.4.x
@@ -1341,7 +2080,7 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 		if (block->rf.timeShape) 
 		{
 			// new file format (v1.4.x)
-			CompressedShape& shapeTime = m_shapeLibrary[block->rf.timeShape];
+			const CompressedShape& shapeTime = findInLibrary(m_shapeLibrary, block->rf.timeShape);
 			// detect regular sampling 
 			if (shapeTime.samples.size()!=shapeTime.numUncompressedSamples &&
 				(shapeTime.samples.size()==3 || shapeTime.samples.size()==4)) 
@@ -1352,32 +2091,8 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 			}
 			else
 			{
-				std::vector<float> waveform_t;
-				waveform_t.resize(shapeTime.numUncompressedSamples);
-				if (!decompressShape(shapeTime,&waveform_t[0]))
-					return false;
-				// we resample the input on the fly 
-				// for now we just use the RF raster time
+				// the shapes have been resampled to the RF raster time
 				fDwellTime_us=m_dRadiofrequencyRasterTime_us;
-				int nSamples=int(0.5+waveform_t.back());
-				// for now we use nearest neighbour/right repetition interpolation
-				// FIXME/TODO: convert to complex, use linear interpolation and convert back to magnitude&phase
-				std::vector<float> wv_a(nSamples);
-				std::vector<float> wv_p(nSamples);
-				int tc=0;
-				for(int c=0;c<nSamples;++c)
-				{
-					if(waveform_t[tc]<(c+1)) 
-					{
-						if (tc<waveform_t.size())
-							++tc;
-					}
-					wv_a[c]=waveform[tc];
-					wv_p[c]=waveform_p[tc];
-				}
-				// replace the waveforms
-				waveform.swap(wv_a);
-				waveform_p.swap(wv_p);
 			}
 		}
 		else
@@ -1390,8 +2105,8 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 				fDwellTime_us=1.0; // old Pulseq's predefined RF raster time
 		}
 		//
-		block->rfAmplitude = std::vector<float>(waveform);
-		block->rfPhase = std::vector<float>(waveform_p);
+		block->rfAmplitude = amplitude;
+		block->rfPhase = phase;
 		block->rfDwellTime_us = fDwellTime_us;
 	}
 
@@ -1400,41 +2115,11 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 	{
 		if (block->isArbitraryGradient(iC-GX))	// is arbitrary gradient?
 		{
-			// Decompress the arbitrary shape for this channel
-			CompressedShape& shape = m_shapeLibrary[block->grad[iC-GX].waveShape];
-
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded shape with "
-				<< shape.samples.size() << " compressed samples" );
-
-			waveform.resize(shape.numUncompressedSamples);
-			if (!decompressShape(shape,&waveform[0]))
-				return false;
-
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape uncompressed to "
-				<< shape.numUncompressedSamples << " samples" );
-
-			if (fabs(m_dGradientRasterTime_us-10)>1e-3)
-			{
-				print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape is on a raster that is different from the system raster, exitting... (will try resampling in the future versions...)" );
-				// TODO: !!!
-				// PROBLEM: we need 'first' and 'last' to be able to interpolate correctly...
+			std::shared_ptr<const std::vector<float> > waveform =
+				getDecodedGradShape(block->grad[iC-GX].waveShape, block->isArbGradWithOversampling(iC-GX));
+			if (!waveform)
 				return false;
-			}
-
-			if (block->isArbGradWithOversampling(iC-GX))	// oversampling?
-			{
-				block->gradWaveforms[iC-GX] = std::vector<float>((waveform.size()+1)/2);
-				std::vector<float>::iterator it_os=waveform.begin();
-				for (std::vector<float>::iterator it=block->gradWaveforms[iC-GX].begin(); it !=block->gradWaveforms[iC-GX].end(); ++it){
-					*it=*it_os;
-					// std::advance(it_os,2); // this doen't work because of the odd number of elements 
-					++it_os;
-					if (it_os!=waveform.end())
-						++it_os;
-				}
-			}
-			else
-				block->gradWaveforms[iC-GX] = std::vector<float>(waveform);
+			block->gradWaveforms[iC-GX] = waveform;
 		}
 	}
 
@@ -1453,9 +2138,6 @@ bool ExternalSequence::decodeBlock(SeqBlock *block)
 		block->delay = m_delayLibrary[events[DELAY]];
 	}*/
 
-	checkGradient(*block);
-	checkRF(*block);
-
 	return true;
 }
 
@@ -1466,53 +2148,203 @@ bool ExternalSequence::decodeExtTrapGradInBlock(SeqBlock *block)
 		<< events[0]+1 << " " << events[1]+1 << " " << events[2]+1 << " "
 		<< events[3]+1 << " " << events[4]+1 );
 
-	std::vector<float> waveform;
-	block->gradExtTrapForms.clear();
-	block->gradExtTrapForms.resize(NUM_GRADS);
 	// Decode gradients
 	for (int iC=GX; iC<ADC; iC++)
 	{
+		block->gradExtTrapTimes[iC-GX].reset();
+		block->gradExtTrapShapes[iC-GX].reset();
 		if (block->isExtTrapGradient(iC-GX))	// is arbitrary gradient?
 		{
 			// Decompress the ExtTrap shapes for this channel
 			// time shape first
-			CompressedShape& tshape = m_shapeLibrary[block->grad[iC-GX].timeShape];
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded time shape " << block->grad[iC-GX].timeShape << " with " << tshape.samples.size() << " compressed samples" );
-			//for (int a=0; a<tshape.samples.size(); ++a) {
-			//	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << tshape.samples[a] );
-			//}
-			waveform.resize(tshape.numUncompressedSamples);
-			if (!decompressShape(tshape,&waveform[0])) return false;
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Time shape uncompressed to " << tshape.numUncompressedSamples << " samples" );
-			//block->gradExtTrapForms[iC-GX].first = std::vector<float>(waveform); 
-			block->gradExtTrapForms[iC-GX].first.resize(waveform.size());
-			for (int i=0;i<waveform.size();++i)
-				block->gradExtTrapForms[iC-GX].first[i]=long(0.5+m_dGradientRasterTime_us*waveform[i]); // convert to long usec from grad rasters 
+			std::shared_ptr<const std::vector<long> > times = getDecodedExtTrapTimes(block->grad[iC-GX].timeShape);
+			if (!times) return false;
 			// now wave amplitude shape
-			CompressedShape& wshape = m_shapeLibrary[block->grad[iC-GX].waveShape];
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded wave shape " << block->grad[iC-GX].waveShape << " with " << wshape.samples.size() << " compressed samples" );
-			waveform.resize(wshape.numUncompressedSamples);
-			if (!decompressShape(wshape,&waveform[0])) return false;
-			print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Wave shape uncompressed to " << wshape.numUncompressedSamples << " samples" );
-			block->gradExtTrapForms[iC-GX].second = std::vector<float>(waveform);
-			if (block->gradExtTrapForms[iC-GX].first.size() != block->gradExtTrapForms[iC-GX].second.size()) {
+			std::shared_ptr<const std::vector<float> > shape = getDecodedExtTrapShape(block->grad[iC-GX].waveShape);
+			if (!shape) return false;
+			if (times->size() != shape->size()) {
 				print_msg(ERROR_MSG, std::ostringstream().flush() << "ERROR: uncompressed extended trapezoid time and wave shape lengths do not match" );
 				return false;
 			}
+			block->gradExtTrapTimes[iC-GX] = times;
+			block->gradExtTrapShapes[iC-GX] = shape;
 		}
 	}
 	return true;
 }
 
 /***********************************************************/
-bool ExternalSequence::decompressShape(CompressedShape& encoded, float *shape)
+std::shared_ptr<const std::vector<float> > ExternalSequence::getDecodedRFShape(int shapeID, int timeShapeID, bool isPhase)
+{
+	const DecodedShapeKey key(isPhase ? DS_RF_PHASE : DS_RF_AMPLITUDE, shapeID, timeShapeID);
+	{
+		std::shared_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+		std::map<DecodedShapeKey, std::shared_ptr<const std::vector<float> > >::const_iterator it = m_decodedShapes.find(key);
+		if (it != m_decodedShapes.end())
+			return it->second;
+	}
+
+	// Decompress outside of the lock, concurrent decoders of the same shape produce identical samples
+	const CompressedShape& shape = findInLibrary(m_shapeLibrary, shapeID);
+	std::vector<float> waveform(shape.numUncompressedSamples);
+	if (!decompressShape(shape,&waveform[0]))
+		return std::shared_ptr<const std::vector<float> >();
+
+	if (isPhase) {
+		// Scale phase by 2pi
+		std::transform(
+			waveform.begin(),
+			waveform.end(),
+			waveform.begin(),
+			[](float x) { return x * static_cast<float>(TWO_PI); }
+		);
+	}
+
+	if (timeShapeID)
+	{
+		const CompressedShape& shapeTime = findInLibrary(m_shapeLibrary, timeShapeID);
+		// regularly sampled shapes are used as they are, the dwell time is set by decodeBlock()
+		if (!(shapeTime.samples.size()!=shapeTime.numUncompressedSamples &&
+			  (shapeTime.samples.size()==3 || shapeTime.samples.size()==4)))
+		{
+			std::vector<float> waveform_t;
+			waveform_t.resize(shapeTime.numUncompressedSamples);
+			if (!decompressShape(shapeTime,&waveform_t[0]))
+				return std::shared_ptr<const std::vector<float> >();
+			// we resample the input on the fly 
+			// for now we just use the RF raster time
+			int nSamples=int(0.5+waveform_t.back());
+			// for now we use nearest neighbour/right repetition interpolation
+			// FIXME/TODO: convert to complex, use linear interpolation and convert back to magnitude&phase
+			std::vector<float> wv(nSamples);
+			int tc=0;
+			for(int c=0;c<nSamples;++c)
+			{
+				if(waveform_t[tc]<(c+1)) 
+				{
+					if (tc<waveform_t.size())
+						++tc;
+				}
+				wv[c]=waveform[tc];
+			}
+			// replace the waveform
+			waveform.swap(wv);
+		}
+	}
+
+	checkRF(waveform, isPhase);
+
+	std::unique_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+	return m_decodedShapes.emplace(key, std::make_shared<const std::vector<float> >(std::move(waveform))).first->second;
+}
+
+/***********************************************************/
+std::shared_ptr<const std::vector<float> > ExternalSequence::getDecodedGradShape(int shapeID, bool oversampling)
+{
+	const DecodedShapeKey key(DS_GRAD_ARBITRARY, shapeID, oversampling ? 1 : 0);
+	{
+		std::shared_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+		std::map<DecodedShapeKey, std::shared_ptr<const std::vector<float> > >::const_iterator it = m_decodedShapes.find(key);
+		if (it != m_decodedShapes.end())
+			return it->second;
+	}
+
+	// Decompress the arbitrary shape
+	const CompressedShape& shape = findInLibrary(m_shapeLibrary, shapeID);
+
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded shape with "
+		<< shape.samples.size() << " compressed samples" );
+
+	std::vector<float> waveform(shape.numUncompressedSamples);
+	if (!decompressShape(shape,&waveform[0]))
+		return std::shared_ptr<const std::vector<float> >();
+
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape uncompressed to "
+		<< shape.numUncompressedSamples << " samples" );
+
+	if (fabs(m_dGradientRasterTime_us-10)>1e-3)
+	{
+		print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Shape is on a raster that is different from the system raster, exitting... (will try resampling in the future versions...)" );
+		// TODO: !!!
+		// PROBLEM: we need 'first' and 'last' to be able to interpolate correctly...
+		return std::shared_ptr<const std::vector<float> >();
+	}
+
+	if (oversampling)
+	{
+		std::vector<float> decimated((waveform.size()+1)/2);
+		std::vector<float>::iterator it_os=waveform.begin();
+		for (std::vector<float>::iterator it=decimated.begin(); it !=decimated.end(); ++it){
+			*it=*it_os;
+			// std::advance(it_os,2); // this doen't work because of the odd number of elements 
+			++it_os;
+			if (it_os!=waveform.end())
+				++it_os;
+		}
+		waveform.swap(decimated);
+	}
+
+	checkGradient(waveform);
+
+	std::unique_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+	return m_decodedShapes.emplace(key, std::make_shared<const std::vector<float> >(std::move(waveform))).first->second;
+}
+
+/***********************************************************/
+std::shared_ptr<const std::vector<float> > ExternalSequence::getDecodedExtTrapShape(int shapeID)
+{
+	const DecodedShapeKey key(DS_EXTTRAP_SHAPE, shapeID, 0);
+	{
+		std::shared_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+		std::map<DecodedShapeKey, std::shared_ptr<const std::vector<float> > >::const_iterator it = m_decodedShapes.find(key);
+		if (it != m_decodedShapes.end())
+			return it->second;
+	}
+
+	const CompressedShape& wshape = findInLibrary(m_shapeLibrary, shapeID);
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded wave shape " << shapeID << " with " << wshape.samples.size() << " compressed samples" );
+	std::vector<float> waveform(wshape.numUncompressedSamples);
+	if (!decompressShape(wshape,&waveform[0]))
+		return std::shared_ptr<const std::vector<float> >();
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Wave shape uncompressed to " << wshape.numUncompressedSamples << " samples" );
+
+	std::unique_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+	return m_decodedShapes.emplace(key, std::make_shared<const std::vector<float> >(std::move(waveform))).first->second;
+}
+
+/***********************************************************/
+std::shared_ptr<const std::vector<long> > ExternalSequence::getDecodedExtTrapTimes(int timeShapeID)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+		std::map<int, std::shared_ptr<const std::vector<long> > >::const_iterator it = m_decodedTimeShapes.find(timeShapeID);
+		if (it != m_decodedTimeShapes.end())
+			return it->second;
+	}
+
+	const CompressedShape& tshape = findInLibrary(m_shapeLibrary, timeShapeID);
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Loaded time shape " << timeShapeID << " with " << tshape.samples.size() << " compressed samples" );
+	std::vector<float> waveform(tshape.numUncompressedSamples);
+	if (!decompressShape(tshape,&waveform[0]))
+		return std::shared_ptr<const std::vector<long> >();
+	print_msg(DEBUG_LOW_LEVEL, std::ostringstream().flush() << "Time shape uncompressed to " << tshape.numUncompressedSamples << " samples" );
+	std::vector<long> times(waveform.size());
+	for (int i=0;i<waveform.size();++i)
+		times[i]=long(0.5+m_dGradientRasterTime_us*waveform[i]); // convert to long usec from grad rasters 
+
+	std::unique_lock<std::shared_mutex> lock(m_decodedShapeMutex);
+	return m_decodedTimeShapes.emplace(timeShapeID, std::make_shared<const std::vector<long> >(std::move(times))).first->second;
+}
+
+/***********************************************************/
+bool ExternalSequence::decompressShape(const CompressedShape& encoded, float *shape)
 {
 	if (!encoded.isCompressed) {
 		memcpy(shape,&encoded.samples.front(),sizeof(float)*encoded.numUncompressedSamples);
 		return true;
 	}
 	// need to uncompress
-	float *packed = &encoded.samples[0];
+	const float *packed = &encoded.samples[0];
 	int numPacked = encoded.samples.size();
 	int numSamples = encoded.numUncompressedSamples;
 
@@ -1570,81 +2402,29 @@ bool ExternalSequence::checkBlockReferences(EventIDs& events)
 }
 
 /***********************************************************/
-void ExternalSequence::checkGradient(SeqBlock& block)
+void ExternalSequence::checkGradient(std::vector<float>& waveform)
 {
-	for (unsigned int i=0; i<NUM_GRADS; i++)
+	for (unsigned j=0; j<waveform.size(); j++)
 	{
-		std::vector<float> &waveform = block.gradWaveforms[i];
-		for (unsigned j=0; j<waveform.size(); j++)
-		{
-			if (waveform[j]>1.0)  waveform[j]= 1.0;
-			if (waveform[j]<-1.0) waveform[j]=-1.0;
-		}
-		// Ensure last point is zero // MZ: no, its wrong! trapezoid gradients have a non-zero at the end!
-		// if (waveform.size()>0) waveform[waveform.size()-1]=0.0;
+		if (waveform[j]>1.0)  waveform[j]= 1.0;
+		if (waveform[j]<-1.0) waveform[j]=-1.0;
 	}
+	// Ensure last point is zero // MZ: no, its wrong! trapezoid gradients have a non-zero at the end!
+	// if (waveform.size()>0) waveform[waveform.size()-1]=0.0;
 }
 
 
 /***********************************************************/
-void ExternalSequence::checkRF(SeqBlock& block)
+void ExternalSequence::checkRF(std::vector<float>& waveform, bool isPhase)
 {
-	for (unsigned int i=0; i<block.rfAmplitude.size(); i++)
+	for (unsigned int i=0; i<waveform.size(); i++)
 	{
-		if (block.rfAmplitude[i]>1.0) block.rfAmplitude[i]=1.0;
-		if (block.rfAmplitude[i]<0.0) block.rfAmplitude[i]=0.0;
-		if (block.rfPhase[i]>TWO_PI-1.e-4) block.rfPhase[i]=(float)(TWO_PI-1.e-4);
-		if (block.rfPhase[i]<0) block.rfPhase[i]=0.0;
-	}
-}
-
-
-/***********************************************************/
-int ExternalSequence::getline(std::istream& is, char *buffer, int MAX_SIZE, bool bRaw)
-{
-	//std::cout << "ExternalSequence::getline()" << std::endl;
-
-	int i=0;	// Current position in buffer
-	for(;;) {
-		char c = (char)is.get();
-
-		if (!bRaw) {
-            switch (c) {
-                case '\n':
-                    buffer[i] = '\0';
-                    // std::cout << "ExternalSequence::getline() EOL i:" << i << std::endl;
-                    // std::cout << "buffer: " << buffer << std::endl;
-                    return gl_true;
-                case '\r':
-                    if (is.peek() == '\n')
-                    {
-                        is.get(); // Discard character
-                    }
-                    buffer[i] = '\0';
-                    // std::cout << "ExternalSequence::getline() CR i:" << i << std::endl;
-                    // std::cout << "buffer: " << buffer << std::endl;
-                    return gl_true;
-            }
-		}
-        switch (c) {
-			case EOF:
-				if(i==0)
-					is.seekg(-1);   // Create error on stream
-				buffer[i]='\0';     // In case last line has no line ending
-				//std::cout << "ExternalSequence::getline() EOF i:" << i << std::endl;
-				return (i!=0)?gl_true:gl_false;
-			default:
-				buffer[i++] = c;
-				if (i>=MAX_SIZE-1 || // -1 because we have to reserve one place for the \0 symbol
-					c=='\n' )        // we are in the *raw* mode
-				{
-					buffer[i]='\0';
-                    if (c == '\n')
-                        return gl_true;
-                    else
-						return gl_truncated;
-				}
-				
+		if (isPhase) {
+			if (waveform[i]>TWO_PI-1.e-4) waveform[i]=(float)(TWO_PI-1.e-4);
+			if (waveform[i]<0) waveform[i]=0.0;
+		} else {
+			if (waveform[i]>1.0) waveform[i]=1.0;
+			if (waveform[i]<0.0) waveform[i]=0.0;
 		}
 	}
 }
@@ -1797,9 +2577,9 @@ bool ExternalSequence::isGradientInBlockStartAtNonZero(SeqBlock *block, int chan
 		return fabs(block->grad[channel].first)>0;
 	}
 	// older formats
-	if (!block->gradWaveforms[channel].empty()) { 
-		//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() uses decompressed shape and returns " << (fabs(block->gradWaveforms[channel].front())>0));
-		return fabs(block->gradWaveforms[channel].front())>0;
+	if (block->gradWaveforms[channel] && !block->gradWaveforms[channel]->empty()) { 
+		//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() uses decompressed shape and returns " << (fabs(block->gradWaveforms[channel]->front())>0));
+		return fabs(block->gradWaveforms[channel]->front())>0;
 	}
 	// we could decode the block's shapes at this point, but we can also just look up the first sample of the compressed shape
 	//ExternalSequence::print_msg(NORMAL_MSG, std::ostringstream().flush() << "isGradientInBlockStartAtNonZero() uses compressed shape and returns " << (fabs(m_shapeLibrary[block->grad[channel].waveShape].samples.front())>0));
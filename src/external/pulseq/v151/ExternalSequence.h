@@ -1,5 +1,6 @@
 /** @file ExternalSequence.h */
 
+#include <cstddef>
 #include <vector>
 #include <iostream>
 #include <string>
@@ -7,6 +8,11 @@
 #include <fstream>
 #include <set>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <shared_mutex>
+#include <tuple>
 //#include <limits>	    // for std::numeric_limits<...>::quiet_NaN()
 
 #ifndef _EXTERNAL_SEQUENCE_H_
@@ -427,10 +433,7 @@ public:
 	/**
 	 * @brief Constructor
 	 */
-	SeqBlock() { 
-		gradWaveforms.resize(NUM_GRADS);
-		gradExtTrapForms.resize(NUM_GRADS);
-	}
+	SeqBlock() {}
 
 	/**
 	 * @brief Return `true` if block has RF event
@@ -528,7 +531,7 @@ public:
 	/**
 	 * @brief Directly get a pointer to the samples of the arbitrary gradient
 	 */
-	float* GetArbGradShapePtr(int channel);
+	const float* GetArbGradShapePtr(int channel);
 
 	/**
 	 * @brief Return the timening and the shape of the ExtTrp grdient on the given gradient channel.
@@ -560,12 +563,12 @@ public:
 	/**
 	 * @brief Directly get a pointer to the samples of the RF amplitude shape
 	 */
-	float* GetRFAmplitudePtr();
+	const float* GetRFAmplitudePtr();
 
 	/**
 	 * @brief Directly get a pointer to the samples of the RF phase shape
 	 */
-	float* GetRFPhasePtr();
+	const float* GetRFPhasePtr();
 
 	/**
 	 * @brief Get dwell time for the RF amplitude and phase shapes (in us)
@@ -656,18 +659,30 @@ protected:
     RfShimmingEvent rfShim;     /**< @brief optional array of RF shimming events */
 	std::vector<LabelEvent> labelinc;    /**< @brief labelinc event, can be more than one */ // MZ: TODO: check if we should switch to storing only IDs in the library
 	std::vector<LabelEvent> labelset;    /**< @brief labelset event, can be more than one */ // MZ: TODO: check if we should switch to storing only IDs in the library
-	// Below is only valid once decompressed:
+	// Below is only valid once decompressed.
+	// The samples are owned by the decoded-shape store of ExternalSequence and shared
+	// between all blocks using the same shape; a block only holds a reference.
 
 	// RF
-	std::vector<float> rfAmplitude;    /**< @brief RF amplitude shape (uncompressed) */
-	std::vector<float> rfPhase;        /**< @brief RF phase shape (uncompressed) */
+	std::shared_ptr<const std::vector<float> > rfAmplitude;    /**< @brief RF amplitude shape (uncompressed) */
+	std::shared_ptr<const std::vector<float> > rfPhase;        /**< @brief RF phase shape (uncompressed) */
 	float              rfDwellTime_us; /**< @brief dwell time of the RF shapes (in us) */
 
 	// Gradient waveforms
-	std::vector< std::vector<float> > gradWaveforms;    /**< @brief Arbitrary gradient shapes for each channel (uncompressed) */
+	std::shared_ptr<const std::vector<float> > gradWaveforms[NUM_GRADS];    /**< @brief Arbitrary gradient shapes for each channel (uncompressed) */
 
 	// ExtTrap waveforms
-	std::vector< std::pair< std::vector< long >, std::vector< float > > > gradExtTrapForms;    /**< @brief ExtTrap gradient shapes for each channel (uncompressed) */
+	std::shared_ptr<const std::vector<long> >  gradExtTrapTimes[NUM_GRADS];   /**< @brief ExtTrap gradient time points for each channel (in us) */
+	std::shared_ptr<const std::vector<float> > gradExtTrapShapes[NUM_GRADS];  /**< @brief ExtTrap gradient amplitudes for each channel (uncompressed) */
+
+	/**
+	 * @brief Dereference a shared shape, falling back to an empty vector
+	 */
+	template<typename T>
+	static const std::vector<T>& sharedOrEmpty(const std::shared_ptr<const std::vector<T> >& shape) {
+		static const std::vector<T> empty;
+		return shape ? *shape : empty;
+	}
 
 	// static for the duraton raster
 	static double s_blockDurationRaster;
@@ -729,24 +744,27 @@ inline std::string SeqBlock::GetTypeString() {
 	return type;
 }
 
-inline float*    SeqBlock::GetArbGradShapePtr(int channel) { return (gradWaveforms[channel].size()>0) ? &gradWaveforms[channel][0] : NULL; }
-inline int       SeqBlock::GetArbGradNumSamples(int channel) {	return gradWaveforms[channel].size(); }
+inline const float* SeqBlock::GetArbGradShapePtr(int channel) { return sharedOrEmpty(gradWaveforms[channel]).empty() ? NULL : gradWaveforms[channel]->data(); }
+inline int       SeqBlock::GetArbGradNumSamples(int channel) {	return sharedOrEmpty(gradWaveforms[channel]).size(); }
 
-inline const std::vector<long>&  SeqBlock::GetExtTrapGradTimes(int channel) { return gradExtTrapForms[channel].first; }
-inline const std::vector<float>& SeqBlock::GetExtTrapGradShape(int channel) { return gradExtTrapForms[channel].second; }
+inline const std::vector<long>&  SeqBlock::GetExtTrapGradTimes(int channel) { return sharedOrEmpty(gradExtTrapTimes[channel]); }
+inline const std::vector<float>& SeqBlock::GetExtTrapGradShape(int channel) { return sharedOrEmpty(gradExtTrapShapes[channel]); }
 
-inline float*    SeqBlock::GetRFAmplitudePtr() { return &rfAmplitude[0]; }
-inline float*    SeqBlock::GetRFPhasePtr() { return &rfPhase[0]; }
-inline int       SeqBlock::GetRFLength() { return rfAmplitude.size(); }
+inline const float* SeqBlock::GetRFAmplitudePtr() { return sharedOrEmpty(rfAmplitude).empty() ? NULL : rfAmplitude->data(); }
+inline const float* SeqBlock::GetRFPhasePtr() { return sharedOrEmpty(rfPhase).empty() ? NULL : rfPhase->data(); }
+inline int       SeqBlock::GetRFLength() { return sharedOrEmpty(rfAmplitude).size(); }
 inline float     SeqBlock::GetRFDwellTime() { return rfDwellTime_us; }
 inline double SeqBlock::getBlockDurationRaster() {return SeqBlock::s_blockDurationRaster; }
 
 inline void      SeqBlock::free() {
-	// Force the memory to be freed
-	std::vector<float>().swap(rfAmplitude);
-	std::vector<float>().swap(rfPhase);
-	std::vector<std::vector<float> >().swap(gradWaveforms);
-	std::vector<std::pair<std::vector<long>,std::vector<float> > >().swap(gradExtTrapForms);
+	// Drop the references; the samples are released with the last block using them
+	rfAmplitude.reset();
+	rfPhase.reset();
+	for (int i=0; i<NUM_GRADS; i++) {
+		gradWaveforms[i].reset();
+		gradExtTrapTimes[i].reset();
+		gradExtTrapShapes[i].reset();
+	}
  }
 
 
@@ -842,6 +860,33 @@ class ExternalSequence
 	enum load_mode {lm_singlefile=0, lm_shapes, lm_events, lm_blocks};
 	bool load(std::istream &data_stream, load_mode loadMose = lm_singlefile);
 
+	/**
+	 * @brief Load the sequence from text already in memory (e.g. a memory-mapped file)
+	 *
+	 * The text is indexed and parsed in place; nothing refers to it after the call returns.
+	 *
+	 * @param  data  start of the sequence text (need not be null terminated)
+	 * @param  size  length of the text in bytes
+	 */
+	bool load_from_memory(const char* data, std::size_t size, load_mode loadMode = lm_singlefile);
+
+	/**
+	 * @brief Append a binary snapshot of the parsed sequence to a byte string
+	 *
+	 * Holds the definitions, signature, block table and all libraries in a versioned format,
+	 * written field by field as fixed-width numbers and 8-byte aligned arrays, so a cache of
+	 * previously loaded files can restore a sequence without parsing its text.
+	 * The result of the signature check is not part of the snapshot.
+	 */
+	void saveSnapshot(std::string& out) const;
+
+	/**
+	 * @brief Restore a sequence from a snapshot written by saveSnapshot()
+	 *
+	 * @return false (leaving the sequence empty) if the snapshot is damaged or has another version
+	 */
+	bool loadSnapshot(const char* data, std::size_t size);
+
 	/**
 	 * @brief Report the version of the loaded sequence
 	 *
@@ -929,16 +974,28 @@ class ExternalSequence
 	 *
 	 * Events are loaded from the library. However, arbitrary waveforms are
 	 * not decoded until decodeBlock() is called.
+	 * The libraries are only read, so different blocks may be fetched
+	 * concurrently once load() has returned.
 	 *
 	 * @see decodeBlock()
 	 */
 	SeqBlock*  GetBlock(int blockIndex);
 
+	/**
+	 * @brief Fill an existing block object from the library events
+	 *
+	 * Same as GetBlock(int), but the caller provides the storage, so blocks can live in
+	 * contiguous arrays and be recycled without a heap allocation per block. Any shapes
+	 * still held by the block are released first.
+	 */
+	void       GetBlock(int blockIndex, SeqBlock *block);
+
 	/**
 	 * @brief Decode a block by looking up indexed events
 	 *
 	 * This involves assigning the block's event objects from the libraries
 	 * as well as decompressing arbitrary RF and gradient shapes.
+	 * Like GetBlock(), it is safe to decode different blocks in parallel.
 	 *
 	 * @return true if successful
 	 */
@@ -972,6 +1029,45 @@ class ExternalSequence
 
 	bool isSignatureCheckSucceeded();
 
+	/**
+	 * @brief Enable or disable hashing the text while it is loaded (enabled by default)
+	 *
+	 * With the check disabled, load() only records the signed range of the text (see GetSignedSize())
+	 * and the caller may verify it later, e.g. on another thread, with CalculateMD5() and
+	 * SetCalculatedSignature().
+	 */
+	void SetSignatureCheck(bool enabled) { m_bSignatureCheck = enabled; }
+
+	/**
+	 * @brief Number of leading bytes of the loaded text covered by the [SIGNATURE] hash
+	 */
+	std::size_t GetSignedSize() const { return m_signedSize; }
+
+	/**
+	 * @brief Find the signed range of a text without loading it
+	 *
+	 * Applies the same rule as load(), so a check can start hashing before (or while) the text
+	 * is parsed.
+	 *
+	 * @param  signedSize  set to the number of leading bytes covered by the [SIGNATURE] hash
+	 * @return false if the text has no [SIGNATURE] section
+	 */
+	static bool FindSignedSize(const char* data, std::size_t size, std::size_t& signedSize);
+
+	/**
+	 * @brief MD5 of a text as lower-case hex, hashed in large chunks
+	 *
+	 * @param  cancelled  optional, polled between chunks; the result is empty if it returns true
+	 */
+	static std::string CalculateMD5(const char* data, std::size_t size, const std::function<bool()>& cancelled = std::function<bool()>());
+
+	/**
+	 * @brief Store the hash calculated for the signed text and compare it with the [SIGNATURE] section
+	 *
+	 * @return the new state of isSignatureCheckSucceeded()
+	 */
+	bool SetCalculatedSignature(const std::string& hash);
+
 	bool usesRfShimExtension();
     bool getRfShimEventByID(int id, RfShimmingEvent& rfse); 
 	
@@ -983,46 +1079,75 @@ class ExternalSequence
 	// *** Private helper functions ***
 
 	/**
-	 * @brief Read a line from the input stream *independent of line ending*.
+	 * @brief Search the text for section headers e.g. [RF], [GRAD] etc
 	 *
-	 * Unlike istream::getline(), this function safely handles three
-	 * different line endings:
-	 *  - Unix/OSX (\\n)
-	 *  - Windows (\\r\\n)
-	 *  - Old Mac (\\r)
-	 *
-	 * @param stream the input file stream to read from
-	 * @param buffer the output line buffer (null terminated)
-	 * @param MAX_SIZE maximum size of the buffer
+	 * Single pass over the buffer that writes the section offsets to the index and records
+	 * the part preceding the [SIGNATURE] section, which it hashes if the signature check is enabled
 	 */
-	// MZ: VC2008 / VD13 do not seem to properly handle the errors streams
-	//static std::istream& 
-	enum gl_ret {gl_false=0, gl_true, gl_truncated};
-    static int getline(std::istream& stream, char* buffer, const int MAX_SIZE, bool bRaw=false);
+	void buildFileIndex(const char* data, std::size_t size);
 
 	/**
-	 * @brief Search the file stream for section headers e.g. [RF], [GRAD] etc
-	 *
-	 * Searches forward in the stream for sections enclosed in square brackets
-	 * and writes to index
+	 * @brief Compare the calculated hash with the one from the [SIGNATURE] section
+	 */
+	void checkSignature();
+
+	/**
+	 * @brief Offset of the first line of a section in the indexed text
+	 * @return false if the section is not present
 	 */
-	void buildFileIndex(std::istream &stream);
+	bool findSection(const char* name, std::size_t& offset) const;
 
 	/**
-	 * @brief Skip the comments and empty lines in the given input stream.
+	 * @brief End of the section starting at offset: the index entry of the following section or the end of the file
+	 */
+	std::size_t sectionEnd(std::size_t offset) const;
+
+	/**
+	 * @brief Split [begin, end) of a section into about numChunks line-aligned pieces
 	 *
-	 * @param stream the input file stream to process
-	 * @param buffer return output buffer of next non-comment line
+	 * With a line prefix, pieces only start at lines beginning with it (e.g. "shape_id").
+	 * Splitting stops at the next section header.
+	 * @return the chunk boundaries, starting with begin and ending with end
 	 */
-	void skipComments(std::istream &stream, char* buffer);
+	static std::vector<std::size_t> splitSection(const char* data, std::size_t begin, std::size_t end, int numChunks, const char* linePrefix);
 
 	/**
-	 * @brief Strip any empty characters at th beginning or at the end of the string.
+	 * @brief Part of the [SHAPES] or [BLOCKS] section read by one worker
 	 *
-	 * @param buffer input line
-	 * @return modified string
+	 * Chunks are parsed independently and merged in file order. A chunk in which the
+	 * section ends (empty line or next header) is flagged so that later chunks are discarded,
+	 * and errors are kept as text until the merge decides whether the chunk counts.
+	 */
+	struct ShapeChunk
+	{
+		std::size_t begin, end;
+		std::vector<std::pair<int,CompressedShape> > shapes;
+		bool sectionEnded;
+		std::string error;
+	};
+	struct BlockChunk
+	{
+		std::size_t begin, end;
+		std::vector<EventIDs> blocks;
+		std::vector<long> durations;
+		bool sectionEnded;
+		std::string error;
+		std::size_t firstInvalid;	/**< @brief index (in the chunk) of the first block with undefined event references */
+	};
+	void readShapeChunk(const char* data, ShapeChunk& chunk) const;
+	void readBlockChunk(const char* data, BlockChunk& chunk) const;
+
+	/**
+	 * @brief Readers of the event library sections
+	 *
+	 * Each fills only its own library, so they run concurrently during load_from_memory().
+	 * They return false (after printing the error) on a malformed entry.
 	 */
-	char* stripWhiteSpace(char *buffer);
+	bool readRFSection(const char* data, std::size_t size);
+	bool readGradientSections(const char* data, std::size_t size); // [GRADIENTS] and [TRAP]
+	bool readADCSection(const char* data, std::size_t size);
+	bool readDelaySection(const char* data, std::size_t size);
+	bool readExtensionSection(const char* data, std::size_t size);
 
 	/**
 	 * @brief Decompress a run-length compressed shape
@@ -1030,7 +1155,25 @@ class ExternalSequence
 	 * @param encoded Compressed shape structure
 	 * @param shape array of floating-point values (must be preallocated!)
 	 */
-	bool decompressShape(CompressedShape& encoded, float *shape);
+	bool decompressShape(const CompressedShape& encoded, float *shape);
+
+	/**
+	 * @brief Look up a library entry without inserting missing IDs
+	 *
+	 * Unlike std::map::operator[] this never modifies the library, which keeps
+	 * GetBlock() and decodeBlock() free of writes to shared state.
+	 *
+	 * @param  library Event or shape library
+	 * @param  id      Library ID
+	 * @return the entry, or a value-initialized object if the ID is unknown
+	 */
+	template<typename T>
+	static const T& findInLibrary(const std::map<int,T>& library, int id)
+	{
+		static const T empty = T();
+		typename std::map<int,T>::const_iterator it = library.find(id);
+		return (it != library.end()) ? it->second : empty;
+	}
 
 
 	/**
@@ -1043,24 +1186,58 @@ class ExternalSequence
 	bool checkBlockReferences(EventIDs& events);
 
 	/**
-	 * @brief Check the shapes defining the arbitrary gradient events (if present)
+	 * @brief Check the shape defining an arbitrary gradient event
 	 *
-	 * Check the *decompressed* amplitude of the given block is
-	 * between [0 1].
-	 * @param  block The sequence block to check
+	 * Clamp the *decompressed* amplitude to [-1 1].
+	 * @param  waveform The decompressed gradient shape
 	 * @see checkRF()
 	 */
-	void checkGradient(SeqBlock& block);
+	void checkGradient(std::vector<float>& waveform);
 
 	/**
-	 * @brief Check the shapes defining the RF event (if present)
+	 * @brief Check a shape defining the RF event
 	 *
-	 * Check the *decompressed* RF amplitude of the given block is
-	 * between [0 1] and the phase between [0 2pi].
-	 * @param  block The sequence block to check
+	 * Clamp the *decompressed* RF amplitude to [0 1] or the phase to [0 2pi].
+	 * @param  waveform The decompressed RF shape
+	 * @param  isPhase  true for the phase shape
 	 * @see checkGradient()
 	 */
-	void checkRF(SeqBlock& block);
+	void checkRF(std::vector<float>& waveform, bool isPhase);
+
+	/**
+	 * @brief Kinds of entries in the decoded-shape store
+	 */
+	enum DecodedShapeKind { DS_RF_AMPLITUDE=0, DS_RF_PHASE, DS_GRAD_ARBITRARY, DS_EXTTRAP_SHAPE };
+
+	/**
+	 * @brief Key of the decoded-shape store: (kind, shape ID, auxiliary ID)
+	 *
+	 * The auxiliary ID is the time shape for RF shapes and the oversampling flag
+	 * for arbitrary gradients, i.e. everything that changes the decoded samples.
+	 */
+	typedef std::tuple<int,int,int> DecodedShapeKey;
+
+	/**
+	 * @brief Return the decoded RF amplitude or phase shape, decoding it on first use
+	 *
+	 * Decompresses, scales (phase), resamples to the RF raster for non-uniform
+	 * time shapes and clamps the samples. The result is shared by all blocks.
+	 * @return the shared samples or an empty pointer on failure
+	 */
+	std::shared_ptr<const std::vector<float> > getDecodedRFShape(int shapeID, int timeShapeID, bool isPhase);
+
+	/**
+	 * @brief Return the decoded arbitrary gradient shape, decoding it on first use
+	 * @return the shared samples or an empty pointer on failure
+	 */
+	std::shared_ptr<const std::vector<float> > getDecodedGradShape(int shapeID, bool oversampling);
+
+	/**
+	 * @brief Return the decoded ExtTrap amplitude shape or time points (in us), decoding them on first use
+	 * @return the shared samples or an empty pointer on failure
+	 */
+	std::shared_ptr<const std::vector<float> > getDecodedExtTrapShape(int shapeID);
+	std::shared_ptr<const std::vector<long> >  getDecodedExtTrapTimes(int timeShapeID);
 
 	/**
 	 * @brief Check the IDs contains references to valid labels in the library
@@ -1090,8 +1267,8 @@ class ExternalSequence
 	int version_revision;
 	int version_combined;
 
-	std::map<std::string,int> m_fileIndex;     /**< @brief File location of sections, [RF], [ADC] etc */
-	std::set<int> m_fileSections;              /**< @brief File location of sections and EOF additionally */
+	std::map<std::string,std::size_t> m_fileIndex; /**< @brief File location of sections, [RF], [ADC] etc */
+	std::set<std::size_t> m_fileSections;          /**< @brief File location of sections and EOF additionally */
 
 	// Low level sequence blocks
 	std::vector<EventIDs> m_blocks;            /**< @brief List of sequence blocks */
@@ -1111,9 +1288,11 @@ class ExternalSequence
 	std::string m_strSignature;
 	std::string m_strSignatureType;
 
-	// pulseq file MD5 signature calculated during file loading
+	// pulseq file MD5 signature calculated during file loading (or later, see SetSignatureCheck())
 	std::string m_strCalculatedMD5Signature;
 	bool m_bSignatureCheckSucceeded;
+	bool m_bSignatureCheck;   /**< @brief Hash the text while loading it */
+	std::size_t m_signedSize; /**< @brief Length of the text covered by the signature */
 
 	// List of events (referenced by blocks)
 	std::map<int,RFEvent>      m_rfLibrary;       /**< @brief Library of RF events */
@@ -1133,6 +1312,11 @@ class ExternalSequence
     
     // List of basic shapes (referenced by events)
 	std::map<int,CompressedShape> m_shapeLibrary;    /**< @brief Library of compressed shapes */
+
+	// Decoded-shape store: every shape is decompressed once and shared by all blocks referencing it
+	std::map<DecodedShapeKey, std::shared_ptr<const std::vector<float> > > m_decodedShapes;  /**< @brief Decoded RF/gradient shapes */
+	std::map<int, std::shared_ptr<const std::vector<long> > > m_decodedTimeShapes;            /**< @brief Decoded ExtTrap time points (us) */
+	std::shared_mutex m_decodedShapeMutex;   /**< @brief Guards the decoded-shape store during concurrent decodeBlock() calls */
 	// raster times
 	double m_dAdcRasterTime_us; // Siemens default: 1e-07s 
 	double m_dGradientRasterTime_us; // Siemens default: 1e-05s 
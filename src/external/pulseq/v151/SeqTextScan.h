@@ -0,0 +1,253 @@
+/** @file SeqTextScan.h - Line and number scanning over an in-memory Pulseq text */
+
+#ifndef _SEQ_TEXT_SCAN_H_
+#define _SEQ_TEXT_SCAN_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+/**
+ * @brief One line of the sequence text, [begin, end) without the line terminator
+ *
+ * Lines are views into the loaded buffer; nothing is copied while scanning.
+ */
+struct SeqLine
+{
+	const char* begin;
+	const char* end;
+
+	SeqLine() : begin(NULL), end(NULL) {}
+	SeqLine(const char* b, const char* e) : begin(b), end(e) {}
+
+	bool empty() const { return begin==end; }
+	std::size_t length() const { return std::size_t(end-begin); }
+	char first() const { return begin<end ? *begin : '\0'; }
+	bool startsWith(const char* prefix) const
+	{
+		const std::size_t n=strlen(prefix);
+		return length()>=n && 0==memcmp(begin,prefix,n);
+	}
+	bool equals(const char* text) const
+	{
+		return length()==strlen(text) && 0==memcmp(begin,text,length());
+	}
+	std::string str() const { return std::string(begin,end); }
+};
+
+/**
+ * @brief Forward reader over the lines of a text buffer
+ *
+ * Handles the same three line endings as ExternalSequence used to (\\n, \\r\\n and \\r).
+ * Positions are byte offsets into the buffer, as stored in the section index.
+ */
+class SeqLineReader
+{
+public:
+	SeqLineReader(const char* data, std::size_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+	/**
+	 * @brief Read the next line; returns false at the end of the buffer
+	 */
+	bool next(SeqLine& line)
+	{
+		if (m_pos>=m_size)
+			return false;
+		const char* b=m_data+m_pos;
+		const char* end=m_data+m_size;
+		const char* e=b;
+		while (e<end && *e!='\n' && *e!='\r')
+			++e;
+		line=SeqLine(b,e);
+		if (e<end && *e=='\r' && e+1<end && e[1]=='\n')
+			e+=2;
+		else if (e<end)
+			e+=1;
+		m_pos=std::size_t(e-m_data);
+		return true;
+	}
+
+	/**
+	 * @brief Read the next line that is neither empty nor a comment
+	 */
+	bool nextContent(SeqLine& line, char commentChar)
+	{
+		while (next(line)) {
+			if (!line.empty() && line.first()!=commentChar)
+				return true;
+		}
+		return false;
+	}
+
+	std::size_t tell() const { return m_pos; }
+	void seek(std::size_t pos) { m_pos = pos<m_size ? pos : m_size; }
+
+private:
+	const char* m_data;
+	std::size_t m_size;
+	std::size_t m_pos;
+};
+
+/**
+ * @brief Whitespace-separated field scanner for one line
+ *
+ * A replacement for the sscanf() calls of the parser: every read skips leading whitespace
+ * and consumes one field, returning false (and leaving the output untouched) if the field
+ * is missing or malformed. Integers are parsed inline; floating-point values go through
+ * std::from_chars where the standard library provides it, so parsing is locale independent
+ * and never touches stdio.
+ */
+class SeqFieldScanner
+{
+public:
+	explicit SeqFieldScanner(const SeqLine& line) : m_p(line.begin), m_end(line.end) {}
+
+	bool readInt(int& value)
+	{
+		long long v;
+		if (!readInteger(v)) return false;
+		value=(int)v;
+		return true;
+	}
+
+	bool readLong(long& value)
+	{
+		long long v;
+		if (!readInteger(v)) return false;
+		value=(long)v;
+		return true;
+	}
+
+	bool readFloat(float& value)
+	{
+		double v;
+		if (!readDouble(v)) return false;
+		value=(float)v;
+		return true;
+	}
+
+	bool readDouble(double& value)
+	{
+		skipSpace();
+		const char* p=m_p;
+		if (p<m_end && *p=='+')
+			++p; // accepted by sscanf, not by from_chars
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+		double v=0.0;
+		std::from_chars_result res=std::from_chars(p,m_end,v);
+		if (res.ec==std::errc()) {
+			value=v;
+			m_p=res.ptr;
+			return true;
+		}
+		if (res.ec!=std::errc::result_out_of_range)
+			return false;
+#endif
+		// Fallback (and out-of-range values): strtod on a terminated copy of the token
+		char token[64];
+		std::size_t n=0;
+		while (p+n<m_end && n<sizeof(token)-1 && !isSpace(p[n])) {
+			token[n]=p[n];
+			++n;
+		}
+		token[n]='\0';
+		char* stop=NULL;
+		const double v2=strtod(token,&stop);
+		if (stop==token)
+			return false;
+		value=v2;
+		m_p=p+(stop-token);
+		return true;
+	}
+
+	/**
+	 * @brief Read a run of non-whitespace characters (like "%s")
+	 */
+	bool readWord(SeqLine& word)
+	{
+		skipSpace();
+		if (m_p>=m_end) return false;
+		const char* b=m_p;
+		while (m_p<m_end && !isSpace(*m_p))
+			++m_p;
+		word=SeqLine(b,m_p);
+		return true;
+	}
+
+	/**
+	 * @brief Read a word into a zero-terminated buffer of the given capacity
+	 */
+	bool readWord(char* buffer, std::size_t capacity)
+	{
+		SeqLine word;
+		if (capacity==0 || !readWord(word)) return false;
+		const std::size_t n = word.length()<capacity-1 ? word.length() : capacity-1;
+		memcpy(buffer,word.begin,n);
+		buffer[n]='\0';
+		return true;
+	}
+
+	/**
+	 * @brief Read a single non-whitespace character (like " %c")
+	 */
+	bool readChar(char& c)
+	{
+		skipSpace();
+		if (m_p>=m_end) return false;
+		c=*m_p++;
+		return true;
+	}
+
+	/**
+	 * @brief The unread part of the line with surrounding whitespace removed
+	 */
+	SeqLine rest()
+	{
+		skipSpace();
+		const char* e=m_end;
+		while (e>m_p && isSpace(e[-1]))
+			--e;
+		return SeqLine(m_p,e);
+	}
+
+	static bool isSpace(char c) { return c==' ' || c=='\t' || c=='\r' || c=='\n' || c=='\v' || c=='\f'; }
+
+private:
+	void skipSpace()
+	{
+		while (m_p<m_end && isSpace(*m_p))
+			++m_p;
+	}
+
+	bool readInteger(long long& value)
+	{
+		skipSpace();
+		const char* p=m_p;
+		bool negative=false;
+		if (p<m_end && (*p=='-' || *p=='+')) {
+			negative=(*p=='-');
+			++p;
+		}
+		if (p>=m_end || *p<'0' || *p>'9')
+			return false;
+		unsigned long long v=0;
+		while (p<m_end && *p>='0' && *p<='9') {
+			v=v*10+(unsigned long long)(*p-'0');
+			++p;
+		}
+		value = negative ? -(long long)v : (long long)v;
+		m_p=p;
+		return true;
+	}
+
+	const char* m_p;
+	const char* m_end;
+};
+
+#endif // _SEQ_TEXT_SCAN_H_
@@ -134,6 +134,7 @@ static void registerOptions(QCommandLineParser& parser, bool includeBuiltInHelpV
     parser.addOption(QCommandLineOption("headless", "Do not show GUI (for testing/CLI)"));
     parser.addOption(QCommandLineOption("exit-after-load", "Exit after loading file (no event loop). Implies --headless."));
     parser.addOption(QCommandLineOption("automation", "Run automation scenario JSON (implies --headless)", "scenario.json"));
+    parser.addOption(QCommandLineOption("no-signature-check", "Skip the [SIGNATURE] hash verification of loaded files"));
 
     // Positional argument for file
     parser.addPositionalArgument("file", "Pulseq sequence file (.seq) to open", "[file]");
@@ -323,6 +324,8 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet("no-signature-check")) window.getPulseqLoader()->setSignatureCheckEnabled(false);
+
     // Open file if specified
     if (!fileToOpen.isEmpty()) {
         // Silent mode if headless/exit-after-load
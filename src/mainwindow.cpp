@@ -30,6 +30,7 @@
 #include <QHBoxLayout>
 #include <QDir>
 #include <QResizeEvent>
+#include <QCloseEvent>
 #include <QTimer>
 #include <cmath>
 #include <limits>
@@ -226,6 +227,8 @@ MainWindow::MainWindow(QWidget* parent)
             this, &MainWindow::onSettingsChanged);
     connect(&Settings::getInstance(), &Settings::timeUnitChanged,
             this, &MainWindow::onTimeUnitChanged);
+    connect(&Settings::getInstance(), &Settings::gammaChanged,
+            m_pulseqLoader, &PulseqLoader::onGammaChanged);
 
     // 7. Install event filters
     m_trManager->installEventFilters();
@@ -294,6 +297,7 @@ MainWindow::~MainWindow()
     // Handlers are QObjects parented to MainWindow and will be deleted automatically.
     SAFE_DELETE(m_pVersionLabel);
     SAFE_DELETE(m_pProgressBar);
+    SAFE_DELETE(m_pCancelLoadButton);
     SAFE_DELETE(m_pCoordLabel);
     SAFE_DELETE(m_settingsDialog);
     delete ui;
@@ -371,6 +375,23 @@ void MainWindow::InitStatusBar()
     m_pProgressBar->setRange(0, 100);
     m_pProgressBar->setValue(0);
     ui->statusbar->addWidget(m_pProgressBar);
+
+    m_pCancelLoadButton = new QPushButton(tr("Cancel"), this);
+    m_pCancelLoadButton->setToolTip(tr("Cancel loading the sequence"));
+    m_pCancelLoadButton->hide();
+    ui->statusbar->addWidget(m_pCancelLoadButton);
+    connect(m_pCancelLoadButton, &QPushButton::clicked, m_pulseqLoader, &PulseqLoader::cancelLoad);
+}
+
+void MainWindow::setLoadInProgress(bool loading)
+{
+    // Only the parts that could touch the sequence are locked; the window itself stays
+    // enabled so it keeps repainting and the Cancel button remains clickable.
+    if (ui->centralwidget) ui->centralwidget->setEnabled(!loading);
+    if (menuBar()) menuBar()->setEnabled(!loading);
+    if (ui->toolBar) ui->toolBar->setEnabled(!loading);
+    setAcceptDrops(!loading);
+    if (m_pCancelLoadButton) m_pCancelLoadButton->setVisible(loading);
 }
 
 // Event handlers are now delegated to the InteractionHandler
@@ -406,6 +427,14 @@ bool MainWindow::eventFilter(QObject* obj, QEvent* event)
     return QMainWindow::eventFilter(obj, event);
 }
 
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    // Do not leave a worker decoding in the background of a closing window
+    if (m_pulseqLoader && m_pulseqLoader->isLoadInProgress())
+        m_pulseqLoader->cancelLoad();
+    QMainWindow::closeEvent(event);
+}
+
 void MainWindow::resizeEvent(QResizeEvent* event)
 {
     QMainWindow::resizeEvent(event);
@@ -452,29 +481,20 @@ void MainWindow::onTimeUnitChanged()
 {
     if (!m_pulseqLoader) return;
 
-    // Remember the current viewport range and tFactor before the reload.
+    // Rescale the loaded sequence in place instead of reloading it. The k-space trajectory is
+    // kept in seconds, so it is not recomputed; only its axis-unit products (TE/excitation
+    // centers, kx=ky=0 guides) follow the new unit. The viewport keeps showing the same
+    // physical time span (e.g. 0-200 ms -> 0-200000 us).
     double oldFactor = m_pulseqLoader->getTFactor();
-    QCPRange savedRange;
-    bool hasRange = false;
-    if (m_waveformDrawer && !m_waveformDrawer->getRects().isEmpty()
-        && m_waveformDrawer->getRects()[0])
-    {
-        savedRange = m_waveformDrawer->getRects()[0]->axis(QCPAxis::atBottom)->range();
-        hasRange = true;
-    }
-
-    m_pulseqLoader->ReOpenPulseqFile();
+    m_pulseqLoader->rescaleTimeUnit();
+    double newFactor = m_pulseqLoader->getTFactor();
+    if (oldFactor == 0.0 || newFactor == oldFactor)
+        return;
 
-    // Restore the viewport so the user keeps seeing the same physical time span
-    // (e.g. 0-200 ms → 0-200000 us).
-    if (hasRange && oldFactor != 0.0)
-    {
-        double newFactor = m_pulseqLoader->getTFactor();
-        double ratio = newFactor / oldFactor;
-        QCPRange newRange(savedRange.lower * ratio, savedRange.upper * ratio);
-        if (auto* ih = getInteractionHandler())
-            ih->synchronizeXAxes(newRange);
-    }
+    m_currentTrajectoryTimeInternal *= newFactor / oldFactor;
+    // A pending measurement was taken in the old unit
+    if (auto* ih = getInteractionHandler())
+        ih->exitMeasureDtMode();
 }
 
 void MainWindow::openSettings()
@@ -645,30 +665,9 @@ void MainWindow::setTrajectoryVisible(bool show)
     PulseqLoader* loader = getPulseqLoader();
     if (show)
     {
-        if (loader)
-        {
-            loader->ensureTrajectoryPrepared();
-            if (loader->needsRfUseGuessWarning())
-            {
-                Settings& s = Settings::getInstance();
-                if (s.getShowTrajectoryApproximateDialog())
-                {
-                    QMessageBox msg(this);
-                    msg.setIcon(QMessageBox::Warning);
-                    msg.setWindowTitle(tr("Trajectory Warning"));
-                    msg.setText(loader->getRfUseGuessWarning());
-                    QCheckBox* cb = new QCheckBox(tr("Do not show this warning again"), &msg);
-                    msg.setCheckBox(cb);
-                    msg.addButton(QMessageBox::Ok);
-                    msg.exec();
-                    if (cb->isChecked())
-                    {
-                        s.setShowTrajectoryApproximateDialog(false);
-                    }
-                }
-                loader->markRfUseGuessWarningShown();
-            }
-        }
+        // While the background pass is still running the warning waits for its last window
+        if (loader && loader->hasTrajectoryData())
+            showRfUseGuessWarningIfNeeded();
         refreshTrajectoryPlotData();
     }
     QList<int> sizes;
@@ -687,6 +686,49 @@ void MainWindow::setTrajectoryVisible(bool show)
     refreshTrajectoryCursor();
 }
 
+void MainWindow::showRfUseGuessWarningIfNeeded()
+{
+    PulseqLoader* loader = getPulseqLoader();
+    if (!loader || !loader->needsRfUseGuessWarning())
+        return;
+    Settings& s = Settings::getInstance();
+    if (s.getShowTrajectoryApproximateDialog())
+    {
+        QMessageBox msg(this);
+        msg.setIcon(QMessageBox::Warning);
+        msg.setWindowTitle(tr("Trajectory Warning"));
+        msg.setText(loader->getRfUseGuessWarning());
+        QCheckBox* cb = new QCheckBox(tr("Do not show this warning again"), &msg);
+        msg.setCheckBox(cb);
+        msg.addButton(QMessageBox::Ok);
+        msg.exec();
+        if (cb->isChecked())
+        {
+            s.setShowTrajectoryApproximateDialog(false);
+        }
+    }
+    loader->markRfUseGuessWarningShown();
+}
+
+void MainWindow::onTrajectoryProgress(bool finished)
+{
+    if (isTrajectoryVisible())
+    {
+        refreshTrajectoryPlotData();
+        if (finished)
+            showRfUseGuessWarningIfNeeded();
+    }
+    else
+    {
+        updateTrajectoryExportState();
+    }
+    // Excitation centers (TE guides) and k=0 crossings come from the same pass
+    if (m_waveformDrawer)
+        m_waveformDrawer->refreshTrajectoryGuides();
+    if (finished && m_trManager)
+        m_trManager->onTrajectoryReady();
+}
+
 void MainWindow::refreshTrajectoryPlotData()
 {
     if (!m_pTrajectoryCurve)
@@ -718,7 +760,7 @@ void MainWindow::refreshTrajectoryPlotData()
         return;
     }
 
-    loader->ensureTrajectoryPrepared();
+    // Shows whatever part of the trajectory has been computed so far
     const QVector<double>& kx = loader->getTrajectoryKx();
     const QVector<double>& ky = loader->getTrajectoryKy();
     const QVector<double>& t = loader->getTrajectoryTimeSec();
@@ -750,18 +792,10 @@ void MainWindow::refreshTrajectoryPlotData()
     {
         double fovMeters = 0.0;
         bool haveFov = false;
-        if (loader)
+        if (loader && loader->getSystemParameters().fovMeters > 0.0)
         {
-            auto seq = loader->getSequence();
-            if (seq)
-            {
-                std::vector<double> def = seq->GetDefinition("FOV");
-                if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0)
-                {
-                    fovMeters = def[0];
-                    haveFov = true;
-                }
-            }
+            fovMeters = loader->getSystemParameters().fovMeters;
+            haveFov = true;
         }
         if (haveFov)
         {
@@ -1054,7 +1088,8 @@ void MainWindow::refreshTrajectoryPlotData()
             m_pTrajectoryPlot->xAxis->setRange(m_trajectoryBaseXRange);
             m_pTrajectoryPlot->yAxis->setRange(m_trajectoryBaseYRange);
         }
-        m_trajectoryRangeInitialized = true;
+        // Keep refitting while the trajectory is still streaming in
+        m_trajectoryRangeInitialized = loader->hasTrajectoryData();
         return true;
     };
 
@@ -1506,18 +1541,10 @@ void MainWindow::refreshTrajectoryCursor()
         {
             double fovMeters = 0.0;
             bool haveFov = false;
-            if (loader)
+            if (loader && loader->getSystemParameters().fovMeters > 0.0)
             {
-                auto seq = loader->getSequence();
-                if (seq)
-                {
-                    std::vector<double> def = seq->GetDefinition("FOV");
-                    if (!def.empty() && std::isfinite(def[0]) && def[0] > 0.0)
-                    {
-                        fovMeters = def[0];
-                        haveFov = true;
-                    }
-                }
+                fovMeters = loader->getSystemParameters().fovMeters;
+                haveFov = true;
             }
             if (haveFov)
             {
@@ -1839,13 +1866,16 @@ void MainWindow::openFileFromCommandLine(const QString& filePath)
     // Use PulseqLoader to open the file
     if (m_pulseqLoader) {
         qDebug() << "Opening file from command line:" << filePath;
-        // Set the file path cache and load the file
-        m_pulseqLoader->setPulseqFilePathCache(filePath);
+        // Load the file; only a successful load becomes the one to reopen
         if (!m_pulseqLoader->LoadPulseqFile(filePath)) {
+            if (m_pulseqLoader->wasLastLoadCancelled())
+                return;
             qWarning() << "Failed to load file:" << filePath;
             QMessageBox::critical(this, "File Error", 
                 QString("Failed to load file:\n%1").arg(filePath));
+            return;
         }
+        m_pulseqLoader->setPulseqFilePathCache(filePath);
     } else {
         qWarning() << "PulseqLoader not available";
     }
@@ -31,6 +31,7 @@ class QDropEvent;
 class QWheelEvent;
 class QEvent;
 class QMouseEvent;
+class QCloseEvent;
 class QCommandLineParser;
 
 #define SAFE_DELETE(p) { if(p) { delete p; p = nullptr; } }
@@ -95,6 +96,8 @@ public:
     QLabel* getCoordLabel() const { return m_pCoordLabel; }
     QLabel* getVersionLabel() const { return m_pVersionLabel; }
     QProgressBar* getProgressBar() const { return m_pProgressBar; }
+    // Lock the plot/menus and show the status-bar Cancel button while a file is loading
+    void setLoadInProgress(bool loading);
 
 protected:
     // Overridden event handlers to delegate to InteractionHandler
@@ -103,12 +106,14 @@ protected:
     void wheelEvent(QWheelEvent *event) override;
     bool eventFilter(QObject* obj, QEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
+    void closeEvent(QCloseEvent* event) override;
 
 private:
     void Init();
     void setupSettingsMenu();
     void setupPlotArea(QVBoxLayout* mainLayout);
     void refreshTrajectoryPlotData();
+    void showRfUseGuessWarningIfNeeded();
     void enforceTrajectoryAspect(bool queueReplot);
     void onPlotSplitterMoved(int pos, int index);
     void scheduleTrajectoryAspectUpdate();
@@ -152,6 +157,8 @@ public:
                                         double& kzOut) const;
     void updateTrajectoryCursorTime(double internalTime);
     void onSettingsChanged();
+    // Called by the loader as trajectory windows stream in (finished: the last one arrived)
+    void onTrajectoryProgress(bool finished);
 
     // Window title helpers
     void setLoadedFileTitle(const QString& filePath);
@@ -169,6 +176,7 @@ private:
     // UI elements managed directly by MainWindow (e.g., status bar)
     QLabel* m_pVersionLabel;
     QProgressBar* m_pProgressBar;
+    QPushButton* m_pCancelLoadButton {nullptr};
     QLabel* m_pCoordLabel; // Used by InteractionHandler and TRManager
     
     // Settings dialog
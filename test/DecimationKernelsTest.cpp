@@ -0,0 +1,70 @@
+// Parity of the vectorized decimation kernels with their scalar loops
+#include <QtTest/QtTest>
+
+#include "DecimationKernels.h"
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace DecimationKernels;
+
+class DecimationKernelsTest : public QObject
+{
+    Q_OBJECT
+private:
+    // Random samples in [-1, 1]; some patterns add ties, NaN breaks or infinities
+    static std::vector<float> makeSamples(std::mt19937& rng, int n, int pattern)
+    {
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+        std::vector<float> s(n);
+        for (float& x : s) {
+            x = u(rng);
+            if (pattern == 1) x = std::round(x * 3.0f) / 3.0f;
+            if (pattern == 2 && rng() % 7 == 0) x = std::numeric_limits<float>::quiet_NaN();
+            if (pattern == 3 && rng() % 11 == 0) x = (rng() % 2 ? 1.0f : -1.0f) * std::numeric_limits<float>::infinity();
+            if (pattern == 4) x = std::numeric_limits<float>::quiet_NaN();
+        }
+        return s;
+    }
+
+private slots:
+    void test_max_triangle_area_matches_scalar()
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        for (int trial = 0; trial < 5000; ++trial) {
+            const int n = 1 + int(rng() % 200);
+            const std::vector<float> s = makeSamples(rng, n, trial % 5);
+            const int begin = int(rng() % n);
+            const int end = begin + int(rng() % (n - begin + 1));
+            const double tStart = 100.0 * u(rng), dt = 1e-3 * (1 + rng() % 5);
+            const double ax = u(rng), ay = u(rng), cx = ax + u(rng), cy = u(rng);
+            const int expected = maxTriangleArea(IsaScalar, s.data(), begin, end, tStart, dt, ax, ay, cx, cy);
+            for (int isa = IsaSse2; isa <= bestIsa(); ++isa)
+                QCOMPARE(maxTriangleArea(Isa(isa), s.data(), begin, end, tStart, dt, ax, ay, cx, cy), expected);
+        }
+    }
+
+    void test_arg_min_max_matches_scalar()
+    {
+        std::mt19937 rng(2);
+        for (int trial = 0; trial < 5000; ++trial) {
+            const int n = 1 + int(rng() % 200);
+            const std::vector<float> s = makeSamples(rng, n, trial % 5);
+            const int begin = int(rng() % n);
+            const int end = begin + int(rng() % (n - begin + 1));
+            int expectedMin = -1, expectedMax = -1;
+            argMinMax(IsaScalar, s.data(), begin, end, expectedMin, expectedMax);
+            for (int isa = IsaSse2; isa <= bestIsa(); ++isa) {
+                int iMin = -1, iMax = -1;
+                argMinMax(Isa(isa), s.data(), begin, end, iMin, iMax);
+                QCOMPARE(iMin, expectedMin);
+                QCOMPARE(iMax, expectedMax);
+            }
+        }
+    }
+};
+
+QTEST_APPLESS_MAIN(DecimationKernelsTest)
+#include "DecimationKernelsTest.moc"
@@ -0,0 +1,176 @@
+// Counter and flag values after each block, answered from the run-length label history, against
+// a plain block-by-block replay of the LABELSET/LABELINC events, with eager and lazy decoding
+#include <QtTest/QtTest>
+#include <QtWidgets>
+
+#include "mainwindow.h"
+#include "PulseqLoader.h"
+#include "Settings.h"
+#include <array>
+#include <vector>
+
+class LabelHistoryTest : public QObject
+{
+    Q_OBJECT
+private:
+    // writeEpiRS_label.seq has 434 blocks; repeated 40 times the sequence spans 17360 blocks,
+    // past the first 16384-block window of lazy decoding
+    static const int kRepeats = 40;
+    static const int kLazyWindowBlocks = 16384;
+
+    QTemporaryDir m_dir;
+    QString m_seqPath;
+    std::vector<std::array<int, NUM_LABELS>> m_counters; // replayed values after each block
+    std::vector<std::array<bool, NUM_FLAGS>> m_flags;
+    bool m_originalLazy {false};
+    bool m_originalCacheEnabled {true};
+
+    static QString findSeqFile(const QString& name)
+    {
+        QString path = QCoreApplication::applicationDirPath() + "/../test/seq_files/" + name;
+        if (!QFile::exists(path))
+            path = QDir(QCoreApplication::applicationDirPath() + "/../../").absoluteFilePath("test/seq_files/" + name);
+        return path;
+    }
+
+    // The [BLOCKS] rows repeated 'repeats' times with running block IDs. The [SIGNATURE] section
+    // is dropped since it no longer matches.
+    static QByteArray repeatBlocks(const QByteArray& text, int repeats)
+    {
+        const QList<QByteArray> lines = text.split('\n');
+        QByteArray out;
+        int i = 0;
+        for (; i < lines.size() && lines[i].trimmed() != "[BLOCKS]"; ++i)
+            out += lines[i] + '\n';
+        if (i == lines.size())
+            return QByteArray();
+        out += "[BLOCKS]\n";
+        QList<QByteArray> rows;
+        for (++i; i < lines.size() && !lines[i].trimmed().isEmpty() && !lines[i].trimmed().startsWith('['); ++i)
+            rows.append(lines[i].simplified());
+        int id = 0;
+        for (int r = 0; r < repeats; ++r)
+        {
+            for (const QByteArray& row : rows)
+            {
+                QList<QByteArray> fields = row.split(' ');
+                fields[0] = QByteArray::number(++id);
+                out += fields.join(' ') + '\n';
+            }
+        }
+        for (; i < lines.size() && lines[i].trimmed() != "[SIGNATURE]"; ++i)
+            out += lines[i] + '\n';
+        return out;
+    }
+
+    void checkAgainstReplay(bool lazy)
+    {
+        Settings::getInstance().setLazyBlockDecoding(lazy);
+        MainWindow w;
+        PulseqLoader* loader = w.getPulseqLoader();
+        loader->setSilentMode(true);
+        QVERIFY(loader->LoadPulseqFile(m_seqPath));
+        QCOMPARE(loader->isLazyDecoding(), lazy);
+
+        const int nBlocks = int(m_counters.size());
+        QCOMPARE(loader->getLabelHistory().blockCount, nBlocks);
+        for (int b = 0; b < nBlocks; ++b)
+        {
+            for (int id = 0; id < NUM_LABELS; ++id)
+            {
+                int value = -1;
+                QVERIFY(loader->getCounterValueAfterBlock(b, id, value));
+                if (value != m_counters[b][id])
+                    QFAIL(qPrintable(QString("counter %1 after block %2: %3, replay %4").arg(id).arg(b).arg(value).arg(m_counters[b][id])));
+            }
+            for (int id = 0; id < NUM_FLAGS; ++id)
+            {
+                bool value = false;
+                QVERIFY(loader->getFlagValueAfterBlock(b, id, value));
+                if (value != m_flags[b][id])
+                    QFAIL(qPrintable(QString("flag %1 after block %2: %3, replay %4").arg(id).arg(b).arg(value).arg(m_flags[b][id])));
+            }
+        }
+
+        int value = 0;
+        bool flag = false;
+        QVERIFY(!loader->getCounterValueAfterBlock(nBlocks, 0, value));
+        QVERIFY(!loader->getFlagValueAfterBlock(-1, 0, flag));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        Settings& settings = Settings::getInstance();
+        m_originalLazy = settings.getLazyBlockDecoding();
+        m_originalCacheEnabled = settings.getSequenceCacheEnabled();
+        settings.setSequenceCacheEnabled(false);
+
+        const QString source = findSeqFile("writeEpiRS_label.seq");
+        QVERIFY2(QFile::exists(source), "Test sequence file not found");
+        QFile in(source);
+        QVERIFY(in.open(QIODevice::ReadOnly));
+        const QByteArray text = repeatBlocks(in.readAll(), kRepeats);
+        QVERIFY(!text.isEmpty());
+        QVERIFY(m_dir.isValid());
+        m_seqPath = m_dir.filePath("writeEpiRS_label_repeated.seq");
+        QFile out(m_seqPath);
+        QVERIFY(out.open(QIODevice::WriteOnly));
+        QCOMPARE(out.write(text), qint64(text.size()));
+        out.close();
+
+        // Reference: decode every block in order and apply its label events (LABELSET, then LABELINC)
+        ExternalSequence seq;
+        seq.SetSignatureCheck(false);
+        QVERIFY(seq.load_from_memory(text.constData(), std::size_t(text.size())));
+        const int nBlocks = seq.GetNumberOfBlocks();
+        QVERIFY(nBlocks > kLazyWindowBlocks);
+        std::array<int, NUM_LABELS> counters {};
+        std::array<bool, NUM_FLAGS> flags {};
+        int labelBlocksPastWindow = 0;
+        m_counters.resize(nBlocks);
+        m_flags.resize(nBlocks);
+        for (int b = 0; b < nBlocks; ++b)
+        {
+            SeqBlock block;
+            seq.GetBlock(b, &block);
+            QVERIFY(seq.decodeBlock(&block));
+            if (block.isLabel())
+            {
+                for (const LabelEvent& e : block.GetLabelSetEvents())
+                {
+                    if (e.numVal.first >= 0 && e.numVal.first < NUM_LABELS) counters[e.numVal.first] = e.numVal.second;
+                    if (e.flagVal.first >= 0 && e.flagVal.first < NUM_FLAGS) flags[e.flagVal.first] = e.flagVal.second;
+                }
+                for (const LabelEvent& e : block.GetLabelIncEvents())
+                {
+                    if (e.numVal.first >= 0 && e.numVal.first < NUM_LABELS) counters[e.numVal.first] += e.numVal.second;
+                }
+                if (b >= kLazyWindowBlocks) ++labelBlocksPastWindow;
+            }
+            m_counters[b] = counters;
+            m_flags[b] = flags;
+        }
+        QVERIFY(labelBlocksPastWindow > 0);
+    }
+
+    void cleanupTestCase()
+    {
+        Settings& settings = Settings::getInstance();
+        settings.setLazyBlockDecoding(m_originalLazy);
+        settings.setSequenceCacheEnabled(m_originalCacheEnabled);
+    }
+
+    void test_eager_matches_replay()
+    {
+        checkAgainstReplay(false);
+    }
+
+    void test_lazy_matches_replay()
+    {
+        checkAgainstReplay(true);
+    }
+};
+
+QTEST_MAIN(LabelHistoryTest)
+#include "LabelHistoryTest.moc"
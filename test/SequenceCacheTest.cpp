@@ -0,0 +1,243 @@
+// On-disk sequence cache: a reopen from the cache must match a cold parse, and truncated or
+// foreign entries must be rejected (and fall back to parsing)
+#include <QtTest/QtTest>
+#include <QtWidgets>
+
+#include "mainwindow.h"
+#include "PulseqLoader.h"
+#include "SequenceCache.h"
+#include "Settings.h"
+#include <cstring>
+#include <string>
+
+class SequenceCacheTest : public QObject
+{
+    Q_OBJECT
+private:
+    // What a load leaves behind that the cache is responsible for
+    struct LoadedState
+    {
+        QVector<double> blockEdges;
+        std::string snapshot; // definitions, block table and every event library
+        QPair<double, double> rfRange;
+        QPair<double, double> gradRange[3];
+        bool signatureVerified {false};
+    };
+
+    QTemporaryDir m_dir;
+    QString m_seqPath;
+    bool m_originalCacheEnabled {true};
+    bool m_originalLazy {false};
+
+    static QString findSeqFile(const QString& name)
+    {
+        QString path = QCoreApplication::applicationDirPath() + "/../test/seq_files/" + name;
+        if (!QFile::exists(path))
+            path = QDir(QCoreApplication::applicationDirPath() + "/../../").absoluteFilePath("test/seq_files/" + name);
+        return path;
+    }
+
+    static bool load(const QString& path, LoadedState& state)
+    {
+        MainWindow w;
+        PulseqLoader* loader = w.getPulseqLoader();
+        loader->setSilentMode(true);
+        if (!loader->LoadPulseqFile(path))
+            return false;
+        state.blockEdges = loader->getBlockEdges();
+        state.snapshot.clear();
+        loader->getSequence()->saveSnapshot(state.snapshot);
+        state.rfRange = loader->getRfGlobalRangeAmp();
+        for (int c = 0; c < 3; ++c)
+            state.gradRange[c] = loader->getGradGlobalRange(c);
+        state.signatureVerified = loader->getSequence()->isSignatureCheckSucceeded();
+        return true;
+    }
+
+    static void compare(const LoadedState& cold, const LoadedState& cached)
+    {
+        QCOMPARE(cached.blockEdges, cold.blockEdges);
+        QVERIFY(cached.snapshot == cold.snapshot);
+        QCOMPARE(cached.rfRange, cold.rfRange);
+        for (int c = 0; c < 3; ++c)
+            QCOMPARE(cached.gradRange[c], cold.gradRange[c]);
+        QCOMPARE(cached.signatureVerified, cold.signatureVerified);
+    }
+
+    SequenceCache::Key key() const
+    {
+        QFile file(m_seqPath);
+        if (!file.open(QIODevice::ReadOnly))
+            return SequenceCache::Key();
+        const QByteArray text = file.readAll();
+        return SequenceCache::makeKey(m_seqPath, text.constData(), std::size_t(text.size()));
+    }
+
+    static QByteArray readEntry(const QString& path)
+    {
+        QFile file(path);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    }
+
+    static void writeEntry(const QString& path, const QByteArray& bytes)
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QCOMPARE(file.write(bytes), qint64(bytes.size()));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        // Keep the cache entries written here out of the user's cache directory
+        QStandardPaths::setTestModeEnabled(true);
+        SequenceCache::clear();
+
+        Settings& settings = Settings::getInstance();
+        m_originalCacheEnabled = settings.getSequenceCacheEnabled();
+        m_originalLazy = settings.getLazyBlockDecoding();
+        settings.setSequenceCacheEnabled(true);
+        settings.setLazyBlockDecoding(false);
+
+        // Work on a copy, so the entry belongs to a path only this test uses
+        const QString source = findSeqFile("writeEpi.seq");
+        QVERIFY2(QFile::exists(source), "Test sequence file not found");
+        QVERIFY(m_dir.isValid());
+        m_seqPath = m_dir.filePath("writeEpi.seq");
+        QVERIFY(QFile::copy(source, m_seqPath));
+    }
+
+    void cleanupTestCase()
+    {
+        SequenceCache::clear();
+        Settings& settings = Settings::getInstance();
+        settings.setSequenceCacheEnabled(m_originalCacheEnabled);
+        settings.setLazyBlockDecoding(m_originalLazy);
+    }
+
+    void init()
+    {
+        SequenceCache::clear();
+    }
+
+    void test_cached_load_matches_cold_load()
+    {
+        LoadedState cold;
+        QVERIFY(load(m_seqPath, cold));
+        QVERIFY(QFile::exists(SequenceCache::entryPath(m_seqPath)));
+
+        // The entry itself restores the same sequence
+        {
+            SequenceCache cache;
+            QVERIFY(cache.open(key()));
+            std::size_t size = 0;
+            const char* snapshot = cache.section(SequenceCache::kSequenceSection, &size);
+            QVERIFY(snapshot);
+            ExternalSequence restored;
+            QVERIFY(restored.loadSnapshot(snapshot, size));
+            std::string resaved;
+            restored.saveSnapshot(resaved);
+            QVERIFY(resaved == cold.snapshot);
+            // The verdict of the signature check is never restored
+            QVERIFY(!restored.isSignatureCheckSucceeded());
+        }
+
+        LoadedState cached;
+        QVERIFY(load(m_seqPath, cached));
+        compare(cold, cached);
+    }
+
+    void test_truncated_entry_is_rejected()
+    {
+        LoadedState cold;
+        QVERIFY(load(m_seqPath, cold));
+        const QString entry = SequenceCache::entryPath(m_seqPath);
+        const QByteArray bytes = readEntry(entry);
+        QVERIFY(!bytes.isEmpty());
+
+        for (const qsizetype cut : { qsizetype(0), qsizetype(16), bytes.size() / 4, bytes.size() / 2, bytes.size() * 3 / 4 })
+        {
+            writeEntry(entry, bytes.left(cut));
+            SequenceCache cache;
+            QVERIFY2(!cache.open(key()), qPrintable(QString("entry cut at %1 bytes was accepted").arg(cut)));
+        }
+
+        // A snapshot section cut short anywhere is rejected as well
+        std::size_t size = 0;
+        {
+            writeEntry(entry, bytes);
+            SequenceCache cache;
+            QVERIFY(cache.open(key()));
+            const char* snapshot = cache.section(SequenceCache::kSequenceSection, &size);
+            QVERIFY(snapshot);
+            for (std::size_t cut = 0; cut < size; cut += 1 + size / 64)
+            {
+                ExternalSequence restored;
+                QVERIFY2(!restored.loadSnapshot(snapshot, cut), qPrintable(QString("snapshot cut at %1 bytes was accepted").arg(cut)));
+            }
+        }
+
+        // The loader falls back to parsing and rewrites the entry
+        writeEntry(entry, bytes.left(bytes.size() / 2));
+        LoadedState reparsed;
+        QVERIFY(load(m_seqPath, reparsed));
+        compare(cold, reparsed);
+        SequenceCache cache;
+        QVERIFY(cache.open(key()));
+    }
+
+    void test_wrong_version_entry_is_rejected()
+    {
+        LoadedState cold;
+        QVERIFY(load(m_seqPath, cold));
+        const QString entry = SequenceCache::entryPath(m_seqPath);
+        const QByteArray bytes = readEntry(entry);
+        QVERIFY(bytes.size() > 48);
+
+        // Entry format version (the quint32 after the 8-byte magic)
+        QByteArray patched = bytes;
+        quint32 formatVersion = 0;
+        memcpy(&formatVersion, patched.constData() + 8, sizeof(formatVersion));
+        formatVersion += 1;
+        memcpy(patched.data() + 8, &formatVersion, sizeof(formatVersion));
+        writeEntry(entry, patched);
+        {
+            SequenceCache cache;
+            QVERIFY(!cache.open(key()));
+        }
+
+        // Application version (first byte after the 48-byte fixed header)
+        patched = bytes;
+        patched[48] = char(patched[48] ^ 0x01);
+        writeEntry(entry, patched);
+        {
+            SequenceCache cache;
+            QVERIFY(!cache.open(key()));
+        }
+
+        // Snapshot format version (the uint32_t after the length-prefixed 8-byte magic)
+        writeEntry(entry, bytes);
+        {
+            SequenceCache cache;
+            QVERIFY(cache.open(key()));
+            std::size_t size = 0;
+            const char* snapshot = cache.section(SequenceCache::kSequenceSection, &size);
+            QVERIFY(snapshot && size > 20);
+            std::string copy(snapshot, size);
+            copy[16] = char(copy[16] ^ 0x01);
+            ExternalSequence restored;
+            QVERIFY(!restored.loadSnapshot(copy.data(), copy.size()));
+        }
+
+        // A rejected entry costs only the speed-up
+        patched = bytes;
+        memcpy(patched.data() + 8, &formatVersion, sizeof(formatVersion));
+        writeEntry(entry, patched);
+        LoadedState reparsed;
+        QVERIFY(load(m_seqPath, reparsed));
+        compare(cold, reparsed);
+    }
+};
+
+QTEST_MAIN(SequenceCacheTest)
+#include "SequenceCacheTest.moc"